@@ -4,7 +4,26 @@ Address::Address(int32_t userId) :
 userId(userId) {
 }
 
+Address::Address(const Address& address) :
+userId(address.userId),
+totalBalance(address.totalBalance),
+numInOrder(address.numInOrder) {
+}
+
+Address& Address::operator=(const Address& address) {
+	userId = address.userId;
+	totalBalance = address.totalBalance;
+	numInOrder = address.numInOrder;
+	totals = nullptr;
+	modified = false;
+	return *this;
+}
+
 void Address::SetTotalBalance(int64_t balance) {
+	if (totals) {
+		MarkModified();
+		totals->totalBalance += balance - totalBalance;
+	}
 	totalBalance = balance;
 }
 
@@ -17,14 +36,26 @@ int64_t Address::GetTotalBalance() const {
 }
 
 void Address::AddToTotalBalance(int64_t amount) {
+	if (totals) {
+		MarkModified();
+		totals->totalBalance += amount;
+	}
 	totalBalance += amount;
 }
 
 void Address::RemoveFromTotalBalance(int64_t amount) {
+	if (totals) {
+		MarkModified();
+		totals->totalBalance -= amount;
+	}
 	totalBalance -= amount;
 }
 
 void Address::SetInOrder(int64_t inOrder) {
+	if (totals) {
+		MarkModified();
+		AddToTotalInOrder(inOrder - numInOrder);
+	}
 	numInOrder = inOrder;
 }
 
@@ -33,10 +64,18 @@ int64_t Address::GetInOrder() const {
 }
 
 void Address::AddToInOrder(int64_t amount) {
+	if (totals) {
+		MarkModified();
+		AddToTotalInOrder(amount);
+	}
 	numInOrder += amount;
 }
 
 void Address::RemoveFromInOrder(int64_t amount) {
+	if (totals) {
+		MarkModified();
+		AddToTotalInOrder(-amount);
+	}
 	numInOrder -= amount;
 }
 
@@ -48,3 +87,29 @@ bool Address::operator==(const Address& address) const {
 	return (userId == address.userId && totalBalance == address.totalBalance
 	&& numInOrder == address.numInOrder);
 }
+
+void Address::AddToTotalInOrder(int64_t amount) {
+	totals->inOrder += amount;
+	if (totals->allInOrder) {
+		*totals->allInOrder += amount;
+	}
+}
+
+void Address::SetTotals(AddressTotals* totals) {
+	this->totals = totals;
+}
+
+bool Address::IsModified() const {
+	return modified;
+}
+
+void Address::MarkModified() {
+	if (totals && !modified) {
+		modified = true;
+		totals->modifiedUserIds.push_back(userId);
+	}
+}
+
+void Address::ClearModified() {
+	modified = false;
+}
@@ -3,9 +3,22 @@
 #include "serializer_defines.h"
 
 #include <cstdint>
+#include <vector>
 
 SERIALIZE_HEADER(Address);
 
+// Running totals over every address in a wallet
+struct AddressTotals {
+	int64_t totalBalance = 0;
+	int64_t inOrder = 0;
+
+	// In order summed over every wallet of the wallet manager, if the wallet is in one
+	int64_t* allInOrder = nullptr;
+
+	// Users whose address has changed since Wallet::TakeModifiedAddresses(), each only once
+	std::vector<int32_t> modifiedUserIds;
+};
+
 class Address {
 public:
 	SERIALIZE_FRIEND(Address);
@@ -13,6 +26,13 @@ public:
 	Address() = default; // For archiving
 	Address(int32_t userId);
 
+	// Copies are detached from the wallet totals, moves (i.e inside the wallet) keep them.
+	// Assigning doesn't update any totals, the wallet rebinds addresses it inserts.
+	Address(const Address& address);
+	Address& operator=(const Address& address);
+	Address(Address&& address) noexcept = default;
+	Address& operator=(Address&& address) noexcept = default;
+
 	void SetTotalBalance(int64_t balance);
 	int64_t GetTotalBalance() const;
 	void AddToTotalBalance(int64_t amount);
@@ -30,8 +50,20 @@ public:
 
 	bool operator==(const Address& address) const;
 
+	// The wallet which owns this address sets this so that its totals are kept up to date
+	void SetTotals(AddressTotals* totals);
+
+	// Any change made while attached to a wallet marks it, copies start unmodified
+	bool IsModified() const;
+	void MarkModified();
+	void ClearModified();
+
 private:
 	int32_t userId = 0;
 	int64_t totalBalance = 0;
 	int64_t numInOrder = 0;
+	AddressTotals* totals = nullptr;
+	bool modified = false;
+
+	void AddToTotalInOrder(int64_t amount);
 };
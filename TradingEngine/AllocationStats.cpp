@@ -0,0 +1,180 @@
+#include "AllocationStats.h"
+
+#include <cstdlib>
+#include <new>
+
+const char* ToString(AllocationSource source) {
+	switch (source) {
+		case AllocationSource::Heap:
+			return "Heap";
+		case AllocationSource::NodePool:
+			return "NodePool";
+		case AllocationSource::NodePoolGrowth:
+			return "NodePoolGrowth";
+		case AllocationSource::PoolMemoryGrowth:
+			return "PoolMemoryGrowth";
+		default:
+			return "Unknown";
+	}
+}
+
+void AllocationStats::Add(MessageType messageType, const AllocationCounts& before) {
+	auto index = static_cast<int>(messageType);
+	if (index < 0 || index >= numMessageTypes) {
+		return;
+	}
+
+	auto& messageStats = stats[index];
+	++messageStats.numMessages;
+	for (size_t i = 0; i < before.size(); ++i) {
+		messageStats.counts[i].allocations += allocationCounts[i].allocations - before[i].allocations;
+		messageStats.counts[i].bytes += allocationCounts[i].bytes - before[i].bytes;
+	}
+}
+
+const MessageAllocationStats* AllocationStats::Get(MessageType messageType) const {
+	auto index = static_cast<int>(messageType);
+	if (index < 0 || index >= numMessageTypes) {
+		return nullptr;
+	}
+
+	return &stats[index];
+}
+
+void AllocationStats::Reset() {
+	stats.fill({});
+}
+
+void AllocationStats::Dump(std::ostream& os) const {
+	for (int messageType = 0; messageType < numMessageTypes; ++messageType) {
+		const auto& messageStats = stats[messageType];
+		if (messageStats.numMessages == 0) {
+			continue;
+		}
+
+		os << ToString(static_cast<MessageType>(messageType)) << " messages=" << messageStats.numMessages;
+		for (size_t source = 0; source < messageStats.counts.size(); ++source) {
+			const auto& allocationCount = messageStats.counts[source];
+			os << " " << ToString(static_cast<AllocationSource>(source)) << "="
+			   << static_cast<double>(allocationCount.allocations) / messageStats.numMessages << "/"
+			   << static_cast<double>(allocationCount.bytes) / messageStats.numMessages << "B";
+		}
+		os << "\n";
+	}
+}
+
+#ifdef TRADING_ENGINE_ALLOCATION_STATS
+namespace {
+
+// aligned_alloc needs the size to be a multiple of the alignment
+void* AlignedAlloc(std::size_t size, std::align_val_t alignment) noexcept {
+	auto align = static_cast<std::size_t>(alignment);
+	auto alignedSize = size ? (size + align - 1) / align * align : align;
+#ifdef _MSC_VER
+	return _aligned_malloc(alignedSize, align);
+#else
+	return std::aligned_alloc(align, alignedSize);
+#endif
+}
+
+void AlignedFree(void* ptr) noexcept {
+#ifdef _MSC_VER
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+}
+
+// Replacing these counts every heap allocation in the process, including the over-aligned ones
+// (i.e MarketBook and the NodePool slabs).
+void* operator new(std::size_t size) {
+	CountAllocation(AllocationSource::Heap, size);
+	if (auto ptr = std::malloc(size ? size : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+	return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	CountAllocation(AllocationSource::Heap, size);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& nothrow) noexcept {
+	return ::operator new(size, nothrow);
+}
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+	std::free(ptr);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	CountAllocation(AllocationSource::Heap, size);
+	if (auto ptr = AlignedAlloc(size, alignment)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+	return ::operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	CountAllocation(AllocationSource::Heap, size);
+	return AlignedAlloc(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& nothrow) noexcept {
+	return ::operator new(size, alignment, nothrow);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+	AlignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+	AlignedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+	AlignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+	AlignedFree(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+	AlignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+	AlignedFree(ptr);
+}
+#endif
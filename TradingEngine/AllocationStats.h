@@ -0,0 +1,99 @@
+#pragma once
+
+#include "MessageType.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Counts allocations made while processing each message, compiled in with
+// TRADING_ENGINE_ALLOCATION_STATS. This also replaces the global operator new/delete so that
+// every heap allocation (Simulator containers, listener operations, output messages..) is seen.
+// When it is not defined nothing is counted and ALLOCATION_COUNTER expands to nothing.
+#ifdef TRADING_ENGINE_ALLOCATION_STATS
+constexpr bool allocationStatsEnabled = true;
+#else
+constexpr bool allocationStatsEnabled = false;
+#endif
+
+enum class AllocationSource {
+	Heap, // Global operator new, this includes the pool growth below
+	NodePool, // Nodes handed out by NodePool
+	NodePoolGrowth, // Slabs NodePool requested
+	PoolMemoryGrowth, // Pages mapped by the PageArena after its capacity was used up
+	Count
+};
+
+const char* ToString(AllocationSource source);
+
+struct AllocationCount {
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+};
+
+using AllocationCounts = std::array<AllocationCount, static_cast<int>(AllocationSource::Count)>;
+
+// Running totals for this thread
+inline thread_local AllocationCounts allocationCounts{};
+
+inline void CountAllocation(AllocationSource source, size_t bytes) {
+	if constexpr (allocationStatsEnabled) {
+		auto& allocationCount = allocationCounts[static_cast<int>(source)];
+		++allocationCount.allocations;
+		allocationCount.bytes += bytes;
+	}
+}
+
+struct MessageAllocationStats {
+	uint64_t numMessages = 0;
+	AllocationCounts counts{};
+};
+
+// Allocations attributed to each input message type. It does not allocate itself.
+class AllocationStats {
+public:
+	// Adds everything allocated on this thread since "before" was taken
+	void Add(MessageType messageType, const AllocationCounts& before);
+
+	// nullptr for message types which can't be input
+	const MessageAllocationStats* Get(MessageType messageType) const;
+
+	void Reset();
+
+	// A line per message type which has been processed, with the average per message
+	void Dump(std::ostream& os) const;
+
+private:
+	constexpr static int numMessageTypes = static_cast<int>(MessageType::MassQuote) + 1;
+	std::array<MessageAllocationStats, numMessageTypes> stats{};
+};
+
+// Attributes the allocations made until it goes out of scope to the message type
+class ScopedAllocationCounter {
+public:
+	ScopedAllocationCounter(AllocationStats* stats, MessageType messageType) :
+	stats(stats),
+	messageType(messageType),
+	before(allocationCounts) {
+	}
+
+	~ScopedAllocationCounter() {
+		stats->Add(messageType, before);
+	}
+
+	ScopedAllocationCounter(const ScopedAllocationCounter&) = delete;
+	ScopedAllocationCounter& operator=(const ScopedAllocationCounter&) = delete;
+
+private:
+	AllocationStats* stats;
+	MessageType messageType;
+	AllocationCounts before;
+};
+
+#ifdef TRADING_ENGINE_ALLOCATION_STATS
+#define ALLOCATION_COUNTER(stats, messageType) \
+	ScopedAllocationCounter allocationCounter { stats, messageType }
+#else
+#define ALLOCATION_COUNTER(stats, messageType)
+#endif
@@ -0,0 +1,108 @@
+#include "BackgroundSnapshot.h"
+
+#include "Error.h"
+#include "PlatformSpecific/fork_process.h"
+#include "PlatformSpecific/segment_file.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace {
+// Returns the exit code for the child
+int WriteSnapshot(const std::string& path, const BackgroundSnapshot::Writer& writer) {
+	auto tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			return 1;
+		}
+
+		writer(file);
+		file.flush();
+		if (!file) {
+			return 1;
+		}
+	}
+
+	// It only replaces the last snapshot once it is on disk, and the rename only lasts once its
+	// directory is
+	if (!ps::SyncFile(tempPath) || std::rename(tempPath.c_str(), path.c_str()) != 0 || !ps::SyncDirectory(path)) {
+		return 1;
+	}
+	return 0;
+}
+}
+
+BackgroundSnapshot::~BackgroundSnapshot() {
+	if (IsInProgress()) {
+		Wait();
+	}
+}
+
+void BackgroundSnapshot::Start(const std::string& path, const Writer& writer) {
+	if (IsInProgress()) {
+		throw Error(Error::Type::SnapshotInProgress, "The last snapshot is still being written");
+	}
+
+	if (ps::ForkGuard::GetNumHeld() != 0) {
+		throw Error(Error::Type::SnapshotFailed, "Threads sharing the state being written are still running");
+	}
+
+	stats = SnapshotStats();
+	started = std::chrono::steady_clock::now();
+	pid = ps::ForkProcess([&path, &writer]() {
+		return WriteSnapshot(path, writer);
+	});
+
+	stats.stall = std::chrono::steady_clock::now() - started;
+	if (pid == -1) {
+		// Can't be done in the background, so write it now
+		int exitCode = 1;
+		try {
+			exitCode = WriteSnapshot(path, writer);
+		} catch (...) {
+		}
+
+		Finish(exitCode);
+		stats.stall = stats.duration;
+		if (!stats.succeeded) {
+			throw Error(Error::Type::SnapshotFailed, "Could not write the snapshot");
+		}
+	}
+}
+
+bool BackgroundSnapshot::Poll() {
+	if (!IsInProgress()) {
+		return false;
+	}
+
+	int exitCode;
+	if (ps::ReapProcess(pid, false, &exitCode)) {
+		Finish(exitCode);
+		return false;
+	}
+	return true;
+}
+
+const SnapshotStats& BackgroundSnapshot::Wait() {
+	if (IsInProgress()) {
+		int exitCode;
+		ps::ReapProcess(pid, true, &exitCode);
+		Finish(exitCode);
+	}
+	return stats;
+}
+
+bool BackgroundSnapshot::IsInProgress() const {
+	return (pid != -1);
+}
+
+const SnapshotStats& BackgroundSnapshot::GetLastStats() const {
+	return stats;
+}
+
+void BackgroundSnapshot::Finish(int exitCode) {
+	pid = -1;
+	stats.duration = std::chrono::steady_clock::now() - started;
+	stats.succeeded = (exitCode == 0);
+}
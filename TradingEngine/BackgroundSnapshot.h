@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+
+struct SnapshotStats {
+	std::chrono::nanoseconds stall{ 0 }; // How long the matching thread was held up for
+	std::chrono::nanoseconds duration{ 0 }; // Until the snapshot was written, as seen by Poll()/Wait()
+	bool succeeded = false;
+};
+
+// Writes a point-in-time snapshot (e.g the TradingEngine) to a file while processing carries
+// on. The process is forked and the child writes the copy-on-write image of memory as it was at
+// that instant, so the matching thread is only stalled for the fork itself. Where processes
+// can't be forked the snapshot is written before Start() returns.
+//
+// Only the thread calling Start() is carried over into the child, so the writer must not use
+// anything another thread could have locked or be half way through changing. Threads which share
+// the engine's state hold a ps::ForkGuard, and Start() refuses to fork while any are held: stop
+// the market warm-up first (MarketManager::StopWarmUp()). Any markets it hadn't got to are then
+// hydrated by the child as it writes them (see serialize(TradingEngine)). The journal's writer,
+// the ring consumers and the replication sender's thread can carry on, the child never uses them.
+//
+// The file is written to "<path>.tmp", synced to disk and renamed (and the directory synced), so
+// a snapshot is either all there or not at all. Only one snapshot can be in progress at a time.
+class BackgroundSnapshot {
+public:
+	using Writer = std::function<void(std::ostream&)>;
+
+	BackgroundSnapshot() = default;
+	BackgroundSnapshot(const BackgroundSnapshot&) = delete;
+	BackgroundSnapshot& operator=(const BackgroundSnapshot&) = delete;
+	~BackgroundSnapshot(); // Waits for one in progress
+
+	// The writer runs in the child, anything it refers to is seen as it is now.
+	// Throws Error::Type::SnapshotInProgress or SnapshotFailed (if it can't be started, or a
+	// ps::ForkGuard is held).
+	void Start(const std::string& path, const Writer& writer);
+
+	// e.g Start<boost::archive::binary_oarchive>(path, tradingEngine)
+	template <class OArchive, class T>
+	void Start(const std::string& path, const T& t) {
+		Start(path, [&t](std::ostream& os) {
+			OArchive archive(os);
+			archive << t;
+		});
+	}
+
+	// Doesn't block, true while the snapshot is still being written
+	bool Poll();
+	const SnapshotStats& Wait();
+
+	bool IsInProgress() const;
+	const SnapshotStats& GetLastStats() const;
+
+private:
+	int pid = -1;
+	std::chrono::steady_clock::time_point started;
+	SnapshotStats stats;
+
+	void Finish(int exitCode);
+};
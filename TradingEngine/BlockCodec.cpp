@@ -0,0 +1,159 @@
+#include "BlockCodec.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+constexpr size_t minMatch = 4;
+constexpr size_t lastLiterals = 5; // The last bytes are always literals, as in LZ4
+constexpr size_t minMatchStart = 12; // No match starts closer than this to the end
+constexpr size_t maxOffset = 65535;
+constexpr int hashBits = 12;
+
+uint32_t Read32(const char* data) {
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+uint32_t Hash(uint32_t sequence) {
+	return (sequence * 2654435761u) >> (32 - hashBits);
+}
+
+// Lengths of 15 or more carry on in the following bytes, 255 at a time
+void AppendLength(size_t length, std::string* out) {
+	for (length -= 15; length >= 255; length -= 255) {
+		out->push_back(static_cast<char>(255));
+	}
+	out->push_back(static_cast<char>(length));
+}
+
+void AppendSequence(const char* literals, size_t numLiterals, size_t offset, size_t matchLength, std::string* out) {
+	auto matchCode = (matchLength > 0) ? matchLength - minMatch : 0;
+	auto token = ((numLiterals < 15 ? numLiterals : 15) << 4) | (matchCode < 15 ? matchCode : 15);
+	out->push_back(static_cast<char>(token));
+	if (numLiterals >= 15) {
+		AppendLength(numLiterals, out);
+	}
+	out->append(literals, numLiterals);
+
+	if (matchLength > 0) {
+		out->push_back(static_cast<char>(offset & 0xFF));
+		out->push_back(static_cast<char>(offset >> 8));
+		if (matchCode >= 15) {
+			AppendLength(matchCode, out);
+		}
+	}
+}
+
+bool ReadLength(const uint8_t*& in, const uint8_t* end, size_t* length) {
+	if (*length != 15) {
+		return true;
+	}
+	while (true) {
+		if (in == end) {
+			return false;
+		}
+		auto byte = *in++;
+		*length += byte;
+		if (byte != 255) {
+			return true;
+		}
+	}
+}
+}
+
+void CompressBlock(std::string_view data, std::string* out) {
+	auto begin = data.data();
+	auto size = data.size();
+	size_t anchor = 0;
+
+	if (size > minMatchStart) {
+		std::vector<uint32_t> table(size_t(1) << hashBits, UINT32_MAX);
+		auto matchLimit = size - minMatchStart;
+		size_t position = 0;
+		while (position < matchLimit) {
+			auto sequence = Read32(begin + position);
+			auto& entry = table[Hash(sequence)];
+			auto candidate = entry;
+			entry = static_cast<uint32_t>(position);
+
+			if (candidate == UINT32_MAX || position - candidate > maxOffset || Read32(begin + candidate) != sequence) {
+				++position;
+				continue;
+			}
+
+			auto length = minMatch;
+			while (position + length < size - lastLiterals && begin[candidate + length] == begin[position + length]) {
+				++length;
+			}
+
+			AppendSequence(begin + anchor, position - anchor, position - candidate, length, out);
+			position += length;
+			anchor = position;
+		}
+	}
+
+	AppendSequence(begin + anchor, size - anchor, 0, 0, out);
+}
+
+bool DecompressBlock(std::string_view data, size_t rawSize, std::string* out) {
+	auto in = reinterpret_cast<const uint8_t*>(data.data());
+	auto end = in + data.size();
+	auto start = out->size();
+	out->resize(start + rawSize);
+	auto output = out->data() + start;
+	size_t written = 0;
+
+	auto fail = [out, start]() {
+		out->resize(start);
+		return false;
+	};
+
+	while (in < end) {
+		auto token = *in++;
+		size_t numLiterals = token >> 4;
+		if (!ReadLength(in, end, &numLiterals) || numLiterals > static_cast<size_t>(end - in) || numLiterals > rawSize - written) {
+			return fail();
+		}
+		std::memcpy(output + written, in, numLiterals);
+		in += numLiterals;
+		written += numLiterals;
+
+		// The last sequence has no match
+		if (in == end) {
+			break;
+		}
+
+		if (end - in < 2) {
+			return fail();
+		}
+		size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		size_t matchLength = token & 0xF;
+		if (!ReadLength(in, end, &matchLength)) {
+			return fail();
+		}
+		matchLength += minMatch;
+		if (offset == 0 || offset > written || matchLength > rawSize - written) {
+			return fail();
+		}
+
+		// Byte at a time when the match overlaps what it is copying (i.e a run of one byte)
+		auto from = output + written - offset;
+		if (offset >= matchLength) {
+			std::memcpy(output + written, from, matchLength);
+		} else {
+			for (size_t i = 0; i < matchLength; ++i) {
+				output[written + i] = from[i];
+			}
+		}
+		written += matchLength;
+	}
+
+	if (written != rawSize) {
+		return fail();
+	}
+	return true;
+}
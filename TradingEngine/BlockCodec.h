@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// A byte oriented LZ77 codec in the LZ4 block format: a token holding the literal and match
+// lengths, the literals, then a 2 byte offset back into what has already been decoded. Greedy
+// matching over a small hash table, so it compresses at a few hundred MB/s and decompressing is
+// little more than memcpy. Used for the blocks of a message archive (see MessageArchive.h).
+
+// Appends the compressed data to out
+void CompressBlock(std::string_view data, std::string* out);
+
+// Appends exactly rawSize bytes to out. Returns false if data is malformed or doesn't decompress
+// to rawSize, out is then left as it was.
+bool DecompressBlock(std::string_view data, size_t rawSize, std::string* out);
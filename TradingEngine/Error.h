@@ -30,6 +30,18 @@ public:
 		Timeout,
 		RPCNotEnoughArguments,
 		InvalidMessageType,
+		InvalidFee,
+		InvalidAmend,
+		InvalidQuote,
+		SnapshotInProgress,
+		SnapshotFailed,
+		JournalFailed,
+		ArchiveFailed,
+		IpcFailed,
+		GatewayFailed,
+		ReplicationFailed,
+		ReplicaDiverged,
+		Overflow,
 
 		// Fatal errors start at 10000
 		FatalErrorUnknown = 10000,
@@ -0,0 +1,176 @@
+#include "EventRing.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+namespace {
+constexpr uint64_t detached = std::numeric_limits<uint64_t>::max();
+
+size_t RoundUpToPowerOf2(size_t size) {
+	size_t powerOf2 = 1;
+	while (powerOf2 < size) {
+		powerOf2 <<= 1;
+	}
+	return powerOf2;
+}
+
+void Pause(WaitStrategy waitStrategy) {
+	if (waitStrategy != WaitStrategy::BusySpin) {
+		std::this_thread::yield();
+	}
+}
+}
+
+uint64_t EventConsumer::GetSequence() const {
+	return sequence.load(std::memory_order_acquire);
+}
+
+void EventConsumer::Detach() {
+	sequence.store(detached, std::memory_order_seq_cst);
+	if (ring->producerBlocked.load(std::memory_order_seq_cst)) {
+		ring->NotifyProducer();
+	}
+}
+
+EventRing::EventRing(size_t size, WaitStrategy producerWaitStrategy)
+	: size(RoundUpToPowerOf2(std::max<size_t>(size, 1)))
+	, mask(this->size - 1)
+	, events(std::make_unique<RingEvent[]>(this->size))
+	, producerWaitStrategy(producerWaitStrategy) {
+}
+
+EventConsumer* EventRing::AddConsumer(WaitStrategy waitStrategy) {
+	std::lock_guard lock(addConsumerMutex);
+	auto index = numConsumers.load(std::memory_order_relaxed);
+	if (index == maxNumConsumers) {
+		return nullptr;
+	}
+
+	// The producer's cached minimum is never past the published sequence, so it can't lap a
+	// consumer starting there even before it sees it
+	auto& consumer = consumers[index];
+	consumer.ring = this;
+	consumer.waitStrategy = waitStrategy;
+	consumer.sequence.store(publishedSequence.load(std::memory_order_acquire), std::memory_order_relaxed);
+	numConsumers.store(index + 1, std::memory_order_seq_cst);
+	return &consumer;
+}
+
+void EventRing::Publish(const Message* messages, size_t count) {
+	while (count > 0) {
+		auto batchSize = std::min(count, size);
+		auto first = publishedSequence.load(std::memory_order_relaxed) + 1;
+		auto last = first + batchSize - 1;
+		WaitForConsumers(last);
+
+		for (size_t i = 0; i < batchSize; ++i) {
+			auto& event = events[(first + i) & mask];
+			event.message = messages[i];
+			if (messages[i].messageType == MessageType::CancelAllOrders) {
+				event.cancelOrders = Message::cancelOrders;
+			} else if (messages[i].messageType == MessageType::MassQuote) {
+				event.cancelOrders = Message::cancelOrders;
+				event.massQuote = Message::massQuote;
+			}
+		}
+
+		publishedSequence.store(last, std::memory_order_seq_cst);
+		if (numBlockedConsumers.load(std::memory_order_seq_cst) > 0) {
+			std::lock_guard lock(mutex);
+			this->published.notify_all();
+		}
+
+		messages += batchSize;
+		count -= batchSize;
+	}
+}
+
+void EventRing::Close() {
+	closed.store(true, std::memory_order_seq_cst);
+	std::lock_guard lock(mutex);
+	published.notify_all();
+}
+
+uint64_t EventRing::GetPublishedSequence() const {
+	return publishedSequence.load(std::memory_order_acquire);
+}
+
+size_t EventRing::GetSize() const {
+	return size;
+}
+
+uint64_t EventRing::GetNumProducerWaits() const {
+	return numProducerWaits.load(std::memory_order_relaxed);
+}
+
+uint64_t EventRing::GetMinConsumerSequence() const {
+	auto minSequence = detached;
+	auto count = numConsumers.load(std::memory_order_seq_cst);
+	for (size_t i = 0; i < count; ++i) {
+		minSequence = std::min(minSequence, consumers[i].sequence.load(std::memory_order_seq_cst));
+	}
+	return minSequence;
+}
+
+// The slot for sequence last held sequence - size, which every consumer has to be past
+void EventRing::WaitForConsumers(uint64_t sequence) {
+	if (sequence <= minConsumerSequence + size) {
+		return;
+	}
+
+	auto isFree = [this, sequence]() {
+		// With no consumers nothing holds the producer back
+		auto minSequence = GetMinConsumerSequence();
+		minConsumerSequence = (minSequence == detached) ? sequence - size : minSequence;
+		return sequence <= minConsumerSequence + size;
+	};
+	if (isFree()) {
+		return;
+	}
+
+	numProducerWaits.fetch_add(1, std::memory_order_relaxed);
+	if (producerWaitStrategy == WaitStrategy::Block) {
+		producerBlocked.store(true, std::memory_order_seq_cst);
+		std::unique_lock lock(mutex);
+		released.wait(lock, isFree);
+		producerBlocked.store(false, std::memory_order_relaxed);
+		return;
+	}
+
+	do {
+		Pause(producerWaitStrategy);
+	} while (!isFree());
+}
+
+uint64_t EventRing::WaitForPublished(uint64_t sequence, WaitStrategy waitStrategy) {
+	auto available = publishedSequence.load(std::memory_order_acquire);
+	if (available >= sequence) {
+		return available;
+	}
+
+	if (waitStrategy == WaitStrategy::Block) {
+		numBlockedConsumers.fetch_add(1, std::memory_order_seq_cst);
+		{
+			std::unique_lock lock(mutex);
+			published.wait(lock, [this, sequence, &available]() {
+				available = publishedSequence.load(std::memory_order_seq_cst);
+				return available >= sequence || closed.load(std::memory_order_seq_cst);
+			});
+		}
+		numBlockedConsumers.fetch_sub(1, std::memory_order_relaxed);
+		return available;
+	}
+
+	while (available < sequence && !closed.load(std::memory_order_acquire)) {
+		Pause(waitStrategy);
+		available = publishedSequence.load(std::memory_order_acquire);
+	}
+	// Anything published before closing is visible once closed is
+	return publishedSequence.load(std::memory_order_acquire);
+}
+
+void EventRing::NotifyProducer() {
+	std::lock_guard lock(mutex);
+	released.notify_all();
+}
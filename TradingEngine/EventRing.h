@@ -0,0 +1,160 @@
+#pragma once
+
+#include "MassQuote.h"
+#include "Message.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// How a thread waits for the other side of an EventRing. BusySpin has the lowest latency and
+// burns a core, Yield gives the core up between checks and Block sleeps until it is woken.
+enum class WaitStrategy {
+	BusySpin,
+	Yield,
+	Block
+};
+
+struct RingEvent {
+	Message message;
+
+	// Copies of the attachment (see Message.h), the statics are only valid on the engine's thread
+	std::string cancelOrders;
+	MassQuote massQuote;
+};
+
+class EventRing;
+
+// One reader of an EventRing (i.e the journaler, market data publisher, fill notifier or
+// replicator), with its own cursor. It sees every event in order and holds the producer back
+// from overwriting anything it hasn't handled yet. Only use it from one thread.
+class EventConsumer {
+public:
+	// Calls handler(sequence, event) for everything published since the last call, then releases
+	// them together. Returns how many were handled, without waiting.
+	template <class Handler>
+	size_t Poll(Handler&& handler);
+
+	// As Poll(), waiting with the consumer's strategy until there is something to handle.
+	// Returns 0 once the ring is closed and everything published has been handled.
+	template <class Handler>
+	size_t Consume(Handler&& handler);
+
+	// Of the last event handled
+	uint64_t GetSequence() const;
+
+	// Stops holding the producer back, for a consumer which is going away. Don't use it after.
+	void Detach();
+
+private:
+	friend class EventRing;
+
+	alignas(64) std::atomic<uint64_t> sequence{ 0 };
+	EventRing* ring = nullptr;
+	WaitStrategy waitStrategy = WaitStrategy::Yield;
+
+	template <class Handler>
+	size_t Handle(uint64_t available, Handler& handler);
+};
+
+// A preallocated ring of output events for one producer (the engine's thread) and any number
+// of consumers, in the style of the LMAX disruptor. Events are copied in once and every
+// consumer reads them in place, so adding a consumer doesn't add copies. The producer only
+// touches the consumers' cursors when it is about to lap the slowest one, and only takes a lock
+// when a consumer is blocked.
+class EventRing {
+public:
+	static constexpr size_t maxNumConsumers = 16;
+
+	// size is rounded up to a power of 2. The producer waits with producerWaitStrategy when the
+	// ring is full.
+	explicit EventRing(size_t size, WaitStrategy producerWaitStrategy = WaitStrategy::Yield);
+
+	EventRing(const EventRing&) = delete;
+	EventRing& operator=(const EventRing&) = delete;
+
+	// Starts from the next event published. Returns nullptr if there are already maxNumConsumers.
+	// Owned by the ring, safe to call from any thread.
+	EventConsumer* AddConsumer(WaitStrategy waitStrategy);
+
+	// Copies the messages (and their attachments) in and publishes them together. Only call from
+	// one thread. Waits while the slowest consumer is a whole ring behind.
+	void Publish(const Message* messages, size_t count);
+
+	// Consumers handle what has been published and then Consume() returns 0
+	void Close();
+
+	// Of the last event published, they start at 1
+	uint64_t GetPublishedSequence() const;
+	size_t GetSize() const;
+
+	// Times the producer found the ring full and had to wait
+	uint64_t GetNumProducerWaits() const;
+
+private:
+	friend class EventConsumer;
+
+	size_t size;
+	size_t mask;
+	std::unique_ptr<RingEvent[]> events;
+	WaitStrategy producerWaitStrategy;
+
+	alignas(64) std::atomic<uint64_t> publishedSequence{ 0 };
+	std::atomic<bool> closed{ false };
+
+	// Producer only
+	alignas(64) uint64_t minConsumerSequence = 0; // Cached, only refreshed when the ring looks full
+	std::atomic<uint64_t> numProducerWaits{ 0 };
+
+	std::array<EventConsumer, maxNumConsumers> consumers;
+	std::atomic<size_t> numConsumers{ 0 };
+	std::mutex addConsumerMutex;
+
+	// For WaitStrategy::Block
+	std::mutex mutex;
+	std::condition_variable published;
+	std::condition_variable released;
+	std::atomic<int> numBlockedConsumers{ 0 };
+	std::atomic<bool> producerBlocked{ false };
+
+	uint64_t GetMinConsumerSequence() const;
+	void WaitForConsumers(uint64_t sequence);
+
+	// Returns the published sequence once it reaches sequence, or earlier if the ring is closed
+	uint64_t WaitForPublished(uint64_t sequence, WaitStrategy waitStrategy);
+	void NotifyProducer();
+};
+
+template <class Handler>
+size_t EventConsumer::Poll(Handler&& handler) {
+	return Handle(ring->publishedSequence.load(std::memory_order_acquire), handler);
+}
+
+template <class Handler>
+size_t EventConsumer::Consume(Handler&& handler) {
+	auto next = sequence.load(std::memory_order_relaxed) + 1;
+	return Handle(ring->WaitForPublished(next, waitStrategy), handler);
+}
+
+template <class Handler>
+size_t EventConsumer::Handle(uint64_t available, Handler& handler) {
+	auto next = sequence.load(std::memory_order_relaxed) + 1;
+	if (available < next) {
+		return 0;
+	}
+
+	for (auto current = next; current <= available; ++current) {
+		handler(current, static_cast<const RingEvent&>(ring->events[current & ring->mask]));
+	}
+
+	sequence.store(available, std::memory_order_seq_cst);
+	if (ring->producerBlocked.load(std::memory_order_seq_cst)) {
+		ring->NotifyProducer();
+	}
+	return available - next + 1;
+}
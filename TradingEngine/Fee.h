@@ -6,7 +6,12 @@ struct Fee {
 	int64_t buyFee = -1;
 	int64_t sellFee = -1;
 
+	// 0 means no fee
 	static int32_t ConvertToDivisibleFee(double feePercent) {
+		if (feePercent <= 0.0) {
+			return 0;
+		}
+
 		auto fraction = feePercent / 100;
 		return static_cast<int32_t>((1 / fraction) + 0.5);
 	}
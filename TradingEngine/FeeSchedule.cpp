@@ -0,0 +1,90 @@
+#include "FeeSchedule.h"
+
+#include "Error.h"
+
+FeeDivider::FeeDivider(int32_t divisor) :
+divisor(divisor) {
+	if (divisor < 0) {
+		throw Error(Error::Type::InvalidFee, "Fee divisor cannot be negative");
+	}
+
+	if (divisor == 0) {
+		return;
+	}
+
+	// With l = ceil(log2(divisor)), m = ceil(2^(63 + l) / divisor) fits in 64 bits and
+	// (x * m) >> (63 + l) == x / divisor for all 0 <= x < 2^63.
+	int32_t log2Ceil = 0;
+	while ((int64_t(1) << log2Ceil) < divisor) {
+		++log2Ceil;
+	}
+
+	shift = 63 + log2Ceil;
+	auto numerator = static_cast<unsigned __int128>(1) << shift;
+	multiplier = static_cast<uint64_t>((numerator + divisor - 1) / divisor);
+}
+
+int32_t FeeDivider::GetDivisor() const {
+	return divisor;
+}
+
+bool FeeDivider::operator==(const FeeDivider& feeDivider) const {
+	return divisor == feeDivider.divisor;
+}
+
+bool FeeTier::operator==(const FeeTier& feeTier) const {
+	return maker == feeTier.maker && taker == feeTier.taker;
+}
+
+void FeeSchedule::SetStandardFee(int32_t feeDivision) {
+	SetTier(0, feeDivision, feeDivision);
+}
+
+void FeeSchedule::SetTier(uint8_t tier, int32_t makerFeeDivision, int32_t takerFeeDivision) {
+	if (tier >= numTiers) {
+		throw Error(Error::Type::InvalidFee, "Fee tier does not exist");
+	}
+
+	tiers[tier] = { FeeDivider(makerFeeDivision), FeeDivider(takerFeeDivision) };
+}
+
+void FeeSchedule::SetFees(const FeeSchedule& feeSchedule) {
+	tiers = feeSchedule.tiers;
+}
+
+void FeeSchedule::SetUserTiers(const UserFeeTiers* userTiers) {
+	this->userTiers = userTiers;
+}
+
+const std::array<FeeTier, FeeSchedule::numTiers>& FeeSchedule::GetTiers() const {
+	return tiers;
+}
+
+bool FeeSchedule::operator==(const FeeSchedule& feeSchedule) const {
+	return tiers == feeSchedule.tiers;
+}
+
+void UserFeeTiers::SetUserTier(int32_t userId, uint8_t tier) {
+	if (tier >= FeeSchedule::numTiers) {
+		throw Error(Error::Type::InvalidFee, "Fee tier does not exist");
+	}
+
+	if (userId < 0) {
+		throw Error(Error::Type::CannotFindUser, "User id cannot be negative");
+	}
+
+	auto index = static_cast<size_t>(userId);
+	if (index >= userTiers.size()) {
+		userTiers.resize(index + 1, 0);
+	}
+
+	userTiers[index] = tier;
+}
+
+const std::vector<uint8_t>& UserFeeTiers::GetUserTiers() const {
+	return userTiers;
+}
+
+bool UserFeeTiers::operator==(const UserFeeTiers& userFeeTiers) const {
+	return userTiers == userFeeTiers.userTiers;
+}
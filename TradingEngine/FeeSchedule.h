@@ -0,0 +1,118 @@
+#pragma once
+
+#include "serializer_defines.h"
+
+#include <array>
+#include <boost/serialization/vector.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+SERIALIZE_HEADER(UserFeeTiers)
+SERIALIZE_HEADER(FeeSchedule)
+
+// Divides by a runtime constant with a multiply and a shift, the reciprocal is worked out once
+// when the divisor is set. Exact for all non-negative int64 dividends (Granlund & Montgomery).
+// A divisor of 0 means no fee, and always gives 0.
+class FeeDivider {
+public:
+	FeeDivider() = default;
+	explicit FeeDivider(int32_t divisor);
+
+	int64_t Divide(int64_t value) const {
+		return static_cast<int64_t>((static_cast<unsigned __int128>(value) * multiplier) >> shift);
+	}
+
+	int32_t GetDivisor() const;
+	bool operator==(const FeeDivider& feeDivider) const;
+
+private:
+	int32_t divisor = 0;
+	uint64_t multiplier = 0;
+	int32_t shift = 0;
+};
+
+struct FeeTier {
+	FeeDivider maker; // The order resting on the book
+	FeeDivider taker; // The incoming order
+
+	bool operator==(const FeeTier& feeTier) const;
+};
+
+// The tier each user is on, 0 unless moved. A dense table indexed by user id, so there is no
+// hashing per fill. There is one for the whole engine (see MarketManager) which every market's
+// FeeSchedule refers to.
+class UserFeeTiers {
+public:
+	SERIALIZE_FRIEND(UserFeeTiers)
+
+	void SetUserTier(int32_t userId, uint8_t tier);
+
+	uint8_t GetUserTier(int32_t userId) const {
+		auto index = static_cast<size_t>(userId);
+		return (index < userTiers.size()) ? userTiers[index] : 0;
+	}
+
+	// Indexed by user id
+	const std::vector<uint8_t>& GetUserTiers() const;
+
+	bool operator==(const UserFeeTiers& userFeeTiers) const;
+
+private:
+	std::vector<uint8_t> userTiers;
+};
+
+// The fees of each tier in a market. Tier 0 is the market's standard fee, which everyone is on
+// unless moved (or there are no user tiers set).
+class FeeSchedule {
+public:
+	SERIALIZE_FRIEND(FeeSchedule)
+
+	constexpr static int numTiers = 8;
+
+	void SetStandardFee(int32_t feeDivision);
+
+	// Fees are "divisible fees" like MarketConfig::feeDivision, see Fee::ConvertToDivisibleFee
+	void SetTier(uint8_t tier, int32_t makerFeeDivision, int32_t takerFeeDivision);
+
+	// Takes the fees of every tier, still referring to the same user tiers (i.e from a snapshot)
+	void SetFees(const FeeSchedule& feeSchedule);
+
+	// Not owned, it must outlive the schedule. Copies refer to the same one.
+	void SetUserTiers(const UserFeeTiers* userTiers);
+
+	const FeeTier& GetTier(int32_t userId) const {
+		return tiers[userTiers ? userTiers->GetUserTier(userId) : 0];
+	}
+
+	const std::array<FeeTier, numTiers>& GetTiers() const;
+
+	// Only the fees are compared, the user tiers are the engine's
+	bool operator==(const FeeSchedule& feeSchedule) const;
+
+private:
+	std::array<FeeTier, numTiers> tiers;
+	const UserFeeTiers* userTiers = nullptr;
+};
+
+namespace boost::serialization {
+
+template <class Archive>
+void serialize(Archive& ar, UserFeeTiers& userFeeTiers, const unsigned int version) {
+	ar& userFeeTiers.userTiers;
+}
+
+// Only the divisors, the reciprocals are worked out again when loading
+template <class Archive>
+void serialize(Archive& ar, FeeSchedule& feeSchedule, const unsigned int version) {
+	for (auto& tier : feeSchedule.tiers) {
+		auto makerDivisor = tier.maker.GetDivisor();
+		auto takerDivisor = tier.taker.GetDivisor();
+		ar& makerDivisor;
+		ar& takerDivisor;
+		if constexpr (Archive::is_loading::value) {
+			tier = { FeeDivider(makerDivisor), FeeDivider(takerDivisor) };
+		}
+	}
+}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Error.h"
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+// Integer fixed point arithmetic where "Scale" units make up 1.0 (e.g 1e8 satoshis in a bitcoin).
+// Everything is constexpr and exact, there is no rounding through a double.
+template <int64_t Scale>
+class FixedPoint {
+public:
+	static_assert(Scale > 0, "Scale must be positive");
+	constexpr static int64_t scale = Scale;
+
+	// The product of 2 scaled values, brought back down to the scale (truncated towards 0).
+	// Products which fit in 64 bits are divided as such (the divisor is a constant so that is a
+	// multiply by its inverse), only larger ones take the 128-bit division. Throws if the result
+	// itself doesn't fit.
+	constexpr static int64_t Multiply(int64_t lhs, int64_t rhs) {
+		int64_t product = 0;
+		if (!__builtin_mul_overflow(lhs, rhs, &product)) {
+			return product / Scale;
+		}
+		return ScaleDown(static_cast<__int128>(lhs) * rhs);
+	}
+
+	// Reduce an already multiplied (doubly scaled) value, throws if it doesn't fit afterwards
+	constexpr static int64_t ScaleDown(__int128 doubleScaled) {
+		auto scaled = doubleScaled / Scale;
+		if (scaled > std::numeric_limits<int64_t>::max() || scaled < std::numeric_limits<int64_t>::min()) {
+			throw Error(Error::Type::Overflow, "Fixed point result does not fit in 64 bits");
+		}
+		return static_cast<int64_t>(scaled);
+	}
+
+	// Nearest scaled value to an external decimal number
+	template <class T>
+	constexpr static int64_t FromDouble(T value) {
+		static_assert(std::is_same_v<double, T>);
+		return static_cast<int64_t>(value * Scale + ((value < 0) ? -0.5 : 0.5));
+	}
+
+	constexpr static double ToDouble(int64_t value) {
+		return static_cast<double>(value) / Scale;
+	}
+};
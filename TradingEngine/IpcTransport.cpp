@@ -0,0 +1,517 @@
+#include "IpcTransport.h"
+
+#include "Error.h"
+#include "MessageCodec.h"
+#include "PlatformSpecific/fork_process.h"
+#include "PlatformSpecific/futex.h"
+#include "TradingEngine.h"
+
+#include <atomic>
+#include <cstring>
+#include <string_view>
+#include <thread>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr uint64_t magic = 0x3130435049455457; // "WTEIPC01"
+constexpr uint32_t formatVersion = 1;
+constexpr size_t cacheLineSize = 64;
+constexpr size_t maxBatchSize = 64; // Requests taken from one client before moving on to the next
+
+enum class SlotState : uint32_t {
+	Free,
+	Connected,
+	Closing, // The client has gone, the server frees it
+	Disconnected // By the server, the slot is freed once the client closes it or exits
+};
+
+// A futex word and whether anyone is asleep on it, so waking costs nothing when nobody is
+struct Signal {
+	alignas(cacheLineSize) std::atomic<uint32_t> futex;
+	std::atomic<uint32_t> numWaiting;
+};
+
+struct RingHeader {
+	alignas(cacheLineSize) std::atomic<uint64_t> writePosition;
+	alignas(cacheLineSize) std::atomic<uint64_t> readPosition;
+};
+
+struct SegmentHeader {
+	uint64_t magic;
+	uint32_t formatVersion;
+	uint32_t numSpins;
+	uint64_t maxNumClients;
+	uint64_t ringSize;
+	uint64_t slotSize; // The slot header and both rings
+	Signal doorbell; // The server sleeps on this
+};
+
+struct SlotHeader {
+	alignas(cacheLineSize) std::atomic<uint32_t> state;
+	std::atomic<int32_t> pid;
+	Signal responseSignal; // The client sleeps on this
+	RingHeader requests;
+	RingHeader responses;
+};
+
+constexpr size_t RoundUp(size_t size, size_t alignment) {
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+constexpr size_t segmentHeaderSize = RoundUp(sizeof(SegmentHeader), cacheLineSize);
+constexpr size_t slotHeaderSize = RoundUp(sizeof(SlotHeader), cacheLineSize);
+
+// Each record is a header and then the payload, padded to 8 bytes. A record which doesn't fit
+// before the end of the ring starts at the beginning, after a wrap record.
+struct RecordHeader {
+	uint32_t size;
+	uint32_t flags;
+};
+
+constexpr uint32_t wrapFlag = 1;
+constexpr uint32_t endOfResponseFlag = 2;
+
+enum class PeekResult {
+	Empty,
+	Record,
+	Corrupt
+};
+
+// One side of a ring, made when needed as it only caches its own position
+class RingView {
+public:
+	RingView(RingHeader* header, char* data, size_t capacity) :
+	header(header),
+	data(data),
+	capacity(capacity),
+	position(0) {
+	}
+
+	size_t GetMaxPayloadSize() const {
+		return capacity / 2 - sizeof(RecordHeader);
+	}
+
+	// Producer side, returns nullptr if there isn't room yet. Nothing is visible to the
+	// consumer until Publish().
+	char* Reserve(size_t size, uint32_t flags) {
+		if (position == 0) {
+			position = header->writePosition.load(std::memory_order_relaxed);
+		}
+
+		auto recordSize = sizeof(RecordHeader) + RoundUp(size, 8);
+		auto offset = position % capacity;
+		auto tail = capacity - offset;
+		auto needed = (tail < recordSize) ? tail + recordSize : recordSize;
+		if (position + needed - header->readPosition.load(std::memory_order_acquire) > capacity) {
+			return nullptr;
+		}
+
+		if (tail < recordSize) {
+			WriteHeader(offset, { 0, wrapFlag });
+			position += tail;
+			offset = 0;
+		}
+		WriteHeader(offset, { static_cast<uint32_t>(size), flags });
+		position += recordSize;
+		return data + offset + sizeof(RecordHeader);
+	}
+
+	void Publish() {
+		header->writePosition.store(position, std::memory_order_seq_cst);
+	}
+
+	// Consumer side, the payload stays valid until Pop()
+	PeekResult Peek(std::string_view* payload, uint32_t* flags) {
+		auto read = header->readPosition.load(std::memory_order_relaxed);
+		auto write = header->writePosition.load(std::memory_order_acquire);
+		while (read < write) {
+			auto offset = read % capacity;
+			RecordHeader record;
+			std::memcpy(&record, data + offset, sizeof(record));
+			if ((record.flags & wrapFlag) != 0) {
+				read += capacity - offset;
+				continue;
+			}
+
+			// Written by the other process, so checked before it is trusted
+			auto recordSize = sizeof(RecordHeader) + RoundUp(record.size, 8);
+			if (recordSize > capacity - offset || read + recordSize > write) {
+				return PeekResult::Corrupt;
+			}
+
+			*payload = std::string_view(data + offset + sizeof(RecordHeader), record.size);
+			*flags = record.flags;
+			position = read + recordSize;
+			return PeekResult::Record;
+		}
+		return PeekResult::Empty;
+	}
+
+	void Pop() {
+		header->readPosition.store(position, std::memory_order_release);
+	}
+
+	bool HasData() const {
+		return header->writePosition.load(std::memory_order_seq_cst) != header->readPosition.load(std::memory_order_relaxed);
+	}
+
+	// Drops everything which hasn't been read, only when the other side has gone
+	void Clear() {
+		header->readPosition.store(header->writePosition.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+private:
+	RingHeader* header;
+	char* data;
+	size_t capacity;
+	uint64_t position; // Written up to (producer) or read up to after Pop() (consumer)
+
+	void WriteHeader(size_t offset, RecordHeader record) {
+		std::memcpy(data + offset, &record, sizeof(record));
+	}
+};
+
+SegmentHeader* GetHeader(const ps::SharedMemory& memory) {
+	return static_cast<SegmentHeader*>(memory.address);
+}
+
+// The sizes are passed in rather than read from the segment header, which every client can write
+SlotHeader* GetSlot(const ps::SharedMemory& memory, size_t slotSize, size_t clientId) {
+	return reinterpret_cast<SlotHeader*>(static_cast<char*>(memory.address) + segmentHeaderSize + clientId * slotSize);
+}
+
+RingView GetRequests(SlotHeader* slot, size_t ringSize) {
+	return RingView(&slot->requests, reinterpret_cast<char*>(slot) + slotHeaderSize, ringSize);
+}
+
+RingView GetResponses(SlotHeader* slot, size_t ringSize) {
+	return RingView(&slot->responses, reinterpret_cast<char*>(slot) + slotHeaderSize + ringSize, ringSize);
+}
+
+size_t GetSlotSize(size_t ringSize) {
+	return slotHeaderSize + 2 * RoundUp(ringSize, cacheLineSize);
+}
+
+SlotState GetState(const SlotHeader* slot) {
+	return static_cast<SlotState>(slot->state.load(std::memory_order_acquire));
+}
+
+void SetState(SlotHeader* slot, SlotState state) {
+	slot->state.store(static_cast<uint32_t>(state), std::memory_order_seq_cst);
+}
+
+void Notify(Signal& signal) {
+	if (signal.numWaiting.load(std::memory_order_seq_cst) > 0) {
+		signal.futex.fetch_add(1, std::memory_order_seq_cst);
+		ps::FutexWakeAll(&signal.futex);
+	}
+}
+
+// Spins, then sleeps on the signal until ready() or the timeout. Whoever makes it ready
+// changes what ready() checks before calling Notify().
+template <class Ready>
+bool Wait(Signal& signal, unsigned numSpins, std::chrono::microseconds timeout, Ready ready) {
+	for (unsigned i = 0; i < numSpins; ++i) {
+		if (ready()) {
+			return true;
+		}
+	}
+
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (true) {
+		signal.numWaiting.fetch_add(1, std::memory_order_seq_cst);
+		auto value = signal.futex.load(std::memory_order_seq_cst);
+		if (ready()) {
+			signal.numWaiting.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		if (now >= deadline) {
+			signal.numWaiting.fetch_sub(1, std::memory_order_relaxed);
+			return false;
+		}
+		ps::FutexWait(&signal.futex, value, std::chrono::duration_cast<std::chrono::microseconds>(deadline - now) + std::chrono::microseconds(1));
+		signal.numWaiting.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+}
+
+IpcServer::IpcServer(const IpcConfig& config) :
+config(config),
+slotSize(GetSlotSize(config.ringSize)) {
+	if (config.maxNumClients == 0 || config.ringSize < 4096 || config.ringSize % 8 != 0) {
+		throw Error(Error::Type::IpcFailed, "Invalid IPC config");
+	}
+
+	memory = ps::CreateSharedMemory(config.name, segmentHeaderSize + config.maxNumClients * slotSize);
+	if (!memory.address) {
+		throw Error(Error::Type::IpcFailed, "Could not create the shared memory");
+	}
+
+	// Zeroed, which is every slot free with empty rings
+	auto header = GetHeader(memory);
+	header->formatVersion = formatVersion;
+	header->numSpins = config.numSpins;
+	header->maxNumClients = config.maxNumClients;
+	header->ringSize = config.ringSize;
+	header->slotSize = slotSize;
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = magic;
+}
+
+IpcServer::~IpcServer() {
+	ps::RemoveSharedMemory(config.name);
+	ps::CloseSharedMemory(memory);
+}
+
+int IpcServer::GetFd() const {
+	return memory.fd;
+}
+
+size_t IpcServer::GetNumClients() const {
+	size_t numClients = 0;
+	for (size_t i = 0; i < config.maxNumClients; ++i) {
+		numClients += (GetState(GetSlot(memory, slotSize, i)) == SlotState::Connected);
+	}
+	return numClients;
+}
+
+size_t IpcServer::Poll(const RequestHandler& handler, std::chrono::microseconds timeout) {
+	auto pollClients = [this, &handler]() {
+		size_t numHandled = 0;
+		for (size_t clientId = 0; clientId < config.maxNumClients; ++clientId) {
+			auto slot = GetSlot(memory, slotSize, clientId);
+			auto state = GetState(slot);
+			if (state == SlotState::Closing) {
+				Release(clientId);
+				continue;
+			} else if (state != SlotState::Connected) {
+				continue;
+			}
+
+			auto requests = GetRequests(slot, config.ringSize);
+			std::string_view payload;
+			uint32_t flags;
+			Message message;
+			for (size_t i = 0; i < maxBatchSize; ++i) {
+				auto result = requests.Peek(&payload, &flags);
+				if (result == PeekResult::Empty) {
+					break;
+				}
+				if (result == PeekResult::Corrupt || !DecodeRaw(payload, &message)) {
+					Disconnect(clientId);
+					break;
+				}
+
+				requests.Pop();
+				handler(clientId, message);
+				++numHandled;
+			}
+		}
+		return numHandled;
+	};
+
+	auto numHandled = pollClients();
+	if (numHandled > 0) {
+		return numHandled;
+	}
+
+	auto header = GetHeader(memory);
+	if (!Wait(header->doorbell, config.numSpins, timeout, [this]() { return HasWork(); })) {
+		ReclaimDeadClients();
+		return 0;
+	}
+	return pollClients();
+}
+
+bool IpcServer::Respond(size_t clientId, const Message* messages, size_t count) {
+	auto slot = GetSlot(memory, slotSize, clientId);
+	if (GetState(slot) != SlotState::Connected) {
+		return false;
+	}
+
+	// Published together, so the client never sees part of a response
+	auto responses = GetResponses(slot, config.ringSize);
+	for (size_t i = 0; i < count || i == 0; ++i) {
+		auto flags = (i + 1 >= count) ? endOfResponseFlag : 0;
+		auto size = (count > 0) ? GetRawSize(messages[i]) : 0;
+		auto record = (size <= responses.GetMaxPayloadSize()) ? responses.Reserve(size, flags) : nullptr;
+		if (!record) {
+			Disconnect(clientId);
+			return false;
+		}
+		if (count > 0) {
+			EncodeRaw(messages[i], record);
+		}
+	}
+
+	responses.Publish();
+	Notify(slot->responseSignal);
+	return true;
+}
+
+size_t IpcServer::Serve(TradingEngine& tradingEngine, std::chrono::microseconds timeout) {
+	return Poll([this, &tradingEngine](size_t clientId, const Message& message) {
+		output.clear();
+		tradingEngine.Process(message, &output);
+		Respond(clientId, output.data(), output.size());
+	},
+	timeout);
+}
+
+void IpcServer::ReclaimDeadClients() {
+	for (size_t clientId = 0; clientId < config.maxNumClients; ++clientId) {
+		auto slot = GetSlot(memory, slotSize, clientId);
+		auto state = GetState(slot);
+		auto pid = slot->pid.load(std::memory_order_acquire);
+		if ((state == SlotState::Connected || state == SlotState::Disconnected) && pid > 0 && !ps::IsProcessAlive(pid)) {
+			Release(clientId);
+		}
+	}
+}
+
+// The client finds out the next time it sends or waits for a response
+void IpcServer::Disconnect(size_t clientId) {
+	auto slot = GetSlot(memory, slotSize, clientId);
+	SetState(slot, SlotState::Disconnected);
+	Notify(slot->responseSignal);
+}
+
+// Only once the client has gone, so the server is the only one left using the rings
+void IpcServer::Release(size_t clientId) {
+	auto slot = GetSlot(memory, slotSize, clientId);
+	GetRequests(slot, config.ringSize).Clear();
+	GetResponses(slot, config.ringSize).Clear();
+
+	slot->pid.store(0, std::memory_order_relaxed);
+	SetState(slot, SlotState::Free);
+}
+
+bool IpcServer::HasWork() const {
+	for (size_t clientId = 0; clientId < config.maxNumClients; ++clientId) {
+		auto slot = GetSlot(memory, slotSize, clientId);
+		auto state = GetState(slot);
+		if (state == SlotState::Closing || (state == SlotState::Connected && GetRequests(slot, config.ringSize).HasData())) {
+			return true;
+		}
+	}
+	return false;
+}
+
+IpcClient::IpcClient(const std::string& name) :
+memory(ps::OpenSharedMemory(name)) {
+	Connect();
+}
+
+IpcClient::IpcClient(int fd) :
+memory(ps::OpenSharedMemory(fd)) {
+	Connect();
+}
+
+IpcClient::~IpcClient() {
+	auto slot = GetSlot(memory, slotSize, clientId);
+	SetState(slot, SlotState::Closing);
+	Notify(GetHeader(memory)->doorbell);
+	ps::CloseSharedMemory(memory);
+}
+
+size_t IpcClient::GetClientId() const {
+	return clientId;
+}
+
+void IpcClient::Send(const Message& message) {
+	auto slot = GetSlot(memory, slotSize, clientId);
+	auto requests = GetRequests(slot, ringSize);
+	auto size = GetRawSize(message);
+	if (GetState(slot) != SlotState::Connected) {
+		throw Error(Error::Type::IpcFailed, "Disconnected by the server");
+	} else if (size > requests.GetMaxPayloadSize()) {
+		throw Error(Error::Type::IpcFailed, "The request is too big for the ring");
+	}
+
+	char* record;
+	while (!(record = requests.Reserve(size, 0))) {
+		// The server drains the ring in batches, so this is short unless it has stopped
+		if (GetState(slot) != SlotState::Connected) {
+			throw Error(Error::Type::IpcFailed, "Disconnected by the server");
+		}
+		std::this_thread::yield();
+	}
+
+	EncodeRaw(message, record);
+	requests.Publish();
+	Notify(GetHeader(memory)->doorbell);
+}
+
+bool IpcClient::Receive(std::vector<Message>* responses, std::chrono::microseconds timeout) {
+	auto header = GetHeader(memory);
+	auto slot = GetSlot(memory, slotSize, clientId);
+	auto ringView = GetResponses(slot, ringSize);
+	responses->clear();
+
+	auto ready = [slot, &ringView]() {
+		return ringView.HasData() || GetState(slot) != SlotState::Connected;
+	};
+	if (!Wait(slot->responseSignal, header->numSpins, timeout, ready)) {
+		return false;
+	}
+
+	// A response is published all at once, so once any of it is there all of it is
+	std::string_view payload;
+	uint32_t flags = 0;
+	while ((flags & endOfResponseFlag) == 0) {
+		auto result = ringView.Peek(&payload, &flags);
+		if (result != PeekResult::Record) {
+			throw Error(Error::Type::IpcFailed, (result == PeekResult::Corrupt) ? "The response ring is corrupt" : "Disconnected by the server");
+		}
+
+		if (!payload.empty()) {
+			responses->emplace_back();
+			if (!DecodeRaw(payload, &responses->back())) {
+				throw Error(Error::Type::IpcFailed, "The response ring is corrupt");
+			}
+		}
+		ringView.Pop();
+	}
+	return true;
+}
+
+bool IpcClient::Call(const Message& message, std::vector<Message>* responses, std::chrono::microseconds timeout) {
+	Send(message);
+	return Receive(responses, timeout);
+}
+
+void IpcClient::Connect() {
+	if (!memory.address) {
+		throw Error(Error::Type::IpcFailed, "Could not open the shared memory");
+	}
+
+	auto header = GetHeader(memory);
+	if (memory.size < segmentHeaderSize || header->magic != magic || header->formatVersion != formatVersion
+		|| header->slotSize < GetSlotSize(header->ringSize)
+		|| memory.size < segmentHeaderSize + header->maxNumClients * header->slotSize) {
+		ps::CloseSharedMemory(memory);
+		throw Error(Error::Type::IpcFailed, "Not a trading engine IPC server");
+	}
+
+	ringSize = header->ringSize;
+	slotSize = header->slotSize;
+
+	for (clientId = 0; clientId < header->maxNumClients; ++clientId) {
+		auto slot = GetSlot(memory, slotSize, clientId);
+		auto expected = static_cast<uint32_t>(SlotState::Free);
+		if (slot->state.compare_exchange_strong(expected, static_cast<uint32_t>(SlotState::Connected), std::memory_order_seq_cst)) {
+#if defined(__linux__) || defined(__APPLE__)
+			slot->pid.store(getpid(), std::memory_order_release);
+#endif
+			return;
+		}
+	}
+
+	ps::CloseSharedMemory(memory);
+	throw Error(Error::Type::IpcFailed, "Every client slot is taken");
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Message.h"
+#include "PlatformSpecific/shared_memory.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class TradingEngine;
+
+// Order entry from gateways in other processes over shared memory. Each client (i.e a gateway
+// process) gets a slot with a request ring and a response ring, single producer/single consumer
+// rings of messages in the raw format (see MessageCodec.h), so a request costs two copies and
+// no system calls while both sides are busy. Whichever side is waiting spins for a while, then
+// sleeps on a futex in the shared memory which the other side only wakes when it's asleep.
+struct IpcConfig {
+	std::string name; // Of the shared memory object (starting with '/'), empty for an anonymous memfd
+	size_t maxNumClients = 16;
+	size_t ringSize = 1024 * 1024; // Bytes in each request and response ring
+	unsigned numSpins = 20000; // Checks before sleeping, in the server and its clients
+};
+
+class IpcServer {
+public:
+	using RequestHandler = std::function<void(size_t clientId, const Message& message)>;
+
+	// Creates the shared memory, replacing any left over with the same name.
+	// Throws Error::Type::IpcFailed if it can't.
+	explicit IpcServer(const IpcConfig& config);
+	~IpcServer(); // Removes the name, connected clients keep their mapping
+
+	IpcServer(const IpcServer&) = delete;
+	IpcServer& operator=(const IpcServer&) = delete;
+
+	// For handing to clients which can't open it by name (i.e forked gateways)
+	int GetFd() const;
+
+	size_t GetNumClients() const;
+
+	// Calls the handler for every waiting request, in the order each client sent them and a
+	// batch of each client's at a time. The attachment is in Message::cancelOrders/massQuote
+	// while it is called. Waits up to timeout when there are none. Returns the number handled.
+	size_t Poll(const RequestHandler& handler, std::chrono::microseconds timeout);
+
+	// The response to one request, which the client gets all together (count can be 0).
+	// Returns false, and disconnects the client, if its response ring is full, so a client which
+	// doesn't keep up can't hold up the engine.
+	bool Respond(size_t clientId, const Message* messages, size_t count);
+
+	// Poll() processing every request with the engine and responding with its output
+	size_t Serve(TradingEngine& tradingEngine, std::chrono::microseconds timeout);
+
+	// Frees the slots of clients whose process has gone without disconnecting, Poll() also
+	// does this when it has waited the whole timeout
+	void ReclaimDeadClients();
+
+private:
+	IpcConfig config;
+	size_t slotSize; // From the config, the segment header is only for clients
+	ps::SharedMemory memory;
+	std::vector<Message> output;
+
+	void Disconnect(size_t clientId);
+	void Release(size_t clientId);
+	bool HasWork() const;
+};
+
+class IpcClient {
+public:
+	// Connects to a server by name or by its fd (see IpcServer::GetFd()).
+	// Throws Error::Type::IpcFailed if there's no server or every slot is taken.
+	explicit IpcClient(const std::string& name);
+	explicit IpcClient(int fd);
+	~IpcClient(); // Disconnects
+
+	IpcClient(const IpcClient&) = delete;
+	IpcClient& operator=(const IpcClient&) = delete;
+
+	size_t GetClientId() const;
+
+	// Queues a request, with its attachment, waiting while the request ring is full. Throws
+	// Error::Type::IpcFailed if the server has disconnected this client or the request can't fit.
+	void Send(const Message& message);
+
+	// The response to the oldest request not yet received, in place of what was in responses.
+	// The attachment of the last one is in Message::cancelOrders/massQuote. Returns false if
+	// there was none within the timeout. Throws Error::Type::IpcFailed if disconnected.
+	bool Receive(std::vector<Message>* responses, std::chrono::microseconds timeout);
+
+	// Send() then Receive()
+	bool Call(const Message& message, std::vector<Message>* responses, std::chrono::microseconds timeout);
+
+private:
+	ps::SharedMemory memory;
+	size_t clientId = 0;
+	size_t ringSize = 0;
+	size_t slotSize = 0;
+
+	void Connect();
+};
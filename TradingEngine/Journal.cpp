@@ -0,0 +1,389 @@
+#include "Journal.h"
+
+#include "Error.h"
+#include "MessageCodec.h"
+#include "PlatformSpecific/io_ring.h"
+#include "PlatformSpecific/segment_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr size_t blockSize = ps::directIoAlignment;
+constexpr size_t recordHeaderSize = sizeof(uint32_t) + sizeof(uint64_t); // Size (including this header), sequence
+constexpr const char* segmentExtension = ".journal";
+
+size_t RoundUp(size_t size) {
+	return (size + blockSize - 1) / blockSize * blockSize;
+}
+
+// Where the next record header goes, it's moved to the next block rather than cross one
+size_t HeaderPosition(size_t size) {
+	auto blockRemaining = blockSize - size % blockSize;
+	return (blockRemaining < recordHeaderSize) ? size + blockRemaining : size;
+}
+
+std::string SegmentPath(const std::string& directory, uint64_t segment) {
+	char name[32];
+	std::snprintf(name, sizeof(name), "%020llu", static_cast<unsigned long long>(segment));
+	return directory + "/" + name + segmentExtension;
+}
+
+// In segment order
+std::vector<std::pair<uint64_t, std::string>> ListSegments(const std::string& directory) {
+	std::vector<std::pair<uint64_t, std::string>> segments;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+		const auto& path = entry.path();
+		auto stem = path.stem().string();
+		if (path.extension() != segmentExtension || stem.empty()
+			|| !std::all_of(stem.begin(), stem.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+			continue;
+		}
+		segments.emplace_back(std::stoull(stem), path.string());
+	}
+
+	std::sort(segments.begin(), segments.end());
+	return segments;
+}
+
+// Returns the last sequence read and whether the segment ended cleanly. With expectedSequence
+// of 0 the first record can have any sequence, otherwise it has to be the one expected.
+std::pair<uint64_t, bool> ReadSegment(const std::string& path, uint64_t expectedSequence, const Journal::RecordHandler& handler) {
+	std::ifstream file(path, std::ios::binary);
+	std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	uint64_t lastSequence = 0;
+	size_t position = 0;
+	while (true) {
+		position = HeaderPosition(position);
+		if (position + recordHeaderSize > contents.size()) {
+			return { lastSequence, true };
+		}
+
+		uint32_t size;
+		uint64_t sequence;
+		std::memcpy(&size, contents.data() + position, sizeof(size));
+		std::memcpy(&sequence, contents.data() + position + sizeof(size), sizeof(sequence));
+		if (size == 0) {
+			// Padding to the end of a flush, unless it's at the start of a block where nothing
+			// has been written yet
+			if (position % blockSize == 0) {
+				return { lastSequence, true };
+			}
+			position = RoundUp(position);
+			continue;
+		}
+
+		auto expected = (lastSequence != 0) ? lastSequence + 1 : expectedSequence;
+		if (size < recordHeaderSize || position + size > contents.size() || (expected != 0 && sequence != expected)) {
+			return { lastSequence, false }; // Torn, this is as far as it was written
+		}
+
+		handler(sequence, std::string_view(contents.data() + position + recordHeaderSize, size - recordHeaderSize));
+		lastSequence = sequence;
+		position += size;
+	}
+}
+}
+
+Journal::Journal(const JournalConfig& config)
+	: config(config) {
+	if (config.bufferSize == 0 || config.bufferSize % blockSize != 0 || config.segmentSize % blockSize != 0
+		|| config.segmentSize < config.bufferSize || config.numBuffers < 2) {
+		throw Error(Error::Type::JournalFailed, "Invalid journal config");
+	}
+
+	// Only the last segment with anything in it needs reading to carry on from it
+	auto segments = ListSegments(config.directory);
+	for (auto it = segments.rbegin(); it != segments.rend() && lastSequence == 0; ++it) {
+		lastSequence = ReadSegment(it->second, 0, [](uint64_t, std::string_view) {}).first;
+	}
+	durableSequence = lastSequence;
+
+	memory = ps::MapPages(config.bufferSize * config.numBuffers, false, false);
+	buffers = std::make_unique<Buffer[]>(config.numBuffers);
+	for (size_t i = 0; i < config.numBuffers; ++i) {
+		buffers[i].data = static_cast<char*>(memory.address) + i * config.bufferSize;
+	}
+	buffers[current].segment = segments.empty() ? 0 : segments.back().first + 1;
+
+	writer = std::thread(&Journal::Write, this);
+}
+
+Journal::~Journal() {
+	try {
+		Flush();
+	} catch (const Error&) {
+		// The writer has failed, there is nothing more which can be written
+	}
+
+	stopping.store(true, std::memory_order_release);
+	writer.join();
+	ps::UnmapPages(memory);
+}
+
+uint64_t Journal::Append(const void* data, size_t size) {
+	std::memcpy(AppendRecord(size), data, size);
+	return lastSequence;
+}
+
+uint64_t Journal::Append(const Message& message) {
+	EncodeRaw(message, AppendRecord(GetRawSize(message)));
+	return lastSequence;
+}
+
+void Journal::Flush() {
+	if (failed.load(std::memory_order_relaxed)) {
+		throw Error(Error::Type::JournalFailed, "Writing the journal failed");
+	}
+	if (buffers[current].size > 0) {
+		NextBuffer(false);
+	}
+}
+
+uint64_t Journal::GetLastSequence() const {
+	return lastSequence;
+}
+
+uint64_t Journal::GetDurableSequence() const {
+	return durableSequence.load(std::memory_order_acquire);
+}
+
+void Journal::Sync() {
+	Flush();
+	while (durableSequence.load(std::memory_order_acquire) < lastSequence) {
+		if (failed.load(std::memory_order_acquire)) {
+			throw Error(Error::Type::JournalFailed, "Writing the journal failed");
+		}
+		std::this_thread::sleep_for(config.writerIdleSleep);
+	}
+}
+
+JournalStats Journal::GetStats() const {
+	JournalStats stats;
+	stats.numBatches = numBatches.load(std::memory_order_relaxed);
+	stats.numBytesWritten = numBytesWritten.load(std::memory_order_relaxed);
+	stats.numStalls = numStalls.load(std::memory_order_relaxed);
+	stats.ioUring = ioUring.load(std::memory_order_relaxed);
+	stats.directIo = directIo.load(std::memory_order_relaxed);
+	return stats;
+}
+
+uint64_t Journal::Read(const std::string& directory, const RecordHandler& handler) {
+	uint64_t lastSequence = 0;
+	for (const auto& segment : ListSegments(directory)) {
+		auto [segmentLastSequence, complete] = ReadSegment(segment.second, (lastSequence != 0) ? lastSequence + 1 : 0, handler);
+		if (segmentLastSequence != 0) {
+			lastSequence = segmentLastSequence;
+		}
+		if (!complete) {
+			break;
+		}
+	}
+	return lastSequence;
+}
+
+bool Journal::DecodeMessage(std::string_view record, Message* message) {
+	return DecodeRaw(record, message);
+}
+
+char* Journal::AppendRecord(size_t size) {
+	if (failed.load(std::memory_order_relaxed)) {
+		throw Error(Error::Type::JournalFailed, "Writing the journal failed");
+	}
+
+	auto recordSize = recordHeaderSize + size;
+	if (recordSize > config.bufferSize) {
+		throw Error(Error::Type::JournalFailed, "The record is bigger than a journal buffer");
+	}
+
+	auto position = HeaderPosition(buffers[current].size);
+	if (position + recordSize > config.bufferSize) {
+		NextBuffer(false);
+		position = 0;
+	}
+	if (buffers[current].offset + position + recordSize > config.segmentSize) {
+		NextBuffer(true);
+		position = 0;
+	}
+
+	auto& buffer = buffers[current];
+	auto record = buffer.data + position;
+	auto header = static_cast<uint32_t>(recordSize);
+	std::memcpy(record, &header, sizeof(header));
+	std::memcpy(record + sizeof(header), &++lastSequence, sizeof(lastSequence));
+
+	buffer.size = position + recordSize;
+	buffer.lastSequence = lastSequence;
+	return record + recordHeaderSize;
+}
+
+void Journal::NextBuffer(bool nextSegment) {
+	auto segment = buffers[current].segment;
+	auto offset = buffers[current].offset + RoundUp(buffers[current].size);
+
+	if (buffers[current].size > 0) {
+		buffers[current].flushed.store(true, std::memory_order_release);
+		current = (current + 1) % config.numBuffers;
+
+		// Every buffer is waiting to be written, only when the disk can't keep up
+		if (buffers[current].flushed.load(std::memory_order_acquire)) {
+			numStalls.fetch_add(1, std::memory_order_relaxed);
+			while (buffers[current].flushed.load(std::memory_order_acquire)) {
+				if (failed.load(std::memory_order_acquire)) {
+					throw Error(Error::Type::JournalFailed, "Writing the journal failed");
+				}
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	if (nextSegment || offset >= config.segmentSize) {
+		++segment;
+		offset = 0;
+	}
+
+	auto& buffer = buffers[current];
+	buffer.segment = segment;
+	buffer.offset = offset;
+	buffer.size = 0;
+}
+
+void Journal::Write() {
+	std::unique_ptr<ps::IoRing> ring;
+	if (config.ioUring) {
+		ring = std::make_unique<ps::IoRing>(static_cast<unsigned>(config.numBuffers * 2));
+	}
+	ioUring.store(ring && ring->IsAvailable(), std::memory_order_relaxed);
+
+	// Opening a segment also opens (and so preallocates) the one after it, which is then ready
+	// before the matching thread gets to it
+	std::map<uint64_t, ps::SegmentFile> files;
+	auto getFile = [this, &files](uint64_t segment) {
+		for (auto index : { segment, segment + 1 }) {
+			if (files.count(index) == 0) {
+				auto file = ps::OpenSegmentFile(SegmentPath(config.directory, index), config.segmentSize, config.directIo);
+				if (file.fd >= 0) {
+					directIo.store(file.directIo, std::memory_order_relaxed);
+					files.emplace(index, file);
+				}
+			}
+		}
+		auto it = files.find(segment);
+		return (it == files.end()) ? -1 : it->second.fd;
+	};
+
+	struct BatchWrite {
+		int fd;
+		const char* data;
+		size_t size;
+		uint64_t offset;
+	};
+
+	std::vector<BatchWrite> writes;
+	std::vector<int> fds;
+	size_t next = 0;
+	while (true) {
+		size_t count = 0;
+		while (count < config.numBuffers && buffers[(next + count) % config.numBuffers].flushed.load(std::memory_order_acquire)) {
+			++count;
+		}
+
+		if (count == 0) {
+			if (stopping.load(std::memory_order_acquire)) {
+				// Anything flushed before stopping was set is visible now
+				if (!buffers[next].flushed.load(std::memory_order_acquire)) {
+					break;
+				}
+				continue;
+			}
+			std::this_thread::sleep_for(config.writerIdleSleep);
+			continue;
+		}
+
+		writes.clear();
+		fds.clear();
+		auto ok = true;
+		for (size_t i = 0; i < count && ok; ++i) {
+			const auto& buffer = buffers[(next + i) % config.numBuffers];
+			auto fd = getFile(buffer.segment);
+			ok = fd >= 0;
+			writes.push_back({ fd, buffer.data, RoundUp(buffer.size), buffer.offset });
+			if (std::find(fds.begin(), fds.end(), fd) == fds.end()) {
+				fds.push_back(fd);
+			}
+		}
+
+		if (ok && ioUring.load(std::memory_order_relaxed)) {
+			for (size_t i = 0; i < writes.size(); ++i) {
+				ring->QueueWrite(writes[i].fd, writes[i].data, writes[i].size, writes[i].offset, i);
+			}
+			for (auto fd : fds) {
+				ring->QueueSyncData(fd, writes.size());
+			}
+			ok = ring->Submit(static_cast<unsigned>(writes.size() + fds.size()));
+
+			// A short write is finished off with pwrite, and then has to be synced again
+			auto resync = false;
+			uint64_t userData;
+			int result;
+			while (ring->PopCompletion(&userData, &result)) {
+				if (result < 0) {
+					ok = false;
+				} else if (userData < writes.size() && static_cast<size_t>(result) < writes[userData].size) {
+					const auto& write = writes[userData];
+					ok = ok && ps::WriteAt(write.fd, write.data + result, write.size - result, write.offset + result);
+					resync = true;
+				}
+			}
+			for (size_t i = 0; ok && resync && i < fds.size(); ++i) {
+				ok = ps::SyncData(fds[i]);
+			}
+		} else if (ok) {
+			for (size_t i = 0; ok && i < writes.size(); ++i) {
+				ok = ps::WriteAt(writes[i].fd, writes[i].data, writes[i].size, writes[i].offset);
+			}
+			for (size_t i = 0; ok && i < fds.size(); ++i) {
+				ok = ps::SyncData(fds[i]);
+			}
+		}
+
+		if (!ok) {
+			failed.store(true, std::memory_order_release);
+			break;
+		}
+
+		const auto& last = buffers[(next + count - 1) % config.numBuffers];
+		durableSequence.store(last.lastSequence, std::memory_order_release);
+		numBatches.fetch_add(1, std::memory_order_relaxed);
+		for (const auto& write : writes) {
+			numBytesWritten.fetch_add(write.size, std::memory_order_relaxed);
+		}
+
+		// Segments before the last one written to are full
+		while (!files.empty() && files.begin()->first < last.segment) {
+			ps::CloseSegmentFile(files.begin()->second);
+			files.erase(files.begin());
+		}
+
+		// Handed back zeroed, so padding is always zeros
+		for (size_t i = 0; i < count; ++i) {
+			auto& buffer = buffers[(next + i) % config.numBuffers];
+			std::memset(buffer.data, 0, RoundUp(buffer.size));
+			buffer.flushed.store(false, std::memory_order_release);
+		}
+		next = (next + count) % config.numBuffers;
+	}
+
+	for (const auto& file : files) {
+		ps::CloseSegmentFile(file.second);
+	}
+}
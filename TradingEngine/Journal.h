@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Message.h"
+#include "PlatformSpecific/page_memory.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+struct JournalConfig {
+	std::string directory; // Must already exist
+	size_t segmentSize = 64 * 1024 * 1024; // Each segment file is allocated up front
+	size_t bufferSize = 1024 * 1024; // Most a single flush can hold, records can't be bigger
+	size_t numBuffers = 8; // Filled while earlier ones are being written
+	bool directIo = true; // O_DIRECT, where the filesystem supports it
+	bool ioUring = true; // Otherwise (or where it isn't available) pwrite and fdatasync
+	std::chrono::microseconds writerIdleSleep{ 20 }; // Between checks for flushed buffers
+};
+
+struct JournalStats {
+	uint64_t numBatches = 0; // Each written and synced together
+	uint64_t numBytesWritten = 0; // Including the padding to the end of each flush's last block
+	uint64_t numStalls = 0; // Times the matching thread had to wait for a buffer to be written
+	bool ioUring = false;
+	bool directIo = false;
+};
+
+// An append only log of records (i.e the input messages) across fixed size, preallocated
+// segment files. Appending only copies the record into a buffer and Flush() hands the buffer
+// over with an atomic store, so neither makes a system call. A writer thread picks up
+// whatever has been flushed, writes it with io_uring (or pwrite) and fdatasyncs it, as one
+// batch, then publishes the sequence of the last record now durable. The engine loop polls
+// GetDurableSequence() to acknowledge everything up to it.
+//
+// Every flush is padded to the next 4KB block, which direct I/O needs. Record headers never
+// cross a block, so the reader can tell padding (zeros) from a record.
+//
+// Not thread safe, appending and flushing must be done by one thread.
+class Journal {
+public:
+	using RecordHandler = std::function<void(uint64_t sequence, std::string_view record)>;
+
+	// Carries on from the records already in the directory, in a new segment.
+	// Throws Error::Type::JournalFailed if the config is invalid.
+	explicit Journal(const JournalConfig& config);
+	~Journal(); // Flushes and waits for everything to be written
+
+	Journal(const Journal&) = delete;
+	Journal& operator=(const Journal&) = delete;
+
+	// Returns the record's sequence, they start at 1. Only waits if every buffer has been
+	// flushed and not written yet. Throws Error::Type::JournalFailed if the record is bigger
+	// than a buffer or a write has failed.
+	uint64_t Append(const void* data, size_t size);
+
+	// In the raw format (see MessageCodec.h), the message followed by its attachment
+	uint64_t Append(const Message& message);
+
+	void Flush();
+
+	uint64_t GetLastSequence() const;
+	uint64_t GetDurableSequence() const;
+
+	// Flushes and blocks until every record appended so far is durable, for shutting down
+	void Sync();
+
+	JournalStats GetStats() const;
+
+	// Calls the handler for every record in the directory in order, stopping at the first one
+	// which wasn't completely written. Returns the last sequence read, 0 if there were none.
+	static uint64_t Read(const std::string& directory, const RecordHandler& handler);
+
+	// The other way to Append(const Message&), the attachment is put back as well. Returns false
+	// if the record isn't a message.
+	static bool DecodeMessage(std::string_view record, Message* message);
+
+private:
+	struct Buffer {
+		char* data = nullptr;
+		uint64_t segment = 0;
+		uint64_t offset = 0; // In the segment, always a whole number of blocks
+		size_t size = 0; // Used so far
+		uint64_t lastSequence = 0;
+		std::atomic<bool> flushed{ false }; // Until the writer has written it
+	};
+
+	JournalConfig config;
+	ps::PageMapping memory;
+	std::unique_ptr<Buffer[]> buffers;
+	size_t current = 0;
+	uint64_t lastSequence = 0;
+
+	// Shared with the writer thread
+	std::atomic<uint64_t> durableSequence{ 0 };
+	std::atomic<bool> failed{ false };
+	std::atomic<bool> stopping{ false };
+	std::atomic<uint64_t> numBatches{ 0 };
+	std::atomic<uint64_t> numBytesWritten{ 0 };
+	std::atomic<uint64_t> numStalls{ 0 };
+	std::atomic<bool> ioUring{ false };
+	std::atomic<bool> directIo{ false };
+	std::thread writer;
+
+	char* AppendRecord(size_t size);
+	void NextBuffer(bool nextSegment);
+	void Write();
+};
@@ -0,0 +1,87 @@
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram() {
+	Reset();
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+	value = std::min(value, maxValue);
+	counts[GetIndex(value)].fetch_add(1, std::memory_order_relaxed);
+	totalCount.fetch_add(1, std::memory_order_relaxed);
+
+	auto currentMin = min.load(std::memory_order_relaxed);
+	while (value < currentMin && !min.compare_exchange_weak(currentMin, value, std::memory_order_relaxed)) {
+	}
+
+	auto currentMax = max.load(std::memory_order_relaxed);
+	while (value > currentMax && !max.compare_exchange_weak(currentMax, value, std::memory_order_relaxed)) {
+	}
+}
+
+void LatencyHistogram::Reset() {
+	for (auto& count : counts) {
+		count.store(0, std::memory_order_relaxed);
+	}
+
+	totalCount.store(0, std::memory_order_relaxed);
+	min.store(UINT64_MAX, std::memory_order_relaxed);
+	max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+	return totalCount.load(std::memory_order_relaxed);
+}
+
+// 0 if nothing has been recorded
+uint64_t LatencyHistogram::GetMin() const {
+	return (GetCount() == 0) ? 0 : min.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+	return max.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::ValueAtPercentile(double percentile) const {
+	auto total = GetCount();
+	if (total == 0) {
+		return 0;
+	}
+
+	percentile = std::clamp(percentile, 0.0, 100.0);
+	auto countAtPercentile = static_cast<uint64_t>(std::ceil(percentile / 100.0 * total));
+	countAtPercentile = std::max<uint64_t>(countAtPercentile, 1);
+
+	uint64_t runningCount = 0;
+	for (int i = 0; i < numCounts; ++i) {
+		runningCount += counts[i].load(std::memory_order_relaxed);
+		if (runningCount >= countAtPercentile) {
+			// Never report more than was actually seen
+			return std::min(HighestEquivalentValue(i), GetMax());
+		}
+	}
+
+	return GetMax();
+}
+
+// The first 2 sub bucket halves are an exact 1:1 mapping, after that each power of 2 gets
+// another half, with values in it shifted down by the power.
+int LatencyHistogram::GetIndex(uint64_t value) {
+	int bucket = 0;
+	auto shifted = value >> subBucketBits;
+	while (shifted != 0) {
+		++bucket;
+		shifted >>= 1;
+	}
+
+	auto subBucket = static_cast<int>(value >> bucket);
+	return bucket * subBucketHalfCount + subBucket;
+}
+
+uint64_t LatencyHistogram::HighestEquivalentValue(int index) {
+	auto bucket = std::max(0, index / subBucketHalfCount - 1);
+	auto subBucket = static_cast<uint64_t>(index - bucket * subBucketHalfCount);
+	return ((subBucket + 1) << bucket) - 1;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// A lock-free HDR (high dynamic range) histogram of durations in timestamp ticks.
+// Values are bucketed by power of 2, with each power of 2 split into a fixed number of linear
+// sub buckets, so the relative error is bounded (~1%) regardless of magnitude.
+// Recording is a single relaxed atomic increment, so it can be read while being written.
+class LatencyHistogram {
+public:
+	LatencyHistogram();
+
+	void Record(uint64_t value);
+	void Reset();
+
+	uint64_t GetCount() const;
+	uint64_t GetMin() const;
+	uint64_t GetMax() const;
+
+	// The highest value equivalent to the bucket containing this percentile (0-100)
+	uint64_t ValueAtPercentile(double percentile) const;
+
+private:
+	constexpr static int subBucketBits = 7;
+	constexpr static int subBucketHalfCount = 1 << (subBucketBits - 1);
+
+	// Anything above this is clamped (~5 seconds at 3 GHz)
+	constexpr static int maxValueBits = 34;
+	constexpr static uint64_t maxValue = (uint64_t(1) << maxValueBits) - 1;
+	constexpr static int numBuckets = maxValueBits - subBucketBits + 1;
+	constexpr static int numCounts = (numBuckets + 1) * subBucketHalfCount;
+
+	std::array<std::atomic<uint64_t>, numCounts> counts;
+	std::atomic<uint64_t> totalCount{ 0 };
+	std::atomic<uint64_t> min{ UINT64_MAX };
+	std::atomic<uint64_t> max{ 0 };
+
+	static int GetIndex(uint64_t value);
+	static uint64_t HighestEquivalentValue(int index);
+};
@@ -0,0 +1,68 @@
+#include "LatencyStats.h"
+
+const char* ToString(LatencyStage stage) {
+	switch (stage) {
+		case LatencyStage::ValidateFunds:
+			return "ValidateFunds";
+		case LatencyStage::ValidateSameUserOrder:
+			return "ValidateSameUserOrder";
+		case LatencyStage::Process:
+			return "Process";
+		case LatencyStage::CommitChanges:
+			return "CommitChanges";
+		case LatencyStage::Translate:
+			return "Translate";
+		default:
+			return "Unknown";
+	}
+}
+
+const char* ToString(OrderType orderType) {
+	switch (orderType) {
+		case OrderType::Limit:
+			return "LimitOrder";
+		case OrderType::Market:
+			return "MarketOrder";
+		case OrderType::StopLimit:
+			return "StopLimitOrder";
+		default:
+			return "Unknown";
+	}
+}
+
+LatencyHistogram& MarketLatencyStats::Get(OrderType orderType, LatencyStage stage) {
+	return histograms[static_cast<int>(orderType)][static_cast<int>(stage)];
+}
+
+const LatencyHistogram& MarketLatencyStats::Get(OrderType orderType, LatencyStage stage) const {
+	return histograms[static_cast<int>(orderType)][static_cast<int>(stage)];
+}
+
+void MarketLatencyStats::Reset() {
+	for (auto& stages : histograms) {
+		for (auto& histogram : stages) {
+			histogram.Reset();
+		}
+	}
+}
+
+void MarketLatencyStats::Dump(std::ostream& os, const CoinPair& coinPair) const {
+	for (int orderType = 0; orderType < numOrderTypes; ++orderType) {
+		for (int stage = 0; stage < static_cast<int>(LatencyStage::Count); ++stage) {
+			const auto& histogram = histograms[orderType][stage];
+			if (histogram.GetCount() == 0) {
+				continue;
+			}
+
+			os << coinPair.GetCoinId() << "/" << coinPair.GetBaseId() << " "
+			   << ToString(static_cast<OrderType>(orderType)) << " "
+			   << ToString(static_cast<LatencyStage>(stage))
+			   << " count=" << histogram.GetCount()
+			   << " min=" << histogram.GetMin()
+			   << " p50=" << histogram.ValueAtPercentile(50.0)
+			   << " p99=" << histogram.ValueAtPercentile(99.0)
+			   << " p99.9=" << histogram.ValueAtPercentile(99.9)
+			   << " max=" << histogram.GetMax() << "\n";
+		}
+	}
+}
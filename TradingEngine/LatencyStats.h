@@ -0,0 +1,83 @@
+#pragma once
+
+#include "CoinPair.h"
+#include "LatencyHistogram.h"
+#include "Orders/OrderType.h"
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#ifdef TRADING_ENGINE_LATENCY_STATS
+#include "PlatformSpecific/timestamp.h"
+#endif
+
+// Per stage timing of order processing, compiled in with TRADING_ENGINE_LATENCY_STATS.
+// When it is not defined LATENCY_TIMER expands to nothing and markets have no stats member,
+// so there is no cost to leaving the calls in.
+#ifdef TRADING_ENGINE_LATENCY_STATS
+constexpr bool latencyStatsEnabled = true;
+#else
+constexpr bool latencyStatsEnabled = false;
+#endif
+
+enum class LatencyStage {
+	ValidateFunds,
+	ValidateSameUserOrder,
+	Process,
+	CommitChanges,
+	Translate, // Listener operations to output messages
+	Count
+};
+
+const char* ToString(LatencyStage stage);
+const char* ToString(OrderType orderType);
+
+// One histogram per order type (what the message was) and stage
+class MarketLatencyStats {
+public:
+	LatencyHistogram& Get(OrderType orderType, LatencyStage stage);
+	const LatencyHistogram& Get(OrderType orderType, LatencyStage stage) const;
+
+	void Reset();
+
+	// A line per histogram which has anything recorded
+	void Dump(std::ostream& os, const CoinPair& coinPair) const;
+
+private:
+	constexpr static int numOrderTypes = 3;
+	std::array<std::array<LatencyHistogram, static_cast<int>(LatencyStage::Count)>, numOrderTypes> histograms;
+};
+
+#ifdef TRADING_ENGINE_LATENCY_STATS
+// Records the time from construction until it goes out of scope (including by exception)
+class ScopedLatencyTimer {
+public:
+	ScopedLatencyTimer(MarketLatencyStats* stats, OrderType orderType, LatencyStage stage) :
+	stats(stats),
+	orderType(orderType),
+	stage(stage),
+	start(ps::ReadTimestamp()) {
+	}
+
+	~ScopedLatencyTimer() {
+		if (stats) {
+			stats->Get(orderType, stage).Record(ps::ReadTimestamp() - start);
+		}
+	}
+
+	ScopedLatencyTimer(const ScopedLatencyTimer&) = delete;
+	ScopedLatencyTimer& operator=(const ScopedLatencyTimer&) = delete;
+
+private:
+	MarketLatencyStats* stats;
+	OrderType orderType;
+	LatencyStage stage;
+	uint64_t start;
+};
+
+#define LATENCY_TIMER(stats, orderType, stage) \
+	ScopedLatencyTimer latencyTimer { stats, orderType, stage }
+#else
+#define LATENCY_TIMER(stats, orderType, stage)
+#endif
@@ -0,0 +1,34 @@
+#include "NullListener.h"
+
+void NullListener::OrderFilled(int64_t) {
+}
+
+void NullListener::NewOpenOrder(const ListenerOrder&, OrderAction) {
+}
+
+void NullListener::NewTrade(int64_t, int64_t, int64_t, int64_t, int64_t, const Fee&) {
+}
+
+void NullListener::NewFilledOrder(const ListenerOrder&, OrderAction) {
+}
+
+void NullListener::PartialFill(int64_t, int64_t) {
+}
+
+void NullListener::StopLimitTriggered(int64_t, int64_t) {
+}
+
+const std::vector<Operation>& NullListener::GetOperations() const {
+	return operations;
+}
+
+void NullListener::ClearOperations() {
+}
+
+bool NullListener::Equals(const IListener& listener) const {
+	return (dynamic_cast<const NullListener*>(&listener) != nullptr);
+}
+
+std::unique_ptr<IListener> NullListener::Clone() const {
+	return std::make_unique<NullListener>();
+}
@@ -8,6 +8,8 @@ type(type),
 listenerOrder(
 // Limit is just a dummy value...
 { tradeId, buyOrderId, sellOrderId, amount, 0, price, -1, OrderType::Limit }) {
+	// The constructor only sets the 32 bits of userId it shares
+	listenerOrder.sellOrderId = sellOrderId;
 	listenerOrder.fees = fees;
 }
 
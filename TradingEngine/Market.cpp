@@ -4,6 +4,8 @@
 #include "Fee.h"
 #include "IWallet.h"
 #include "Listener/IListener.h"
+#include "Listener/NullListener.h"
+#include "PlatformSpecific/prefetch.h"
 #include "SimulatorTrade.h"
 #include "Units.h"
 
@@ -21,6 +23,8 @@ config(config) {
 	if (coinPair.GetBaseId() == coinPair.GetCoinId()) {
 		throw Error(Error::Type::CoinIdsSame, "Base and Coin Id are the same...");
 	}
+
+	feeSchedule.SetStandardFee(config.feeDivision);
 }
 
 Market::Market(std::unique_ptr<IListener>&& listener, const CoinPair& coinPair,
@@ -32,22 +36,13 @@ Market::Market(const Market& market) {
 	listener = market.listener->Clone();
 	coinPair = market.coinPair;
 
-	buyLimitOrderMap = market.buyLimitOrderMap;
-	sellLimitOrderMap = market.sellLimitOrderMap;
-
-	buyStopLimitOrderMap = market.buyStopLimitOrderMap;
-	sellStopLimitOrderMap = market.sellStopLimitOrderMap;
-
-	// This is a map of user ids with a collection of all the orders they have open
-	userOrderMap = market.userOrderMap;
-
-	currentOrderId = market.currentOrderId;
-	currentTradeId = market.currentTradeId;
+	// Orders, the users' orders, ids, reservations and the simulator
+	*book = *market.book;
+	book->reservationTotal = nullptr;
+	LinkUserOrders();
 
 	config = market.config;
-
-	// This contains the changes that will be committed later after processing successfully
-	simulator = market.simulator;
+	feeSchedule = market.feeSchedule;
 }
 
 Market& Market::operator=(const Market& other) {
@@ -58,41 +53,92 @@ Market& Market::operator=(const Market& other) {
 
 // Clean set up before any processing should be done
 void Market::PreProcess() const {
-	simulator.SetCurrentOrderId(currentOrderId);
-	simulator.SetCurrentTradeId(currentTradeId);
+	book->simulator.SetCurrentOrderId(book->currentOrderId);
+	book->simulator.SetCurrentTradeId(book->currentTradeId);
 }
 
 // This is the main entry point.
 template <OrderAction Side, class Order>
 void Market::NewProcess(const OrderContainer<Order>& orderContainer,
 MarketWallets* marketWallets) {
+	modified = true;
 	PreProcess();
 
 	ValidateFunds<Side>(marketWallets, orderContainer);
 
 	ValidateSameUserOrder<Side>(orderContainer);
 
-	const_cast<Order&>(orderContainer.order).SetId(simulator.GetCurrentOrderId());
+	const_cast<Order&>(orderContainer.order).SetId(book->simulator.GetCurrentOrderId());
 
 	try {
+		LATENCY_TIMER(latencyStats.get(), GetOrderType<Order>(), LatencyStage::Process);
 		Process<Side>(orderContainer, marketWallets);
-		simulator.IncrementOrderId();
+		book->simulator.IncrementOrderId();
+	} catch (...) {
+		book->simulator.Clear();
+		throw; // Rethrow exception
+	}
+
+	PostProcess<Side, Order>(marketWallets);
+}
+
+// Runs the matching part of processing against the live book, the simulator stages the fills
+// as usual but they are never committed. The listener is swapped out so nobody is told about it.
+template <OrderAction Side, class Order>
+OrderQuote Market::Quote(const OrderContainer<Order>& inOrderContainer) {
+	static_assert(!IsStopLimitOrder_v<Order>, "Stop-limit orders don't match when placed");
+
+	PreProcess();
+
+	OrderContainer<Order> orderContainer = inOrderContainer;
+	orderContainer.order.SetId(book->simulator.GetCurrentOrderId());
+
+	auto liveListener = std::exchange(listener, std::make_unique<NullListener>());
+	int64_t lastTradePrice = -1;
+	try {
+		if constexpr (Side == OrderAction::Buy) {
+			ConsumeOrderBook<Side, Order, std::less<int64_t>, std::less_equal<int64_t>>(&orderContainer,
+			&lastTradePrice, book->sellLimitOrderMap);
+		} else {
+			ConsumeOrderBook<Side, Order, std::greater<int64_t>, std::greater_equal<int64_t>>(
+			&orderContainer, &lastTradePrice, book->buyLimitOrderMap);
+		}
 	} catch (...) {
-		simulator.Clear();
+		listener = std::move(liveListener);
+		book->simulator.Clear();
 		throw; // Rethrow exception
 	}
 
-	PostProcess<Side>(orderContainer, marketWallets);
+	listener = std::move(liveListener);
+
+	OrderQuote quote;
+	quote.fills = book->simulator.GetTrades();
+	quote.filled = orderContainer.order.GetFilled();
+	quote.remaining = orderContainer.order.GetRemaining();
+
+	// 128-bit as the sum of amount * price can exceed int64 for large orders
+	__int128 weightedPrice = 0;
+	for (const auto& fill : quote.fills) {
+		weightedPrice += static_cast<__int128>(fill.amount) * fill.price;
+		quote.fees.buyFee += fill.fees.buyFee;
+		quote.fees.sellFee += fill.fees.sellFee;
+	}
+
+	if (quote.filled != 0) {
+		quote.averagePrice = static_cast<int64_t>(weightedPrice / quote.filled);
+	}
+
+	book->simulator.Clear();
+	return quote;
 }
 
 // Actually make the changes from the simulator
 template <OrderAction Side, class Order>
-void Market::PostProcess(const OrderContainer<Order>& orderContainer,
-MarketWallets* marketWallets) {
-	currentOrderId = simulator.GetCurrentOrderId();
-	currentTradeId = simulator.GetCurrentTradeId();
-	CommitChanges<Side>(orderContainer, marketWallets);
-	simulator.Clear();
+void Market::PostProcess(MarketWallets* marketWallets) {
+	book->currentOrderId = book->simulator.GetCurrentOrderId();
+	book->currentTradeId = book->simulator.GetCurrentTradeId();
+	CommitChanges<Side, Order>(marketWallets);
+	book->simulator.Clear();
 }
 
 void Market::SetListener(std::unique_ptr<IListener>&& listener) {
@@ -103,6 +149,8 @@ void Market::SetListener(std::unique_ptr<IListener>&& listener) {
 template <OrderAction Side, class T>
 void Market::ValidateFunds(MarketWallets* marketWallets,
 const OrderContainer<T>& orderContainer) const {
+	LATENCY_TIMER(latencyStats.get(), GetOrderType<T>(), LatencyStage::ValidateFunds);
+
 	if constexpr (Side == OrderAction::Buy) {
 		auto address = marketWallets->baseWallet->GetAddress(orderContainer.order.GetUserId());
 		auto availableBalance = address->GetAvailableBalance();
@@ -119,37 +167,39 @@ const OrderContainer<T>& orderContainer) const {
 // "Process*Order". Throws if order is not valid
 template <OrderAction Side, class Order>
 void Market::ValidateSameUserOrder(const OrderContainer<Order>& orderContainer) {
+	LATENCY_TIMER(latencyStats.get(), GetOrderType<Order>(), LatencyStage::ValidateSameUserOrder);
+
 	if constexpr (IsStopLimitOrder_v<Order>) {
 		// Check that this user does not have any existing limit orders in the other order book,
 		// which may cause this stop-limit order to execute that one (i.e trade with yourself).
 		auto limitOrderPrice = orderContainer.order.GetActualPrice();
-		auto it = userOrderMap.find(orderContainer.order.GetUserId());
-		if (it == userOrderMap.end()) {
+		auto it = book->userOrderMap.find(orderContainer.order.GetUserId());
+		if (it == book->userOrderMap.end()) {
 			return;
 		}
 
 		// Found
 		const auto& userOrders = it->second;
 		if constexpr (Side == OrderAction::Buy) {
-			Check(sellLimitOrderMap.key_comp(), userOrders.sellLimitPrices, limitOrderPrice);
+			Check(book->sellLimitOrderMap.key_comp(), userOrders.sellLimitPrices, limitOrderPrice);
 		} else {
-			Check(buyLimitOrderMap.key_comp(), userOrders.buyLimitPrices, limitOrderPrice);
+			Check(book->buyLimitOrderMap.key_comp(), userOrders.buyLimitPrices, limitOrderPrice);
 		}
 	} else if constexpr (IsLimitOrder_v<Order>) {
 		// Check that this user does not have any existing limit orders in the other order book,
 		// which may cause this stop-limit order to execute that one (i.e trade with yourself).
 		auto limitOrderPrice = orderContainer.GetPrice();
-		auto it = userOrderMap.find(orderContainer.order.GetUserId());
-		if (it == userOrderMap.end()) {
+		auto it = book->userOrderMap.find(orderContainer.order.GetUserId());
+		if (it == book->userOrderMap.end()) {
 			return;
 		}
 
 		// Found
 		const auto& userOrders = it->second;
 		if constexpr (Side == OrderAction::Buy) {
-			Check(sellStopLimitOrderMap.key_comp(), userOrders.sellStopLimitPrices, limitOrderPrice);
+			Check(book->sellStopLimitOrderMap.key_comp(), userOrders.sellStopLimitPrices, limitOrderPrice);
 		} else {
-			Check(buyStopLimitOrderMap.key_comp(), userOrders.buyStopLimitPrices, limitOrderPrice);
+			Check(book->buyStopLimitOrderMap.key_comp(), userOrders.buyStopLimitPrices, limitOrderPrice);
 		}
 	}
 }
@@ -172,44 +222,71 @@ int64_t price) {
 	}
 }
 
+// What a resting order holds in its user's wallet (and the book's reservations). Buys hold the
+// notional of what's left at their limit price in the base coin, sells what's left of the coin.
+template <OrderAction Side, class Order>
+int64_t InOrderAmount(const Order& order, int64_t price) {
+	if constexpr (Side == OrderAction::Sell) {
+		return order.GetRemaining();
+	} else if constexpr (IsStopLimitOrder_v<Order>) {
+		return Units::Multiply(order.GetRemaining(), order.GetActualPrice());
+	} else {
+		return Units::Multiply(order.GetRemaining(), price);
+	}
+}
+
+// The order in its price level, end() if it isn't there. It's found straight from the handle when
+// there is one, the level is only searched for orders which aren't linked yet (or when only the
+// id is known, i.e cancelling or amending a single order).
+template <class Orders>
+auto FindOrder(Orders& orders, const PriceOrderId& priceOrderId) {
+	if (priceOrderId.handle != NodePool::nullHandle) {
+		return orders.FromHandle(priceOrderId.handle);
+	}
+
+	return std::find_if(orders.begin(), orders.end(), [id = priceOrderId.orderId](const auto& order) {
+		return (id == order.GetId());
+	});
+}
+
 template <>
 void Market::Process<OrderAction::Buy>(const OrderContainer<MarketOrder>& orderContainer,
 MarketWallets* marketWallets) const {
-	ProcessMarketOrder<OrderAction::Buy>(orderContainer, sellLimitOrderMap,
-	buyStopLimitOrderMap, marketWallets);
+	ProcessMarketOrder<OrderAction::Buy>(orderContainer, book->sellLimitOrderMap,
+	book->buyStopLimitOrderMap, marketWallets);
 }
 
 template <>
 void Market::Process<OrderAction::Sell>(const OrderContainer<MarketOrder>& orderContainer,
 MarketWallets* marketWallets) const {
-	ProcessMarketOrder<OrderAction::Sell>(orderContainer, buyLimitOrderMap,
-	sellStopLimitOrderMap, marketWallets);
+	ProcessMarketOrder<OrderAction::Sell>(orderContainer, book->buyLimitOrderMap,
+	book->sellStopLimitOrderMap, marketWallets);
 }
 
 template <>
 void Market::Process<OrderAction::Buy>(const OrderContainer<LimitOrder>& orderContainer,
 MarketWallets* marketWallets) const {
-	ProcessLimitOrder<OrderAction::Buy>(orderContainer, sellLimitOrderMap, buyStopLimitOrderMap,
+	ProcessLimitOrder<OrderAction::Buy>(orderContainer, book->sellLimitOrderMap, book->buyStopLimitOrderMap,
 	marketWallets);
 }
 
 template <>
 void Market::Process<OrderAction::Sell>(const OrderContainer<LimitOrder>& orderContainer,
 MarketWallets* marketWallets) const {
-	ProcessLimitOrder<OrderAction::Sell>(orderContainer, buyLimitOrderMap,
-	sellStopLimitOrderMap, marketWallets);
+	ProcessLimitOrder<OrderAction::Sell>(orderContainer, book->buyLimitOrderMap,
+	book->sellStopLimitOrderMap, marketWallets);
 }
 
 template <>
 void Market::Process<OrderAction::Buy>(const OrderContainer<StopLimitOrder>& orderContainer,
 MarketWallets* marketWallets) const {
-	ProcessStopLimitOrder<OrderAction::Buy>(orderContainer, sellLimitOrderMap, buyStopLimitOrderMap);
+	ProcessStopLimitOrder<OrderAction::Buy>(orderContainer, book->sellLimitOrderMap, book->buyStopLimitOrderMap);
 }
 
 template <>
 void Market::Process<OrderAction::Sell>(const OrderContainer<StopLimitOrder>& orderContainer,
 MarketWallets* marketWallets) const {
-	ProcessStopLimitOrder<OrderAction::Sell>(orderContainer, buyLimitOrderMap, sellStopLimitOrderMap);
+	ProcessStopLimitOrder<OrderAction::Sell>(orderContainer, book->buyLimitOrderMap, book->sellStopLimitOrderMap);
 }
 
 template <OrderAction Side, class Comp>
@@ -239,8 +316,8 @@ MarketWallets* marketWallets) const {
 }
 
 int32_t Market::NumLimitOpenOrders(int32_t userId) const {
-	auto it = userOrderMap.find(userId);
-	if (it == userOrderMap.end()) {
+	auto it = book->userOrderMap.find(userId);
+	if (it == book->userOrderMap.end()) {
 		return 0;
 	}
 
@@ -249,8 +326,8 @@ int32_t Market::NumLimitOpenOrders(int32_t userId) const {
 }
 
 int32_t Market::NumStopLimitOpenOrders(int32_t userId) const {
-	auto it = userOrderMap.find(userId);
-	if (it == userOrderMap.end()) {
+	auto it = book->userOrderMap.find(userId);
+	if (it == book->userOrderMap.end()) {
 		return 0;
 	}
 
@@ -303,7 +380,7 @@ MarketWallets* marketWallets) const {
 
 	if (orderContainer.order.GetRemaining() != 0) {
 		NewOpenOrder<Side>(orderContainer);
-		simulator.InsertLimitOrder(orderContainer.GetPrice(), orderContainer.order);
+		book->simulator.InsertLimitOrder(orderContainer.GetPrice(), orderContainer.order);
 	}
 
 	KickOffStopOrders<Side>(stopLimitOrders, lastTradePrice, marketWallets);
@@ -322,7 +399,7 @@ const StopLimitOrderMap<Comp>& stopLimitOrders) const {
 		"Buy stop limit price is lower than the current ask order or"
 		" sell stop price is higher than current bid order");
 	} else {
-		simulator.SetInsertedStopLimitOrder(orderContainer.price, orderContainer.order);
+		book->simulator.SetInsertedStopLimitOrder(orderContainer.price, orderContainer.order);
 		NewOpenOrder<Side>(orderContainer);
 	}
 }
@@ -348,7 +425,7 @@ int64_t lastTradePrice, MarketWallets* marketWallets) const {
 	LimitOrderMap<Comp> convertedStopToLimitOrderMap;
 
 	// Firstly skip the number of stop limit orders to remove
-	auto numTriggeredStopOrders = simulator.GetNumTriggeredStopOrders();
+	auto numTriggeredStopOrders = book->simulator.GetNumTriggeredStopOrders();
 
 	// Initially skip the ones which have already been processed
 	auto it = stopLimitOrderMap.cbegin();
@@ -374,7 +451,7 @@ int64_t lastTradePrice, MarketWallets* marketWallets) const {
 			for (auto& stopLimitOrder : stopLimitOrders) {
 				auto limitOrder = ConvertToLimitOrder(stopLimitOrder);
 				convertedStopToLimitOrders.push_back({ limitOrder, stopLimitOrder.GetActualPrice() });
-				simulator.IncrementNumTriggeredStopOrders();
+				book->simulator.IncrementNumTriggeredStopOrders();
 			}
 		} else {
 			break;
@@ -382,7 +459,7 @@ int64_t lastTradePrice, MarketWallets* marketWallets) const {
 		++it;
 	}
 
-	auto triggeredTradeId = simulator.GetCurrentTradeId() - 1;
+	auto triggeredTradeId = book->simulator.GetCurrentTradeId() - 1;
 	for (auto& limitOrderContainer : convertedStopToLimitOrders) {
 		listener->StopLimitTriggered(limitOrderContainer.order.GetId(), triggeredTradeId);
 		Process<Side, LimitOrder>(limitOrderContainer, marketWallets);
@@ -394,25 +471,19 @@ void Market::ConsumeOrderBook(OrderContainer<T>* orderContainer, int64_t* lastTr
 const LimitOrderMap<Comp>& limitOrderMap) const {
 	auto& order = orderContainer->order;
 
-	// Firstly skip the number of limit orders to remove
-	auto numLimitOrdersToRemove = simulator.GetNumLimitOrdersToRemove();
-
-	// Initially skip the ones which have already been processed
+	// Initially skip the levels which have already been consumed (by the orders processed before
+	// this one in the same batch, i.e the stop orders it triggered)
+	auto numLimitOrdersToRemove = book->simulator.GetNumLimitOrdersToRemove();
 	auto it = limitOrderMap.cbegin();
-	for (; it != limitOrderMap.cend(); ++it) {
-		if (numLimitOrdersToRemove != 0) {
-			auto count = static_cast<int>(it->second.size());
-			if (numLimitOrdersToRemove > count) {
-				numLimitOrdersToRemove -= count;
-			} else {
-				auto orderIter = it->second.begin();
-				Consume<Side>(orderContainer, it->first, lastTradePrice, orderIter + numLimitOrdersToRemove, it->second.end());
-				++it;
-				break;
-			}
-		} else {
-			break;
-		}
+	while (numLimitOrdersToRemove != 0 && it != limitOrderMap.cend() && numLimitOrdersToRemove >= it->second.size()) {
+		numLimitOrdersToRemove -= it->second.size();
+		++it;
+	}
+
+	// Then carry on from where the last one stopped part way through a level
+	if (numLimitOrdersToRemove != 0 && it != limitOrderMap.cend()) {
+		Consume<Side>(orderContainer, it->first, lastTradePrice, book->simulator.GetNextLimitOrder(), it->second.end());
+		++it;
 	}
 
 	// Now process the rest
@@ -429,6 +500,12 @@ const LimitOrderMap<Comp>& limitOrderMap) const {
 				}
 			}
 
+			// Start loading the first order of the next price level while this one is consumed
+			auto next = std::next(it);
+			if (next != limitOrderMap.cend() && !next->second.empty()) {
+				ps::Prefetch(&next->second.front());
+			}
+
 			// Will this order consume a price in the book?
 			bool finishedOrder = Consume<Side>(orderContainer, price, lastTradePrice,
 			limitOrders.begin(), limitOrders.end());
@@ -453,8 +530,8 @@ int64_t origOrderId, int64_t orderId, int64_t origUserId, int32_t userId) const
 
 template <OrderAction Side, class T>
 bool Market::Consume(OrderContainer<T>* orderContainer, int64_t price, int64_t* lastTradePrice,
-typename std::deque<LimitOrder>::const_iterator start,
-typename std::deque<LimitOrder>::const_iterator end) const {
+Orders<LimitOrder>::const_iterator start,
+Orders<LimitOrder>::const_iterator end) const {
 	auto& order = orderContainer->order;
 	auto orderIter = start;
 	while (orderIter != end) {
@@ -462,23 +539,35 @@ typename std::deque<LimitOrder>::const_iterator end) const {
 			throw Error(Error::Type::TradeSameUser, "Cannot trade your own order");
 		}
 
-		auto orderTotalCoins = orderIter->GetRemaining() - simulator.GetLastFill();
+		auto orderTotalCoins = orderIter->GetRemaining() - book->simulator.GetLastFill();
 		*lastTradePrice = price; // TODO: Seems redundant
 		auto orderRemaining = order.GetRemaining();
 
 		auto [buyId, sellId, buyUserId, sellUserId] = ConsumeHelper<Side>(order.GetId(),
 		orderIter->GetId(), order.GetUserId(), orderIter->GetUserId());
 
+		// What each fill releases of the resting order's in order, see InOrderAmount. Taking the
+		// difference means the releases add up to exactly what was reserved.
+		auto makerInOrder = [orderTotalCoins, price](int64_t fill) {
+			if constexpr (Side == OrderAction::Sell) {
+				return Units::Multiply(orderTotalCoins, price) - Units::Multiply(orderTotalCoins - fill, price);
+			} else {
+				return fill;
+			}
+		};
+
 		if (orderTotalCoins > orderRemaining) {
 			// Eat into it
-			simulator.AddToLastFill(orderRemaining);
+			book->simulator.AddToLastFill(orderRemaining);
 			order.AddToFill(orderRemaining);
-			auto fees = CalculateFees(orderRemaining, price);
-			listener->NewTrade(simulator.GetCurrentTradeId(), buyId, sellId, orderRemaining, price,
+			auto fees = CalculateFees<Side>(orderRemaining, price, buyUserId, sellUserId);
+			listener->NewTrade(book->simulator.GetCurrentTradeId(), buyId, sellId, orderRemaining, price,
 			fees);
-			simulator.AddTrade(buyUserId, sellUserId, orderRemaining, price, fees);
+			book->simulator.AddTrade(buyUserId, sellUserId, orderRemaining, price, fees,
+			makerInOrder(orderRemaining));
 			listener->PartialFill(orderIter->GetId(), orderRemaining);
-			simulator.IncrementTradeId();
+			book->simulator.IncrementTradeId();
+			book->simulator.SetNextLimitOrder(orderIter);
 
 			// TODO, make this a template listener->NewFilledOrder<Side>(); ?
 			if constexpr (Side == OrderAction::Buy) {
@@ -490,19 +579,21 @@ typename std::deque<LimitOrder>::const_iterator end) const {
 			return true;
 		} else {
 			// Consume the whole order
-			simulator.IncrementNumLimitOrdersToRemove();
-			simulator.SetLastFill(0);
+			book->simulator.IncrementNumLimitOrdersToRemove();
+			book->simulator.SetLastFill(0);
 			order.AddToFill(orderTotalCoins);
-			auto fees = CalculateFees(orderTotalCoins, price);
-			listener->NewTrade(simulator.GetCurrentTradeId(), buyId, sellId, orderTotalCoins, price,
+			auto fees = CalculateFees<Side>(orderTotalCoins, price, buyUserId, sellUserId);
+			listener->NewTrade(book->simulator.GetCurrentTradeId(), buyId, sellId, orderTotalCoins, price,
 			fees);
-			simulator.AddTrade(buyUserId, sellUserId, orderTotalCoins, price, fees);
+			book->simulator.AddTrade(buyUserId, sellUserId, orderTotalCoins, price, fees,
+			makerInOrder(orderTotalCoins));
 			listener->OrderFilled(orderIter->GetId());
-			simulator.IncrementTradeId();
+			book->simulator.IncrementTradeId();
 
 			// This might have consumed the rest of the needed orders
 			if (order.GetRemaining() == 0) {
 				listener->OrderFilled(order.GetId());
+				book->simulator.SetNextLimitOrder(std::next(orderIter));
 				return true;
 			}
 
@@ -523,7 +614,7 @@ int64_t availableBalance) const {
 
 	auto remainingBalance = availableBalance;
 
-	for (const auto& [price, sellOrders] : sellLimitOrderMap) {
+	for (const auto& [price, sellOrders] : book->sellLimitOrderMap) {
 		for (const auto& sellOrder : sellOrders) {
 			if (sellOrder.GetUserId() == marketBuyOrder.GetUserId()) {
 				throw Error(Error::Type::TradeSameUser, "Cannot buy your own sell order");
@@ -531,7 +622,7 @@ int64_t availableBalance) const {
 
 			if (sellOrder.GetRemaining() > order.GetRemaining()) {
 				// Eat into the order
-				if (Units::ScaleDown(order.GetRemaining() * price) > remainingBalance) {
+				if (Units::Multiply(order.GetRemaining(), price) > remainingBalance) {
 					throw Error(Error::Type::InsufficientFunds,
 					"User doesn't have enough money to fulfil the market buy order");
 				} else {
@@ -539,11 +630,11 @@ int64_t availableBalance) const {
 				}
 			} else {
 				// Carry onto next order
-				if (Units::ScaleDown(sellOrder.GetRemaining() * price) > remainingBalance) {
+				if (Units::Multiply(sellOrder.GetRemaining(), price) > remainingBalance) {
 					throw Error(Error::Type::InsufficientFunds,
 					"User doesn't have enough money to fulfil the market buy order");
 				} else {
-					remainingBalance -= price * sellOrder.GetRemaining();
+					remainingBalance -= Units::Multiply(sellOrder.GetRemaining(), price);
 					order.AddToFill(sellOrder.GetRemaining());
 				}
 			}
@@ -562,8 +653,8 @@ const OrderContainer<MarketOrder>& orderContainer, int64_t availableBalance) con
 template <>
 void Market::ThrowIfInsufficientFunds<OrderAction::Buy>(
 const OrderContainer<LimitOrder>& orderContainer, int64_t availableBalance) const {
-	auto funds = orderContainer.order.GetRemaining() * orderContainer.GetPrice();
-	if (Units::ScaleDown(funds) > availableBalance) {
+	auto funds = Units::Multiply(orderContainer.order.GetRemaining(), orderContainer.GetPrice());
+	if (funds > availableBalance) {
 		throw Error(Error::Type::InsufficientFunds,
 		"User doesn't have enough coins to make this limit order");
 	}
@@ -572,8 +663,8 @@ const OrderContainer<LimitOrder>& orderContainer, int64_t availableBalance) cons
 template <>
 void Market::ThrowIfInsufficientFunds<OrderAction::Buy>(
 const OrderContainer<StopLimitOrder>& orderContainer, int64_t availableBalance) const {
-	auto funds = orderContainer.order.GetRemaining() * orderContainer.order.GetActualPrice();
-	if (Units::ScaleDown(funds) > availableBalance) {
+	auto funds = Units::Multiply(orderContainer.order.GetRemaining(), orderContainer.order.GetActualPrice());
+	if (funds > availableBalance) {
 		throw Error(Error::Type::InsufficientFunds,
 		"User doesn't have enough coins to make this stop-limit order");
 	}
@@ -582,56 +673,57 @@ const OrderContainer<StopLimitOrder>& orderContainer, int64_t availableBalance)
 template <>
 void Market::CancelOrder<OrderAction::Buy, LimitOrder>(int64_t id, int64_t price,
 MarketWallets* marketWallets) {
-	CancelHelper<OrderAction::Buy, LimitOrder>(buyLimitOrderMap, id, price, marketWallets);
+	CancelHelper<OrderAction::Buy, LimitOrder>(book->buyLimitOrderMap, id, price, marketWallets);
 }
 
 template <>
 void Market::CancelOrder<OrderAction::Sell, LimitOrder>(int64_t id, int64_t price,
 MarketWallets* marketWallets) {
-	CancelHelper<OrderAction::Sell, LimitOrder>(sellLimitOrderMap, id, price, marketWallets);
+	CancelHelper<OrderAction::Sell, LimitOrder>(book->sellLimitOrderMap, id, price, marketWallets);
 }
 
 template <>
 void Market::CancelOrder<OrderAction::Buy, StopLimitOrder>(int64_t id, int64_t price,
 MarketWallets* marketWallets) {
-	CancelHelper<OrderAction::Buy, StopLimitOrder>(buyStopLimitOrderMap, id, price, marketWallets);
+	CancelHelper<OrderAction::Buy, StopLimitOrder>(book->buyStopLimitOrderMap, id, price, marketWallets);
 }
 
 template <>
 void Market::CancelOrder<OrderAction::Sell, StopLimitOrder>(int64_t id, int64_t price,
 MarketWallets* marketWallets) {
-	CancelHelper<OrderAction::Sell, StopLimitOrder>(sellStopLimitOrderMap, id, price, marketWallets);
+	CancelHelper<OrderAction::Sell, StopLimitOrder>(book->sellStopLimitOrderMap, id, price, marketWallets);
 }
 
 // This should only be called for a single remove.
 template <OrderAction Side, class Order, class Comp>
 void Market::CancelHelper(OrderMap<Order, Comp>& orderMap, int64_t id, int64_t price,
 MarketWallets* marketWallets) {
+	modified = true;
 	auto ordersIter = orderMap.find(price);
 	if (ordersIter == orderMap.end()) {
 		throw Error(Error::Type::InvalidIdPrice, "Could not find id and rate combo");
 	}
 
+	// Only the id is known, so the level is searched for it (see FindOrder)
 	auto& orders = ordersIter->second;
-
-	auto limitOrderIter = std::find_if(orders.begin(), orders.end(), [id](const auto& limitOrder) {
-		return (id == limitOrder.GetId());
-	});
-
-	bool foundOrder = (limitOrderIter != orders.end());
-	if (!foundOrder) {
+	auto limitOrderIter = FindOrder(orders, PriceOrderId{ price, id });
+	if (limitOrderIter == orders.end()) {
 		throw Error(Error::Type::InvalidIdPrice, "Could not find id and rate combo");
 	}
 
 	auto userId = limitOrderIter->GetUserId();
+	auto [userOrders, priceOrderIdIter] = FindUserOrder<Side, Order, Comp>(userId, id, price);
+
+	auto inOrder = InOrderAmount<Side>(*limitOrderIter, price);
+	AddToReservations<Side>(-inOrder);
 
 	// Update wallet
 	if constexpr (Side == OrderAction::Buy) {
 		auto address = marketWallets->baseWallet->GetAddress(userId);
-		address->RemoveFromInOrder(limitOrderIter->GetRemaining());
+		address->RemoveFromInOrder(inOrder);
 	} else {
 		auto address = marketWallets->coinWallet->GetAddress(userId);
-		address->RemoveFromInOrder(limitOrderIter->GetRemaining());
+		address->RemoveFromInOrder(inOrder);
 	}
 
 	// If this price point will become empty after removing this order,
@@ -643,16 +735,118 @@ MarketWallets* marketWallets) {
 	}
 
 	// Remove from user id cache..
-	auto& allUserOrders = userOrderMap.at(userId);
-	auto& userOrders = GetUserOrderCacheHelper<Side, Order>(&allUserOrders);
+	userOrders->erase(priceOrderIdIter);
+}
+
+// The order's entry in the user's cache, which must be there
+template <OrderAction Side, class Order, class Comp>
+std::pair<std::vector<PriceOrderId>*, std::vector<PriceOrderId>::iterator> Market::FindUserOrder(
+int32_t userId, int64_t id, int64_t price) {
+	auto it = book->userOrderMap.find(userId);
+	if (it == book->userOrderMap.end()) {
+		throw Error(Error::Type::InvalidIdPrice, "Could not find id and rate combo");
+	}
+
+	auto& userOrders = GetUserOrderCacheHelper<Side, Order>(&it->second);
+	PriceOrderId priceOrderId{ price, id };
 
 	Comp comp;
-	auto itPair = std::equal_range(userOrders.begin(), userOrders.end(),
-	PriceOrderId{ price, id }, CompareUserOrders(comp));
+	auto lb = std::lower_bound(userOrders.begin(), userOrders.end(), priceOrderId, CompareUserOrders(comp));
+	if (lb == userOrders.end() || !(*lb == priceOrderId)) {
+		throw Error(Error::Type::InvalidIdPrice, "Could not find id and rate combo");
+	}
+	return { &userOrders, lb };
+}
 
-	if (itPair.first != itPair.second) { // TODO: Is this needed if there is nothing to remove?
-		userOrders.erase(itPair.first, itPair.second);
+template <OrderAction Side>
+void Market::AmendOrder(int64_t id, int64_t price, int64_t newPrice, int64_t newAmount,
+MarketWallets* marketWallets) {
+	modified = true;
+	if constexpr (Side == OrderAction::Buy) {
+		AmendHelper<Side>(book->buyLimitOrderMap, id, price, newPrice, newAmount, marketWallets);
+	} else {
+		AmendHelper<Side>(book->sellLimitOrderMap, id, price, newPrice, newAmount, marketWallets);
+	}
+}
+
+template <OrderAction Side, class Comp>
+void Market::AmendHelper(LimitOrderMap<Comp>& limitOrderMap, int64_t id, int64_t price,
+int64_t newPrice, int64_t newAmount, MarketWallets* marketWallets) {
+	auto ordersIter = limitOrderMap.find(price);
+	if (ordersIter == limitOrderMap.end()) {
+		throw Error(Error::Type::InvalidIdPrice, "Could not find id and rate combo");
+	}
+
+	auto& orders = ordersIter->second;
+	auto limitOrderIter = FindOrder(orders, PriceOrderId{ price, id });
+	if (limitOrderIter == orders.end()) {
+		throw Error(Error::Type::InvalidIdPrice, "Could not find id and rate combo");
+	}
+
+	auto userId = limitOrderIter->GetUserId();
+	auto [userOrders, priceOrderIdIter] = FindUserOrder<Side, LimitOrder, Comp>(userId, id, price);
+
+	if (newAmount <= limitOrderIter->GetFilled()) {
+		throw Error(Error::Type::InvalidAmend, "The new amount must be more than has been filled");
+	}
+
+	auto address = (Side == OrderAction::Buy) ? marketWallets->baseWallet->GetAddress(userId)
+	                                          : marketWallets->coinWallet->GetAddress(userId);
+
+	// Reducing the amount keeps its place in the queue
+	if (newPrice == price && newAmount <= limitOrderIter->GetAmount()) {
+		auto inOrder = InOrderAmount<Side>(*limitOrderIter, price);
+		limitOrderIter->SetAmount(newAmount);
+		auto released = inOrder - InOrderAmount<Side>(*limitOrderIter, price);
+		AddToReservations<Side>(-released);
+		address->RemoveFromInOrder(released);
+		return;
+	}
+
+	// Otherwise take it off the book, remembering where it was in case it needs putting back
+	auto original = *limitOrderIter;
+	auto inOrder = InOrderAmount<Side>(original, price);
+	auto wasOnlyOrder = (orders.size() == 1);
+	typename Orders<LimitOrder>::const_iterator next;
+	if (wasOnlyOrder) {
+		limitOrderMap.erase(ordersIter);
+	} else {
+		next = orders.erase(limitOrderIter);
+	}
+
+	AddToReservations<Side>(-inOrder);
+	address->RemoveFromInOrder(inOrder);
+	userOrders->erase(priceOrderIdIter);
+
+	OrderContainer<LimitOrder> orderContainer{ { userId, newAmount, original.GetFilled() }, newPrice };
+	orderContainer.order.SetId(id);
+
+	try {
+		PreProcess();
+		ValidateFunds<Side>(marketWallets, orderContainer);
+		ValidateSameUserOrder<Side>(orderContainer);
+
+		LATENCY_TIMER(latencyStats.get(), OrderType::Limit, LatencyStage::Process);
+		Process<Side>(orderContainer, marketWallets);
+	} catch (...) {
+		book->simulator.Clear();
+
+		typename Orders<LimitOrder>::iterator restored;
+		if (wasOnlyOrder) {
+			auto& restoredOrders = limitOrderMap[price];
+			restored = restoredOrders.insert(restoredOrders.end(), original);
+		} else {
+			restored = orders.insert(next, original);
+		}
+
+		AddToReservations<Side>(inOrder);
+		address->AddToInOrder(inOrder);
+		AddToUserCache<Side, LimitOrder, Comp>(userId, price, id, Orders<LimitOrder>::GetHandle(restored));
+		throw; // Rethrow exception
 	}
+
+	// The id is reused, so the current order id is left alone
+	PostProcess<Side, LimitOrder>(marketWallets);
 }
 
 template <OrderAction Side, class Order, typename Comp>
@@ -664,16 +858,13 @@ void Market::CancelOrders(OrderMap<Order, Comp>& orderMap, std::vector<PriceOrde
 		}
 
 		auto& orders = ordersIter->second;
-
-		auto limitOrderIter = std::find_if(orders.begin(), orders.end(), [id = priceOrderId.orderId](const auto& limitOrder) {
-			return (id == limitOrder.GetId());
-		});
-
-		bool foundOrder = (limitOrderIter != orders.end());
-		if (!foundOrder) {
+		auto limitOrderIter = FindOrder(orders, priceOrderId);
+		if (limitOrderIter == orders.end()) {
 			throw Error(Error::Type::InvalidIdPrice, "Could not find id and rate combo");
 		}
 
+		AddToReservations<Side>(-InOrderAmount<Side>(*limitOrderIter, priceOrderId.price));
+
 		// If this price point will become empty after removing this order,
 		// just remove the whole price, otherwise remove the item.
 		if (orders.size() == 1) {
@@ -685,23 +876,32 @@ void Market::CancelOrders(OrderMap<Order, Comp>& orderMap, std::vector<PriceOrde
 }
 
 void Market::CancelAll() {
-	buyLimitOrderMap.clear();
-	sellLimitOrderMap.clear();
+	modified = true;
+	book->buyLimitOrderMap.clear();
+	book->sellLimitOrderMap.clear();
 
-	buyStopLimitOrderMap.clear();
-	sellStopLimitOrderMap.clear();
+	book->buyStopLimitOrderMap.clear();
+	book->sellStopLimitOrderMap.clear();
 
-	userOrderMap.clear();
+	book->userOrderMap.clear();
+	AddToReservations<OrderAction::Buy>(-book->reservations.buy);
+	AddToReservations<OrderAction::Sell>(-book->reservations.sell);
 }
 
 // Returns a collection of the ids cancelled
 std::vector<int64_t> Market::CancelAll(int32_t userId) {
-	auto& userOrderPriceIds = GetUserOrders(userId);
+	modified = true;
+	auto it = book->userOrderMap.find(userId);
+	if (it == book->userOrderMap.end()) {
+		return {};
+	}
+
+	auto& userOrderPriceIds = it->second;
 
-	CancelOrders<OrderAction::Buy, LimitOrder>(buyLimitOrderMap, userOrderPriceIds.buyLimitPrices);
-	CancelOrders<OrderAction::Sell, LimitOrder>(sellLimitOrderMap, userOrderPriceIds.sellLimitPrices);
-	CancelOrders<OrderAction::Buy, StopLimitOrder>(buyStopLimitOrderMap, userOrderPriceIds.buyStopLimitPrices);
-	CancelOrders<OrderAction::Sell, StopLimitOrder>(sellStopLimitOrderMap, userOrderPriceIds.sellStopLimitPrices);
+	CancelOrders<OrderAction::Buy, LimitOrder>(book->buyLimitOrderMap, userOrderPriceIds.buyLimitPrices);
+	CancelOrders<OrderAction::Sell, LimitOrder>(book->sellLimitOrderMap, userOrderPriceIds.sellLimitPrices);
+	CancelOrders<OrderAction::Buy, StopLimitOrder>(book->buyStopLimitOrderMap, userOrderPriceIds.buyStopLimitPrices);
+	CancelOrders<OrderAction::Sell, StopLimitOrder>(book->sellStopLimitOrderMap, userOrderPriceIds.sellStopLimitPrices);
 
 	std::vector<int64_t> ids;
 	auto CancelUserOrders = [&ids](auto& priceIds) {
@@ -718,29 +918,188 @@ std::vector<int64_t> Market::CancelAll(int32_t userId) {
 	return ids;
 }
 
-template <OrderAction Side, class T>
-void Market::CommitChanges(const OrderContainer<T>& orderContainer,
+// Whether someone other than the user has an order at the price or better. Only the levels up to
+// the price are visited, and rather than walking their orders they are compared with how many of
+// them are the user's (their cache is sorted the same way as the map).
+template <class Comp>
+bool Market::IsCrossedByOtherUser(const LimitOrderMap<Comp>& limitOrderMap,
+const std::vector<PriceOrderId>& userPriceOrderIds, int64_t price) const {
+	auto comp = limitOrderMap.key_comp();
+	auto userIt = userPriceOrderIds.begin();
+	for (const auto& [levelPrice, orders] : limitOrderMap) {
+		if (comp(price, levelPrice)) {
+			return false;
+		}
+
+		size_t numUserOrders = 0;
+		for (; userIt != userPriceOrderIds.end() && userIt->price == levelPrice; ++userIt) {
+			++numUserOrders;
+		}
+
+		if (orders.size() > numUserOrders) {
+			return true;
+		}
+	}
+	return false;
+}
+
+template <OrderAction Side, class Comp>
+int64_t Market::SumInOrder(const LimitOrderMap<Comp>& limitOrderMap,
+const std::vector<PriceOrderId>& priceOrderIds) const {
+	int64_t inOrder = 0;
+	for (const auto& priceOrderId : priceOrderIds) {
+		auto ordersIter = limitOrderMap.find(priceOrderId.price);
+		if (ordersIter == limitOrderMap.end()) {
+			throw Error(Error::Type::InvalidIdPrice, "Could not find id and rate combo");
+		}
+
+		const auto& orders = ordersIter->second;
+		auto limitOrderIter = FindOrder(orders, priceOrderId);
+		if (limitOrderIter == orders.end()) {
+			throw Error(Error::Type::InvalidIdPrice, "Could not find id and rate combo");
+		}
+
+		inOrder += InOrderAmount<Side>(*limitOrderIter, priceOrderId.price);
+	}
+	return inOrder;
+}
+
+// Nothing is matched so they go straight on the book, much like ForceAddOrder
+template <OrderAction Side, class Comp>
+void Market::AddQuotes(LimitOrderMap<Comp>& limitOrderMap, int32_t userId,
+const std::vector<QuoteLevel>& quoteLevels) {
+	for (const auto& quoteLevel : quoteLevels) {
+		OrderContainer<LimitOrder> orderContainer{ { userId, quoteLevel.amount, 0 }, quoteLevel.price };
+		orderContainer.order.SetId(book->currentOrderId++);
+
+		ForceAdd<Side>(limitOrderMap, orderContainer);
+		listener->NewOpenOrder(ConvertToListenerOrder(orderContainer), Side);
+	}
+}
+
+// Everything is validated up front for the whole ladder, so once the user's orders start being
+// replaced nothing can fail.
+std::vector<int64_t> Market::ReplaceQuotes(int32_t userId, const MassQuote& massQuote,
 MarketWallets* marketWallets) {
-	if constexpr (Side == OrderAction::Buy) {
-		// Set in order for original order, in actual wallet.
-		auto origUserId = orderContainer.order.GetUserId();
-		auto origAddress = marketWallets->baseWallet->GetAddress(origUserId);
+	modified = true;
+	const auto& bids = massQuote.bids;
+	const auto& asks = massQuote.asks;
 
-		CommitChangesHelper<Side>(orderContainer.order.GetRemaining(), buyLimitOrderMap, sellLimitOrderMap,
-		buyStopLimitOrderMap, origAddress, marketWallets);
-	} else {
-		auto origUserId = orderContainer.order.GetUserId();
-		auto origAddress = marketWallets->coinWallet->GetAddress(origUserId);
+	auto isInvalid = [](const QuoteLevel& quoteLevel) {
+		return (quoteLevel.price <= 0 || quoteLevel.amount <= 0);
+	};
+
+	if (std::any_of(bids.begin(), bids.end(), isInvalid) || std::any_of(asks.begin(), asks.end(), isInvalid)) {
+		throw Error(Error::Type::InvalidQuote, "Quotes must have a positive price and amount");
+	}
+
+	if (bids.size() + asks.size() > static_cast<size_t>(config.maxNumLimitOpenOrders)) {
+		throw Error(Error::Type::ReachedNumOpenOrders,
+		"You have reached the maximum number of limit open orders allowed");
+	}
+
+	// The user's own resting orders don't count as they are about to be replaced
+	auto byPrice = [](const QuoteLevel& lhs, const QuoteLevel& rhs) {
+		return (lhs.price < rhs.price);
+	};
+
+	auto userOrdersIter = book->userOrderMap.find(userId);
+	auto userOrders = (userOrdersIter != book->userOrderMap.end()) ? &userOrdersIter->second : nullptr;
+	const std::vector<PriceOrderId> noPriceOrderIds;
+	const auto& userBuys = userOrders ? userOrders->buyLimitPrices : noPriceOrderIds;
+	const auto& userSells = userOrders ? userOrders->sellLimitPrices : noPriceOrderIds;
+
+	auto bestBid = bids.empty() ? -1 : std::max_element(bids.begin(), bids.end(), byPrice)->price;
+	auto bestAsk = asks.empty() ? -1 : std::min_element(asks.begin(), asks.end(), byPrice)->price;
+	if ((bestBid != -1 && bestAsk != -1 && bestBid >= bestAsk)
+	|| (bestBid != -1 && IsCrossedByOtherUser(book->sellLimitOrderMap, userSells, bestBid))
+	|| (bestAsk != -1 && IsCrossedByOtherUser(book->buyLimitOrderMap, userBuys, bestAsk))) {
+		throw Error(Error::Type::InvalidQuote, "Quotes cannot cross the book");
+	}
+
+	int64_t releasedBuy = 0;
+	int64_t releasedSell = 0;
+	if (userOrders) {
+		// Same as ValidateSameUserOrder for each limit order
+		for (const auto& bid : bids) {
+			Check(book->sellStopLimitOrderMap.key_comp(), userOrders->sellStopLimitPrices, bid.price);
+		}
+
+		for (const auto& ask : asks) {
+			Check(book->buyStopLimitOrderMap.key_comp(), userOrders->buyStopLimitPrices, ask.price);
+		}
+
+		releasedBuy = SumInOrder<OrderAction::Buy>(book->buyLimitOrderMap, userOrders->buyLimitPrices);
+		releasedSell = SumInOrder<OrderAction::Sell>(book->sellLimitOrderMap, userOrders->sellLimitPrices);
+	}
+
+	// A single funds check per side for the whole ladder, in the units the orders will hold in order
+	// (see InOrderAmount): bids are checked, released and reserved as their notional, asks as coins
+	int64_t buyFunds = 0;
+	for (const auto& bid : bids) {
+		buyFunds += Units::Multiply(bid.amount, bid.price);
+	}
+
+	int64_t sellAmount = 0;
+	for (const auto& ask : asks) {
+		sellAmount += ask.amount;
+	}
+
+	auto baseAddress = marketWallets->baseWallet->GetAddress(userId);
+	auto coinAddress = marketWallets->coinWallet->GetAddress(userId);
+	if (buyFunds > baseAddress->GetAvailableBalance() + releasedBuy) {
+		throw Error(Error::Type::InsufficientFunds, "User doesn't have enough coins to make these bids");
+	}
+
+	if (sellAmount > coinAddress->GetAvailableBalance() + releasedSell) {
+		throw Error(Error::Type::InsufficientFunds, "User doesn't have enough coins to make these asks");
+	}
+
+	std::vector<int64_t> ids;
+	if (userOrders) {
+		CancelOrders<OrderAction::Buy, LimitOrder>(book->buyLimitOrderMap, userOrders->buyLimitPrices);
+		CancelOrders<OrderAction::Sell, LimitOrder>(book->sellLimitOrderMap, userOrders->sellLimitPrices);
+
+		auto CancelUserOrders = [&ids](auto& priceIds) {
+			std::transform(priceIds.begin(), priceIds.end(),
+			std::back_inserter(ids), [](const auto& priceId) { return priceId.orderId; });
+			priceIds.clear();
+		};
 
-		CommitChangesHelper<Side>(orderContainer.order.GetRemaining(), sellLimitOrderMap, buyLimitOrderMap,
-		sellStopLimitOrderMap, origAddress, marketWallets);
+		CancelUserOrders(userOrders->buyLimitPrices);
+		CancelUserOrders(userOrders->sellLimitPrices);
+
+		baseAddress->RemoveFromInOrder(releasedBuy);
+		coinAddress->RemoveFromInOrder(releasedSell);
+	}
+
+	AddQuotes<OrderAction::Buy>(book->buyLimitOrderMap, userId, bids);
+	AddQuotes<OrderAction::Sell>(book->sellLimitOrderMap, userId, asks);
+
+	// Like any other resting limit order (see CommitChangesHelper)
+	baseAddress->AddToInOrder(buyFunds);
+	coinAddress->AddToInOrder(sellAmount);
+	return ids;
+}
+
+template <OrderAction Side, class T>
+void Market::CommitChanges(MarketWallets* marketWallets) {
+	LATENCY_TIMER(latencyStats.get(), GetOrderType<T>(), LatencyStage::CommitChanges);
+
+	// Orders which rest on the book hold their funds in this wallet
+	if constexpr (Side == OrderAction::Buy) {
+		CommitChangesHelper<Side>(book->buyLimitOrderMap, book->sellLimitOrderMap,
+		book->buyStopLimitOrderMap, marketWallets->baseWallet, marketWallets);
+	} else {
+		CommitChangesHelper<Side>(book->sellLimitOrderMap, book->buyLimitOrderMap,
+		book->sellStopLimitOrderMap, marketWallets->coinWallet, marketWallets);
 	}
 }
 
 template <OrderAction Side, class Comp, class Order>
 void Market::RemoveOrders(int32_t userId, int64_t price, int64_t stopOrderId) {
-	auto it = userOrderMap.find(userId);
-	if (it == userOrderMap.end()) {
+	auto it = book->userOrderMap.find(userId);
+	if (it == book->userOrderMap.end()) {
 		return;
 	}
 
@@ -758,12 +1117,12 @@ void Market::RemoveOrders(int32_t userId, int64_t price, int64_t stopOrderId) {
 }
 
 template <OrderAction Side, class Order, class Comp>
-void Market::AddToUserCache(int32_t userId, int64_t price, int64_t orderId) {
-	PriceOrderId priceOrderId{ price, orderId };
-	auto it = userOrderMap.find(userId);
-	if (it == userOrderMap.end()) {
+void Market::AddToUserCache(int32_t userId, int64_t price, int64_t orderId, NodePool::Handle handle) {
+	PriceOrderId priceOrderId{ price, orderId, handle };
+	auto it = book->userOrderMap.find(userId);
+	if (it == book->userOrderMap.end()) {
 		// TODO: Add it...
-		auto itPair = userOrderMap.insert({ userId, UserOrders() });
+		auto itPair = book->userOrderMap.insert({ userId, UserOrders() });
 		it = itPair.first; // Assume it was inserted....
 	}
 
@@ -775,70 +1134,87 @@ void Market::AddToUserCache(int32_t userId, int64_t price, int64_t orderId) {
 	orders.insert(lb, priceOrderId);
 }
 
-// This original order which sparked this off..
+// Only orders resting on the book hold anything in order. The order being processed (and any stop
+// orders it triggered) reserve what they insert, and each trade releases the resting order's share.
 template <OrderAction Side, class Comp, class Comp1>
-void Market::CommitChangesHelper(int64_t amountRemaining,
-LimitOrderMap<Comp>& insertedLimitOrderMap,
+void Market::CommitChangesHelper(LimitOrderMap<Comp>& insertedLimitOrderMap,
 LimitOrderMap<Comp1>& updatedLimitOrderMap,
 StopLimitOrderMap<Comp1>& stopOrderMap,
-std::vector<Address>::iterator origAddress,
+IWallet* wallet,
 MarketWallets* marketWallets) {
+	auto reserve = [this, wallet](const auto& order, int64_t price) {
+		auto inOrder = InOrderAmount<Side>(order, price);
+		AddToReservations<Side>(inOrder);
+		wallet->GetAddress(order.GetUserId())->AddToInOrder(inOrder);
+	};
+
+	auto release = [this, wallet](const auto& order, int64_t price) {
+		auto inOrder = InOrderAmount<Side>(order, price);
+		AddToReservations<Side>(-inOrder);
+		wallet->GetAddress(order.GetUserId())->RemoveFromInOrder(inOrder);
+	};
+
 	// Remove from stop orders.. (TODO, double check.., test with only 1 stop order..)
-	auto numTriggeredStopOrders = simulator.GetNumTriggeredStopOrders();
+	auto numTriggeredStopOrders = book->simulator.GetNumTriggeredStopOrders();
 	for (auto it = stopOrderMap.begin(); it != stopOrderMap.end();) {
 		auto& stopOrders = it->second;
 		auto price = it->first;
-		auto count = static_cast<int>(stopOrders.size());
+		auto count = stopOrders.size();
 		if (numTriggeredStopOrders >= count) {
 			// Remove any from user's own cached orders..
 			for (const auto& stopOrder : stopOrders) {
 				RemoveOrders<Side, Comp1, StopLimitOrder>(stopOrder.GetUserId(), price,
 				stopOrder.GetId());
+				release(stopOrder, price);
 			}
 
 			// Remove the whole price point.
 			it = stopOrderMap.erase(it);
 			numTriggeredStopOrders -= count;
 		} else {
-			// Remove any from user's own cache
-			auto it = stopOrders.begin();
-			for (; it != stopOrders.begin() + numTriggeredStopOrders; ++it) {
-				RemoveOrders<Side, Comp1, StopLimitOrder>(it->GetUserId(), price, it->GetId());
+			// Remove them from the front of the price point and the user's own cache
+			for (size_t i = 0; i < numTriggeredStopOrders; ++i) {
+				const auto& stopOrder = stopOrders.front();
+				RemoveOrders<Side, Comp1, StopLimitOrder>(stopOrder.GetUserId(), price, stopOrder.GetId());
+				release(stopOrder, price);
+				stopOrders.pop_front();
 			}
-
-			// Remove stop orders from price point
-			stopOrders.erase(stopOrders.begin(), stopOrders.begin() + numTriggeredStopOrders);
 			break;
 		}
 	}
 
 	// Insert orders to the limit orders
-	auto& simulatorInsertedLimitOrderMap = simulator.GetInsertedLimitOrders();
+	auto& simulatorInsertedLimitOrderMap = book->simulator.GetInsertedLimitOrders();
 	for (auto& [price, insertedLimitOrders] : simulatorInsertedLimitOrderMap) {
 		for (const auto& limitOrder : insertedLimitOrders) {
-			insertedLimitOrderMap[price].push_back(limitOrder);
-			AddToUserCache<Side, LimitOrder, Comp>(limitOrder.GetUserId(), price, limitOrder.GetId());
+			auto& orders = insertedLimitOrderMap[price];
+			auto it = orders.emplace(orders.end(), limitOrder);
+			AddToUserCache<Side, LimitOrder, Comp>(limitOrder.GetUserId(), price, limitOrder.GetId(),
+			Orders<LimitOrder>::GetHandle(it));
+			reserve(limitOrder, price);
 		}
 	}
 
 	// Insert stop limit order (is mutally exclusive with the other orders).
-	if (simulator.InsertedAStopLimitOrder()) {
-		auto& insertedStopLimitOrder = *simulator.GetInsertedStopLimitOrder().stopLimitOrder;
-		auto price = simulator.GetInsertedStopLimitOrder().price;
-		stopOrderMap[price].push_back(insertedStopLimitOrder);
+	if (book->simulator.InsertedAStopLimitOrder()) {
+		auto& insertedStopLimitOrder = *book->simulator.GetInsertedStopLimitOrder().stopLimitOrder;
+		auto price = book->simulator.GetInsertedStopLimitOrder().price;
+		auto& stopOrders = stopOrderMap[price];
+		auto it = stopOrders.emplace(stopOrders.end(), insertedStopLimitOrder);
 
 		auto userId = insertedStopLimitOrder.GetUserId();
 		auto orderId = insertedStopLimitOrder.GetId();
-		AddToUserCache<Side, StopLimitOrder, Comp1>(userId, price, orderId);
+		AddToUserCache<Side, StopLimitOrder, Comp1>(userId, price, orderId, Orders<StopLimitOrder>::GetHandle(it));
+		reserve(insertedStopLimitOrder, price);
 	}
 
 	// Remove limit orders which have been consumed
-	auto numLimitOrdersToRemove = simulator.GetNumLimitOrdersToRemove();
+	auto numLimitOrdersToRemove = book->simulator.GetNumLimitOrdersToRemove();
 	if (numLimitOrdersToRemove > 0) {
 		for (auto it = updatedLimitOrderMap.begin(); it != updatedLimitOrderMap.end();) {
 			auto& updatedLimitOrders = it->second;
 			auto price = it->first;
-			auto count = static_cast<int>(updatedLimitOrders.size());
+			auto count = updatedLimitOrders.size();
 			if (numLimitOrdersToRemove >= count) {
 				// Remove any from user's own cached orders..
 				for (const auto& limitOrder : updatedLimitOrders) {
@@ -850,37 +1226,38 @@ MarketWallets* marketWallets) {
 				it = updatedLimitOrderMap.erase(it);
 				numLimitOrdersToRemove -= count;
 			} else {
-				// Remove any from user's own cache
-				for (auto it = updatedLimitOrders.begin();
-				     it != updatedLimitOrders.begin() + numTriggeredStopOrders; ++it) {
-					RemoveOrders<Side, Comp1, LimitOrder>(it->GetUserId(), price, it->GetId());
+				// Remove them from the front of the price point and the user's own cache
+				for (size_t i = 0; i < numLimitOrdersToRemove; ++i) {
+					const auto& limitOrder = updatedLimitOrders.front();
+					RemoveOrders<Side, Comp1, LimitOrder>(limitOrder.GetUserId(), price, limitOrder.GetId());
+					updatedLimitOrders.pop_front();
 				}
-
-				// Remove stop orders from price point
-				updatedLimitOrders.erase(updatedLimitOrders.begin(),
-				updatedLimitOrders.begin() + numLimitOrdersToRemove);
 				break;
 			}
 		}
 	}
 
 	// Update the fill of the last limit order if needed
-	if (simulator.GetLastFill() > 0) {
-		updatedLimitOrderMap.begin()->second.front().AddToFill(simulator.GetLastFill());
+	if (book->simulator.GetLastFill() > 0) {
+		updatedLimitOrderMap.begin()->second.front().AddToFill(book->simulator.GetLastFill());
 	}
 
-	origAddress->AddToInOrder(amountRemaining);
-
 	// Update balances for all the address for which trades occurred
-	const auto& allTrades = simulator.GetTrades();
+	constexpr auto otherSide = (Side == OrderAction::Buy) ? OrderAction::Sell : OrderAction::Buy;
+	const auto& allTrades = book->simulator.GetTrades();
 	for (const auto& trade : allTrades) {
+		// Every trade consumes the other side of the book
+		AddToReservations<otherSide>(-trade.makerInOrder);
+
 		auto buyersCoinAddress = marketWallets->coinWallet->GetAddress(trade.buyUserId);
 		buyersCoinAddress->AddToTotalBalance(trade.amount - (trade.fees.buyFee));
 
 		// Remove the coin they used to buy from their balance
 		auto buyersBaseAddress = marketWallets->baseWallet->GetAddress(trade.buyUserId);
-		buyersBaseAddress->RemoveFromTotalBalance(Units::ScaleDown(trade.amount * trade.price));
-		buyersBaseAddress->RemoveFromInOrder(Units::ScaleDown(trade.amount * trade.price));
+		buyersBaseAddress->RemoveFromTotalBalance(Units::Multiply(trade.amount, trade.price));
+		if constexpr (otherSide == OrderAction::Buy) {
+			buyersBaseAddress->RemoveFromInOrder(trade.makerInOrder);
+		}
 
 		// Now do same but for seller
 		auto sellersBaseAddress = marketWallets->baseWallet->GetAddress(trade.sellUserId);
@@ -889,24 +1266,26 @@ MarketWallets* marketWallets) {
 		// Remove the amount of coin they used to sell from the balance
 		auto sellersCoinAddress = marketWallets->coinWallet->GetAddress(trade.sellUserId);
 		sellersCoinAddress->RemoveFromTotalBalance(trade.amount);
-		sellersCoinAddress->RemoveFromInOrder(trade.amount);
+		if constexpr (otherSide == OrderAction::Sell) {
+			sellersCoinAddress->RemoveFromInOrder(trade.makerInOrder);
+		}
 	}
 }
 
 const BuyLimitOrderMap& Market::GetBuyLimitOrderMap() const {
-	return buyLimitOrderMap;
+	return book->buyLimitOrderMap;
 }
 
 const SellLimitOrderMap& Market::GetSellLimitOrderMap() const {
-	return sellLimitOrderMap;
+	return book->sellLimitOrderMap;
 }
 
 const BuyStopLimitOrderMap& Market::GetBuyStopLimitOrderMap() const {
-	return buyStopLimitOrderMap;
+	return book->buyStopLimitOrderMap;
 }
 
 const SellStopLimitOrderMap& Market::GetSellStopLimitOrderMap() const {
-	return sellStopLimitOrderMap;
+	return book->sellStopLimitOrderMap;
 }
 
 const CoinPair& Market::GetCoinPair() const {
@@ -914,21 +1293,32 @@ const CoinPair& Market::GetCoinPair() const {
 }
 
 bool Market::operator==(const Market& market) const {
-	return coinPair == market.coinPair && buyLimitOrderMap == market.buyLimitOrderMap
-	&& sellLimitOrderMap == market.sellLimitOrderMap
-	&& buyStopLimitOrderMap == market.buyStopLimitOrderMap
-	&& sellStopLimitOrderMap == market.sellStopLimitOrderMap
-	&& currentOrderId == market.currentOrderId && currentTradeId == market.currentTradeId
-	&& userOrderMap == market.userOrderMap && config == market.config
+	return coinPair == market.coinPair && book->buyLimitOrderMap == market.book->buyLimitOrderMap
+	&& book->sellLimitOrderMap == market.book->sellLimitOrderMap
+	&& book->buyStopLimitOrderMap == market.book->buyStopLimitOrderMap
+	&& book->sellStopLimitOrderMap == market.book->sellStopLimitOrderMap
+	&& book->currentOrderId == market.book->currentOrderId && book->currentTradeId == market.book->currentTradeId
+	&& book->userOrderMap == market.book->userOrderMap && config == market.config
+	&& feeSchedule == market.feeSchedule
 	&& *listener == *market.listener;
 }
 
 void Market::SetMaxOrderId(int64_t id) {
-	currentOrderId = id;
+	modified = true;
+	book->currentOrderId = id;
 }
 
 void Market::SetMaxTradeId(int64_t id) {
-	currentTradeId = id;
+	modified = true;
+	book->currentTradeId = id;
+}
+
+bool Market::IsModified() const {
+	return modified;
+}
+
+void Market::ClearModified() {
+	modified = false;
 }
 
 IListener& Market::GetListener() const {
@@ -936,23 +1326,50 @@ IListener& Market::GetListener() const {
 }
 
 void Market::SetFeePercentage(double feePercent) {
+	modified = true;
 	config.feeDivision = Fee::ConvertToDivisibleFee(feePercent);
+	feeSchedule.SetStandardFee(config.feeDivision);
+}
+
+void Market::SetFeeTier(uint8_t tier, double makerFeePercent, double takerFeePercent) {
+	modified = true;
+	feeSchedule.SetTier(tier, Fee::ConvertToDivisibleFee(makerFeePercent),
+	Fee::ConvertToDivisibleFee(takerFeePercent));
+}
+
+void Market::SetFeeSchedule(const FeeSchedule& feeSchedule) {
+	modified = true;
+	this->feeSchedule.SetFees(feeSchedule);
+}
+
+void Market::SetUserFeeTiers(const UserFeeTiers* userFeeTiers) {
+	feeSchedule.SetUserTiers(userFeeTiers);
 }
 
 void Market::SetMaxNumLimitOpenOrders(int32_t numOpenOrders) {
+	modified = true;
 	config.maxNumLimitOpenOrders = numOpenOrders;
 }
 
 void Market::SetMaxNumStopLimitOpenOrders(int32_t numOpenOrders) {
+	modified = true;
 	config.maxNumStopLimitOpenOrders = numOpenOrders;
 }
 
-Fee Market::CalculateFees(int64_t amount, int64_t price) const {
-	auto standardFee = config.feeDivision;
+// The buyer pays in coin and the seller in base, the incoming order (Side) is the taker.
+template <OrderAction Side>
+Fee Market::CalculateFees(int64_t amount, int64_t price, int32_t buyUserId, int32_t sellUserId) const {
+	const auto& buyTier = feeSchedule.GetTier(buyUserId);
+	const auto& sellTier = feeSchedule.GetTier(sellUserId);
 
 	Fee fees;
-	fees.buyFee = amount / standardFee;
-	fees.sellFee = Units::ScaleDown(amount * price) / standardFee;
+	if constexpr (Side == OrderAction::Buy) {
+		fees.buyFee = buyTier.taker.Divide(amount);
+		fees.sellFee = sellTier.maker.Divide(Units::Multiply(amount, price));
+	} else {
+		fees.buyFee = buyTier.maker.Divide(amount);
+		fees.sellFee = sellTier.taker.Divide(Units::Multiply(amount, price));
+	}
 	return fees;
 }
 
@@ -965,7 +1382,7 @@ LimitOrder Market::ConvertToLimitOrder(const StopLimitOrder& stopLimitOrder) con
 }
 
 UserOrders& Market::GetUserOrders(int32_t userId) {
-	return userOrderMap.at(userId);
+	return book->userOrderMap.at(userId);
 }
 
 template <OrderAction Side, class Order>
@@ -995,32 +1412,146 @@ const MarketConfig& Market::GetConfig() const {
 	return config;
 }
 
+const FeeSchedule& Market::GetFeeSchedule() const {
+	return feeSchedule;
+}
+
+int64_t Market::GetCurrentOrderId() const {
+	return book->currentOrderId;
+}
+
+int64_t Market::GetCurrentTradeId() const {
+	return book->currentTradeId;
+}
+
 const UserOrderMap& Market::GetUserOrderMap() const {
-	return userOrderMap;
+	return book->userOrderMap;
+}
+
+const BookReservations& Market::GetReservations() const {
+	return book->reservations;
+}
+
+MarketLatencyStats* Market::GetLatencyStats() {
+#ifdef TRADING_ENGINE_LATENCY_STATS
+	return latencyStats.get();
+#else
+	return nullptr;
+#endif
+}
+
+const MarketLatencyStats* Market::GetLatencyStats() const {
+#ifdef TRADING_ENGINE_LATENCY_STATS
+	return latencyStats.get();
+#else
+	return nullptr;
+#endif
+}
+
+void Market::SetPoolShard(PoolShard& shard) {
+	// Unless it's already built in it (see ScopedPoolShard)
+	if (book->buyLimitOrderMap.get_allocator().GetShard() != &shard) {
+		auto newBook = std::make_unique<MarketBook>(shard);
+		*newBook = *book;
+		newBook->reservationTotal = book->reservationTotal;
+		book = std::move(newBook);
+	}
+
+	// The copied orders are in new nodes, and markets loaded from a snapshot were never linked
+	LinkUserOrders();
+}
+
+void Market::LinkUserOrders() {
+	LinkUserOrdersHelper<OrderAction::Buy>(book->buyLimitOrderMap);
+	LinkUserOrdersHelper<OrderAction::Sell>(book->sellLimitOrderMap);
+	LinkUserOrdersHelper<OrderAction::Buy>(book->buyStopLimitOrderMap);
+	LinkUserOrdersHelper<OrderAction::Sell>(book->sellStopLimitOrderMap);
+}
+
+template <OrderAction Side, class Order, class Comp>
+void Market::LinkUserOrdersHelper(OrderMap<Order, Comp>& orderMap) {
+	Comp comp;
+	for (auto& [price, orders] : orderMap) {
+		for (auto it = orders.begin(); it != orders.end(); ++it) {
+			auto& userOrders = GetUserOrderCacheHelper<Side, Order>(&book->userOrderMap.at(it->GetUserId()));
+			PriceOrderId priceOrderId{ price, it->GetId() };
+			auto lb = std::lower_bound(userOrders.begin(), userOrders.end(), priceOrderId, CompareUserOrders(comp));
+			if (lb != userOrders.end() && *lb == priceOrderId) {
+				lb->handle = Orders<Order>::GetHandle(it);
+			}
+		}
+	}
+}
+
+MarketMemoryUsage Market::GetMemoryUsage() const {
+	MarketMemoryUsage memoryUsage;
+	memoryUsage.numPriceLevels = book->usage.numNodes;
+	memoryUsage.priceLevelBytes = book->usage.bytes;
+
+	auto addOrders = [&memoryUsage](const auto& orderMap) {
+		for (const auto& priceLevel : orderMap) {
+			memoryUsage.numOrders += priceLevel.second.size();
+			memoryUsage.orderBytes += priceLevel.second.size() * priceLevel.second.nodeSize;
+		}
+	};
+
+	addOrders(book->buyLimitOrderMap);
+	addOrders(book->sellLimitOrderMap);
+	addOrders(book->buyStopLimitOrderMap);
+	addOrders(book->sellStopLimitOrderMap);
+	return memoryUsage;
+}
+
+template <OrderAction Side>
+void Market::AddToReservations(int64_t amount) {
+	if constexpr (Side == OrderAction::Buy) {
+		book->reservations.buy += amount;
+	} else {
+		book->reservations.sell += amount;
+	}
+
+	if (book->reservationTotal) {
+		*book->reservationTotal += amount;
+	}
+}
+
+void Market::SetReservationTotal(int64_t* total) {
+	auto reserved = book->reservations.buy + book->reservations.sell;
+	if (book->reservationTotal) {
+		*book->reservationTotal -= reserved;
+	}
+
+	book->reservationTotal = total;
+	if (total) {
+		*total += reserved;
+	}
 }
 
 template <OrderAction Side, class Order, class Comp>
 void Market::ForceAdd(OrderMap<Order, Comp>& orderMap,
 const OrderContainer<Order>& orderContainer) {
 	// Add to order map
-	orderMap[orderContainer.GetPrice()].push_back(orderContainer.order);
+	auto& orders = orderMap[orderContainer.GetPrice()];
+	auto it = orders.emplace(orders.end(), orderContainer.order);
+	AddToReservations<Side>(InOrderAmount<Side>(orderContainer.order, orderContainer.GetPrice()));
 	AddToUserCache<Side, Order, Comp>(orderContainer.order.GetUserId(), orderContainer.GetPrice(),
-	orderContainer.order.GetId());
+	orderContainer.order.GetId(), Orders<Order>::GetHandle(it));
 }
 
 template <OrderAction Side, class Order>
 void Market::ForceAddOrder(const OrderContainer<Order>& orderContainer) {
+	modified = true;
 	if constexpr (Side == OrderAction::Buy) {
 		if constexpr (IsLimitOrder_v<Order>) {
-			ForceAdd<Side>(buyLimitOrderMap, orderContainer);
+			ForceAdd<Side>(book->buyLimitOrderMap, orderContainer);
 		} else {
-			ForceAdd<Side>(buyStopLimitOrderMap, orderContainer);
+			ForceAdd<Side>(book->buyStopLimitOrderMap, orderContainer);
 		}
 	} else {
 		if constexpr (IsLimitOrder_v<Order>) {
-			ForceAdd<Side>(sellLimitOrderMap, orderContainer);
+			ForceAdd<Side>(book->sellLimitOrderMap, orderContainer);
 		} else {
-			ForceAdd<Side>(sellStopLimitOrderMap, orderContainer);
+			ForceAdd<Side>(book->sellStopLimitOrderMap, orderContainer);
 		}
 	}
 }
@@ -1039,6 +1570,15 @@ const OrderContainer<StopLimitOrder>& orderContainer, MarketWallets* marketWalle
 template void Market::NewProcess<OrderAction::Sell>(
 const OrderContainer<StopLimitOrder>& orderContainer, MarketWallets* marketWallets);
 
+template OrderQuote Market::Quote<OrderAction::Buy>(
+const OrderContainer<MarketOrder>& orderContainer);
+template OrderQuote Market::Quote<OrderAction::Sell>(
+const OrderContainer<MarketOrder>& orderContainer);
+template OrderQuote Market::Quote<OrderAction::Buy>(
+const OrderContainer<LimitOrder>& orderContainer);
+template OrderQuote Market::Quote<OrderAction::Sell>(
+const OrderContainer<LimitOrder>& orderContainer);
+
 template const std::vector<PriceOrderId>& Market::GetUserOrderCache<OrderAction::Buy, LimitOrder>(
 int32_t userId);
 template const std::vector<PriceOrderId>& Market::GetUserOrderCache<OrderAction::Sell,
@@ -1048,6 +1588,11 @@ StopLimitOrder>(int32_t userId);
 template const std::vector<PriceOrderId>& Market::GetUserOrderCache<OrderAction::Sell,
 StopLimitOrder>(int32_t userId);
 
+template void Market::AmendOrder<OrderAction::Buy>(int64_t id, int64_t price, int64_t newPrice,
+int64_t newAmount, MarketWallets* marketWallets);
+template void Market::AmendOrder<OrderAction::Sell>(int64_t id, int64_t price, int64_t newPrice,
+int64_t newAmount, MarketWallets* marketWallets);
+
 template void Market::ForceAddOrder<OrderAction::Buy>(
 const OrderContainer<LimitOrder>& orderContainer);
 template void Market::ForceAddOrder<OrderAction::Sell>(
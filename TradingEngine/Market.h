@@ -2,19 +2,23 @@
 
 #include "Address.h"
 #include "CoinPair.h"
+#include "FeeSchedule.h"
+#include "LatencyStats.h"
+#include "MarketBook.h"
 #include "Listener/IListener.h"
+#include "MassQuote.h"
 #include "Orders/MarketOrder.h"
 #include "Orders/OrderAction.h"
 #include "Orders/OrderContainer.h"
 #include "Orders/StopLimitOrder.h"
-#include "Simulator.h"
+#include "OrderQuote.h"
 #include "market_helper.h"
 #include "serializer_defines.h"
 
 #include <cstdint>
-#include <deque>
 #include <memory>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 class IListener;
@@ -40,6 +44,10 @@ public:
 	template <OrderAction Side, class T>
 	void NewProcess(const OrderContainer<T>& orderContainer, MarketWallets* coinWallets);
 
+	// What the order would fill at right now, nothing is committed.
+	template <OrderAction Side, class Order>
+	OrderQuote Quote(const OrderContainer<Order>& orderContainer);
+
 	const BuyLimitOrderMap& GetBuyLimitOrderMap() const;
 	const SellLimitOrderMap& GetSellLimitOrderMap() const;
 	const BuyStopLimitOrderMap& GetBuyStopLimitOrderMap() const;
@@ -53,24 +61,71 @@ public:
 	void SetMaxOrderId(int64_t id);
 	void SetMaxTradeId(int64_t id);
 
+	// Whether anything has changed since ClearModified(), for delta snapshots (see SnapshotDelta.h)
+	bool IsModified() const;
+	void ClearModified();
+
 	template <OrderAction Side, class Order>
 	void CancelOrder(int64_t id, int64_t price, MarketWallets* marketWallets);
 
+	// Changes a resting limit order. Reducing the amount at the same price is done in place and
+	// keeps its time priority. Anything else moves it in a single pass, it's processed at the new
+	// price/amount with the same id (so it can trade) and goes to the back of the queue. The
+	// order is left untouched if that fails.
+	template <OrderAction Side>
+	void AmendOrder(int64_t id, int64_t price, int64_t newPrice, int64_t newAmount,
+	MarketWallets* marketWallets);
+
 	void CancelAll();
 	std::vector<int64_t> CancelAll(int32_t userId);
 
+	// Replaces all of the user's resting limit orders with the quotes, as a whole or not at all.
+	// Quotes never trade, the ladder is rejected if any of it would cross the book. Returns the
+	// ids of the orders replaced.
+	std::vector<int64_t> ReplaceQuotes(int32_t userId, const MassQuote& massQuote,
+	MarketWallets* marketWallets);
+
 	// For testing...
 	template <OrderAction Side, class Order>
 	const std::vector<PriceOrderId>& GetUserOrderCache(int32_t userId);
 
 	void SetFeePercentage(double fee);
+	void SetFeeTier(uint8_t tier, double makerFeePercent, double takerFeePercent);
+	// The fees of every tier (i.e from a snapshot, the market's own archive doesn't have them)
+	void SetFeeSchedule(const FeeSchedule& feeSchedule);
+	// The tier of each user, owned by the MarketManager which must outlive the market. Everyone
+	// pays the standard fee without it.
+	void SetUserFeeTiers(const UserFeeTiers* userFeeTiers);
 	void SetMaxNumLimitOpenOrders(int32_t numOpenOrders);
 	void SetMaxNumStopLimitOpenOrders(int32_t numOpenOrders);
 
 	IListener& GetListener() const;
 	const MarketConfig& GetConfig() const;
+	const FeeSchedule& GetFeeSchedule() const;
+	// The ids the next order and trade will get
+	int64_t GetCurrentOrderId() const;
+	int64_t GetCurrentTradeId() const;
 	UserOrders& GetUserOrders(int32_t userId);
 	const UserOrderMap& GetUserOrderMap() const;
+	const BookReservations& GetReservations() const;
+
+	// nullptr unless built with TRADING_ENGINE_LATENCY_STATS
+	MarketLatencyStats* GetLatencyStats();
+	const MarketLatencyStats* GetLatencyStats() const;
+
+	// Moves the order books to the shard's node pools (unless they are already there), the shard
+	// must outlive the market
+	void SetPoolShard(PoolShard& shard);
+
+	// Gives the users' cached orders the handles of their nodes, so going through a user's orders
+	// (CancelAll(userId), mass quotes) doesn't search their price levels. For markets loaded from
+	// a snapshot, copies link themselves.
+	void LinkUserOrders();
+	MarketMemoryUsage GetMemoryUsage() const;
+
+	// Keeps the total up to date with this market's reservations (buy and sell summed), starting by
+	// adding what it has now. nullptr detaches it, taking them back out of the previous total.
+	void SetReservationTotal(int64_t* total);
 
 	template <OrderAction Side, class Order>
 	void ForceAddOrder(const OrderContainer<Order>& orderContainer);
@@ -78,25 +133,25 @@ public:
 private:
 	std::unique_ptr<IListener> listener;
 
+	// The order books and everything else touched while matching, see MarketBook.h
+	std::unique_ptr<MarketBook> book = std::make_unique<MarketBook>();
+
 	// This uniquely identifies the market.
 	CoinPair coinPair;
-	BuyLimitOrderMap buyLimitOrderMap;
-	SellLimitOrderMap sellLimitOrderMap;
-
-	BuyStopLimitOrderMap buyStopLimitOrderMap;
-	SellStopLimitOrderMap sellStopLimitOrderMap;
 
-	// This is a map of user ids with a collection of all the orders they have open
-	UserOrderMap userOrderMap;
+	MarketConfig config;
 
-	int64_t currentOrderId = 1;
-	int64_t currentTradeId = 1;
+	// Precomputed from config.feeDivision (tier 0) and any other tiers set, users are looked up in
+	// the engine's UserFeeTiers.
+	FeeSchedule feeSchedule;
 
-	MarketConfig config;
+#ifdef TRADING_ENGINE_LATENCY_STATS
+	// Timings of each processing stage, copies start with their own empty stats.
+	std::unique_ptr<MarketLatencyStats> latencyStats = std::make_unique<MarketLatencyStats>();
+#endif
 
-	// This contains the changes that will be committed later after processing successfully.
-	// It is the only variable which should be modified inside the const methods.
-	mutable Simulator simulator;
+	// Set by every public method which changes the market, new markets and copies start modified.
+	bool modified = true;
 
 	void PreProcess() const;
 
@@ -104,18 +159,17 @@ private:
 	void Process(const OrderContainer<T>& orderContainer, MarketWallets* marketWallets) const;
 
 	template <OrderAction Side, class Order>
-	void PostProcess(const OrderContainer<Order>& orderContainer, MarketWallets* marketWallets);
+	void PostProcess(MarketWallets* marketWallets);
 
 	template <OrderAction Side, class T>
-	void CommitChanges(const OrderContainer<T>& orderContainer, MarketWallets* marketWallets);
+	void CommitChanges(MarketWallets* marketWallets);
 
 	bool SimulateMarketBuyOrder(const MarketOrder& marketBuyOrder, int64_t availableBalance) const;
 
 	template <OrderAction Side, class T, class T1>
-	void CommitChangesHelper(int64_t orderRemaining,
-	LimitOrderMap<T>& insertedLimitOrderMap, LimitOrderMap<T1>& updatedLimitOrderMap,
-	StopLimitOrderMap<T1>& stopOrderMap, std::vector<Address>::iterator origAddress,
-	MarketWallets* marketWallets);
+	void CommitChangesHelper(LimitOrderMap<T>& insertedLimitOrderMap,
+	LimitOrderMap<T1>& updatedLimitOrderMap, StopLimitOrderMap<T1>& stopOrderMap,
+	IWallet* wallet, MarketWallets* marketWallets);
 
 	template <OrderAction Side, class T>
 	void ThrowIfInsufficientFunds(const OrderContainer<T>& order, int64_t availableBalance) const = delete;
@@ -142,7 +196,8 @@ private:
 	std::tuple<int64_t, int64_t, int32_t, int32_t> ConsumeHelper(int64_t origOrderId,
 	int64_t orderId, int64_t origUserId, int32_t userId) const;
 
-	Fee CalculateFees(int64_t amount, int64_t price) const;
+	template <OrderAction Side>
+	Fee CalculateFees(int64_t amount, int64_t price, int32_t buyUserId, int32_t sellUserId) const;
 
 	template <OrderAction Side, class T, class Sort, class Sort1>
 	void ConsumeOrderBook(OrderContainer<T>* orderContainer,
@@ -151,8 +206,8 @@ private:
 
 	template <OrderAction Side, class T>
 	bool Consume(OrderContainer<T>* orderContainer, int64_t price, int64_t* lastTradePrice,
-	typename std::deque<LimitOrder>::const_iterator start,
-	typename std::deque<LimitOrder>::const_iterator end) const;
+	Orders<LimitOrder>::const_iterator start,
+	Orders<LimitOrder>::const_iterator end) const;
 
 	template <OrderAction Side, class Sort>
 	void KickOffStopOrders(const StopLimitOrderMap<Sort>& stopLimitOrders,
@@ -175,7 +230,10 @@ private:
 	std::vector<PriceOrderId>& GetUserOrderCacheHelper(UserOrders* userOrders);
 
 	template <OrderAction Side, class Order, class Comp>
-	void AddToUserCache(int32_t userId, int64_t price, int64_t orderId);
+	void AddToUserCache(int32_t userId, int64_t price, int64_t orderId, NodePool::Handle handle);
+
+	template <OrderAction Side>
+	void AddToReservations(int64_t amount);
 
 	template <OrderAction Side, class Order>
 	void ValidateSameUserOrder(const OrderContainer<Order>& orderContainer);
@@ -189,6 +247,29 @@ private:
 	template <OrderAction Side, class Order, class Comp>
 	void CancelHelper(OrderMap<Order, Comp>& orderMap, int64_t id, int64_t price, MarketWallets* marketWallets);
 
+	template <OrderAction Side, class Order, class Comp>
+	std::pair<std::vector<PriceOrderId>*, std::vector<PriceOrderId>::iterator> FindUserOrder(int32_t userId,
+	int64_t id, int64_t price);
+
+	template <OrderAction Side, class Comp>
+	void AmendHelper(LimitOrderMap<Comp>& limitOrderMap, int64_t id, int64_t price, int64_t newPrice,
+	int64_t newAmount, MarketWallets* marketWallets);
+
 	template <OrderAction Side, class Order, typename Comp>
 	void CancelOrders(OrderMap<Order, Comp>& orderMap, std::vector<PriceOrderId>& priceOrderIds);
+
+	template <class Comp>
+	bool IsCrossedByOtherUser(const LimitOrderMap<Comp>& limitOrderMap,
+	const std::vector<PriceOrderId>& userPriceOrderIds, int64_t price) const;
+
+	template <OrderAction Side, class Comp>
+	int64_t SumInOrder(const LimitOrderMap<Comp>& limitOrderMap,
+	const std::vector<PriceOrderId>& priceOrderIds) const;
+
+	template <OrderAction Side, class Order, class Comp>
+	void LinkUserOrdersHelper(OrderMap<Order, Comp>& orderMap);
+
+	template <OrderAction Side, class Comp>
+	void AddQuotes(LimitOrderMap<Comp>& limitOrderMap, int32_t userId,
+	const std::vector<QuoteLevel>& quoteLevels);
 };
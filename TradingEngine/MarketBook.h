@@ -0,0 +1,72 @@
+#pragma once
+
+#include "NodePool.h"
+#include "ShardAllocator.h"
+#include "Simulator.h"
+#include "market_helper.h"
+
+#include <cstddef>
+#include <cstdint>
+
+struct MarketMemoryUsage {
+	size_t numPriceLevels = 0;
+	size_t priceLevelBytes = 0; // Map nodes taken from the market's pool shard
+	size_t numOrders = 0;
+	size_t orderBytes = 0;
+};
+
+// The state of a market which is used while matching, kept in its own cache line aligned
+// allocation. Markets hold it by pointer so it does not move when the markets around it are
+// inserted/removed, and the rarely used parts of the market (listener, config..) don't share
+// its cache lines. The price levels and their orders are allocated from the shard it was
+// created with.
+struct alignas(64) MarketBook {
+	explicit MarketBook(PoolShard& shard = PoolShard::GetDefault()) :
+	buyLimitOrderMap(BuyLimitOrderMap::allocator_type(ShardAllocator<char>(shard, &usage))),
+	sellLimitOrderMap(SellLimitOrderMap::allocator_type(ShardAllocator<char>(shard, &usage))),
+	buyStopLimitOrderMap(BuyStopLimitOrderMap::allocator_type(ShardAllocator<char>(shard, &usage))),
+	sellStopLimitOrderMap(SellStopLimitOrderMap::allocator_type(ShardAllocator<char>(shard, &usage))) {
+	}
+
+	MarketBook(const MarketBook&) = delete;
+
+	// Copies the orders into this book's shard, the usage is left to count them
+	MarketBook& operator=(const MarketBook& other) {
+		buyLimitOrderMap = other.buyLimitOrderMap;
+		sellLimitOrderMap = other.sellLimitOrderMap;
+		buyStopLimitOrderMap = other.buyStopLimitOrderMap;
+		sellStopLimitOrderMap = other.sellStopLimitOrderMap;
+		currentOrderId = other.currentOrderId;
+		currentTradeId = other.currentTradeId;
+		userOrderMap = other.userOrderMap;
+		reservations = other.reservations;
+		simulator = other.simulator;
+		return *this;
+	}
+
+	BuyLimitOrderMap buyLimitOrderMap;
+	SellLimitOrderMap sellLimitOrderMap;
+
+	BuyStopLimitOrderMap buyStopLimitOrderMap;
+	SellStopLimitOrderMap sellStopLimitOrderMap;
+
+	int64_t currentOrderId = 1;
+	int64_t currentTradeId = 1;
+
+	// This is a map of user ids with a collection of all the orders they have open, looked up
+	// by every order (open order limits, same user checks, the user's cache)
+	UserOrderMap userOrderMap;
+
+	BookReservations reservations;
+	// Changes to the reservations are added to it too, if set (see Market::SetReservationTotal).
+	// Copies of the book are left detached.
+	int64_t* reservationTotal = nullptr;
+
+	// This contains the changes that will be committed later after processing successfully.
+	// It is the only variable which should be modified inside the const methods of Market.
+	Simulator simulator;
+
+	// Counts the price level nodes of the maps above. They only hold its address and don't
+	// allocate when constructed, so it can come last and leave them at the start of the book.
+	PoolUsage usage;
+};
@@ -0,0 +1,231 @@
+#include "MarketHydrator.h"
+
+#include "Error.h"
+
+#include <algorithm>
+#include <utility>
+
+MarketHydrator::~MarketHydrator() {
+	StopWarmUp();
+}
+
+void MarketHydrator::Register(const CoinPair& coinPair, MarketLoader loader, uint32_t stateHash) {
+	auto pendingMarket = std::make_shared<PendingMarket>();
+	pendingMarket->loader = std::move(loader);
+	pendingMarket->stateHash = stateHash;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!pendingMarkets.emplace(coinPair, std::move(pendingMarket)).second) {
+		throw Error(Error::Type::MarketAlreadyExists);
+	}
+}
+
+bool MarketHydrator::IsPending(const CoinPair& coinPair) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return pendingMarkets.count(coinPair) != 0;
+}
+
+bool MarketHydrator::IsEmpty() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return pendingMarkets.empty();
+}
+
+size_t MarketHydrator::GetNumPending() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return pendingMarkets.size();
+}
+
+std::vector<CoinPair> MarketHydrator::GetPending() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<CoinPair> coinPairs;
+	for (const auto& pendingMarket : pendingMarkets) {
+		coinPairs.push_back(pendingMarket.first);
+	}
+	return coinPairs;
+}
+
+std::vector<std::pair<CoinPair, uint32_t>> MarketHydrator::GetPendingStateHashes() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::pair<CoinPair, uint32_t>> stateHashes;
+	for (const auto& pendingMarket : pendingMarkets) {
+		stateHashes.emplace_back(pendingMarket.first, pendingMarket.second->stateHash);
+	}
+	return stateHashes;
+}
+
+size_t MarketHydrator::GetNumUndecoded() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return std::count_if(pendingMarkets.begin(), pendingMarkets.end(), [](const auto& pendingMarket) {
+		return pendingMarket.second->state != State::Decoded;
+	});
+}
+
+std::optional<HydratedMarket> MarketHydrator::Take(const CoinPair& coinPair, PoolShard& poolShard) {
+	std::unique_lock<std::mutex> lock(mutex);
+	auto it = pendingMarkets.find(coinPair);
+	if (it == pendingMarkets.end()) {
+		return std::nullopt;
+	}
+
+	auto pendingMarket = it->second;
+	WaitUntilDecoded(lock, *pendingMarket);
+	if (pendingMarket->state == State::Decoded) {
+		pendingMarkets.erase(coinPair);
+		return std::move(pendingMarket->hydrated);
+	}
+
+	// Decoded here, the warm-up skips it meanwhile
+	pendingMarket->state = State::Decoding;
+	lock.unlock();
+
+	std::optional<HydratedMarket> hydrated;
+	try {
+		ScopedPoolShard scopedPoolShard(poolShard);
+		hydrated.emplace();
+		pendingMarket->loader(&hydrated->market);
+	} catch (...) {
+		hydrated.reset();
+		lock.lock();
+		pendingMarket->state = State::Pending;
+		throw;
+	}
+
+	lock.lock();
+	pendingMarkets.erase(coinPair);
+	return hydrated;
+}
+
+void MarketHydrator::Remove(const CoinPair& coinPair) {
+	std::optional<HydratedMarket> hydrated; // Destroyed after unlocking
+	std::unique_lock<std::mutex> lock(mutex);
+	auto it = pendingMarkets.find(coinPair);
+	if (it == pendingMarkets.end()) {
+		return;
+	}
+
+	auto pendingMarket = it->second;
+	WaitUntilDecoded(lock, *pendingMarket);
+	hydrated = std::move(pendingMarket->hydrated);
+	pendingMarkets.erase(coinPair);
+}
+
+void MarketHydrator::StartWarmUp(const std::vector<CoinPair>& priority) {
+	StopWarmUp();
+
+	std::vector<CoinPair> order;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = false;
+		sealRequested = false;
+		order = priority;
+		for (const auto& pendingMarket : pendingMarkets) {
+			order.push_back(pendingMarket.first);
+		}
+	}
+
+	// Grouped by base coin, those with the first market in the order going first
+	std::map<int32_t, size_t> baseRanks;
+	for (const auto& coinPair : order) {
+		baseRanks.emplace(coinPair.GetBaseId(), baseRanks.size());
+	}
+	std::stable_sort(order.begin(), order.end(), [&baseRanks](const CoinPair& lhs, const CoinPair& rhs) {
+		return baseRanks.at(lhs.GetBaseId()) < baseRanks.at(rhs.GetBaseId());
+	});
+
+	// Taken here rather than on the thread, so nothing can fork between it starting and taking it
+	forkGuard.emplace();
+	warmUpThread = std::thread(&MarketHydrator::WarmUp, this, std::move(order));
+}
+
+void MarketHydrator::StopWarmUp() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	if (warmUpThread.joinable()) {
+		warmUpThread.join();
+	}
+	forkGuard.reset();
+}
+
+bool MarketHydrator::IsWarmingUp() const {
+	return warmUpThread.joinable();
+}
+
+void MarketHydrator::WarmUp(std::vector<CoinPair> order) {
+	// The markets decoded into the current shard stay Decoding until it is handed out with them
+	std::shared_ptr<PoolShard> poolShard;
+	int32_t baseId = 0;
+	std::vector<std::shared_ptr<PendingMarket>> unsealed;
+	auto seal = [this, &poolShard, &unsealed]() {
+		for (auto& pendingMarket : unsealed) {
+			pendingMarket->state = State::Decoded;
+		}
+		unsealed.clear();
+		poolShard.reset();
+		sealRequested = false;
+		decoded.notify_all();
+	};
+
+	for (const auto& coinPair : order) {
+		std::shared_ptr<PendingMarket> pendingMarket;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (poolShard && (stopping || sealRequested || coinPair.GetBaseId() != baseId)) {
+				seal();
+			}
+			if (stopping) {
+				return;
+			}
+
+			// Already taken, or listed twice
+			auto it = pendingMarkets.find(coinPair);
+			if (it == pendingMarkets.end() || it->second->state != State::Pending) {
+				continue;
+			}
+
+			pendingMarket = it->second;
+			pendingMarket->state = State::Decoding;
+		}
+
+		// A failure is left for Take() to retry, so it is reported where the market was needed
+		std::optional<HydratedMarket> hydrated;
+		try {
+			if (!poolShard) {
+				poolShard = std::make_shared<PoolShard>();
+				baseId = coinPair.GetBaseId();
+			}
+			ScopedPoolShard scopedPoolShard(*poolShard);
+			hydrated.emplace(); // The market's book has to be created in the scope too
+			hydrated->poolShard = poolShard;
+			pendingMarket->loader(&hydrated->market);
+		} catch (...) {
+			hydrated.reset();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (hydrated) {
+			pendingMarket->hydrated = std::move(hydrated);
+			unsealed.push_back(std::move(pendingMarket));
+		} else {
+			pendingMarket->state = State::Pending;
+			decoded.notify_all();
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	seal();
+}
+
+void MarketHydrator::WaitUntilDecoded(std::unique_lock<std::mutex>& lock, const PendingMarket& pendingMarket) {
+	decoded.wait(lock, [this, &pendingMarket]() {
+		if (pendingMarket.state != State::Decoding) {
+			return true;
+		}
+
+		// It may be waiting for the rest of its base coin
+		sealRequested = true;
+		return false;
+	});
+}
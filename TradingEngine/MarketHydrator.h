@@ -0,0 +1,88 @@
+#pragma once
+
+#include "CoinPair.h"
+#include "Market.h"
+#include "NodePool.h"
+#include "PlatformSpecific/fork_process.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Decodes a market into the (default constructed) one given, on whichever thread hydrates it
+using MarketLoader = std::function<void(Market* market)>;
+
+struct HydratedMarket {
+	std::shared_ptr<PoolShard> poolShard; // Set when the warm-up decoded it, shared by its base coin
+	Market market;
+};
+
+// The markets registered from snapshot metadata whose books haven't been decoded yet (see
+// MarketManager::RegisterMarket). Whoever needs one first decodes it, unless the warm-up thread
+// has already got to it. The markets already hydrated are matching in their base coin's shard, so
+// the warm-up can't decode into it. It goes a base coin at a time instead, decoding them into a
+// shard of their own which is only handed out once it has moved on (or is asked to, by whoever
+// is waiting for one of them), so they still share one.
+class MarketHydrator {
+public:
+	MarketHydrator() = default;
+	MarketHydrator(const MarketHydrator&) = delete;
+	MarketHydrator& operator=(const MarketHydrator&) = delete;
+	~MarketHydrator(); // Stops the warm-up
+
+	// stateHash is the market's part of TradingEngine::GetStateHash() when it was saved
+	void Register(const CoinPair& coinPair, MarketLoader loader, uint32_t stateHash = 0);
+	bool IsPending(const CoinPair& coinPair) const;
+	bool IsEmpty() const;
+	size_t GetNumPending() const;
+	std::vector<CoinPair> GetPending() const;
+	std::vector<std::pair<CoinPair, uint32_t>> GetPendingStateHashes() const;
+	size_t GetNumUndecoded() const; // Pending, but not decoded by the warm-up yet
+
+	// Removes the market, decoding it on this thread into poolShard unless the warm-up already
+	// has (if it is part way through, this waits for it). Empty if it isn't pending. If the loader
+	// throws the exception is passed on and the market stays pending.
+	std::optional<HydratedMarket> Take(const CoinPair& coinPair, PoolShard& poolShard);
+
+	// Drops it without decoding it (i.e it's been replaced)
+	void Remove(const CoinPair& coinPair);
+
+	// Any left after the ones in priority order are warmed up in coin pair order
+	void StartWarmUp(const std::vector<CoinPair>& priority);
+	void StopWarmUp(); // Waits for the market it's decoding
+	bool IsWarmingUp() const;
+
+private:
+	enum class State {
+		Pending,
+		Decoding,
+		Decoded
+	};
+
+	struct PendingMarket {
+		MarketLoader loader;
+		uint32_t stateHash = 0;
+		State state = State::Pending;
+		std::optional<HydratedMarket> hydrated; // Once the warm-up has decoded it
+	};
+
+	// Everything below is shared with the warm-up thread
+	mutable std::mutex mutex;
+	std::condition_variable decoded;
+	std::map<CoinPair, std::shared_ptr<PendingMarket>> pendingMarkets;
+	bool stopping = false;
+	bool sealRequested = false; // Someone is waiting for a market which the warm-up decoded
+	std::thread warmUpThread;
+	std::optional<ps::ForkGuard> forkGuard; // Until the warm-up is stopped, see BackgroundSnapshot
+
+	void WarmUp(std::vector<CoinPair> order);
+	void WaitUntilDecoded(std::unique_lock<std::mutex>& lock, const PendingMarket& pendingMarket);
+};
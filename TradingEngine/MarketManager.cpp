@@ -11,35 +11,197 @@
 #include <utility>
 
 void MarketManager::AddMarket(Market&& market) {
+	auto& poolShard = GetPoolShard(market.GetCoinPair().GetBaseId());
+	InsertMarket(std::move(market), poolShard);
+}
+
+void MarketManager::InsertMarket(Market&& market, PoolShard& poolShard) {
 	auto& markets = marketsMap[market.GetCoinPair().GetBaseId()];
 	auto lb = findLbMarketFromCoinId(markets, market.GetCoinPair().GetCoinId());
-	if (lb != markets.end() && lb->GetCoinPair().GetCoinId() == market.GetCoinPair().GetCoinId()) {
+	if ((lb != markets.end() && lb->GetCoinPair().GetCoinId() == market.GetCoinPair().GetCoinId())
+	|| (hydrator && hydrator->IsPending(market.GetCoinPair()))) {
 		throw Error(Error::Type::MarketAlreadyExists);
 	}
 
 	lb = markets.insert(lb, std::move(market));
+	lb->SetPoolShard(poolShard);
+	lb->SetReservationTotal(reservationTotal.get());
+	lb->SetUserFeeTiers(userFeeTiers.get());
+
+	// The market may already have orders in it (i.e restoring)
+	for (const auto& userOrders : lb->GetUserOrderMap()) {
+		AddUserMarket(userOrders.first, lb->GetCoinPair());
+	}
+}
+
+void MarketManager::RegisterMarket(const CoinPair& coinPair, MarketLoader loader, const std::vector<int32_t>& userIds, uint32_t stateHash) {
+	auto& markets = marketsMap[coinPair.GetBaseId()];
+	auto lb = findLbMarketFromCoinId(markets, coinPair.GetCoinId());
+	if (lb != markets.end() && lb->GetCoinPair().GetCoinId() == coinPair.GetCoinId()) {
+		throw Error(Error::Type::MarketAlreadyExists);
+	}
+
+	if (!hydrator) {
+		hydrator = std::make_unique<MarketHydrator>();
+	}
+	hydrator->Register(coinPair, std::move(loader), stateHash);
+	for (auto userId : userIds) {
+		AddUserMarket(userId, coinPair);
+	}
+}
+
+void MarketManager::StartWarmUp(const std::vector<CoinPair>& priority) {
+	if (hydrator) {
+		hydrator->StartWarmUp(priority);
+	}
+}
+
+void MarketManager::StopWarmUp() {
+	if (hydrator) {
+		hydrator->StopWarmUp();
+	}
+}
+
+void MarketManager::HydrateAll() {
+	while (hydrator && !hydrator->IsEmpty()) {
+		for (const auto& coinPair : hydrator->GetPending()) {
+			Hydrate(coinPair);
+		}
+	}
+}
+
+size_t MarketManager::GetNumPendingMarkets() const {
+	return hydrator ? hydrator->GetNumPending() : 0;
+}
+
+std::vector<std::pair<CoinPair, uint32_t>> MarketManager::GetPendingStateHashes() const {
+	return hydrator ? hydrator->GetPendingStateHashes() : std::vector<std::pair<CoinPair, uint32_t>>();
+}
+
+bool MarketManager::IsWarmedUp() const {
+	return !hydrator || hydrator->GetNumUndecoded() == 0;
+}
+
+bool MarketManager::Hydrate(const CoinPair& coinPair) {
+	if (!hydrator) {
+		return false;
+	}
+
+	auto hydrated = hydrator->Take(coinPair, GetPoolShard(coinPair.GetBaseId()));
+	if (!hydrated) {
+		return false;
+	}
+
+	if (!hydrated->poolShard) {
+		InsertMarket(std::move(hydrated->market), GetPoolShard(coinPair.GetBaseId()));
+		return true;
+	}
+
+	if (std::find(hydratedPoolShards.begin(), hydratedPoolShards.end(), hydrated->poolShard) == hydratedPoolShards.end()) {
+		hydratedPoolShards.push_back(hydrated->poolShard);
+	}
+	InsertMarket(std::move(hydrated->market), *hydrated->poolShard);
+	return true;
+}
+
+void MarketManager::SetMarket(Market&& market) {
+	// Replaces the snapshot's version, which would only be thrown away
+	if (hydrator) {
+		hydrator->Remove(market.GetCoinPair());
+	}
+
+	auto& markets = marketsMap[market.GetCoinPair().GetBaseId()];
+	auto lb = findLbMarketFromCoinId(markets, market.GetCoinPair().GetCoinId());
+	if (lb == markets.end() || lb->GetCoinPair().GetCoinId() != market.GetCoinPair().GetCoinId()) {
+		AddMarket(std::move(market));
+		return;
+	}
+
+	lb->SetReservationTotal(nullptr);
+	*lb = std::move(market);
+	lb->SetPoolShard(*poolShards.at(lb->GetCoinPair().GetBaseId()));
+	lb->SetReservationTotal(reservationTotal.get());
+	lb->SetUserFeeTiers(userFeeTiers.get());
+
+	for (const auto& userOrders : lb->GetUserOrderMap()) {
+		AddUserMarket(userOrders.first, lb->GetCoinPair());
+	}
+}
+
+std::vector<Market> MarketManager::TakeModifiedMarkets() {
+	std::vector<Market> modifiedMarkets;
+	for (auto& markets : marketsMap) {
+		for (auto& market : markets.second) {
+			if (market.IsModified()) {
+				market.ClearModified();
+				modifiedMarkets.push_back(market);
+			}
+		}
+	}
+	return modifiedMarkets;
+}
+
+void MarketManager::ClearModified() {
+	userFeeTiersModified = false;
+	for (auto& markets : marketsMap) {
+		for (auto& market : markets.second) {
+			market.ClearModified();
+		}
+	}
+}
+
+void MarketManager::AddUserMarket(int32_t userId, const CoinPair& coinPair) {
+	auto& coinPairs = userMarketsMap[userId];
+	auto lb = std::lower_bound(coinPairs.begin(), coinPairs.end(), coinPair);
+	if (lb == coinPairs.end() || *lb != coinPair) {
+		coinPairs.insert(lb, coinPair);
+	}
+}
+
+void MarketManager::RebuildIndexes() {
+	userMarketsMap.clear();
+	for (auto& markets : marketsMap) {
+		for (auto& market : markets.second) {
+			market.SetReservationTotal(reservationTotal.get());
+			market.SetUserFeeTiers(userFeeTiers.get());
+			market.LinkUserOrders();
+			for (const auto& userOrders : market.GetUserOrderMap()) {
+				AddUserMarket(userOrders.first, market.GetCoinPair());
+			}
+		}
+	}
 }
 
-//
+// Only visits (and hydrates) the markets the user has placed orders in, rather than every market.
 std::unordered_map<CoinPair, std::vector<int64_t>> MarketManager::CancelAll(int32_t userId, WalletManager& walletManager) {
 	std::unordered_map<CoinPair, std::vector<int64_t>> cancelledOrderMap;
 
-	for (auto& [baseId, markets] : marketsMap) {
-		auto baseWallet = walletManager.GetWallet(baseId);
+	auto it = userMarketsMap.find(userId);
+	if (it == userMarketsMap.end()) {
+		return cancelledOrderMap;
+	}
+
+	// Hydrating a market indexes its users again, so the list is taken out first
+	std::vector<CoinPair> coinPairs;
+	coinPairs.swap(it->second);
+	for (const auto& coinPair : coinPairs) {
+		auto baseWallet = walletManager.GetWallet(coinPair.GetBaseId());
 		baseWallet->GetAddress(userId)->SetInOrder(0);
 
-		for (auto& market : markets) {
-			auto coinWallet = walletManager.GetWallet(market.GetCoinPair().GetCoinId());
-			coinWallet->GetAddress(userId)->SetInOrder(0);
-			auto cancelledIds = market.CancelAll(userId);
-			cancelledOrderMap.insert(std::make_pair(market.GetCoinPair(), std::move(cancelledIds)));
-		}
+		auto coinWallet = walletManager.GetWallet(coinPair.GetCoinId());
+		coinWallet->GetAddress(userId)->SetInOrder(0);
+
+		auto cancelledIds = GetMarket(coinPair)->CancelAll(userId);
+		cancelledOrderMap.insert(std::make_pair(coinPair, std::move(cancelledIds)));
 	}
+
+	userMarketsMap.erase(userId);
 	return cancelledOrderMap;
 }
 
 // This cancels everyone's order in all markets
 void MarketManager::CancelAll(WalletManager& walletManager) {
+	HydrateAll();
 	for (auto& markets : marketsMap) {
 		auto baseWallet = walletManager.GetWallet(markets.first);
 		for (auto& address : baseWallet->GetAddresses()) {
@@ -55,9 +217,12 @@ void MarketManager::CancelAll(WalletManager& walletManager) {
 			market.CancelAll();
 		}
 	}
+
+	userMarketsMap.clear();
 }
 
 void MarketManager::SetFees(double feePercent) {
+	HydrateAll();
 	for (auto& markets : marketsMap) {
 		for (auto& market : markets.second) {
 			market.SetFeePercentage(feePercent);
@@ -65,7 +230,61 @@ void MarketManager::SetFees(double feePercent) {
 	}
 }
 
+void MarketManager::SetFeeTier(uint8_t tier, double makerFeePercent, double takerFeePercent) {
+	HydrateAll();
+	for (auto& markets : marketsMap) {
+		for (auto& market : markets.second) {
+			market.SetFeeTier(tier, makerFeePercent, takerFeePercent);
+		}
+	}
+}
+
+void MarketManager::SetUserFeeTier(int32_t userId, uint8_t tier) {
+	userFeeTiers->SetUserTier(userId, tier);
+	userFeeTiersModified = true;
+}
+
+MarketFeeSchedules MarketManager::GetFeeSchedules() const {
+	MarketFeeSchedules feeSchedules;
+	for (const auto& markets : marketsMap) {
+		for (const auto& market : markets.second) {
+			feeSchedules.emplace_back(market.GetCoinPair(), market.GetFeeSchedule());
+		}
+	}
+	return feeSchedules;
+}
+
+void MarketManager::SetFeeSchedules(const MarketFeeSchedules& feeSchedules) {
+	for (const auto& [coinPair, feeSchedule] : feeSchedules) {
+		auto market = GetMarket(coinPair);
+		if (market == marketsMap[coinPair.GetBaseId()].end() || market->GetCoinPair() != coinPair) {
+			throw Error(Error::Type::SnapshotFailed, "The fee schedule is for a market which doesn't exist");
+		}
+		market->SetFeeSchedule(feeSchedule);
+	}
+}
+
+const UserFeeTiers& MarketManager::GetUserFeeTiers() const {
+	return *userFeeTiers;
+}
+
+// The markets keep pointing at the same table
+void MarketManager::SetUserFeeTiers(const UserFeeTiers& userFeeTiers) {
+	*this->userFeeTiers = userFeeTiers;
+	userFeeTiersModified = true;
+}
+
+std::optional<UserFeeTiers> MarketManager::TakeModifiedUserFeeTiers() {
+	if (!userFeeTiersModified) {
+		return std::nullopt;
+	}
+
+	userFeeTiersModified = false;
+	return *userFeeTiers;
+}
+
 void MarketManager::SetMaxNumLimitOpenOrders(int32_t numOpenOrders) {
+	HydrateAll();
 	for (auto& markets : marketsMap) {
 		for (auto& market : markets.second) {
 			market.SetMaxNumLimitOpenOrders(numOpenOrders);
@@ -74,6 +293,7 @@ void MarketManager::SetMaxNumLimitOpenOrders(int32_t numOpenOrders) {
 }
 
 void MarketManager::SetMaxNumStopLimitOpenOrders(int32_t numOpenOrders) {
+	HydrateAll();
 	for (auto& markets : marketsMap) {
 		for (auto& market : markets.second) {
 			market.SetMaxNumStopLimitOpenOrders(numOpenOrders);
@@ -94,13 +314,75 @@ std::vector<Market>& markets, int32_t coinId) {
 // Assumes that the market exists
 std::vector<Market>::iterator MarketManager::GetMarket(const CoinPair& coinPair) {
 	auto& markets = marketsMap[coinPair.GetBaseId()];
-	return findLbMarketFromCoinId(markets, coinPair.GetCoinId());
+	auto lb = findLbMarketFromCoinId(markets, coinPair.GetCoinId());
+	if ((lb == markets.end() || lb->GetCoinPair().GetCoinId() != coinPair.GetCoinId()) && Hydrate(coinPair)) {
+		lb = findLbMarketFromCoinId(markets, coinPair.GetCoinId());
+	}
+	return lb;
 }
 
 const MarketsMap& MarketManager::GetMarkets() const {
 	return marketsMap;
 }
 
+const UserMarketsMap& MarketManager::GetUserMarkets() const {
+	return userMarketsMap;
+}
+
+void MarketManager::DumpLatencyStats(std::ostream& os) const {
+	for (const auto& markets : marketsMap) {
+		for (const auto& market : markets.second) {
+			if (auto latencyStats = market.GetLatencyStats()) {
+				latencyStats->Dump(os, market.GetCoinPair());
+			}
+		}
+	}
+}
+
+void MarketManager::ResetLatencyStats() {
+	for (auto& markets : marketsMap) {
+		for (auto& market : markets.second) {
+			if (auto latencyStats = market.GetLatencyStats()) {
+				latencyStats->Reset();
+			}
+		}
+	}
+}
+
+size_t MarketManager::TrimPools() {
+	auto released = PoolShard::GetDefault().Trim();
+	for (auto& poolShard : poolShards) {
+		released += poolShard.second->Trim();
+	}
+	for (auto& poolShard : hydratedPoolShards) {
+		released += poolShard->Trim();
+	}
+	return released;
+}
+
+PoolShard& MarketManager::GetPoolShard(int32_t baseId) {
+	auto& poolShard = poolShards[baseId];
+	if (!poolShard) {
+		poolShard = std::make_shared<PoolShard>();
+	}
+	return *poolShard;
+}
+
+size_t MarketManager::GetReservedPoolBytes() const {
+	auto reserved = PoolShard::GetDefault().GetReservedBytes();
+	for (const auto& poolShard : poolShards) {
+		reserved += poolShard.second->GetReservedBytes();
+	}
+	for (const auto& poolShard : hydratedPoolShards) {
+		reserved += poolShard->GetReservedBytes();
+	}
+	return reserved;
+}
+
+bool MarketManager::InOrderMatchesReservations(const WalletManager& walletManager) const {
+	return (walletManager.GetTotalInOrder() == *reservationTotal);
+}
+
 bool MarketManager::operator==(const MarketManager& marketManager) const {
-	return (marketsMap == marketManager.marketsMap);
+	return (marketsMap == marketManager.marketsMap && *userFeeTiers == *marketManager.userFeeTiers);
 }
@@ -1,16 +1,25 @@
 #pragma once
 
 #include "Market.h"
+#include "MarketHydrator.h"
+#include "NodePool.h"
 #include "WalletManager.h"
 #include "serializer_defines.h"
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 SERIALIZE_HEADER(MarketManager)
 
 using MarketsMap = std::unordered_map<int32_t, std::vector<Market>>;
+using UserMarketsMap = std::unordered_map<int32_t, std::vector<CoinPair>>;
+using MarketFeeSchedules = std::vector<std::pair<CoinPair, FeeSchedule>>;
 
 class MarketManager {
 public:
@@ -19,9 +28,56 @@ public:
 	MarketManager() = default; // For serializing
 	void AddMarket(Market&& market);
 
+	// Registers a market without decoding its book (i.e from snapshot metadata), which is done when
+	// it's first needed or by the warm-up thread, whichever is first. userIds are the users with
+	// orders in it (from the snapshot index), so cancelling all of a user's orders only hydrates
+	// their markets. stateHash is its part of TradingEngine::GetStateHash() when it was saved.
+	// Anything which goes through every market hydrates the rest first. The const accessors only
+	// see hydrated markets.
+	void RegisterMarket(const CoinPair& coinPair, MarketLoader loader, const std::vector<int32_t>& userIds = {}, uint32_t stateHash = 0);
+
+	// Hydrates the markets in the background, those in priority order (e.g by volume) first
+	void StartWarmUp(const std::vector<CoinPair>& priority);
+	void StopWarmUp();
+	void HydrateAll();
+	size_t GetNumPendingMarkets() const;
+	std::vector<std::pair<CoinPair, uint32_t>> GetPendingStateHashes() const;
+
+	// Every pending market has been decoded, so hydrating them won't hold anything up
+	bool IsWarmedUp() const;
+
+	// Adds the market, or replaces the one with the same coin pair (i.e applying a delta snapshot)
+	void SetMarket(Market&& market);
+
+	// Copies of the markets changed since the last call
+	std::vector<Market> TakeModifiedMarkets();
+	void ClearModified();
+
+	// Hydrates it if it's still pending
 	std::vector<Market>::iterator GetMarket(const CoinPair& coinPair);
 
+	// Records that the user may have open orders in this market, so CancelAll(userId) visits it
+	void AddUserMarket(int32_t userId, const CoinPair& coinPair);
+
+	// The index above and the reservation total aren't serialized, so they're rebuilt from the
+	// markets once they have been deserialized (see serialize(TradingEngine)). The markets are
+	// reattached to the user fee tiers too.
+	void RebuildIndexes();
+
 	void SetFees(double feePercent);
+	void SetFeeTier(uint8_t tier, double makerFeePercent, double takerFeePercent);
+	// Applies to every market (including pending ones) without visiting them
+	void SetUserFeeTier(int32_t userId, uint8_t tier);
+
+	// Neither the markets' archives nor the manager's have the fees, so snapshots carry these
+	// alongside them. Only the hydrated markets' schedules are returned.
+	MarketFeeSchedules GetFeeSchedules() const;
+	void SetFeeSchedules(const MarketFeeSchedules& feeSchedules);
+	const UserFeeTiers& GetUserFeeTiers() const;
+	void SetUserFeeTiers(const UserFeeTiers& userFeeTiers);
+
+	// A copy of the user fee tiers if any have changed since the last call (or ClearModified())
+	std::optional<UserFeeTiers> TakeModifiedUserFeeTiers();
 	void SetMaxNumLimitOpenOrders(int32_t numOpenOrders);
 	void SetMaxNumStopLimitOpenOrders(int32_t numOpenOrders);
 
@@ -30,11 +86,56 @@ public:
 
 	bool operator==(const MarketManager& marketManager) const;
 
+	// Checks that the in order of every wallet adds up to what the open orders of every market
+	// reserve. O(1), both sums are kept up to date as they change, so it can run after every batch.
+	// The coins are summed together, Wallet::GetTotalInOrder and Market::GetReservations narrow a
+	// mismatch down. Markets which are still pending only count once they are hydrated.
+	bool InOrderMatchesReservations(const WalletManager& walletManager) const;
+
+	// Writes the stage timings of every market, see LatencyStats.h
+	void DumpLatencyStats(std::ostream& os) const;
+	void ResetLatencyStats();
+
+	// The shard the markets of this base coin are in, created if there are none yet
+	PoolShard& GetPoolShard(int32_t baseId);
+
+	// Frees the pool slabs which no longer hold any price levels or orders, returns the bytes released
+	size_t TrimPools();
+	size_t GetReservedPoolBytes() const;
+
 	// Just for testing
 	const MarketsMap& GetMarkets() const;
+	const UserMarketsMap& GetUserMarkets() const;
 
 private:
+	// The markets of each base coin share a shard, declared first so it outlives them
+	std::unordered_map<int32_t, std::shared_ptr<PoolShard>> poolShards;
+
+	// Of the markets the warm-up hydrated, which stay in the shard they were decoded into (one
+	// for each base coin it went through, see MarketHydrator)
+	std::vector<std::shared_ptr<PoolShard>> hydratedPoolShards;
+
+	// The reservations of every market added up, on the heap so that the markets can point to it
+	// while the manager moves around
+	std::unique_ptr<int64_t> reservationTotal = std::make_unique<int64_t>(0);
+
+	// Which fee tier each user is on, shared by every market (likewise on the heap)
+	std::unique_ptr<UserFeeTiers> userFeeTiers = std::make_unique<UserFeeTiers>();
+	bool userFeeTiersModified = false;
+
 	// Map of base coin ids against a vector of markets for each coin pair sorted by coin id
 	MarketsMap marketsMap;
+
+	// Map of user ids against the coin pairs (sorted) of markets they have placed orders in since
+	// their last mass cancel. It can contain markets where everything has since been filled or
+	// cancelled, it only needs to be a superset.
+	UserMarketsMap userMarketsMap;
+
+	// Only created once a market is registered
+	std::unique_ptr<MarketHydrator> hydrator;
+
+	void InsertMarket(Market&& market, PoolShard& poolShard);
+	bool Hydrate(const CoinPair& coinPair);
+
 	std::vector<Market>::iterator findLbMarketFromCoinId(std::vector<Market>& markets, int32_t coinId);
 };
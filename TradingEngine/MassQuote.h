@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// A single level of a market maker's quote ladder
+struct QuoteLevel {
+	int64_t price;
+	int64_t amount;
+
+	bool operator==(const QuoteLevel& quoteLevel) const {
+		return (price == quoteLevel.price && amount == quoteLevel.amount);
+	}
+};
+
+// Everything a user is quoting in one market, it replaces all of their resting limit orders
+// there in one go (see Market::ReplaceQuotes). Either side can be empty.
+struct MassQuote {
+	std::vector<QuoteLevel> bids;
+	std::vector<QuoteLevel> asks;
+
+	bool operator==(const MassQuote& massQuote) const {
+		return (bids == massQuote.bids && asks == massQuote.asks);
+	}
+};
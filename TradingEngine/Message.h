@@ -1,20 +1,26 @@
 #pragma once
 
+#include "MassQuote.h"
 #include "MessageType.h"
 
 #include <cstdint>
 #include <string>
 
-// This will be attached with Messages of MessageType::CancelAllOrders
+// This will be attached with Messages of MessageType::CancelAllOrders and MessageType::MassQuote
 struct Message {
 	inline static std::string cancelOrders;
 
+	// The ladder for Messages of MessageType::MassQuote
+	inline static MassQuote massQuote;
+
 	MessageType messageType = MessageType::Last;
 	int32_t id = 0; // This is set from Jason.. to uniquely identify messages
 
 	union {
 		int64_t stopPrice = -1;
 		double feePercentage;
+		int64_t newPrice; // AmendOrder
+		int64_t buyFee; // NewTrade
 	};
 
 	union {
@@ -48,7 +54,10 @@ struct Message {
 		int32_t maxNumStopLimitOpenOrders;
 	};
 
-	int64_t filled;
+	union {
+		int64_t filled;
+		int64_t sellFee; // NewTrade
+	};
 
 	union {
 		bool isBuy;
@@ -79,6 +88,16 @@ struct Message {
 				&& orderType == message.orderType && orderId == message.orderId
 				&& price == message.price);
 				break;
+			case MessageType::AmendOrder:
+				equal = (coinId == message.coinId && baseId == message.baseId && isBuy == message.isBuy
+				&& orderId == message.orderId && price == message.price && newPrice == message.newPrice
+				&& amount == message.amount);
+				break;
+			case MessageType::MassQuote:
+				equal = (coinId == message.coinId && baseId == message.baseId
+				&& userId == message.userId);
+				// Additionally the static massQuote needs to be checked..
+				break;
 			case MessageType::CancelAllOrders:
 				equal = (userId == message.userId);
 				// Additionally the static cancelOrders needs to be checked..
@@ -119,7 +138,8 @@ struct Message {
 			case MessageType::NewTrade:
 				equal = (buyOrderId == message.buyOrderId && sellOrderId == message.sellOrderId
 				&& amount == message.amount && price == message.price
-				&& tradeId == message.tradeId);
+				&& tradeId == message.tradeId && buyFee == message.buyFee
+				&& sellFee == message.sellFee);
 				break;
 			case MessageType::NewOpenOrder:
 				equal = (coinId == message.coinId && baseId == message.baseId
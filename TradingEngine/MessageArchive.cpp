@@ -0,0 +1,203 @@
+#include "MessageArchive.h"
+
+#include "BlockCodec.h"
+#include "Error.h"
+#include "Journal.h"
+#include "PlatformSpecific/crc32c.h"
+
+#include <cstring>
+#include <memory>
+
+namespace {
+constexpr char magic[8] = { 'W', 'T', 'E', 'A', 'R', 'C', 'H', '\0' };
+constexpr uint32_t formatVersion = 1;
+constexpr uint32_t maxBlockSize = 1024 * 1024 * 1024; // Anything bigger is corrupt
+
+struct FileHeader {
+	char magic[8];
+	uint32_t formatVersion;
+	uint32_t reserved;
+};
+
+struct BlockHeader {
+	uint64_t firstSequence;
+	uint32_t numMessages;
+	uint32_t rawSize; // Encoded, before compression
+	uint32_t storedSize;
+	uint32_t crc; // Of this header (with crc 0) and the stored bytes
+	uint8_t codec;
+	uint8_t reserved[7];
+};
+
+uint32_t BlockCrc(BlockHeader header, const char* data) {
+	header.crc = 0;
+	return ps::Crc32c(data, header.storedSize, ps::Crc32c(&header, sizeof(header)));
+}
+}
+
+MessageArchiveWriter::MessageArchiveWriter(std::ostream& stream, const MessageArchiveConfig& config, uint64_t firstSequence)
+	: stream(stream)
+	, config(config)
+	, firstSequence(firstSequence) {
+	FileHeader header;
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.formatVersion = formatVersion;
+	header.reserved = 0;
+	if (!stream.write(reinterpret_cast<const char*>(&header), sizeof(header))) {
+		throw Error(Error::Type::ArchiveFailed, "Could not write the archive");
+	}
+	block.reserve(config.blockSize + 1024);
+	stats.numStoredBytes = sizeof(header);
+}
+
+MessageArchiveWriter::~MessageArchiveWriter() {
+	try {
+		Flush();
+	} catch (const Error&) {
+		// The stream has failed, which the owner can check for
+	}
+}
+
+uint64_t MessageArchiveWriter::Append(const Message& message) {
+	encoder.Encode(message, &block);
+	++numMessages;
+	++stats.numMessages;
+	stats.numRawBytes += GetRawSize(message);
+
+	auto sequence = firstSequence + numMessages - 1;
+	if (block.size() >= config.blockSize) {
+		Flush();
+	}
+	return sequence;
+}
+
+void MessageArchiveWriter::Flush() {
+	if (numMessages == 0) {
+		return;
+	}
+
+	BlockHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.firstSequence = firstSequence;
+	header.numMessages = numMessages;
+	header.rawSize = static_cast<uint32_t>(block.size());
+	header.codec = static_cast<uint8_t>(ArchiveCodec::None);
+
+	const std::string* stored = &block;
+	if (config.codec == ArchiveCodec::Lz) {
+		compressed.clear();
+		CompressBlock(block, &compressed);
+		if (compressed.size() < block.size()) {
+			header.codec = static_cast<uint8_t>(ArchiveCodec::Lz);
+			stored = &compressed;
+		}
+	}
+	header.storedSize = static_cast<uint32_t>(stored->size());
+	header.crc = BlockCrc(header, stored->data());
+
+	if (!stream.write(reinterpret_cast<const char*>(&header), sizeof(header)) || !stream.write(stored->data(), stored->size())) {
+		throw Error(Error::Type::ArchiveFailed, "Could not write the archive");
+	}
+
+	++stats.numBlocks;
+	stats.numEncodedBytes += block.size();
+	stats.numStoredBytes += sizeof(header) + stored->size();
+
+	// Each block can be decoded on its own
+	firstSequence += numMessages;
+	numMessages = 0;
+	block.clear();
+	encoder.Reset();
+}
+
+MessageArchiveStats MessageArchiveWriter::GetStats() const {
+	return stats;
+}
+
+uint64_t ReadMessageArchive(std::istream& stream, const MessageHandler& handler, uint64_t fromSequence) {
+	FileHeader fileHeader;
+	if (!stream.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader))
+		|| std::memcmp(fileHeader.magic, magic, sizeof(magic)) != 0 || fileHeader.formatVersion != formatVersion) {
+		throw Error(Error::Type::ArchiveFailed, "Not a message archive");
+	}
+
+	MessageDecoder decoder;
+	std::string stored;
+	std::string block;
+	uint64_t lastSequence = 0;
+	while (true) {
+		BlockHeader header;
+		stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (stream.gcount() == 0 && stream.eof()) {
+			return lastSequence;
+		}
+		if (!stream || header.numMessages == 0 || header.storedSize > maxBlockSize || header.rawSize > maxBlockSize) {
+			throw Error(Error::Type::ArchiveFailed, "The archive has a corrupt block header");
+		}
+
+		// Skipped over without reading it
+		auto blockLastSequence = header.firstSequence + header.numMessages - 1;
+		if (blockLastSequence < fromSequence) {
+			if (!stream.seekg(header.storedSize, std::ios::cur)) {
+				throw Error(Error::Type::ArchiveFailed, "The archive is truncated");
+			}
+			lastSequence = blockLastSequence;
+			continue;
+		}
+
+		stored.resize(header.storedSize);
+		if (!stream.read(stored.data(), stored.size())) {
+			throw Error(Error::Type::ArchiveFailed, "The archive is truncated");
+		}
+		if (BlockCrc(header, stored.data()) != header.crc) {
+			throw Error(Error::Type::ArchiveFailed, "The archive has a corrupt block");
+		}
+
+		const std::string* encoded = &stored;
+		if (header.codec == static_cast<uint8_t>(ArchiveCodec::Lz)) {
+			block.clear();
+			if (!DecompressBlock(stored, header.rawSize, &block)) {
+				throw Error(Error::Type::ArchiveFailed, "The archive has a corrupt block");
+			}
+			encoded = &block;
+		} else if (header.codec != static_cast<uint8_t>(ArchiveCodec::None)) {
+			throw Error(Error::Type::ArchiveFailed, "The archive uses an unknown codec");
+		}
+
+		decoder.Reset();
+		std::string_view data(*encoded);
+		Message message;
+		for (uint32_t i = 0; i < header.numMessages; ++i) {
+			if (!decoder.Decode(&data, &message)) {
+				throw Error(Error::Type::ArchiveFailed, "The archive has a corrupt block");
+			}
+			auto sequence = header.firstSequence + i;
+			if (sequence >= fromSequence) {
+				handler(sequence, message);
+			}
+		}
+		lastSequence = blockLastSequence;
+	}
+}
+
+uint64_t ArchiveJournal(const std::string& directory, std::ostream& stream, const MessageArchiveConfig& config) {
+	std::unique_ptr<MessageArchiveWriter> writer;
+	uint64_t numArchived = 0;
+	Message message;
+	Journal::Read(directory, [&](uint64_t sequence, std::string_view record) {
+		if (!writer) {
+			writer = std::make_unique<MessageArchiveWriter>(stream, config, sequence);
+		}
+		if (!Journal::DecodeMessage(record, &message)) {
+			throw Error(Error::Type::ArchiveFailed, "The journal has a record which isn't a message");
+		}
+		writer->Append(message);
+		++numArchived;
+	});
+
+	if (!writer) {
+		writer = std::make_unique<MessageArchiveWriter>(stream, config);
+	}
+	writer->Flush();
+	return numArchived;
+}
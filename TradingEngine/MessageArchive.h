@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Message.h"
+#include "MessageCodec.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+
+// A file of Messages (i.e the input journal, or the events which came out) for keeping history
+// around. Messages are delta encoded (see MessageCodec.h) into blocks, each compressed (see
+// BlockCodec.h) and covered by a CRC32C. Every block starts the encoding again, so replay can
+// skip whole blocks before the sequence it wants from their headers alone.
+enum class ArchiveCodec : uint8_t {
+	None = 0,
+	Lz = 1
+};
+
+struct MessageArchiveConfig {
+	size_t blockSize = 64 * 1024; // Encoded bytes collected before a block is compressed and written
+	ArchiveCodec codec = ArchiveCodec::Lz; // A block is stored as it is if it doesn't compress
+};
+
+struct MessageArchiveStats {
+	uint64_t numMessages = 0;
+	uint64_t numBlocks = 0;
+	uint64_t numRawBytes = 0; // As they are in memory (and the journal), including attachments
+	uint64_t numEncodedBytes = 0; // After delta encoding
+	uint64_t numStoredBytes = 0; // After compression, including the block headers
+};
+
+class MessageArchiveWriter {
+public:
+	// Messages are numbered consecutively from firstSequence
+	MessageArchiveWriter(std::ostream& stream, const MessageArchiveConfig& config, uint64_t firstSequence = 1);
+	~MessageArchiveWriter(); // Flushes
+
+	MessageArchiveWriter(const MessageArchiveWriter&) = delete;
+	MessageArchiveWriter& operator=(const MessageArchiveWriter&) = delete;
+
+	// Returns the message's sequence. Throws Error::Type::ArchiveFailed if the stream fails.
+	uint64_t Append(const Message& message);
+
+	// Writes what has been appended as a (possibly short) block
+	void Flush();
+
+	MessageArchiveStats GetStats() const;
+
+private:
+	std::ostream& stream;
+	MessageArchiveConfig config;
+	MessageEncoder encoder;
+	std::string block;
+	std::string compressed;
+	uint64_t firstSequence; // Of the block being collected
+	uint32_t numMessages = 0; // In the block being collected
+	MessageArchiveStats stats;
+};
+
+using MessageHandler = std::function<void(uint64_t sequence, const Message& message)>;
+
+// Calls the handler for every message from fromSequence on, the attachment is in
+// Message::cancelOrders/massQuote while it is called. Returns the last sequence in the archive,
+// 0 if it is empty. Throws Error::Type::ArchiveFailed if it isn't an archive or a block is
+// corrupt, after calling the handler for everything before it.
+uint64_t ReadMessageArchive(std::istream& stream, const MessageHandler& handler, uint64_t fromSequence = 0);
+
+// Archives every message in a journal directory (see Journal.h). Returns the number archived.
+uint64_t ArchiveJournal(const std::string& directory, std::ostream& stream, const MessageArchiveConfig& config);
@@ -0,0 +1,265 @@
+#include "MessageCodec.h"
+
+#include <cstring>
+
+namespace {
+struct Field {
+	size_t offset;
+	size_t size;
+	bool perMarket; // Otherwise against the last message of any market
+};
+
+// Ordered by how often they change, so the mask for a typical order fits in one byte. The first
+// two pick the market and so are always against the last message.
+constexpr size_t coinIdField = 0;
+constexpr size_t baseIdField = 1;
+const Field fields[MessageContext::numFields] = {
+	{ offsetof(Message, tradeId), sizeof(int64_t), false }, // And coinId
+	{ offsetof(Message, baseId), sizeof(int32_t), false },
+	{ offsetof(Message, id), sizeof(int32_t), false },
+	{ offsetof(Message, price), sizeof(int64_t), true },
+	{ offsetof(Message, amount), sizeof(int64_t), true },
+	{ offsetof(Message, orderId), sizeof(int64_t), false }, // And userId
+	{ offsetof(Message, isBuy), sizeof(bool), true },
+	{ offsetof(Message, stopPrice), sizeof(int64_t), true },
+	{ offsetof(Message, sellOrderId), sizeof(int64_t), false },
+	{ offsetof(Message, filled), sizeof(int64_t), true },
+	{ offsetof(Message, errorCode), sizeof(int), false },
+	{ offsetof(Message, fullUpdate), sizeof(bool), false }
+};
+
+uint64_t GetField(const Message& message, size_t field) {
+	uint64_t value = 0;
+	std::memcpy(&value, reinterpret_cast<const char*>(&message) + fields[field].offset, fields[field].size);
+	return value;
+}
+
+void SetField(Message* message, size_t field, uint64_t value) {
+	// A bool holding anything but 0 or 1 is undefined behaviour once it's read
+	if (fields[field].size == sizeof(bool)) {
+		value = (value != 0);
+	}
+	std::memcpy(reinterpret_cast<char*>(message) + fields[field].offset, &value, fields[field].size);
+}
+
+// One of the types declared. Last (999999) is a long way past the others, it's the empty message
+// which the engine answers with Error::Type::InvalidMessageType.
+bool IsMessageType(uint64_t messageType) {
+	return messageType <= static_cast<uint64_t>(MessageType::MassQuote) || messageType == static_cast<uint64_t>(MessageType::Last);
+}
+
+uint64_t ZigZag(uint64_t value) {
+	return (value << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(value) >> 63);
+}
+
+uint64_t UnZigZag(uint64_t value) {
+	return (value >> 1) ^ (0 - (value & 1));
+}
+
+void AppendVarint(uint64_t value, std::string* out) {
+	char bytes[10];
+	size_t size = 0;
+	for (; value >= 0x80; value >>= 7) {
+		bytes[size++] = static_cast<char>(value | 0x80);
+	}
+	bytes[size++] = static_cast<char>(value);
+	out->append(bytes, size);
+}
+
+bool ReadVarint(std::string_view* data, uint64_t* value) {
+	*value = 0;
+	for (size_t i = 0; i < data->size() && i < 10; ++i) {
+		auto byte = static_cast<uint8_t>((*data)[i]);
+		*value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+		if ((byte & 0x80) == 0) {
+			data->remove_prefix(i + 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+void AppendLevels(const std::vector<QuoteLevel>& levels, std::string* out) {
+	int64_t price = 0;
+	for (const auto& level : levels) {
+		AppendVarint(ZigZag(level.price - price), out);
+		AppendVarint(ZigZag(level.amount), out);
+		price = level.price;
+	}
+}
+
+bool ReadLevels(std::string_view* data, uint64_t numLevels, std::vector<QuoteLevel>* levels) {
+	levels->clear();
+	int64_t price = 0;
+	for (uint64_t i = 0; i < numLevels; ++i) {
+		uint64_t priceDelta, amount;
+		if (!ReadVarint(data, &priceDelta) || !ReadVarint(data, &amount)) {
+			return false;
+		}
+		price += static_cast<int64_t>(UnZigZag(priceDelta));
+		levels->push_back({ price, static_cast<int64_t>(UnZigZag(amount)) });
+	}
+	return true;
+}
+}
+
+void MessageContext::Reset() {
+	previous = Fields{};
+	markets.clear();
+}
+
+MessageContext::Fields& MessageContext::GetMarket(uint64_t coinId, uint64_t baseId) {
+	return markets.try_emplace(CoinPair(static_cast<int32_t>(coinId), static_cast<int32_t>(baseId)), previous).first->second;
+}
+
+void MessageEncoder::Encode(const Message& message, std::string* out) {
+	Fields values;
+	for (size_t i = 0; i < numFields; ++i) {
+		values[i] = GetField(message, i);
+	}
+
+	auto& market = GetMarket(values[coinIdField], values[baseIdField]);
+	uint64_t mask = 0;
+	Fields deltas;
+	for (size_t i = 0; i < numFields; ++i) {
+		deltas[i] = values[i] - (fields[i].perMarket ? market[i] : previous[i]);
+		if (deltas[i] != 0) {
+			mask |= uint64_t(1) << i;
+		}
+	}
+
+	AppendVarint(static_cast<uint64_t>(message.messageType), out);
+	AppendVarint(mask, out);
+	for (size_t i = 0; i < numFields; ++i) {
+		if (deltas[i] != 0) {
+			AppendVarint(ZigZag(deltas[i]), out);
+		}
+	}
+	previous = market = values;
+
+	if (message.messageType == MessageType::CancelAllOrders) {
+		AppendVarint(Message::cancelOrders.size(), out);
+		out->append(Message::cancelOrders);
+	} else if (message.messageType == MessageType::MassQuote) {
+		AppendVarint(Message::massQuote.bids.size(), out);
+		AppendVarint(Message::massQuote.asks.size(), out);
+		AppendLevels(Message::massQuote.bids, out);
+		AppendLevels(Message::massQuote.asks, out);
+	}
+}
+
+bool MessageDecoder::Decode(std::string_view* data, Message* message) {
+	uint64_t messageType, mask;
+	if (!ReadVarint(data, &messageType) || !IsMessageType(messageType) || !ReadVarint(data, &mask) || (mask >> numFields) != 0) {
+		return false;
+	}
+
+	Fields deltas{};
+	for (size_t i = 0; i < numFields; ++i) {
+		if ((mask & (uint64_t(1) << i)) != 0) {
+			uint64_t delta;
+			if (!ReadVarint(data, &delta)) {
+				return false;
+			}
+			deltas[i] = UnZigZag(delta);
+		}
+	}
+
+	// The market has to be known before the fields encoded against it
+	auto coinId = previous[coinIdField] + deltas[coinIdField];
+	auto baseId = previous[baseIdField] + deltas[baseIdField];
+	auto& market = GetMarket(coinId, baseId);
+	Fields values;
+	for (size_t i = 0; i < numFields; ++i) {
+		values[i] = (fields[i].perMarket ? market[i] : previous[i]) + deltas[i];
+	}
+	previous = market = values;
+
+	*message = Message();
+	message->messageType = static_cast<MessageType>(messageType);
+	for (size_t i = 0; i < numFields; ++i) {
+		SetField(message, i, values[i]);
+	}
+
+	if (message->messageType == MessageType::CancelAllOrders) {
+		uint64_t size;
+		if (!ReadVarint(data, &size) || size > data->size()) {
+			return false;
+		}
+		Message::cancelOrders.assign(data->data(), size);
+		data->remove_prefix(size);
+	} else if (message->messageType == MessageType::MassQuote) {
+		// Each level takes at least 2 bytes, checked so a malformed count can't allocate much
+		uint64_t numBids, numAsks;
+		if (!ReadVarint(data, &numBids) || !ReadVarint(data, &numAsks) || numBids + numAsks > data->size() / 2) {
+			return false;
+		}
+		if (!ReadLevels(data, numBids, &Message::massQuote.bids) || !ReadLevels(data, numAsks, &Message::massQuote.asks)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t GetRawSize(const Message& message) {
+	if (message.messageType == MessageType::CancelAllOrders) {
+		return sizeof(Message) + Message::cancelOrders.size();
+	} else if (message.messageType == MessageType::MassQuote) {
+		return sizeof(Message) + 2 * sizeof(uint32_t) + (Message::massQuote.bids.size() + Message::massQuote.asks.size()) * sizeof(QuoteLevel);
+	}
+	return sizeof(Message);
+}
+
+void EncodeRaw(const Message& message, char* out) {
+	std::memcpy(out, &message, sizeof(Message));
+	out += sizeof(Message);
+
+	if (message.messageType == MessageType::CancelAllOrders) {
+		std::memcpy(out, Message::cancelOrders.data(), Message::cancelOrders.size());
+	} else if (message.messageType == MessageType::MassQuote) {
+		const auto& bids = Message::massQuote.bids;
+		const auto& asks = Message::massQuote.asks;
+		uint32_t numLevels[2] = { static_cast<uint32_t>(bids.size()), static_cast<uint32_t>(asks.size()) };
+		std::memcpy(out, numLevels, sizeof(numLevels));
+		out += sizeof(numLevels);
+		std::memcpy(out, bids.data(), bids.size() * sizeof(QuoteLevel));
+		out += bids.size() * sizeof(QuoteLevel);
+		std::memcpy(out, asks.data(), asks.size() * sizeof(QuoteLevel));
+	}
+}
+
+bool DecodeRaw(std::string_view data, Message* message) {
+	if (data.size() < sizeof(Message)) {
+		return false;
+	}
+	std::memcpy(message, data.data(), sizeof(Message));
+
+	// It may have come from another process, so the type and the bools are checked before the
+	// engine switches on or branches on them
+	auto messageType = static_cast<int>(message->messageType);
+	if (messageType < 0 || !IsMessageType(static_cast<uint64_t>(messageType))) {
+		return false;
+	}
+	message->isBuy = (data[offsetof(Message, isBuy)] != 0);
+	message->fullUpdate = (data[offsetof(Message, fullUpdate)] != 0);
+	data.remove_prefix(sizeof(Message));
+
+	if (message->messageType == MessageType::CancelAllOrders) {
+		Message::cancelOrders.assign(data.data(), data.size());
+	} else if (message->messageType == MessageType::MassQuote) {
+		uint32_t numLevels[2];
+		if (data.size() < sizeof(numLevels)) {
+			return false;
+		}
+		std::memcpy(numLevels, data.data(), sizeof(numLevels));
+		data.remove_prefix(sizeof(numLevels));
+		if (data.size() != (uint64_t(numLevels[0]) + numLevels[1]) * sizeof(QuoteLevel)) {
+			return false;
+		}
+
+		auto levels = reinterpret_cast<const QuoteLevel*>(data.data());
+		Message::massQuote.bids.assign(levels, levels + numLevels[0]);
+		Message::massQuote.asks.assign(levels + numLevels[0], levels + numLevels[0] + numLevels[1]);
+	}
+	return true;
+}
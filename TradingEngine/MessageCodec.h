@@ -0,0 +1,62 @@
+#pragma once
+
+#include "CoinPair.h"
+#include "Message.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// A compact encoding of a stream of Messages. Each field is stored as the zigzag varint of its
+// difference from the last message: ids against the last message of any market, prices and
+// amounts against the last message in the same market. A leading mask says which fields
+// changed, so repeated coin/base ids cost nothing and a typical order takes around 10 bytes
+// rather than sizeof(Message). The attachment (see Message.h) follows its message.
+//
+// Each message depends on the ones before it, so they have to be decoded in the order they were
+// encoded, starting from the same Reset() point (i.e each block of a MessageArchive).
+class MessageContext {
+public:
+	static constexpr size_t numFields = 12;
+	using Fields = std::array<uint64_t, numFields>;
+
+	// Forget every message so far, the next one is encoded against nothing
+	void Reset();
+
+protected:
+	Fields previous{};
+	std::unordered_map<CoinPair, Fields> markets;
+
+	// A market seen for the first time starts from the last message
+	Fields& GetMarket(uint64_t coinId, uint64_t baseId);
+};
+
+class MessageEncoder : public MessageContext {
+public:
+	// Appends the message, and its attachment, to out
+	void Encode(const Message& message, std::string* out);
+};
+
+class MessageDecoder : public MessageContext {
+public:
+	// Decodes the message at the front of data and removes it from data. The attachment is put
+	// back in Message::cancelOrders/massQuote. Returns false if data is malformed (including an
+	// unknown message type).
+	bool Decode(std::string_view* data, Message* message);
+};
+
+// The raw format, which the journal and the shared memory transport carry: the message as it is
+// in memory followed by its attachment. For a CancelAllOrders that's the cancelOrders string,
+// for a MassQuote the number of bids and asks (uint32_t each) then the levels.
+size_t GetRawSize(const Message& message);
+
+// Writes GetRawSize(message) bytes
+void EncodeRaw(const Message& message, char* out);
+
+// The attachment is put back in Message::cancelOrders/massQuote. Returns false if data is too
+// short to be a message, or isn't one of the message types (Last, the empty message, is one). The
+// bools are read as bytes, so anything other than 0 is true.
+bool DecodeRaw(std::string_view data, Message* message);
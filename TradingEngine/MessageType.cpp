@@ -0,0 +1,66 @@
+#include "MessageType.h"
+
+const char* ToString(MessageType messageType) {
+	switch (messageType) {
+		case MessageType::MarketOrder:
+			return "MarketOrder";
+		case MessageType::LimitOrder:
+			return "LimitOrder";
+		case MessageType::StopLimitOrder:
+			return "StopLimitOrder";
+		case MessageType::CancelOrder:
+			return "CancelOrder";
+		case MessageType::CancelAllOrders:
+			return "CancelAllOrders";
+		case MessageType::Deposit:
+			return "Deposit";
+		case MessageType::Withdraw:
+			return "Withdraw";
+		case MessageType::NewCoin:
+			return "NewCoin";
+		case MessageType::NewMarket:
+			return "NewMarket";
+		case MessageType::SetFeePercentage:
+			return "SetFeePercentage";
+		case MessageType::SetMaxNumLimitOpenOrders:
+			return "SetMaxNumLimitOpenOrders";
+		case MessageType::SetMaxNumStopLimitOpenOrders:
+			return "SetMaxNumStopLimitOpenOrders";
+		case MessageType::SetInOrder:
+			return "SetInOrder";
+		case MessageType::GetAmount:
+			return "GetAmount";
+		case MessageType::GetAvailable:
+			return "GetAvailable";
+		case MessageType::GetInOrder:
+			return "GetInOrder";
+		case MessageType::GetTotal:
+			return "GetTotal";
+		case MessageType::ClearOpenOrders:
+			return "ClearOpenOrders";
+		case MessageType::ClearEveryonesOpenOrders:
+			return "ClearEveryonesOpenOrders";
+		case MessageType::ClearAllEveryonesOpenOrders:
+			return "ClearAllEveryonesOpenOrders";
+		case MessageType::NewOpenOrder:
+			return "NewOpenOrder";
+		case MessageType::NewTrade:
+			return "NewTrade";
+		case MessageType::OrderFilled:
+			return "OrderFilled";
+		case MessageType::NewFilledOrder:
+			return "NewFilledOrder";
+		case MessageType::PartialFill:
+			return "PartialFill";
+		case MessageType::StopLimitTriggered:
+			return "StopLimitTriggered";
+		case MessageType::Quit:
+			return "Quit";
+		case MessageType::AmendOrder:
+			return "AmendOrder";
+		case MessageType::MassQuote:
+			return "MassQuote";
+		default:
+			return "Unknown";
+	}
+}
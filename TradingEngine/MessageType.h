@@ -38,6 +38,12 @@ enum class MessageType {
 
 	Quit,
 
+	// Added later, so after Quit to keep the values above
+	AmendOrder,
+	MassQuote,
+
 	// This should be at the end...
 	Last = 999999
 };
+
+const char* ToString(MessageType messageType);
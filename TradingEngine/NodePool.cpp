@@ -0,0 +1,195 @@
+#include "NodePool.h"
+
+#include "AllocationStats.h"
+#include "PoolMemory.h"
+
+#include <algorithm>
+#include <new>
+
+namespace {
+size_t RoundUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+thread_local PoolShard* scopedPoolShard = nullptr;
+}
+
+NodePool::NodePool(size_t nodeSize, size_t nodeAlignment) :
+nodeSize(RoundUp(std::max(nodeSize, sizeof(FreeNode)), nodeAlignment)),
+nodeAlignment(nodeAlignment) {
+	firstNodeOffset = RoundUp(sizeof(Slab), nodeAlignment);
+	nodesPerSlab = (slabSize - firstNodeOffset) / this->nodeSize;
+	if (nodesPerSlab == 0) {
+		throw std::bad_alloc();
+	}
+}
+
+NodePool::~NodePool() {
+	for (auto slab : slabs) {
+		if (slab) {
+			FreeSlab(slab);
+		}
+	}
+}
+
+void* NodePool::Allocate() {
+	CountAllocation(AllocationSource::NodePool, nodeSize);
+	while (!available.empty()) {
+		auto slab = available.back();
+		if (slab->freeList) {
+			auto node = slab->freeList;
+			slab->freeList = node->next;
+			++slab->numInUse;
+			++numNodesInUse;
+			return node;
+		} else if (slab->numCarved < nodesPerSlab) {
+			auto node = reinterpret_cast<char*>(slab) + firstNodeOffset + slab->numCarved * nodeSize;
+			++slab->numCarved;
+			++slab->numInUse;
+			++numNodesInUse;
+			return node;
+		}
+
+		// Full
+		slab->isAvailable = false;
+		available.pop_back();
+	}
+
+	auto slab = NewSlab();
+	slab->isAvailable = true;
+	available.push_back(slab);
+
+	++slab->numCarved;
+	++slab->numInUse;
+	++numNodesInUse;
+	return reinterpret_cast<char*>(slab) + firstNodeOffset;
+}
+
+void NodePool::Deallocate(void* ptr) {
+	auto slab = GetSlab(ptr);
+	auto node = static_cast<FreeNode*>(ptr);
+	node->next = slab->freeList;
+	slab->freeList = node;
+	--slab->numInUse;
+
+	auto owner = slab->owner;
+	--owner->numNodesInUse;
+	if (!slab->isAvailable) {
+		slab->isAvailable = true;
+		owner->available.push_back(slab);
+	}
+}
+
+size_t NodePool::Trim() {
+	auto isEmpty = [](const Slab* slab) { return slab->numInUse == 0; };
+	available.erase(std::remove_if(available.begin(), available.end(), isEmpty), available.end());
+
+	size_t numReleased = 0;
+	for (auto& slab : slabs) {
+		if (slab && isEmpty(slab)) {
+			freeSlabIndices.push_back(slab->index);
+			FreeSlab(slab);
+			slab = nullptr;
+			++numReleased;
+		}
+	}
+	numSlabs -= numReleased;
+	return numReleased * slabSize;
+}
+
+size_t NodePool::GetNodeSize() const {
+	return nodeSize;
+}
+
+size_t NodePool::GetNodeAlignment() const {
+	return nodeAlignment;
+}
+
+size_t NodePool::GetReservedBytes() const {
+	return numSlabs * slabSize;
+}
+
+size_t NodePool::GetNumNodesInUse() const {
+	return numNodesInUse;
+}
+
+NodePool::Slab* NodePool::NewSlab() {
+	if (freeSlabIndices.empty()) {
+		if (slabs.size() == maxSlabs) {
+			throw std::bad_alloc();
+		}
+		// So adding it can't fail once it has been allocated
+		if (slabs.size() == slabs.capacity()) {
+			slabs.reserve(std::max(slabs.size() * 2, size_t(16)));
+		}
+	}
+
+	CountAllocation(AllocationSource::NodePoolGrowth, slabSize);
+	auto memory = AllocatePoolBlock(slabSize, slabSize);
+	auto slab = new (memory) Slab(this);
+	if (freeSlabIndices.empty()) {
+		slab->index = static_cast<Handle>(slabs.size());
+		slabs.push_back(slab);
+	} else {
+		slab->index = freeSlabIndices.back();
+		freeSlabIndices.pop_back();
+		slabs[slab->index] = slab;
+	}
+	++numSlabs;
+	return slab;
+}
+
+void NodePool::FreeSlab(Slab* slab) {
+	slab->~Slab();
+	FreePoolBlock(slab, slabSize, slabSize);
+}
+
+NodePool& PoolShard::GetPool(size_t nodeSize, size_t nodeAlignment) {
+	for (auto& pool : pools) {
+		if (pool->GetNodeAlignment() == nodeAlignment
+		&& pool->GetNodeSize() == RoundUp(std::max(nodeSize, sizeof(void*)), nodeAlignment)) {
+			return *pool;
+		}
+	}
+
+	pools.push_back(std::make_unique<NodePool>(nodeSize, nodeAlignment));
+	return *pools.back();
+}
+
+size_t PoolShard::Trim() {
+	size_t released = 0;
+	for (auto& pool : pools) {
+		released += pool->Trim();
+	}
+	return released;
+}
+
+size_t PoolShard::GetReservedBytes() const {
+	size_t reserved = 0;
+	for (const auto& pool : pools) {
+		reserved += pool->GetReservedBytes();
+	}
+	return reserved;
+}
+
+PoolShard& PoolShard::GetDefault() {
+	if (scopedPoolShard) {
+		return *scopedPoolShard;
+	}
+	// Never destroyed, containers in static objects may still be destroyed after it would have been
+	static auto poolShard = new PoolShard;
+	return *poolShard;
+}
+
+ScopedPoolShard::ScopedPoolShard(PoolShard& shard) :
+previous(scopedPoolShard) {
+	scopedPoolShard = &shard;
+}
+
+ScopedPoolShard::~ScopedPoolShard() {
+	scopedPoolShard = previous;
+}
+
+PoolShard* ScopedPoolShard::Get() {
+	return scopedPoolShard;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// A pool of fixed size nodes, carved out of slabs which are only allocated when needed.
+// Slabs are aligned to their size, so the slab a node belongs to is found from its address,
+// which lets slabs with nothing in use be handed back with Trim().
+// Nodes can also be referred to by a 32 bit handle, their slab's index in the pool and where they
+// are in it, which needs them to be aligned to at least 8 bytes.
+// Not thread safe, it is meant to be used by the markets of a single shard.
+class NodePool {
+public:
+	constexpr static size_t slabSize = 16384;
+
+	using Handle = uint32_t;
+	constexpr static Handle nullHandle = UINT32_MAX;
+
+	NodePool(size_t nodeSize, size_t nodeAlignment);
+	~NodePool();
+
+	NodePool(const NodePool&) = delete;
+	NodePool& operator=(const NodePool&) = delete;
+
+	void* Allocate();
+
+	// Returns the node to the pool it came from, which does not have to be this one
+	static void Deallocate(void* ptr);
+
+	// Frees every slab which has no nodes in use, returns the number of bytes released.
+	// With a PageArena (see PoolMemory.h) they go back to it rather than to the OS.
+	size_t Trim();
+
+	size_t GetNodeSize() const;
+	size_t GetNodeAlignment() const;
+	size_t GetReservedBytes() const;
+	size_t GetNumNodesInUse() const;
+
+	static Handle ToHandle(const void* ptr) {
+		auto offset = reinterpret_cast<uintptr_t>(ptr) & (slabSize - 1);
+		return GetSlab(ptr)->index << offsetBits | static_cast<Handle>(offset >> offsetShift);
+	}
+
+	// The node must be from this pool
+	void* FromHandle(Handle handle) const {
+		return reinterpret_cast<char*>(slabs[handle >> offsetBits]) + ((handle & offsetMask) << offsetShift);
+	}
+
+private:
+	constexpr static Handle offsetShift = 3;
+	constexpr static Handle offsetBits = 11; // slabSize >> offsetShift
+	constexpr static Handle offsetMask = (1u << offsetBits) - 1;
+	constexpr static size_t maxSlabs = size_t(1) << (32 - offsetBits);
+	static_assert((slabSize >> offsetShift) == (size_t(1) << offsetBits), "Offsets must fill the low bits");
+
+	struct FreeNode {
+		FreeNode* next;
+	};
+
+	struct Slab {
+		NodePool* owner;
+		Handle index = 0; // In "slabs"
+		FreeNode* freeList = nullptr;
+		size_t numInUse = 0;
+		size_t numCarved = 0; // Nodes are carved out of the slab lazily
+		bool isAvailable = false; // In "available"
+
+		explicit Slab(NodePool* owner) :
+		owner(owner) {
+		}
+	};
+
+	size_t nodeSize;
+	size_t nodeAlignment;
+	size_t firstNodeOffset;
+	size_t nodesPerSlab;
+	size_t numNodesInUse = 0;
+
+	size_t numSlabs = 0;
+	std::vector<Slab*> slabs; // Trimmed slabs leave a hole, reused by the next one
+	std::vector<Handle> freeSlabIndices;
+	std::vector<Slab*> available; // Slabs which (may) have free nodes
+
+	static Slab* GetSlab(const void* ptr) {
+		return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(ptr) & ~(uintptr_t(slabSize) - 1));
+	}
+
+	Slab* NewSlab();
+	static void FreeSlab(Slab* slab);
+};
+
+// The node pools shared by a group of markets, one per distinct node size.
+class PoolShard {
+public:
+	PoolShard() = default;
+	PoolShard(const PoolShard&) = delete;
+	PoolShard& operator=(const PoolShard&) = delete;
+
+	NodePool& GetPool(size_t nodeSize, size_t nodeAlignment);
+
+	size_t Trim();
+	size_t GetReservedBytes() const;
+
+	// Used by anything not given a shard, or the one scoped on this thread (see ScopedPoolShard)
+	static PoolShard& GetDefault();
+
+private:
+	std::vector<std::unique_ptr<NodePool>> pools;
+};
+
+// While it is alive, whatever on this thread would use the default shard uses this one instead,
+// the order queues included. Lets markets be built on several threads at once (see
+// SectionedSnapshot.h) as long as no two threads scope the same shard.
+class ScopedPoolShard {
+public:
+	explicit ScopedPoolShard(PoolShard& shard);
+	~ScopedPoolShard();
+
+	ScopedPoolShard(const ScopedPoolShard&) = delete;
+	ScopedPoolShard& operator=(const ScopedPoolShard&) = delete;
+
+	// nullptr when none is scoped on this thread
+	static PoolShard* Get();
+
+private:
+	PoolShard* previous;
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Fee.h"
+#include "SimulatorTrade.h"
+
+#include <cstdint>
+#include <vector>
+
+// The result of matching an order against the book without committing it.
+struct OrderQuote {
+	std::vector<SimulatorTrade> fills;
+	int64_t filled = 0;
+	int64_t remaining = 0;
+	int64_t averagePrice = -1; // Volume weighted, -1 if nothing would fill
+	Fee fees{ 0, 0 }; // Summed over all the fills
+};
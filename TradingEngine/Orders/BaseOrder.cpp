@@ -30,6 +30,10 @@ void BaseOrder::RemoveFromFill(int64_t fill) {
 	filled -= fill;
 }
 
+void BaseOrder::SetAmount(int64_t amount) {
+	this->amount = amount;
+}
+
 void BaseOrder::SetId(int64_t orderId) {
 	this->orderId = orderId;
 }
@@ -17,6 +17,7 @@ public:
 	int64_t GetFilled() const;
 	void AddToFill(int64_t fill);
 	void RemoveFromFill(int64_t fill);
+	void SetAmount(int64_t amount);
 	void SetId(int64_t orderId);
 	int64_t GetId() const;
 	bool operator==(const BaseOrder& order) const;
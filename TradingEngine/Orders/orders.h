@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MarketOrder.h"
+#include "OrderType.h"
 #include "StopLimitOrder.h"
 
 #include <type_traits>
@@ -28,3 +29,15 @@ struct IsStopLimitOrder<StopLimitOrder> : std::true_type {};
 
 template <class T>
 inline constexpr bool IsStopLimitOrder_v = IsStopLimitOrder<T>::value;
+
+template <class Order>
+constexpr OrderType GetOrderType() {
+	if constexpr (IsMarketOrder_v<Order>) {
+		return OrderType::Market;
+	} else if constexpr (IsLimitOrder_v<Order>) {
+		return OrderType::Limit;
+	} else {
+		static_assert(IsStopLimitOrder_v<Order>);
+		return OrderType::StopLimit;
+	}
+}
@@ -0,0 +1,71 @@
+#include "crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define CRC32C_X86
+#include <immintrin.h>
+#endif
+
+namespace ps {
+
+namespace {
+constexpr uint32_t polynomial = 0x82F63B78; // Reversed
+
+std::array<uint32_t, 256> MakeTable() {
+	std::array<uint32_t, 256> table;
+	for (uint32_t i = 0; i < table.size(); ++i) {
+		auto crc = i;
+		for (auto bit = 0; bit < 8; ++bit) {
+			crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+		}
+		table[i] = crc;
+	}
+	return table;
+}
+
+const std::array<uint32_t, 256> table = MakeTable();
+
+uint32_t Crc32cScalar(const uint8_t* bytes, size_t size, uint32_t crc) {
+	for (size_t i = 0; i < size; ++i) {
+		crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+#ifdef CRC32C_X86
+__attribute__((target("sse4.2"))) uint32_t Crc32cSSE42(const uint8_t* bytes, size_t size, uint32_t crc) {
+	uint64_t crc64 = crc;
+	for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), bytes += sizeof(uint64_t)) {
+		uint64_t word;
+		std::memcpy(&word, bytes, sizeof(word));
+		crc64 = _mm_crc32_u64(crc64, word);
+	}
+
+	crc = static_cast<uint32_t>(crc64);
+	for (; size > 0; --size, ++bytes) {
+		crc = _mm_crc32_u8(crc, *bytes);
+	}
+	return crc;
+}
+
+bool DetectSSE42() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+}
+
+const bool hasSSE42 = DetectSSE42();
+#endif
+}
+
+uint32_t Crc32c(const void* data, size_t size, uint32_t crc) {
+	auto bytes = static_cast<const uint8_t*>(data);
+#ifdef CRC32C_X86
+	if (hasSSE42) {
+		return ~Crc32cSSE42(bytes, size, ~crc);
+	}
+#endif
+	return ~Crc32cScalar(bytes, size, ~crc);
+}
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ps {
+
+// CRC-32C (Castagnoli), as used by iSCSI/ext4/LevelDB. On x86 with GCC/Clang it uses the SSE4.2
+// crc32 instruction when the CPU has it (checked once at start up), otherwise a table.
+// Pass the previous result as crc to carry on over more data.
+uint32_t Crc32c(const void* data, size_t size, uint32_t crc = 0);
+}
@@ -0,0 +1,87 @@
+#include "fork_process.h"
+
+#include <atomic>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <cerrno>
+#include <csignal>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace ps {
+
+namespace {
+std::atomic<size_t> numForkGuards{ 0 };
+}
+
+ForkGuard::ForkGuard() {
+	++numForkGuards;
+}
+
+ForkGuard::~ForkGuard() {
+	--numForkGuards;
+}
+
+size_t ForkGuard::GetNumHeld() {
+	return numForkGuards;
+}
+
+#if defined(__linux__) || defined(__APPLE__)
+int ForkProcess(const std::function<int()>& child) {
+	if (ForkGuard::GetNumHeld() != 0) {
+		return -1;
+	}
+
+	auto pid = fork();
+	if (pid == 0) {
+		int exitCode = 1;
+		try {
+			exitCode = child();
+		} catch (...) {
+		}
+
+		// Skips the atexit handlers and static destructors, those belong to the parent
+		_exit(exitCode);
+	}
+	return pid;
+}
+
+bool ReapProcess(int pid, bool block, int* exitCode) {
+	int status = 0;
+	pid_t reaped;
+	do {
+		reaped = waitpid(pid, &status, block ? 0 : WNOHANG);
+	} while (reaped == -1 && errno == EINTR);
+
+	if (reaped == 0) {
+		return false; // Still running
+	}
+
+	if (reaped == -1) {
+		*exitCode = -1; // Not our child, or already reaped
+	} else {
+		*exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	}
+	return true;
+}
+
+bool IsProcessAlive(int pid) {
+	return kill(pid, 0) == 0 || errno != ESRCH;
+}
+#else
+int ForkProcess(const std::function<int()>& child) {
+	return -1;
+}
+
+bool ReapProcess(int pid, bool block, int* exitCode) {
+	*exitCode = -1;
+	return true;
+}
+
+bool IsProcessAlive(int pid) {
+	return true;
+}
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace ps {
+
+// Held by a thread which shares state with the rest of the process (i.e the market warm-up) for
+// as long as it runs. Only the forking thread is carried over into a child, anything such a thread
+// had locked or was half way through changing would stay that way in it, so nothing is forked
+// while one is held.
+class ForkGuard {
+public:
+	ForkGuard();
+	~ForkGuard();
+
+	ForkGuard(const ForkGuard&) = delete;
+	ForkGuard& operator=(const ForkGuard&) = delete;
+
+	static size_t GetNumHeld();
+};
+
+// Runs child in a forked process, which sees a copy-on-write image of this process' memory as
+// it was when forked (only the calling thread is carried over). Its return value is the exit
+// code, the child never returns from here. Returns the child's pid, or -1 if it couldn't be
+// forked (or a ForkGuard is held). Processes can only be forked on Linux/macOS, everywhere else
+// it's always -1.
+int ForkProcess(const std::function<int()>& child);
+
+// Whether the child has exited, with its exit code (-1 if it was killed). Only blocks when
+// block is set. A reaped child can't be waited on again.
+bool ReapProcess(int pid, bool block, int* exitCode);
+
+// Whether any process (not only a child) with this pid is still running. Always true off
+// Linux/macOS.
+bool IsProcessAlive(int pid);
+}
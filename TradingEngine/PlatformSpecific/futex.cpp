@@ -0,0 +1,39 @@
+#include "futex.h"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef __linux__
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ps {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+"Futexes need a plain 32 bit word");
+
+#ifdef __linux__
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::microseconds timeout) {
+	timespec relative;
+	relative.tv_sec = static_cast<time_t>(timeout.count() / 1000000);
+	relative.tv_nsec = static_cast<long>(timeout.count() % 1000000 * 1000);
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &relative, nullptr, 0);
+}
+
+void FutexWakeAll(std::atomic<uint32_t>* word) {
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+#else
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::microseconds timeout) {
+	if (word->load(std::memory_order_acquire) == expected) {
+		std::this_thread::sleep_for(std::min(timeout, std::chrono::microseconds(50)));
+	}
+}
+
+void FutexWakeAll(std::atomic<uint32_t>* word) {
+}
+#endif
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ps {
+
+// Sleeps while *word is still expected, until woken or the timeout passes (which can also wake
+// early). Works across processes when word is in shared memory. On Linux this is a futex,
+// everywhere else it sleeps for a short while instead (up to the timeout).
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::microseconds timeout);
+
+// Wakes every thread sleeping on word
+void FutexWakeAll(std::atomic<uint32_t>* word);
+}
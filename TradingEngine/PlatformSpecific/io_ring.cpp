@@ -0,0 +1,205 @@
+#include "io_ring.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define PS_HAS_IO_URING
+#endif
+#endif
+
+namespace ps {
+
+#ifdef PS_HAS_IO_URING
+namespace {
+template <class T>
+T* Offset(void* base, uint32_t offset) {
+	return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+}
+
+IoRing::IoRing(unsigned numEntries) {
+	io_uring_params params;
+	std::memset(&params, 0, sizeof(params));
+	fd = static_cast<int>(syscall(__NR_io_uring_setup, numEntries, &params));
+	if (fd < 0) {
+		fd = -1;
+		return;
+	}
+
+	submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	auto singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (singleMapping && completionRingSize > submissionRingSize) {
+		submissionRingSize = completionRingSize;
+	}
+
+	auto map = [this](size_t size, off_t offset) {
+		auto address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+		return (address == MAP_FAILED) ? nullptr : address;
+	};
+
+	submissionRing = map(submissionRingSize, IORING_OFF_SQ_RING);
+	completionRing = singleMapping ? submissionRing : map(completionRingSize, IORING_OFF_CQ_RING);
+	entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+	entries = map(entriesSize, IORING_OFF_SQES);
+	if (!submissionRing || !completionRing || !entries) {
+		Release();
+		return;
+	}
+
+	this->numEntries = params.sq_entries;
+	submissionHead = Offset<unsigned>(submissionRing, params.sq_off.head);
+	submissionTail = Offset<unsigned>(submissionRing, params.sq_off.tail);
+	submissionMask = Offset<unsigned>(submissionRing, params.sq_off.ring_mask);
+	submissionArray = Offset<unsigned>(submissionRing, params.sq_off.array);
+	completionHead = Offset<unsigned>(completionRing, params.cq_off.head);
+	completionTail = Offset<unsigned>(completionRing, params.cq_off.tail);
+	completionMask = Offset<unsigned>(completionRing, params.cq_off.ring_mask);
+	completions = Offset<void>(completionRing, params.cq_off.cqes);
+}
+
+IoRing::~IoRing() {
+	Release();
+}
+
+bool IoRing::QueueWrite(int fd, const void* data, size_t size, uint64_t offset, uint64_t userData) {
+	auto entry = static_cast<io_uring_sqe*>(NextEntry());
+	if (!entry) {
+		return false;
+	}
+
+	entry->opcode = IORING_OP_WRITE;
+	entry->fd = fd;
+	entry->addr = reinterpret_cast<uint64_t>(data);
+	entry->len = static_cast<uint32_t>(size);
+	entry->off = offset;
+	entry->user_data = userData;
+	return true;
+}
+
+bool IoRing::QueueSyncData(int fd, uint64_t userData) {
+	auto entry = static_cast<io_uring_sqe*>(NextEntry());
+	if (!entry) {
+		return false;
+	}
+
+	entry->opcode = IORING_OP_FSYNC;
+	entry->fd = fd;
+	entry->fsync_flags = IORING_FSYNC_DATASYNC;
+	entry->user_data = userData;
+	entry->flags = IOSQE_IO_DRAIN;
+	return true;
+}
+
+bool IoRing::Submit(unsigned numToWaitFor) {
+	auto flags = (numToWaitFor > 0) ? IORING_ENTER_GETEVENTS : 0u;
+	while (true) {
+		auto result = syscall(__NR_io_uring_enter, fd, numQueued, numToWaitFor, flags, nullptr, 0);
+
+		// Whatever the kernel has taken off the queue has been submitted, even if interrupted
+		numQueued = *submissionTail - __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE);
+		if (result >= 0) {
+			return numQueued == 0;
+		}
+		if (errno != EINTR) {
+			return false;
+		}
+	}
+}
+
+bool IoRing::PopCompletion(uint64_t* userData, int* result) {
+	auto head = *completionHead;
+	if (head == __atomic_load_n(completionTail, __ATOMIC_ACQUIRE)) {
+		return false;
+	}
+
+	auto completion = static_cast<io_uring_cqe*>(completions) + (head & *completionMask);
+	*userData = completion->user_data;
+	*result = completion->res;
+	__atomic_store_n(completionHead, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+void IoRing::Release() {
+	if (entries) {
+		munmap(entries, entriesSize);
+	}
+	if (completionRing && completionRing != submissionRing) {
+		munmap(completionRing, completionRingSize);
+	}
+	if (submissionRing) {
+		munmap(submissionRing, submissionRingSize);
+	}
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	entries = completionRing = submissionRing = nullptr;
+	fd = -1;
+}
+
+void* IoRing::NextEntry() {
+	if (fd < 0) {
+		return nullptr;
+	}
+
+	auto tail = *submissionTail;
+	if (tail - __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE) >= numEntries) {
+		return nullptr;
+	}
+
+	auto index = tail & *submissionMask;
+	auto entry = static_cast<io_uring_sqe*>(entries) + index;
+	std::memset(entry, 0, sizeof(*entry));
+	submissionArray[index] = index;
+
+	// Published now, the kernel only looks at it once it's submitted
+	__atomic_store_n(submissionTail, tail + 1, __ATOMIC_RELEASE);
+	++numQueued;
+	return entry;
+}
+#else
+IoRing::IoRing(unsigned numEntries) {
+}
+
+IoRing::~IoRing() {
+}
+
+bool IoRing::QueueWrite(int fd, const void* data, size_t size, uint64_t offset, uint64_t userData) {
+	return false;
+}
+
+bool IoRing::QueueSyncData(int fd, uint64_t userData) {
+	return false;
+}
+
+bool IoRing::Submit(unsigned numToWaitFor) {
+	return false;
+}
+
+bool IoRing::PopCompletion(uint64_t* userData, int* result) {
+	return false;
+}
+
+void IoRing::Release() {
+}
+
+void* IoRing::NextEntry() {
+	return nullptr;
+}
+#endif
+
+bool IoRing::IsAvailable() const {
+	return fd >= 0;
+}
+
+unsigned IoRing::GetNumEntries() const {
+	return numEntries;
+}
+}
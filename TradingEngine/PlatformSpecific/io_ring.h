@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ps {
+
+// Just enough of io_uring to write files: writes and fdatasyncs are queued, then submitted
+// together in one system call which also waits for them. Set up with the raw system calls, so
+// there's no dependency on liburing. It isn't available off Linux, on kernels older than 5.6 or
+// where a seccomp profile blocks it (i.e some containers), callers then use WriteAt()/SyncData().
+class IoRing {
+public:
+	explicit IoRing(unsigned numEntries);
+	~IoRing();
+
+	IoRing(const IoRing&) = delete;
+	IoRing& operator=(const IoRing&) = delete;
+
+	bool IsAvailable() const;
+	unsigned GetNumEntries() const;
+
+	// Writes can run in any order, a sync only starts once everything queued before it has
+	// completed. Both return false if the submission queue is full.
+	bool QueueWrite(int fd, const void* data, size_t size, uint64_t offset, uint64_t userData);
+	bool QueueSyncData(int fd, uint64_t userData);
+
+	// Submits everything queued, waiting until numToWaitFor have completed.
+	// Returns false if the kernel refused them.
+	bool Submit(unsigned numToWaitFor);
+
+	// result is what the system call would have returned, or -errno. False if none are waiting.
+	bool PopCompletion(uint64_t* userData, int* result);
+
+private:
+	int fd = -1;
+	unsigned numEntries = 0;
+	unsigned numQueued = 0;
+
+	void* submissionRing = nullptr;
+	size_t submissionRingSize = 0;
+	void* completionRing = nullptr; // Can be the same mapping
+	size_t completionRingSize = 0;
+	void* entries = nullptr;
+	size_t entriesSize = 0;
+
+	unsigned* submissionHead = nullptr;
+	unsigned* submissionTail = nullptr;
+	unsigned* submissionMask = nullptr;
+	unsigned* submissionArray = nullptr;
+	unsigned* completionHead = nullptr;
+	unsigned* completionTail = nullptr;
+	unsigned* completionMask = nullptr;
+	void* completions = nullptr;
+
+	void Release();
+	void* NextEntry();
+};
+}
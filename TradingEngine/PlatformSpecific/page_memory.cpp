@@ -0,0 +1,81 @@
+#include "page_memory.h"
+
+#include <cstring>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace ps {
+
+namespace {
+
+size_t RoundUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void PreFault(void* address, size_t size) {
+	auto bytes = static_cast<volatile char*>(address);
+	for (size_t offset = 0; offset < size; offset += smallPageSize) {
+		bytes[offset] = 0;
+	}
+}
+}
+
+#ifdef __linux__
+PageMapping MapPages(size_t size, bool hugePages, bool lock) {
+	PageMapping mapping;
+	if (hugePages) {
+		mapping.size = RoundUp(size, hugePageSize);
+		auto address = mmap(nullptr, mapping.size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+		if (address != MAP_FAILED) {
+			mapping.address = address;
+			mapping.hugePages = true;
+		}
+	}
+
+	if (!mapping.address) {
+		// None reserved (vm.nr_hugepages), ask for transparent ones instead
+		mapping.size = RoundUp(size, smallPageSize);
+		auto address = mmap(nullptr, mapping.size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+		if (address == MAP_FAILED) {
+			throw std::bad_alloc();
+		}
+
+		mapping.address = address;
+#ifdef MADV_HUGEPAGE
+		if (hugePages) {
+			madvise(mapping.address, mapping.size, MADV_HUGEPAGE);
+		}
+#endif
+	}
+
+	// MAP_POPULATE is only a hint
+	PreFault(mapping.address, mapping.size);
+	mapping.locked = lock && mlock(mapping.address, mapping.size) == 0;
+	return mapping;
+}
+
+void UnmapPages(const PageMapping& mapping) {
+	if (mapping.locked) {
+		munlock(mapping.address, mapping.size);
+	}
+	munmap(mapping.address, mapping.size);
+}
+#else
+PageMapping MapPages(size_t size, bool, bool) {
+	PageMapping mapping;
+	mapping.size = RoundUp(size, smallPageSize);
+	mapping.address = ::operator new(mapping.size, std::align_val_t(smallPageSize));
+	std::memset(mapping.address, 0, mapping.size);
+	return mapping;
+}
+
+void UnmapPages(const PageMapping& mapping) {
+	::operator delete(mapping.address, std::align_val_t(smallPageSize));
+}
+#endif
+}
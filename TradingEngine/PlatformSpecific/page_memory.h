@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+namespace ps {
+
+constexpr size_t smallPageSize = 4096;
+constexpr size_t hugePageSize = 2 * 1024 * 1024;
+
+struct PageMapping {
+	void* address = nullptr;
+	size_t size = 0;
+	bool hugePages = false; // Explicit 2MB pages, otherwise transparent huge pages are only asked for
+	bool locked = false;
+};
+
+// Maps size bytes (rounded up to the page size) of zeroed memory, from 2MB huge pages when asked
+// and available, falling back to regular pages. Every page is touched before returning so no
+// page faults are taken when it is first used, and it is mlocked if lock is set and the limits
+// allow it. On Linux this uses mmap, everywhere else it's an aligned operator new.
+// Throws std::bad_alloc if no memory could be mapped.
+PageMapping MapPages(size_t size, bool hugePages, bool lock);
+void UnmapPages(const PageMapping& mapping);
+}
@@ -0,0 +1,122 @@
+#include "segment_file.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace ps {
+
+#if defined(__linux__) || defined(__APPLE__)
+namespace {
+bool Allocate(int fd, size_t size) {
+#ifdef __linux__
+	return posix_fallocate(fd, 0, static_cast<off_t>(size)) == 0;
+#else
+	return ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+}
+}
+
+SegmentFile OpenSegmentFile(const std::string& path, size_t size, bool directIo) {
+	SegmentFile file;
+	auto flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+#ifdef O_DIRECT
+	if (directIo) {
+		file.fd = open(path.c_str(), flags | O_DIRECT, 0644);
+		file.directIo = file.fd >= 0;
+	}
+#endif
+	if (file.fd < 0) {
+		file.fd = open(path.c_str(), flags, 0644);
+	}
+	if (file.fd < 0) {
+		return file;
+	}
+
+	if (!Allocate(file.fd, size)) {
+		close(file.fd);
+		file.fd = -1;
+		return file;
+	}
+
+	SyncDirectory(path);
+	return file;
+}
+
+void CloseSegmentFile(const SegmentFile& file) {
+	if (file.fd >= 0) {
+		close(file.fd);
+	}
+}
+
+bool WriteAt(int fd, const void* data, size_t size, uint64_t offset) {
+	auto bytes = static_cast<const char*>(data);
+	while (size > 0) {
+		auto written = pwrite(fd, bytes, size, static_cast<off_t>(offset));
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+
+		bytes += written;
+		size -= static_cast<size_t>(written);
+		offset += static_cast<uint64_t>(written);
+	}
+	return true;
+}
+
+bool SyncData(int fd) {
+#ifdef __linux__
+	return fdatasync(fd) == 0;
+#else
+	return fsync(fd) == 0;
+#endif
+}
+
+bool SyncFile(const std::string& path) {
+	auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+
+	auto synced = (fsync(fd) == 0);
+	close(fd);
+	return synced;
+}
+
+bool SyncDirectory(const std::string& path) {
+	auto slash = path.find_last_of('/');
+	auto directory = (slash == std::string::npos) ? std::string(".") : path.substr(0, slash + 1);
+	return SyncFile(directory);
+}
+#else
+SegmentFile OpenSegmentFile(const std::string& path, size_t size, bool directIo) {
+	return SegmentFile();
+}
+
+void CloseSegmentFile(const SegmentFile& file) {
+}
+
+bool WriteAt(int fd, const void* data, size_t size, uint64_t offset) {
+	return false;
+}
+
+bool SyncData(int fd) {
+	return false;
+}
+
+bool SyncFile(const std::string& path) {
+	return true;
+}
+
+bool SyncDirectory(const std::string& path) {
+	return true;
+}
+#endif
+}
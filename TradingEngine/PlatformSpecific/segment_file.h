@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ps {
+
+// Direct I/O needs the buffers, sizes and offsets to be multiples of this
+constexpr size_t directIoAlignment = 4096;
+
+struct SegmentFile {
+	int fd = -1;
+	bool directIo = false; // Bypasses the page cache
+};
+
+// Creates the file (if needed) with size bytes allocated up front, so writing into it never
+// changes its metadata and fdatasync only has the data to flush. The directory entry is synced
+// too. With directIo it is opened with O_DIRECT, unless the filesystem can't do it (i.e tmpfs).
+// fd is -1 if it couldn't be opened, files are only supported on Linux/macOS.
+SegmentFile OpenSegmentFile(const std::string& path, size_t size, bool directIo);
+void CloseSegmentFile(const SegmentFile& file);
+
+// Both retry until done, returning false on an error
+bool WriteAt(int fd, const void* data, size_t size, uint64_t offset);
+bool SyncData(int fd);
+
+// For files written some other way (i.e std::ofstream). SyncFile flushes the file to disk,
+// SyncDirectory the directory holding the path so the file's creation/renaming there lasts too.
+// Off Linux/macOS there is nothing to do and they return true.
+bool SyncFile(const std::string& path);
+bool SyncDirectory(const std::string& path);
+}
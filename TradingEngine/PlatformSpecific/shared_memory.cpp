@@ -0,0 +1,128 @@
+#include "shared_memory.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ps {
+
+#if defined(__linux__) || defined(__APPLE__)
+namespace {
+SharedMemory Map(int fd, size_t size, bool closeOnFailure) {
+	SharedMemory memory;
+	auto address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (address == MAP_FAILED) {
+		if (closeOnFailure) {
+			close(fd);
+		}
+		return memory;
+	}
+
+	memory.address = address;
+	memory.size = size;
+	memory.fd = fd;
+	return memory;
+}
+
+int CreateFd(const std::string& name) {
+#ifdef __linux__
+	if (name.empty()) {
+		return memfd_create("trading_engine", MFD_CLOEXEC);
+	}
+#endif
+	if (name.empty()) {
+		return -1;
+	}
+	shm_unlink(name.c_str());
+	return shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+}
+}
+
+SharedMemory CreateSharedMemory(const std::string& name, size_t size) {
+	auto fd = CreateFd(name);
+	if (fd < 0) {
+		return SharedMemory();
+	}
+	if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+		close(fd);
+		if (!name.empty()) {
+			shm_unlink(name.c_str());
+		}
+		return SharedMemory();
+	}
+
+	auto memory = Map(fd, size, true);
+	if (!memory.address && !name.empty()) {
+		shm_unlink(name.c_str());
+	}
+
+	// So the first message across doesn't take the page faults
+	auto bytes = static_cast<volatile char*>(memory.address);
+	for (size_t offset = 0; bytes && offset < size; offset += 4096) {
+		bytes[offset] = 0;
+	}
+	return memory;
+}
+
+SharedMemory OpenSharedMemory(const std::string& name) {
+	auto fd = shm_open(name.c_str(), O_RDWR, 0);
+	if (fd < 0) {
+		return SharedMemory();
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0 || status.st_size == 0) {
+		close(fd);
+		return SharedMemory();
+	}
+	return Map(fd, static_cast<size_t>(status.st_size), true);
+}
+
+SharedMemory OpenSharedMemory(int fd) {
+	struct stat status;
+	if (fstat(fd, &status) != 0 || status.st_size == 0) {
+		return SharedMemory();
+	}
+
+	auto memory = Map(fd, static_cast<size_t>(status.st_size), false);
+	memory.fd = -1;
+	return memory;
+}
+
+void CloseSharedMemory(const SharedMemory& memory) {
+	if (memory.address) {
+		munmap(memory.address, memory.size);
+	}
+	if (memory.fd >= 0) {
+		close(memory.fd);
+	}
+}
+
+void RemoveSharedMemory(const std::string& name) {
+	if (!name.empty()) {
+		shm_unlink(name.c_str());
+	}
+}
+#else
+SharedMemory CreateSharedMemory(const std::string& name, size_t size) {
+	return SharedMemory();
+}
+
+SharedMemory OpenSharedMemory(const std::string& name) {
+	return SharedMemory();
+}
+
+SharedMemory OpenSharedMemory(int fd) {
+	return SharedMemory();
+}
+
+void CloseSharedMemory(const SharedMemory& memory) {
+}
+
+void RemoveSharedMemory(const std::string& name) {
+}
+#endif
+}
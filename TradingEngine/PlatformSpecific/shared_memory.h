@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace ps {
+
+struct SharedMemory {
+	void* address = nullptr; // nullptr if it couldn't be created/opened
+	size_t size = 0;
+	int fd = -1; // Kept open, so it can be handed to another process
+};
+
+// Creates size bytes of zeroed memory which other processes can map. A name (starting with '/')
+// makes it a POSIX shared memory object which any process can open by name, replacing one left
+// over with the same name. Without a name it is an anonymous memfd on Linux, which only reaches
+// other processes by inheriting the fd (i.e forked) or being sent it. Every page is touched
+// before returning. Shared memory is only supported on Linux/macOS.
+SharedMemory CreateSharedMemory(const std::string& name, size_t size);
+
+// Maps the whole of a shared memory object created by another process
+SharedMemory OpenSharedMemory(const std::string& name);
+SharedMemory OpenSharedMemory(int fd); // Which stays owned by the caller
+
+void CloseSharedMemory(const SharedMemory& memory);
+void RemoveSharedMemory(const std::string& name); // The name only, mappings stay valid
+}
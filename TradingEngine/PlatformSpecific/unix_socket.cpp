@@ -0,0 +1,302 @@
+#include "unix_socket.h"
+
+#include <algorithm>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+namespace ps {
+
+#if defined(__linux__) || defined(__APPLE__)
+static_assert(sizeof(IoSlice) == sizeof(iovec) && offsetof(iovec, iov_base) == offsetof(IoSlice, data)
+&& offsetof(iovec, iov_len) == offsetof(IoSlice, size),
+"IoSlice must be laid out as iovec");
+
+namespace {
+bool MakeAddress(const std::string& path, sockaddr_un* address) {
+	std::memset(address, 0, sizeof(*address));
+	address->sun_family = AF_UNIX;
+	if (path.empty() || path.size() >= sizeof(address->sun_path)) {
+		return false;
+	}
+	std::memcpy(address->sun_path, path.data(), path.size());
+	return true;
+}
+
+bool SetNonBlocking(int fd) {
+	auto flags = fcntl(fd, F_GETFL, 0);
+	return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+int MakeSocket() {
+	auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1) {
+		return -1;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+	int on = 1;
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+	return fd;
+}
+}
+
+int ListenUnixSocket(const std::string& path, int backlog) {
+	sockaddr_un address;
+	if (!MakeAddress(path, &address)) {
+		return -1;
+	}
+
+	// Only a stale socket is replaced, anything else at the path is left alone
+	struct stat status;
+	if (lstat(path.c_str(), &status) == 0) {
+		if (!S_ISSOCK(status.st_mode) || unlink(path.c_str()) != 0) {
+			return -1;
+		}
+	} else if (errno != ENOENT) {
+		return -1;
+	}
+
+	auto fd = MakeSocket();
+	if (fd == -1) {
+		return -1;
+	}
+	if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, backlog) != 0 || !SetNonBlocking(fd)) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int AcceptUnixSocket(int listenFd) {
+	while (true) {
+		auto fd = accept(listenFd, nullptr, nullptr);
+		if (fd == -1) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			return -1;
+		}
+
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+		int on = 1;
+		setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+		if (!SetNonBlocking(fd)) {
+			close(fd);
+			continue;
+		}
+		return fd;
+	}
+}
+
+int ConnectUnixSocket(const std::string& path) {
+	sockaddr_un address;
+	if (!MakeAddress(path, &address)) {
+		return -1;
+	}
+
+	auto fd = MakeSocket();
+	if (fd == -1) {
+		return -1;
+	}
+	int result;
+	do {
+		result = connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+	} while (result != 0 && errno == EINTR);
+	if (result != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+bool CreateSocketPair(int* first, int* second) {
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+		return false;
+	}
+	for (auto fd : fds) {
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+		int on = 1;
+		setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+	}
+	*first = fds[0];
+	*second = fds[1];
+	return true;
+}
+
+void CloseSocket(int fd) {
+	if (fd != -1) {
+		close(fd);
+	}
+}
+
+void RemoveUnixSocket(const std::string& path) {
+	if (!path.empty()) {
+		unlink(path.c_str());
+	}
+}
+
+int64_t ReadSocket(int fd, void* data, size_t size) {
+	while (true) {
+		auto numRead = read(fd, data, size);
+		if (numRead >= 0) {
+			return numRead;
+		} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return socketWouldBlock;
+		} else if (errno != EINTR) {
+			return 0;
+		}
+	}
+}
+
+int64_t WriteSocket(int fd, const IoSlice* slices, size_t count) {
+	// sendmsg() is writev() with flags, so a closed peer is an error rather than a SIGPIPE
+	msghdr header;
+	std::memset(&header, 0, sizeof(header));
+	header.msg_iov = const_cast<iovec*>(reinterpret_cast<const iovec*>(slices));
+	header.msg_iovlen = std::min(count, maxNumIoSlices);
+#ifdef MSG_NOSIGNAL
+	constexpr int flags = MSG_NOSIGNAL;
+#else
+	constexpr int flags = 0;
+#endif
+	while (true) {
+		auto numWritten = sendmsg(fd, &header, flags);
+		if (numWritten >= 0) {
+			return numWritten;
+		} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return socketWouldBlock;
+		} else if (errno != EINTR) {
+			return 0;
+		}
+	}
+}
+
+bool WaitReadable(int fd, std::chrono::milliseconds timeout) {
+	pollfd pollFd;
+	pollFd.fd = fd;
+	pollFd.events = POLLIN;
+	pollFd.revents = 0;
+	int result;
+	do {
+		result = poll(&pollFd, 1, static_cast<int>(timeout.count()));
+	} while (result == -1 && errno == EINTR);
+	return result > 0;
+}
+#else
+int ListenUnixSocket(const std::string& path, int backlog) {
+	return -1;
+}
+
+int AcceptUnixSocket(int listenFd) {
+	return -1;
+}
+
+int ConnectUnixSocket(const std::string& path) {
+	return -1;
+}
+
+bool CreateSocketPair(int* first, int* second) {
+	return false;
+}
+
+void CloseSocket(int fd) {
+}
+
+void RemoveUnixSocket(const std::string& path) {
+}
+
+int64_t ReadSocket(int fd, void* data, size_t size) {
+	return 0;
+}
+
+int64_t WriteSocket(int fd, const IoSlice* slices, size_t count) {
+	return 0;
+}
+
+bool WaitReadable(int fd, std::chrono::milliseconds timeout) {
+	return false;
+}
+#endif
+
+#ifdef __linux__
+EventPoll::EventPoll() :
+fd(epoll_create1(EPOLL_CLOEXEC)) {
+}
+
+EventPoll::~EventPoll() {
+	if (fd != -1) {
+		close(fd);
+	}
+}
+
+bool EventPoll::Add(int socketFd, uint64_t userData, bool writable) {
+	epoll_event event;
+	std::memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (writable ? static_cast<uint32_t>(EPOLLOUT) : 0);
+	event.data.u64 = userData;
+	return epoll_ctl(fd, EPOLL_CTL_ADD, socketFd, &event) == 0;
+}
+
+void EventPoll::Remove(int socketFd) {
+	epoll_ctl(fd, EPOLL_CTL_DEL, socketFd, nullptr);
+}
+
+size_t EventPoll::Wait(Event* events, size_t maxNumEvents, std::chrono::milliseconds timeout) {
+	constexpr size_t batchSize = 64;
+	epoll_event ready[batchSize];
+	auto numReady = epoll_wait(fd, ready, static_cast<int>(std::min(maxNumEvents, batchSize)), static_cast<int>(timeout.count()));
+	if (numReady <= 0) {
+		return 0;
+	}
+
+	for (int i = 0; i < numReady; ++i) {
+		events[i].userData = ready[i].data.u64;
+		events[i].readable = (ready[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0;
+		events[i].writable = (ready[i].events & EPOLLOUT) != 0;
+		events[i].closed = (ready[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0;
+	}
+	return static_cast<size_t>(numReady);
+}
+#else
+EventPoll::EventPoll() {
+}
+
+EventPoll::~EventPoll() {
+}
+
+bool EventPoll::Add(int socketFd, uint64_t userData, bool writable) {
+	return false;
+}
+
+void EventPoll::Remove(int socketFd) {
+}
+
+size_t EventPoll::Wait(Event* events, size_t maxNumEvents, std::chrono::milliseconds timeout) {
+	return 0;
+}
+#endif
+
+bool EventPoll::IsAvailable() const {
+	return fd != -1;
+}
+}
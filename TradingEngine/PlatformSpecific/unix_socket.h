@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ps {
+
+// Unix domain stream sockets, only supported on Linux/macOS. Everything returns -1/false where
+// they aren't.
+
+// Replaces a socket left over at path, but fails if anything else is there. Non-blocking.
+// Returns the fd, or -1 if it couldn't listen.
+int ListenUnixSocket(const std::string& path, int backlog);
+
+// Non-blocking. Returns -1 once there are no more waiting.
+int AcceptUnixSocket(int listenFd);
+
+// Blocking, for clients. Returns -1 if nothing is listening.
+int ConnectUnixSocket(const std::string& path);
+
+// A connected pair of blocking sockets, i.e for a forked child to talk to its parent
+bool CreateSocketPair(int* first, int* second);
+
+void CloseSocket(int fd);
+void RemoveUnixSocket(const std::string& path);
+
+// Returned by ReadSocket()/WriteSocket() when a non-blocking socket has nothing to read or no
+// room to write. 0 means the other end has closed (or the socket failed).
+constexpr int64_t socketWouldBlock = -1;
+
+int64_t ReadSocket(int fd, void* data, size_t size);
+
+// Laid out as iovec, so they go to writev() as they are
+struct IoSlice {
+	const void* data;
+	size_t size;
+};
+
+// Gathers the slices into one write (up to maxNumIoSlices). Returns the number of bytes
+// written, which can be fewer than asked for.
+constexpr size_t maxNumIoSlices = 1024;
+int64_t WriteSocket(int fd, const IoSlice* slices, size_t count);
+
+// Whether fd has something to read (or has closed) within the timeout
+bool WaitReadable(int fd, std::chrono::milliseconds timeout);
+
+// Edge-triggered readiness of many sockets (epoll). Only supported on Linux, elsewhere
+// IsAvailable() is false.
+class EventPoll {
+public:
+	struct Event {
+		uint64_t userData;
+		bool readable; // Or closed
+		bool writable;
+		bool closed; // By the other end, once what it sent before has been read
+	};
+
+	EventPoll();
+	~EventPoll();
+
+	EventPoll(const EventPoll&) = delete;
+	EventPoll& operator=(const EventPoll&) = delete;
+
+	bool IsAvailable() const;
+
+	// Edge-triggered, so an event only comes when more arrives or room is made. After one the
+	// socket must be read/written until socketWouldBlock before waiting again.
+	bool Add(int fd, uint64_t userData, bool writable);
+	void Remove(int fd);
+
+	// Waits up to timeout for events, returning how many were put in events (up to maxNumEvents)
+	size_t Wait(Event* events, size_t maxNumEvents, std::chrono::milliseconds timeout);
+
+private:
+	int fd = -1;
+};
+}
@@ -0,0 +1,188 @@
+#include "PoolMemory.h"
+
+#include "AllocationStats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <new>
+
+namespace {
+// Never destroyed, the static pools may still give blocks back to them while exiting.
+// Earlier arenas are kept as well when it is configured again, for the blocks still in use.
+PageArena* pageArena = nullptr;
+
+std::vector<PageArena*>& GetPageArenas() {
+	static auto pageArenas = new std::vector<PageArena*>();
+	return *pageArenas;
+}
+
+// Blocks are only taken when a pool grows, pools in different shards can do so on different threads
+std::mutex& GetBlockMutex() {
+	static auto blockMutex = new std::mutex();
+	return *blockMutex;
+}
+
+// The mappings of every arena sorted by address, so a freed block finds its arena with a binary
+// search. Rebuilt whenever the current arena maps more, which is rare and slow anyway.
+struct ArenaRange {
+	const char* begin;
+	const char* end;
+	PageArena* arena;
+};
+
+std::vector<ArenaRange>& GetArenaRanges() {
+	static auto arenaRanges = new std::vector<ArenaRange>();
+	return *arenaRanges;
+}
+
+size_t numIndexedMappings = 0; // Of the current arena
+
+void IndexArenas() {
+	auto& arenaRanges = GetArenaRanges();
+	arenaRanges.clear();
+	for (auto arena : GetPageArenas()) {
+		for (const auto& mapping : arena->GetMappings()) {
+			auto begin = static_cast<const char*>(mapping.address);
+			arenaRanges.push_back({ begin, begin + mapping.size, arena });
+		}
+	}
+
+	std::sort(arenaRanges.begin(), arenaRanges.end(), [](const ArenaRange& lhs, const ArenaRange& rhs) {
+		return std::less<const char*>()(lhs.begin, rhs.begin);
+	});
+	numIndexedMappings = pageArena->GetMappings().size();
+}
+
+// The last range starting at or before ptr, if it contains it
+template <class Ranges, class Begin, class End>
+auto FindRange(Ranges& ranges, const void* ptr, Begin begin, End end) {
+	std::less<const void*> less;
+	auto it = std::upper_bound(ranges.begin(), ranges.end(), ptr, [&](const void* address, const auto& range) {
+		return less(address, begin(range));
+	});
+	if (it == ranges.begin() || !less(ptr, end(*std::prev(it)))) {
+		return ranges.end();
+	}
+	return std::prev(it);
+}
+}
+
+PageArena::PageArena(const PoolMemoryConfig& config) :
+config(config) {
+	stats.hugePages = config.hugePages;
+	stats.locked = config.lock;
+	if (config.capacity > 0) {
+		Map(config.capacity);
+	}
+}
+
+PageArena::~PageArena() {
+	for (const auto& mapping : mappings) {
+		ps::UnmapPages(mapping);
+	}
+}
+
+void* PageArena::Allocate(size_t size, size_t alignment) {
+	auto sizeFreeBlocks = std::lower_bound(freeBlocks.begin(), freeBlocks.end(), size, [](const auto& sizeFreeBlocks, size_t size) {
+		return sizeFreeBlocks.first < size;
+	});
+	if (sizeFreeBlocks != freeBlocks.end() && sizeFreeBlocks->first == size && !sizeFreeBlocks->second.empty()) {
+		auto ptr = sizeFreeBlocks->second.back();
+		if (reinterpret_cast<uintptr_t>(ptr) % alignment == 0) {
+			sizeFreeBlocks->second.pop_back();
+			return ptr;
+		}
+	}
+
+	auto aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(next) + alignment - 1) & ~(uintptr_t(alignment) - 1));
+	if (!next || aligned + size > end) {
+		// Growing on the hot path, the rest of the current mapping is abandoned
+		auto growth = std::max(config.growthSize, size + alignment);
+		Map(growth);
+		++stats.numGrowths;
+		CountAllocation(AllocationSource::PoolMemoryGrowth, growth);
+		if (config.onGrowth) {
+			config.onGrowth(growth);
+		}
+		aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(next) + alignment - 1) & ~(uintptr_t(alignment) - 1));
+	}
+
+	next = aligned + size;
+	stats.usedBytes += size;
+	return aligned;
+}
+
+void PageArena::Deallocate(void* ptr, size_t size) {
+	auto it = std::lower_bound(freeBlocks.begin(), freeBlocks.end(), size, [](const auto& sizeFreeBlocks, size_t size) {
+		return sizeFreeBlocks.first < size;
+	});
+	if (it == freeBlocks.end() || it->first != size) {
+		it = freeBlocks.emplace(it, size, std::vector<void*>{});
+	}
+	it->second.push_back(ptr);
+}
+
+bool PageArena::Owns(const void* ptr) const {
+	auto begin = [](const ps::PageMapping& mapping) { return mapping.address; };
+	auto end = [](const ps::PageMapping& mapping) { return static_cast<const char*>(mapping.address) + mapping.size; };
+	return FindRange(mappings, ptr, begin, end) != mappings.end();
+}
+
+const PoolMemoryStats& PageArena::GetStats() const {
+	return stats;
+}
+
+const std::vector<ps::PageMapping>& PageArena::GetMappings() const {
+	return mappings;
+}
+
+void PageArena::Map(size_t size) {
+	auto mapping = ps::MapPages(size, config.hugePages, config.lock);
+	mappings.insert(std::upper_bound(mappings.begin(), mappings.end(), mapping, [](const ps::PageMapping& lhs, const ps::PageMapping& rhs) {
+		return std::less<const void*>()(lhs.address, rhs.address);
+	}), mapping);
+	stats.mappedBytes += mapping.size;
+	stats.hugePages = stats.hugePages && mapping.hugePages;
+	stats.locked = stats.locked && mapping.locked;
+
+	next = static_cast<char*>(mapping.address);
+	end = next + mapping.size;
+}
+
+void ConfigurePoolMemory(const PoolMemoryConfig& config) {
+	std::lock_guard<std::mutex> lock(GetBlockMutex());
+	pageArena = new PageArena(config);
+	GetPageArenas().push_back(pageArena);
+	IndexArenas();
+}
+
+const PoolMemoryStats* GetPoolMemoryStats() {
+	return pageArena ? &pageArena->GetStats() : nullptr;
+}
+
+void* AllocatePoolBlock(size_t size, size_t alignment) {
+	std::lock_guard<std::mutex> lock(GetBlockMutex());
+	if (pageArena) {
+		auto ptr = pageArena->Allocate(size, alignment);
+		if (pageArena->GetMappings().size() != numIndexedMappings) {
+			IndexArenas();
+		}
+		return ptr;
+	}
+	return ::operator new(size, std::align_val_t(alignment));
+}
+
+void FreePoolBlock(void* ptr, size_t size, size_t alignment) {
+	std::lock_guard<std::mutex> lock(GetBlockMutex());
+	auto& arenaRanges = GetArenaRanges();
+	auto begin = [](const ArenaRange& range) { return range.begin; };
+	auto end = [](const ArenaRange& range) { return range.end; };
+	auto it = FindRange(arenaRanges, ptr, begin, end);
+	if (it != arenaRanges.end()) {
+		it->arena->Deallocate(ptr, size);
+		return;
+	}
+	::operator delete(ptr, std::align_val_t(alignment));
+}
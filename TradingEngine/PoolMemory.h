@@ -0,0 +1,69 @@
+#pragma once
+
+#include "PlatformSpecific/page_memory.h"
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Where the pools (NodePool slabs, used for the price levels and their orders) get their blocks from. By default
+// this is operator new, which leaves the first touch of every new block (and its page faults) to
+// happen while matching. ConfigurePoolMemory() at start up switches to a PageArena instead.
+struct PoolMemoryConfig {
+	size_t capacity = 0; // Bytes mapped and pre-faulted up front
+	bool hugePages = true; // From 2MB pages where possible
+	bool lock = false; // mlock the capacity so it is never paged out
+	size_t growthSize = ps::hugePageSize; // Minimum mapped each time the capacity runs out
+
+	// Called (while processing) whenever more memory has to be mapped, with the bytes mapped
+	std::function<void(size_t)> onGrowth;
+};
+
+struct PoolMemoryStats {
+	size_t mappedBytes = 0;
+	size_t usedBytes = 0; // Handed out to the pools, including blocks they have given back
+	size_t numGrowths = 0; // Mappings made after the initial capacity was used up
+	bool hugePages = false; // Every mapping is from explicit huge pages
+	bool locked = false; // Every mapping is locked
+};
+
+// A bump allocator over mapped pages. Blocks given back are kept on a free list per size for
+// reuse, the pages are only released when the arena is destroyed. The free lists and mappings
+// are sorted (by size and address), so finding either is a binary search. Not thread safe.
+class PageArena {
+public:
+	explicit PageArena(const PoolMemoryConfig& config);
+	~PageArena();
+
+	PageArena(const PageArena&) = delete;
+	PageArena& operator=(const PageArena&) = delete;
+
+	void* Allocate(size_t size, size_t alignment);
+	void Deallocate(void* ptr, size_t size);
+	bool Owns(const void* ptr) const;
+
+	const PoolMemoryStats& GetStats() const;
+	const std::vector<ps::PageMapping>& GetMappings() const;
+
+private:
+	PoolMemoryConfig config;
+	PoolMemoryStats stats;
+	std::vector<ps::PageMapping> mappings; // By address
+	std::vector<std::pair<size_t, std::vector<void*>>> freeBlocks; // By size
+	char* next = nullptr;
+	char* end = nullptr;
+
+	void Map(size_t size);
+};
+
+// Must be done before anything is allocated from the pools, blocks already handed out are left
+// where they are. Throws std::bad_alloc if the capacity can't be mapped.
+void ConfigurePoolMemory(const PoolMemoryConfig& config);
+
+// nullptr when the pools use operator new
+const PoolMemoryStats* GetPoolMemoryStats();
+
+// Safe to call from several threads
+void* AllocatePoolBlock(size_t size, size_t alignment);
+void FreePoolBlock(void* ptr, size_t size, size_t alignment);
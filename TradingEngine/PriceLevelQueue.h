@@ -0,0 +1,374 @@
+#pragma once
+
+#include "NodePool.h"
+#include "ShardAllocator.h"
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// The FIFO queue of orders at a single price. Each order lives in its own node, linked in both
+// directions, and the nodes are carved out of the slabs of the shard it was given (see NodePool),
+// which the order maps pass down to their queues (see OrderMap). The links are 32 bit node
+// handles rather than pointers, so a node is only 8 bytes bigger than its order. Unlike
+// std::deque nothing here depends on how the standard library lays out its containers.
+//
+// push_back/pop_front/insert are O(1), and iterators (or their 32 bit handles) stay valid until that
+// order is erased, which unlinks it in O(1). Not thread safe.
+template <class Order>
+class PriceLevelQueue {
+private:
+	struct Node {
+		NodePool::Handle prev = NodePool::nullHandle;
+		NodePool::Handle next = NodePool::nullHandle;
+		Order order;
+
+		template <class... Args>
+		explicit Node(Args&&... args) :
+		order(std::forward<Args>(args)...) {
+		}
+	};
+
+	static_assert(alignof(Node) >= 8, "Node handles need nodes aligned to 8 bytes");
+
+	template <bool IsConst>
+	class Iterator {
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = Order;
+		using difference_type = std::ptrdiff_t;
+		using pointer = std::conditional_t<IsConst, const Order*, Order*>;
+		using reference = std::conditional_t<IsConst, const Order&, Order&>;
+
+		Iterator() = default;
+
+		// iterator -> const_iterator
+		template <bool WasConst, class = std::enable_if_t<IsConst && !WasConst>>
+		Iterator(const Iterator<WasConst>& other) :
+		queue(other.queue),
+		node(other.node) {
+		}
+
+		reference operator*() const {
+			return node->order;
+		}
+
+		pointer operator->() const {
+			return &node->order;
+		}
+
+		Iterator& operator++() {
+			node = queue->GetNode(node->next);
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			auto it = *this;
+			++*this;
+			return it;
+		}
+
+		// end() is the node after the last one
+		Iterator& operator--() {
+			node = queue->GetNode(node ? node->prev : queue->last);
+			return *this;
+		}
+
+		Iterator operator--(int) {
+			auto it = *this;
+			--*this;
+			return it;
+		}
+
+		bool operator==(const Iterator& other) const {
+			return node == other.node;
+		}
+
+		bool operator!=(const Iterator& other) const {
+			return node != other.node;
+		}
+
+	private:
+		friend class PriceLevelQueue;
+
+		const PriceLevelQueue* queue = nullptr;
+		Node* node = nullptr; // nullptr at the end
+
+		Iterator(const PriceLevelQueue* queue, Node* node) :
+		queue(queue),
+		node(node) {
+		}
+	};
+
+public:
+	using value_type = Order;
+	using size_type = size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = Order&;
+	using const_reference = const Order&;
+	using iterator = Iterator<false>;
+	using const_iterator = Iterator<true>;
+	using allocator_type = ShardAllocator<Order>; // Only its shard is used
+	using Handle = NodePool::Handle;
+
+	constexpr static size_t nodeSize = sizeof(Node);
+
+	PriceLevelQueue() :
+	PriceLevelQueue(allocator_type()) {
+	}
+
+	explicit PriceLevelQueue(const allocator_type& allocator) :
+	PriceLevelQueue(&allocator.GetShard()->GetPool(sizeof(Node), alignof(Node))) {
+	}
+
+	// Copies share the other's shard
+	PriceLevelQueue(const PriceLevelQueue& other) :
+	PriceLevelQueue(other, other.nodePool) {
+	}
+
+	PriceLevelQueue(const PriceLevelQueue& other, const allocator_type& allocator) :
+	PriceLevelQueue(allocator) {
+		for (const auto& order : other) {
+			push_back(order);
+		}
+	}
+
+	PriceLevelQueue(PriceLevelQueue&& other) noexcept :
+	PriceLevelQueue(other.nodePool) {
+		swap(other);
+	}
+
+	// The nodes can only be taken over if they are in the same shard, otherwise they are copied
+	PriceLevelQueue(PriceLevelQueue&& other, const allocator_type& allocator) :
+	PriceLevelQueue(allocator) {
+		if (nodePool == other.nodePool) {
+			swap(other);
+		} else {
+			for (const auto& order : other) {
+				push_back(order);
+			}
+		}
+	}
+
+	// Copied into this queue's shard
+	PriceLevelQueue& operator=(const PriceLevelQueue& other) {
+		if (this != &other) {
+			PriceLevelQueue copy(other, nodePool);
+			swap(copy);
+		}
+		return *this;
+	}
+
+	PriceLevelQueue& operator=(PriceLevelQueue&& other) noexcept {
+		if (this != &other) {
+			clear();
+			swap(other);
+		}
+		return *this;
+	}
+
+	~PriceLevelQueue() {
+		clear();
+	}
+
+	iterator begin() noexcept {
+		return iterator(this, GetNode(first));
+	}
+
+	iterator end() noexcept {
+		return iterator(this, nullptr);
+	}
+
+	const_iterator begin() const noexcept {
+		return const_iterator(this, GetNode(first));
+	}
+
+	const_iterator end() const noexcept {
+		return const_iterator(this, nullptr);
+	}
+
+	const_iterator cbegin() const noexcept {
+		return begin();
+	}
+
+	const_iterator cend() const noexcept {
+		return end();
+	}
+
+	size_t size() const noexcept {
+		return count;
+	}
+
+	bool empty() const noexcept {
+		return count == 0;
+	}
+
+	Order& front() {
+		return *begin();
+	}
+
+	const Order& front() const {
+		return *begin();
+	}
+
+	Order& back() {
+		return GetNode(last)->order;
+	}
+
+	const Order& back() const {
+		return GetNode(last)->order;
+	}
+
+	void push_back(const Order& order) {
+		emplace_back(order);
+	}
+
+	template <class... Args>
+	Order& emplace_back(Args&&... args) {
+		return *emplace(end(), std::forward<Args>(args)...);
+	}
+
+	// Links the order in before pos, it's only for putting an order back where it was
+	iterator insert(const_iterator pos, const Order& order) {
+		return emplace(pos, order);
+	}
+
+	template <class... Args>
+	iterator emplace(const_iterator pos, Args&&... args) {
+		auto memory = nodePool->Allocate();
+		Node* node;
+		try {
+			node = new (memory) Node(std::forward<Args>(args)...);
+		} catch (...) {
+			NodePool::Deallocate(memory);
+			throw;
+		}
+
+		auto handle = NodePool::ToHandle(node);
+		auto next = pos.node;
+		node->prev = next ? next->prev : last;
+		if (next) {
+			node->next = NodePool::ToHandle(next);
+			next->prev = handle;
+		} else {
+			last = handle;
+		}
+
+		if (node->prev == NodePool::nullHandle) {
+			first = handle;
+		} else {
+			GetNode(node->prev)->next = handle;
+		}
+		++count;
+		return iterator(this, node);
+	}
+
+	void pop_front() {
+		erase(begin());
+	}
+
+	// Unlinks the order, returns the one after it
+	iterator erase(const_iterator it) {
+		auto node = it.node;
+		auto next = node->next;
+		if (node->prev == NodePool::nullHandle) {
+			first = next;
+		} else {
+			GetNode(node->prev)->next = next;
+		}
+
+		if (next == NodePool::nullHandle) {
+			last = node->prev;
+		} else {
+			GetNode(next)->prev = node->prev;
+		}
+		--count;
+
+		node->~Node();
+		NodePool::Deallocate(node);
+		return iterator(this, GetNode(next));
+	}
+
+	iterator erase(const_iterator first, const_iterator last) {
+		while (first != last) {
+			first = erase(first);
+		}
+		return iterator(this, last.node);
+	}
+
+	void clear() noexcept {
+		auto handle = first;
+		while (handle != NodePool::nullHandle) {
+			auto node = GetNode(handle);
+			handle = node->next;
+			node->~Node();
+			NodePool::Deallocate(node);
+		}
+
+		first = last = NodePool::nullHandle;
+		count = 0;
+	}
+
+	// The nodes stay in their shard, which goes with them
+	void swap(PriceLevelQueue& other) noexcept {
+		std::swap(nodePool, other.nodePool);
+		std::swap(first, other.first);
+		std::swap(last, other.last);
+		std::swap(count, other.count);
+	}
+
+	// Names the order until it is erased, so it can be found again without walking the queue
+	static Handle GetHandle(const_iterator it) noexcept {
+		return NodePool::ToHandle(it.node);
+	}
+
+	iterator FromHandle(Handle handle) noexcept {
+		return iterator(this, GetNode(handle));
+	}
+
+	const_iterator FromHandle(Handle handle) const noexcept {
+		return const_iterator(this, GetNode(handle));
+	}
+
+	bool operator==(const PriceLevelQueue& other) const {
+		if (count != other.count) {
+			return false;
+		}
+
+		auto it = begin();
+		for (const auto& order : other) {
+			if (!(*it == order)) {
+				return false;
+			}
+			++it;
+		}
+		return true;
+	}
+
+	bool operator!=(const PriceLevelQueue& other) const {
+		return !(*this == other);
+	}
+
+private:
+	NodePool* nodePool;
+	Handle first = NodePool::nullHandle;
+	Handle last = NodePool::nullHandle;
+	size_t count = 0;
+
+	explicit PriceLevelQueue(NodePool* nodePool) noexcept :
+	nodePool(nodePool) {
+	}
+
+	PriceLevelQueue(const PriceLevelQueue& other, NodePool* nodePool) :
+	PriceLevelQueue(nodePool) {
+		for (const auto& order : other) {
+			push_back(order);
+		}
+	}
+
+	Node* GetNode(Handle handle) const {
+		return handle == NodePool::nullHandle ? nullptr : static_cast<Node*>(nodePool->FromHandle(handle));
+	}
+};
@@ -0,0 +1,284 @@
+#include "Replication.h"
+
+#include "Error.h"
+#include "MessageCodec.h"
+#include "PlatformSpecific/crc32c.h"
+#include "PlatformSpecific/unix_socket.h"
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <mutex>
+#include <string_view>
+
+namespace {
+// Each record is a header then size bytes of payload. An input's payload is the checksum of its
+// output on the primary then the message in the raw format, a checkpoint's is the state hash.
+struct RecordHeader {
+	uint32_t size;
+	uint32_t type;
+	uint64_t sequence;
+};
+
+constexpr uint32_t inputRecord = 1;
+constexpr uint32_t checkpointRecord = 2;
+constexpr size_t maxRecordSize = 1024 * 1024;
+constexpr size_t readSize = 64 * 1024;
+
+// Of what every output message is, whether it failed and what it says (prices, amounts, fills,
+// fees and ids), and which orders were cancelled or replaced. Messages also have unions and
+// padding which aren't always set, so only the fields each type sets are checksummed.
+uint32_t OutputChecksum(const Message* output, size_t count) {
+	auto crc = ps::Crc32c(&count, sizeof(count));
+	for (size_t i = 0; i < count; ++i) {
+		const auto& message = output[i];
+		int64_t fields[11] = { static_cast<int64_t>(message.messageType), message.errorCode };
+		size_t numFields = 2;
+		auto add = [&fields, &numFields](std::initializer_list<int64_t> values) {
+			for (auto value : values) {
+				fields[numFields++] = value;
+			}
+		};
+
+		switch (message.messageType) {
+			case MessageType::OrderFilled:
+				add({ message.orderId });
+				break;
+			case MessageType::NewTrade:
+				add({ message.buyOrderId, message.sellOrderId, message.amount, message.price, message.tradeId,
+				message.buyFee, message.sellFee });
+				break;
+			case MessageType::NewOpenOrder:
+				add({ message.coinId, message.baseId, message.userId, message.isBuy, message.orderType, message.price,
+				message.stopPrice, message.amount, message.filled });
+				break;
+			case MessageType::NewFilledOrder:
+				add({ message.coinId, message.baseId, message.userId, message.isBuy, message.orderType, message.amount,
+				message.price });
+				break;
+			case MessageType::PartialFill:
+				add({ message.orderId, message.filled });
+				break;
+			case MessageType::StopLimitTriggered:
+				add({ message.orderId, message.tradeId });
+				break;
+			case MessageType::Last:
+				// The answer to a GetAmount/GetAvailable/GetInOrder/GetTotal
+				add({ message.amount });
+				break;
+			default:
+				// The input echoed back (or with its error), which the replica was sent as it is
+				break;
+		}
+		crc = ps::Crc32c(fields, numFields * sizeof(int64_t), crc);
+
+		// The ids cancelled, or replaced by the quotes
+		if (message.messageType == MessageType::CancelAllOrders || message.messageType == MessageType::MassQuote) {
+			crc = ps::Crc32c(Message::cancelOrders.data(), Message::cancelOrders.size(), crc);
+		}
+	}
+	return crc;
+}
+}
+
+ReplicationSender::ReplicationSender(int fd, const ReplicationConfig& config, uint64_t lastSequence) :
+fd(fd),
+config(config),
+sequence(lastSequence),
+sendThread(&ReplicationSender::Send, this) {
+}
+
+ReplicationSender::~ReplicationSender() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	queuedChanged.notify_all();
+	sendThread.join();
+}
+
+uint64_t ReplicationSender::Process(TradingEngine& tradingEngine, const Message& message, std::vector<Message>* output) {
+	// Encoded first, as the engine can replace the attachment with the output's
+	++sequence;
+	auto payload = Append(inputRecord, sizeof(uint32_t) + GetRawSize(message));
+	EncodeRaw(message, payload + sizeof(uint32_t));
+
+	auto begin = output->size();
+	tradingEngine.Process(message, output);
+	auto checksum = OutputChecksum(output->data() + begin, output->size() - begin);
+	std::memcpy(payload, &checksum, sizeof(checksum));
+
+	if (config.stateHash && config.checkpointInterval > 0 && sequence % config.checkpointInterval == 0) {
+		auto stateHash = config.stateHash(tradingEngine);
+		std::memcpy(Append(checkpointRecord, sizeof(stateHash)), &stateHash, sizeof(stateHash));
+	}
+	return sequence;
+}
+
+void ReplicationSender::Flush() {
+	std::unique_lock<std::mutex> lock(mutex);
+	queuedChanged.wait(lock, [this]() { return failed || numUnsent == 0 || numUnsent + buffer.size() <= config.maxQueuedBytes; });
+	if (failed) {
+		throw Error(Error::Type::ReplicationFailed, "The replica has gone");
+	}
+
+	numUnsent += buffer.size();
+	queued.append(buffer);
+	buffer.clear();
+	lock.unlock();
+	queuedChanged.notify_all();
+}
+
+void ReplicationSender::Wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	queuedChanged.wait(lock, [this]() { return failed || numUnsent == 0; });
+	if (failed) {
+		throw Error(Error::Type::ReplicationFailed, "The replica has gone");
+	}
+}
+
+uint64_t ReplicationSender::GetSequence() const {
+	return sequence;
+}
+
+void ReplicationSender::Send() {
+	// Swapped with what's queued, so the engine can queue more while it's written
+	std::string sending;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		queuedChanged.wait(lock, [this]() { return stopping || !queued.empty(); });
+		if (queued.empty()) {
+			return;
+		}
+
+		sending.swap(queued);
+		lock.unlock();
+		ps::IoSlice slice{ sending.data(), sending.size() };
+		while (slice.size > 0) {
+			auto numWritten = ps::WriteSocket(fd, &slice, 1);
+			if (numWritten == 0 || numWritten == ps::socketWouldBlock) {
+				break;
+			}
+			slice.data = static_cast<const char*>(slice.data) + numWritten;
+			slice.size -= static_cast<size_t>(numWritten);
+		}
+		lock.lock();
+
+		numUnsent -= sending.size();
+		sending.clear();
+		failed = failed || (slice.size > 0);
+		queuedChanged.notify_all();
+		if (failed) {
+			return;
+		}
+	}
+}
+
+char* ReplicationSender::Append(uint32_t type, size_t size) {
+	if (size > maxRecordSize) {
+		throw Error(Error::Type::ReplicationFailed, "The input is too big to replicate");
+	}
+
+	RecordHeader header{ static_cast<uint32_t>(size), type, sequence };
+	auto offset = buffer.size();
+	buffer.resize(offset + sizeof(header) + size);
+	std::memcpy(&buffer[offset], &header, sizeof(header));
+	return &buffer[offset + sizeof(header)];
+}
+
+Replica::Replica(TradingEngine& tradingEngine, int fd, const ReplicationConfig& config, uint64_t lastSequence) :
+tradingEngine(tradingEngine),
+fd(fd),
+config(config),
+sequence(lastSequence) {
+}
+
+size_t Replica::Poll(std::chrono::milliseconds timeout) {
+	if (primaryGone || !ps::WaitReadable(fd, timeout)) {
+		return 0;
+	}
+
+	if (input.size() - inputSize < readSize) {
+		input.resize(inputSize + readSize);
+	}
+	auto numRead = ps::ReadSocket(fd, input.data() + inputSize, input.size() - inputSize);
+	if (numRead == 0) {
+		// A record the primary didn't finish sending was never applied by it either
+		primaryGone = true;
+		return 0;
+	} else if (numRead == ps::socketWouldBlock) {
+		return 0;
+	}
+	inputSize += static_cast<size_t>(numRead);
+
+	size_t numApplied = 0;
+	size_t offset = 0;
+	RecordHeader header;
+	while (inputSize - offset >= sizeof(header)) {
+		std::memcpy(&header, input.data() + offset, sizeof(header));
+		if (header.size > maxRecordSize) {
+			throw Error(Error::Type::ReplicaDiverged, "Not a replication stream");
+		}
+		if (inputSize - offset - sizeof(header) < header.size) {
+			// Room for the rest of it
+			input.resize(std::max(input.size(), inputSize + header.size + sizeof(header)));
+			break;
+		}
+
+		numApplied += Apply(header.type, header.sequence, input.data() + offset + sizeof(header), header.size);
+		offset += sizeof(header) + header.size;
+	}
+
+	std::memmove(input.data(), input.data() + offset, inputSize - offset);
+	inputSize -= offset;
+	return numApplied;
+}
+
+bool Replica::IsPrimaryGone() const {
+	return primaryGone;
+}
+
+uint64_t Replica::GetSequence() const {
+	return sequence;
+}
+
+uint64_t Replica::GetNumCheckpoints() const {
+	return numCheckpoints;
+}
+
+bool Replica::Apply(uint32_t type, uint64_t recordSequence, const char* payload, size_t size) {
+	if (type == checkpointRecord) {
+		// Of the state after the input with the same sequence
+		uint32_t stateHash;
+		if (!config.stateHash || recordSequence != sequence || size != sizeof(stateHash)) {
+			return false;
+		}
+		std::memcpy(&stateHash, payload, sizeof(stateHash));
+		if (config.stateHash(tradingEngine) != stateHash) {
+			throw Error(Error::Type::ReplicaDiverged, "The state differs from the primary's");
+		}
+		++numCheckpoints;
+		return false;
+	}
+
+	if (recordSequence <= sequence) {
+		return false;
+	} else if (recordSequence != sequence + 1) {
+		throw Error(Error::Type::ReplicaDiverged, "An input is missing");
+	}
+
+	uint32_t checksum;
+	Message message;
+	if (type != inputRecord || size < sizeof(checksum) || !DecodeRaw(std::string_view(payload + sizeof(checksum), size - sizeof(checksum)), &message)) {
+		throw Error(Error::Type::ReplicaDiverged, "Not a replication stream");
+	}
+	std::memcpy(&checksum, payload, sizeof(checksum));
+
+	output.clear();
+	tradingEngine.Process(message, &output);
+	sequence = recordSequence;
+	if (OutputChecksum(output.data(), output.size()) != checksum) {
+		throw Error(Error::Type::ReplicaDiverged, "An input's output differs from the primary's");
+	}
+	return true;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Message.h"
+#include "TradingEngine.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A hot standby: the primary sends each sequenced input to a replica, which applies it to its
+// own engine. The engine is deterministic given its input (order and trade ids only come from
+// the order things are processed in), so the replica stays identical and can take over as soon
+// as the primary goes, without restoring a snapshot and replaying the journal.
+//
+// Every input is sent with a checksum of the output it gave on the primary, so the replica
+// notices at once if an input did something different. Every checkpointInterval inputs the
+// primary also sends its state hash, which catches any difference the output didn't show. Both
+// engines have to start from the same state, either empty or the same snapshot.
+//
+// The stream goes over a connected stream socket, i.e one end of ps::CreateSocketPair() each for
+// a forked replica, or a Unix domain socket for a replica started separately.
+struct ReplicationConfig {
+	// i.e &TradingEngine::GetStateHash, the same on both ends. There are no checkpoints without one.
+	std::function<uint32_t(TradingEngine&)> stateHash;
+	uint64_t checkpointInterval = 10000; // Inputs between state hashes
+
+	// Flushed but not yet written to the socket, beyond which Flush() waits for the replica
+	size_t maxQueuedBytes = 64 * 1024 * 1024;
+};
+
+// The primary's end. Only use it from the engine's thread, the socket is written by a thread of
+// its own so the engine doesn't wait for the replica.
+class ReplicationSender {
+public:
+	// fd is blocking and stays owned by the caller (until Wait() has returned, or the sender is
+	// destroyed). lastSequence is of the last input the engine has processed (i.e the journal's),
+	// so the sequences carry on from it.
+	ReplicationSender(int fd, const ReplicationConfig& config, uint64_t lastSequence = 0);
+	ReplicationSender(const ReplicationSender&) = delete;
+	ReplicationSender& operator=(const ReplicationSender&) = delete;
+	~ReplicationSender(); // Sends everything flushed
+
+	// Processes the input with the engine, appending the output, and queues it for the replica.
+	// Returns the input's sequence.
+	uint64_t Process(TradingEngine& tradingEngine, const Message& message, std::vector<Message>* output);
+
+	// Hands everything queued to the sending thread, i.e once per batch. Only waits if the replica
+	// is so far behind that more than config.maxQueuedBytes are waiting to be sent. Throws
+	// Error::Type::ReplicationFailed if the replica has gone.
+	void Flush();
+
+	// Waits until everything flushed has been sent, throws as Flush()
+	void Wait();
+
+	uint64_t GetSequence() const;
+
+private:
+	int fd;
+	ReplicationConfig config;
+	uint64_t sequence;
+	std::string buffer;
+
+	// Everything below is shared with the sending thread
+	std::mutex mutex;
+	std::condition_variable queuedChanged;
+	std::string queued;
+	size_t numUnsent = 0; // Queued, or being written
+	bool failed = false;
+	bool stopping = false;
+	std::thread sendThread;
+
+	char* Append(uint32_t type, size_t size);
+	void Send();
+};
+
+// The standby's end. Only use it from one thread.
+class Replica {
+public:
+	// fd stays owned by the caller. lastSequence is of the last input already in the engine
+	// (i.e from a snapshot), anything the primary sends up to it is skipped.
+	Replica(TradingEngine& tradingEngine, int fd, const ReplicationConfig& config, uint64_t lastSequence = 0);
+
+	// Applies everything which has arrived, waiting up to timeout for something. Returns the
+	// number of inputs applied. Throws Error::Type::ReplicaDiverged if an input is missing or the
+	// output or state hash differs from the primary's, after which the replica can't take over.
+	size_t Poll(std::chrono::milliseconds timeout);
+
+	// Whether the primary has closed the stream (or exited). Everything it sent has been
+	// applied, so the engine is ready to take over from GetSequence().
+	bool IsPrimaryGone() const;
+
+	// Of the last input applied
+	uint64_t GetSequence() const;
+
+	// State hashes which matched the primary's
+	uint64_t GetNumCheckpoints() const;
+
+private:
+	TradingEngine& tradingEngine;
+	int fd;
+	ReplicationConfig config;
+	uint64_t sequence;
+	uint64_t numCheckpoints = 0;
+	bool primaryGone = false;
+
+	std::vector<char> input;
+	size_t inputSize = 0;
+	std::vector<Message> output;
+
+	// Returns whether it was an input which was applied
+	bool Apply(uint32_t type, uint64_t recordSequence, const char* payload, size_t size);
+};
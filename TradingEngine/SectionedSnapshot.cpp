@@ -0,0 +1,201 @@
+#include "SectionedSnapshot.h"
+
+#include "Error.h"
+#include "PlatformSpecific/segment_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+namespace {
+constexpr char magic[8] = { 'W', 'T', 'E', 'S', 'E', 'C', 'T', '\0' };
+constexpr uint32_t formatVersion = 4;
+
+struct Header {
+	char magic[8];
+	uint32_t formatVersion;
+	uint64_t deltaSequence;
+	uint64_t numSections;
+};
+
+struct IndexEntry {
+	uint8_t type;
+	int32_t coinId;
+	int32_t baseId;
+	uint32_t stateHash;
+	uint64_t offset;
+	uint64_t size;
+	uint64_t numUserIds;
+};
+
+template <class T>
+void Write(std::ofstream& file, const T& t) {
+	file.write(reinterpret_cast<const char*>(&t), sizeof(T));
+}
+
+// Returns false if there isn't enough left
+template <class T>
+bool Read(const std::vector<char>& buffer, size_t* position, T* t) {
+	if (buffer.size() - *position < sizeof(T)) {
+		return false;
+	}
+
+	std::memcpy(t, buffer.data() + *position, sizeof(T));
+	*position += sizeof(T);
+	return true;
+}
+}
+
+void WriteSectionedSnapshot(const std::string& path, uint64_t deltaSequence, const std::vector<SnapshotSection>& sections) {
+	auto tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			throw Error(Error::Type::SnapshotFailed, "Could not write the snapshot");
+		}
+
+		Header header{};
+		std::copy(std::begin(magic), std::end(magic), header.magic);
+		header.formatVersion = formatVersion;
+		header.deltaSequence = deltaSequence;
+		header.numSections = sections.size();
+		Write(file, header);
+
+		uint64_t offset = 0;
+		for (const auto& section : sections) {
+			IndexEntry entry{};
+			entry.type = static_cast<uint8_t>(section.type);
+			entry.coinId = section.coinId;
+			entry.baseId = section.baseId;
+			entry.stateHash = section.stateHash;
+			entry.offset = offset;
+			entry.size = section.data.size();
+			entry.numUserIds = section.userIds.size();
+			Write(file, entry);
+			offset += entry.size;
+		}
+
+		for (const auto& section : sections) {
+			file.write(reinterpret_cast<const char*>(section.userIds.data()), section.userIds.size() * sizeof(int32_t));
+		}
+
+		for (const auto& section : sections) {
+			file.write(section.data.data(), section.data.size());
+		}
+
+		file.flush();
+		if (!file) {
+			throw Error(Error::Type::SnapshotFailed, "Could not write the snapshot");
+		}
+	}
+
+	// Same as BackgroundSnapshot, the old one is only replaced by one which is all on disk
+	if (!ps::SyncFile(tempPath) || std::rename(tempPath.c_str(), path.c_str()) != 0 || !ps::SyncDirectory(path)) {
+		throw Error(Error::Type::SnapshotFailed, "Could not write the snapshot");
+	}
+}
+
+void ReadSectionedSnapshot(const std::string& path, SectionedSnapshot* snapshot) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) {
+		throw Error(Error::Type::SnapshotFailed, "Could not open the snapshot");
+	}
+
+	auto& buffer = snapshot->buffer;
+	buffer.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	if (!file.read(buffer.data(), buffer.size())) {
+		throw Error(Error::Type::SnapshotFailed, "Could not read the snapshot");
+	}
+
+	size_t position = 0;
+	Header header;
+	if (!Read(buffer, &position, &header) || !std::equal(std::begin(magic), std::end(magic), header.magic)
+	|| header.formatVersion != formatVersion) {
+		throw Error(Error::Type::SnapshotFailed, "Not a sectioned snapshot");
+	}
+
+	if (header.numSections > (buffer.size() - position) / sizeof(IndexEntry)) {
+		throw Error(Error::Type::SnapshotFailed, "The snapshot index is truncated");
+	}
+
+	std::vector<IndexEntry> entries(header.numSections);
+	for (auto& entry : entries) {
+		Read(buffer, &position, &entry);
+	}
+
+	std::vector<std::vector<int32_t>> userIds(entries.size());
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (entries[i].numUserIds > (buffer.size() - position) / sizeof(int32_t)) {
+			throw Error(Error::Type::SnapshotFailed, "The snapshot index is truncated");
+		}
+
+		userIds[i].resize(entries[i].numUserIds);
+		std::memcpy(userIds[i].data(), buffer.data() + position, userIds[i].size() * sizeof(int32_t));
+		position += userIds[i].size() * sizeof(int32_t);
+	}
+
+	auto dataSize = buffer.size() - position;
+	snapshot->deltaSequence = header.deltaSequence;
+	snapshot->sections.clear();
+	snapshot->sections.reserve(entries.size());
+	for (size_t i = 0; i < entries.size(); ++i) {
+		const auto& entry = entries[i];
+		if (entry.type > static_cast<uint8_t>(SnapshotSection::Type::UserFeeTiers) || entry.offset > dataSize
+		|| entry.size > dataSize - entry.offset) {
+			throw Error(Error::Type::SnapshotFailed, "The snapshot index is invalid");
+		}
+
+		SnapshotSection section;
+		section.type = static_cast<SnapshotSection::Type>(entry.type);
+		section.coinId = entry.coinId;
+		section.baseId = entry.baseId;
+		section.stateHash = entry.stateHash;
+		section.data = std::string_view(buffer.data() + position + entry.offset, entry.size);
+		section.userIds = std::move(userIds[i]);
+		snapshot->sections.push_back(std::move(section));
+	}
+}
+
+void RunInParallel(size_t numTasks, unsigned numThreads, const std::function<void(size_t)>& task) {
+	if (numThreads == 0) {
+		numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	numThreads = static_cast<unsigned>(std::min<size_t>(numThreads, numTasks));
+
+	std::atomic<size_t> nextTask{ 0 };
+	std::exception_ptr firstException;
+	std::mutex exceptionMutex;
+	auto worker = [&]() {
+		for (auto i = nextTask++; i < numTasks; i = nextTask++) {
+			try {
+				task(i);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(exceptionMutex);
+				if (!firstException) {
+					firstException = std::current_exception();
+				}
+			}
+		}
+	};
+
+	// This thread does its share too
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < numThreads; ++i) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	if (firstException) {
+		std::rethrow_exception(firstException);
+	}
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+#include "NodePool.h"
+#include "TradingEngine.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A full snapshot split into sections, an archive per wallet and per market (followed by its fee
+// schedule) and one of the user fee tiers, behind an index of where each one is. Unlike a single
+// archive of the TradingEngine the sections can be decoded independently, so a restore can
+// rebuild the order maps on every core rather than one.
+//
+// Layout (native byte order, it is only meant to be read back by the same build):
+//   header  magic, format version, delta sequence, number of sections
+//   index   per section: type, coin id, base id, state hash, offset and size of its data, number
+//           of users
+//   users   per market section, the ids of the users with orders in it
+//   data    the archives, offsets are from the start of the data
+//
+// See TradingEngine::SaveSections(), LoadSections() and LoadSectionsLazily().
+
+struct SnapshotSection {
+	enum class Type : uint8_t {
+		Wallet,
+		Market,
+		UserFeeTiers
+	};
+
+	Type type = Type::Wallet;
+	int32_t coinId = 0;
+	int32_t baseId = 0; // Markets only
+	uint32_t stateHash = 0; // Markets only, their part of TradingEngine::GetStateHash()
+	std::string_view data; // Into whatever it was written from or read into
+
+	// Markets only, so a lazy load knows which markets a user has orders in before decoding them
+	std::vector<int32_t> userIds;
+};
+
+struct SectionedSnapshot {
+	uint64_t deltaSequence = 0;
+	std::vector<SnapshotSection> sections;
+	std::vector<char> buffer; // The file, which the sections point into
+};
+
+// Written next to it and renamed into place once complete.
+// Throws Error::Type::SnapshotFailed if it can't be written.
+void WriteSectionedSnapshot(const std::string& path, uint64_t deltaSequence, const std::vector<SnapshotSection>& sections);
+
+// Reads the whole file in one go, throws Error::Type::SnapshotFailed if it is missing or malformed
+void ReadSectionedSnapshot(const std::string& path, SectionedSnapshot* snapshot);
+
+// Calls task(0) ... task(numTasks - 1) spread across the threads (0 is one per core), returning
+// once all of them have finished. The first exception thrown by a task is rethrown.
+void RunInParallel(size_t numTasks, unsigned numThreads, const std::function<void(size_t)>& task);
+
+// Lets an archive read a section where it is, rather than copying it into a stringstream
+class SectionBuffer : public std::streambuf {
+public:
+	explicit SectionBuffer(std::string_view data) {
+		auto begin = const_cast<char*>(data.data());
+		setg(begin, begin, begin + data.size());
+	}
+};
+
+template <class IArchive, class T>
+void DecodeSection(const SnapshotSection& section, T* t) {
+	SectionBuffer buffer(section.data);
+	std::istream stream(&buffer);
+	IArchive archive(stream);
+	archive >> *t;
+}
+
+template <class OArchive, class T>
+std::string EncodeSection(const T& t) {
+	std::ostringstream stream;
+	{
+		OArchive archive(stream);
+		archive << t;
+	}
+	return stream.str();
+}
+
+// The market's own archive doesn't have its fee schedule, so it follows in the same section
+template <class IArchive>
+void DecodeMarketSection(const SnapshotSection& section, Market* market) {
+	SectionBuffer buffer(section.data);
+	std::istream stream(&buffer);
+	IArchive archive(stream);
+	archive >> *market;
+
+	FeeSchedule feeSchedule;
+	archive >> feeSchedule;
+	market->SetFeeSchedule(feeSchedule);
+}
+
+template <class OArchive>
+std::string EncodeMarketSection(const Market& market) {
+	std::ostringstream stream;
+	{
+		OArchive archive(stream);
+		archive << market;
+		archive << market.GetFeeSchedule();
+	}
+	return stream.str();
+}
+
+template <class OArchive>
+void TradingEngine::SaveSections(const std::string& path, unsigned numThreads) {
+	marketManager.HydrateAll();
+
+	std::vector<SnapshotSection> sections;
+	std::vector<std::function<std::string(SnapshotSection*)>> encoders;
+	for (const auto& wallet : walletManager.GetWallets()) {
+		sections.push_back({ SnapshotSection::Type::Wallet, wallet.GetCoinId(), 0, 0, {} });
+		encoders.emplace_back([&wallet](SnapshotSection*) { return EncodeSection<OArchive>(wallet); });
+	}
+
+	for (const auto& markets : marketManager.GetMarkets()) {
+		for (const auto& market : markets.second) {
+			const auto& coinPair = market.GetCoinPair();
+			sections.push_back({ SnapshotSection::Type::Market, coinPair.GetCoinId(), coinPair.GetBaseId(), 0, {} });
+			for (const auto& userOrders : market.GetUserOrderMap()) {
+				sections.back().userIds.push_back(userOrders.first);
+			}
+			std::sort(sections.back().userIds.begin(), sections.back().userIds.end());
+			encoders.emplace_back([&market](SnapshotSection* section) {
+				section->stateHash = HashMarket(market);
+				return EncodeMarketSection<OArchive>(market);
+			});
+		}
+	}
+
+	sections.push_back({ SnapshotSection::Type::UserFeeTiers, 0, 0, 0, {} });
+	encoders.emplace_back([this](SnapshotSection*) { return EncodeSection<OArchive>(marketManager.GetUserFeeTiers()); });
+
+	// Encoding (and hashing) only reads the markets and wallets, so any of them can be done on any thread
+	std::vector<std::string> encoded(sections.size());
+	RunInParallel(sections.size(), numThreads, [&encoded, &encoders, &sections](size_t i) {
+		encoded[i] = encoders[i](&sections[i]);
+	});
+
+	for (size_t i = 0; i < sections.size(); ++i) {
+		sections[i].data = encoded[i];
+	}
+
+	WriteSectionedSnapshot(path, deltaSequence, sections);
+}
+
+template <class IArchive>
+void TradingEngine::LoadSections(const std::string& path, unsigned numThreads) {
+	SectionedSnapshot snapshot;
+	ReadSectionedSnapshot(path, &snapshot);
+
+	// A task per wallet, and one per base coin for its markets. Those share a shard (see
+	// MarketManager), which is scoped to the task so its nodes are allocated where they will stay.
+	struct Task {
+		std::vector<const SnapshotSection*> sections;
+		PoolShard* poolShard = nullptr; // Only for markets
+		std::vector<Wallet> wallets;
+		std::vector<Market> markets;
+	};
+
+	std::vector<Task> tasks;
+	std::map<int32_t, size_t> baseTasks;
+	for (const auto& section : snapshot.sections) {
+		if (section.type == SnapshotSection::Type::Wallet) {
+			tasks.emplace_back().sections.push_back(&section);
+			continue;
+		} else if (section.type == SnapshotSection::Type::UserFeeTiers) {
+			UserFeeTiers userFeeTiers;
+			DecodeSection<IArchive>(section, &userFeeTiers);
+			marketManager.SetUserFeeTiers(userFeeTiers);
+			continue;
+		}
+
+		auto it = baseTasks.find(section.baseId);
+		if (it == baseTasks.end()) {
+			it = baseTasks.emplace(section.baseId, tasks.size()).first;
+			tasks.emplace_back().poolShard = &marketManager.GetPoolShard(section.baseId);
+		}
+		tasks[it->second].sections.push_back(&section);
+	}
+
+	RunInParallel(tasks.size(), numThreads, [&tasks](size_t i) {
+		auto& task = tasks[i];
+		if (!task.poolShard) {
+			for (auto section : task.sections) {
+				DecodeSection<IArchive>(*section, &task.wallets.emplace_back());
+			}
+			return;
+		}
+
+		ScopedPoolShard scopedPoolShard(*task.poolShard);
+		for (auto section : task.sections) {
+			DecodeMarketSection<IArchive>(*section, &task.markets.emplace_back());
+		}
+	});
+
+	// The order maps are already in their shards, so adding them only moves the books
+	for (auto& task : tasks) {
+		for (auto& wallet : task.wallets) {
+			walletManager.AddWallet(std::move(wallet));
+		}
+		for (auto& market : task.markets) {
+			marketManager.AddMarket(std::move(market));
+		}
+	}
+
+	deltaSequence = snapshot.deltaSequence;
+}
+
+template <class IArchive>
+void TradingEngine::LoadSectionsLazily(const std::string& path, const std::vector<CoinPair>& warmUpOrder, unsigned numThreads) {
+	// Kept alive by the loaders until every market has been hydrated
+	auto snapshot = std::make_shared<SectionedSnapshot>();
+	ReadSectionedSnapshot(path, snapshot.get());
+
+	std::vector<const SnapshotSection*> walletSections;
+	for (const auto& section : snapshot->sections) {
+		if (section.type == SnapshotSection::Type::Wallet) {
+			walletSections.push_back(&section);
+			continue;
+		} else if (section.type == SnapshotSection::Type::UserFeeTiers) {
+			UserFeeTiers userFeeTiers;
+			DecodeSection<IArchive>(section, &userFeeTiers);
+			marketManager.SetUserFeeTiers(userFeeTiers);
+			continue;
+		}
+
+		marketManager.RegisterMarket({ section.coinId, section.baseId }, [snapshot, &section](Market* market) {
+			DecodeMarketSection<IArchive>(section, market);
+		},
+		section.userIds, section.stateHash);
+	}
+
+	std::vector<Wallet> wallets(walletSections.size());
+	RunInParallel(walletSections.size(), numThreads, [&wallets, &walletSections](size_t i) {
+		DecodeSection<IArchive>(*walletSections[i], &wallets[i]);
+	});
+
+	for (auto& wallet : wallets) {
+		walletManager.AddWallet(std::move(wallet));
+	}
+
+	deltaSequence = snapshot->deltaSequence;
+	marketManager.StartWarmUp(warmUpOrder);
+}
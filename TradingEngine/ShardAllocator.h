@@ -0,0 +1,102 @@
+#pragma once
+
+#include "NodePool.h"
+
+#include <cstddef>
+#include <type_traits>
+
+// Node counts for everything allocated through the allocators pointing at it
+struct PoolUsage {
+	size_t numNodes = 0;
+	size_t bytes = 0;
+};
+
+// Allocator for node based containers which takes nodes from the NodePool of a shard, so
+// nothing is reserved until a node is needed and markets in the same shard share slabs.
+// It is cheap to copy, the default constructed one uses PoolShard::GetDefault().
+template <typename T>
+class ShardAllocator {
+public:
+	using value_type = T;
+
+	using propagate_on_container_copy_assignment = std::false_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	ShardAllocator() noexcept :
+	ShardAllocator(PoolShard::GetDefault()) {
+	}
+
+	explicit ShardAllocator(PoolShard& shard, PoolUsage* usage = nullptr) noexcept :
+	shard(&shard),
+	usage(usage) {
+	}
+
+	template <typename U>
+	ShardAllocator(const ShardAllocator<U>& other) noexcept :
+	shard(other.GetShard()),
+	usage(other.GetUsage()) {
+	}
+
+	// A copied container is not part of the same market, so it isn't counted in its usage
+	ShardAllocator select_on_container_copy_construction() const {
+		return ShardAllocator(*shard);
+	}
+
+	T* allocate(size_t numToAllocate) {
+		if (numToAllocate != 1) {
+			return static_cast<T*>(::operator new(sizeof(T) * numToAllocate));
+		}
+
+		auto& nodePool = GetPool();
+		if (usage) {
+			++usage->numNodes;
+			usage->bytes += nodePool.GetNodeSize();
+		}
+		return static_cast<T*>(nodePool.Allocate());
+	}
+
+	void deallocate(T* ptr, size_t numToFree) {
+		if (numToFree != 1) {
+			::operator delete(ptr);
+			return;
+		}
+
+		if (usage) {
+			--usage->numNodes;
+			usage->bytes -= GetPool().GetNodeSize();
+		}
+		NodePool::Deallocate(ptr);
+	}
+
+	PoolShard* GetShard() const noexcept {
+		return shard;
+	}
+
+	PoolUsage* GetUsage() const noexcept {
+		return usage;
+	}
+
+private:
+	PoolShard* shard;
+	PoolUsage* usage;
+	NodePool* pool = nullptr; // Looked up on first use
+
+	NodePool& GetPool() {
+		if (!pool) {
+			pool = &shard->GetPool(sizeof(T), alignof(T));
+		}
+		return *pool;
+	}
+};
+
+// Nodes can be returned through any of them, but they must agree on whose usage they count in
+template <class T, class U>
+bool operator==(const ShardAllocator<T>& x, const ShardAllocator<U>& y) noexcept {
+	return x.GetShard() == y.GetShard() && x.GetUsage() == y.GetUsage();
+}
+
+template <class T, class U>
+bool operator!=(const ShardAllocator<T>& x, const ShardAllocator<U>& y) noexcept {
+	return !(x == y);
+}
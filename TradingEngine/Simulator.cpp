@@ -1,8 +1,8 @@
 #include "Simulator.h"
 
 void Simulator::AddTrade(int32_t buyUserId, int32_t sellUserId, int64_t amount, int64_t price,
-const Fee& fees) {
-	trades.emplace_back(buyUserId, sellUserId, amount, price, fees);
+const Fee& fees, int64_t makerInOrder) {
+	trades.emplace_back(buyUserId, sellUserId, amount, price, fees, makerInOrder);
 }
 
 const std::vector<SimulatorTrade>& Simulator::GetTrades() const {
@@ -37,7 +37,7 @@ void Simulator::IncrementNumTriggeredStopOrders() {
 	++numTriggeredStopOrders;
 }
 
-int Simulator::GetNumTriggeredStopOrders() const {
+size_t Simulator::GetNumTriggeredStopOrders() const {
 	return numTriggeredStopOrders;
 }
 
@@ -45,10 +45,18 @@ void Simulator::IncrementNumLimitOrdersToRemove() {
 	++numLimitOrdersToRemove;
 }
 
-int Simulator::GetNumLimitOrdersToRemove() const {
+size_t Simulator::GetNumLimitOrdersToRemove() const {
 	return numLimitOrdersToRemove;
 }
 
+void Simulator::SetNextLimitOrder(PriceLevelQueue<LimitOrder>::const_iterator nextLimitOrder) {
+	this->nextLimitOrder = nextLimitOrder;
+}
+
+PriceLevelQueue<LimitOrder>::const_iterator Simulator::GetNextLimitOrder() const {
+	return nextLimitOrder;
+}
+
 void Simulator::SetLastFill(int64_t lastFill) {
 	this->lastFill = lastFill;
 }
@@ -95,4 +103,5 @@ void Simulator::Clear() {
 
 	lastFill = 0;
 	numLimitOrdersToRemove = 0;
+	nextLimitOrder = {};
 }
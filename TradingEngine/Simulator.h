@@ -1,8 +1,11 @@
 #pragma once
 
+#include "Orders/LimitOrder.h"
 #include "Orders/StopLimitOrder.h"
+#include "PriceLevelQueue.h"
 #include "SimulatorTrade.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <map>
 #include <memory>
@@ -23,7 +26,8 @@ struct PriceStopLimitOrder {
 
 class Simulator {
 public:
-	void AddTrade(int32_t buyUserId, int32_t sellUserId, int64_t amount, int64_t price, const Fee& fees);
+	void AddTrade(int32_t buyUserId, int32_t sellUserId, int64_t amount, int64_t price, const Fee& fees,
+	int64_t makerInOrder);
 	const std::vector<SimulatorTrade>& GetTrades() const;
 	void Clear();
 
@@ -35,12 +39,17 @@ public:
 	void IncrementTradeId();
 	int64_t GetCurrentTradeId() const;
 
-	int GetNumTriggeredStopOrders() const;
+	size_t GetNumTriggeredStopOrders() const;
 	void IncrementNumTriggeredStopOrders();
 
-	int GetNumLimitOrdersToRemove() const;
+	size_t GetNumLimitOrdersToRemove() const;
 	void IncrementNumLimitOrdersToRemove();
 
+	// Where the last order to stop part way through a level did so, the next one carries on from
+	// there rather than stepping over what was consumed (see Market::ConsumeOrderBook)
+	void SetNextLimitOrder(PriceLevelQueue<LimitOrder>::const_iterator nextLimitOrder);
+	PriceLevelQueue<LimitOrder>::const_iterator GetNextLimitOrder() const;
+
 	void SetLastFill(int64_t lastFill);
 	int64_t GetLastFill();
 
@@ -62,8 +71,9 @@ private:
 	PriceStopLimitOrder insertedStopLimitOrder; // Should at max be one...
 	std::vector<SimulatorTrade> trades;
 
-	int numTriggeredStopOrders = 0;
+	size_t numTriggeredStopOrders = 0;
 
 	int64_t lastFill = 0;
-	int numLimitOrdersToRemove = 0;
+	size_t numLimitOrdersToRemove = 0;
+	PriceLevelQueue<LimitOrder>::const_iterator nextLimitOrder;
 };
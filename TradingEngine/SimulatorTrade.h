@@ -10,13 +10,15 @@ struct SimulatorTrade {
 	int64_t amount;
 	int64_t price;
 	Fee fees;
+	int64_t makerInOrder; // Released from the resting order's in order (and the book's reservations)
 
 	SimulatorTrade(int32_t buyUserId, int32_t sellUserId, int64_t amount, int64_t price,
-	const Fee& fees) :
+	const Fee& fees, int64_t makerInOrder) :
 	buyUserId(buyUserId),
 	sellUserId(sellUserId),
 	amount(amount),
 	price(price),
-	fees(fees) {
+	fees(fees),
+	makerInOrder(makerInOrder) {
 	}
 };
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Error.h"
+#include "PlatformSpecific/segment_file.h"
+#include "SnapshotDelta.h"
+#include "TradingEngine.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Compacting a delta chain (see SnapshotDelta.h), with the archive types the snapshots were
+// written with, e.g CompactSnapshots<boost::archive::binary_iarchive, boost::archive::binary_oarchive>.
+// The output is written next to it, synced to disk and renamed into place once complete.
+
+template <class IArchive, class T>
+void LoadSnapshot(const std::string& path, T* t) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		throw Error(Error::Type::SnapshotFailed, "Could not open the snapshot");
+	}
+
+	IArchive archive(file);
+	archive >> *t;
+}
+
+template <class OArchive, class T>
+void SaveSnapshot(const std::string& path, const T& t) {
+	auto tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			throw Error(Error::Type::SnapshotFailed, "Could not write the snapshot");
+		}
+
+		// Some archives only finish writing when they are destroyed
+		{
+			OArchive archive(file);
+			archive << t;
+		}
+		file.close();
+		if (!file) {
+			throw Error(Error::Type::SnapshotFailed, "Could not write the snapshot");
+		}
+	}
+
+	// Same as BackgroundSnapshot, the old one is only replaced by one which is all on disk
+	if (!ps::SyncFile(tempPath) || std::rename(tempPath.c_str(), path.c_str()) != 0 || !ps::SyncDirectory(path)) {
+		throw Error(Error::Type::SnapshotFailed, "Could not write the snapshot");
+	}
+}
+
+// Applies the deltas, in order, to the full snapshot and writes the result as a new full
+// snapshot. Later deltas chain onto it just as they would have onto the last delta.
+template <class IArchive, class OArchive>
+void CompactSnapshots(const std::string& basePath, const std::vector<std::string>& deltaPaths,
+const std::string& outputPath) {
+	TradingEngine tradingEngine;
+	LoadSnapshot<IArchive>(basePath, &tradingEngine);
+
+	for (const auto& deltaPath : deltaPaths) {
+		SnapshotDelta delta;
+		LoadSnapshot<IArchive>(deltaPath, &delta);
+		tradingEngine.ApplyDelta(delta);
+	}
+
+	SaveSnapshot<OArchive>(outputPath, tradingEngine);
+}
+
+// Merges consecutive deltas into one, without needing the (much larger) full snapshot
+template <class IArchive, class OArchive>
+void MergeDeltas(const std::vector<std::string>& deltaPaths, const std::string& outputPath) {
+	SnapshotDelta mergedDelta;
+	for (size_t i = 0; i < deltaPaths.size(); ++i) {
+		SnapshotDelta delta;
+		LoadSnapshot<IArchive>(deltaPaths[i], &delta);
+		if (i == 0) {
+			mergedDelta = std::move(delta);
+		} else {
+			mergedDelta.Merge(std::move(delta));
+		}
+	}
+
+	SaveSnapshot<OArchive>(outputPath, mergedDelta);
+}
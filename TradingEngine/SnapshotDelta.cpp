@@ -0,0 +1,53 @@
+#include "SnapshotDelta.h"
+
+#include "Error.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+void SnapshotDelta::Merge(SnapshotDelta&& delta) {
+	if (delta.baseSequence != sequence) {
+		throw Error(Error::Type::SnapshotFailed, "Deltas have to be merged in the order they were taken");
+	}
+
+	sequence = delta.sequence;
+
+	for (auto& walletDelta : delta.wallets) {
+		auto it = std::find_if(wallets.begin(), wallets.end(), [coinId = walletDelta.coinId](const auto& walletDelta) {
+			return (walletDelta.coinId == coinId);
+		});
+
+		if (it == wallets.end()) {
+			wallets.push_back(std::move(walletDelta));
+			continue;
+		}
+
+		// Both are sorted, set_union takes the later one of any which are in both
+		std::vector<Address> addresses;
+		addresses.reserve(it->addresses.size() + walletDelta.addresses.size());
+		std::set_union(walletDelta.addresses.begin(), walletDelta.addresses.end(),
+		it->addresses.begin(), it->addresses.end(), std::back_inserter(addresses),
+		[](const Address& lhs, const Address& rhs) {
+			return (lhs.GetUserId() < rhs.GetUserId());
+		});
+
+		it->addresses = std::move(addresses);
+	}
+
+	for (auto& market : delta.markets) {
+		auto it = std::find_if(markets.begin(), markets.end(), [&market](const auto& existingMarket) {
+			return (existingMarket.GetCoinPair() == market.GetCoinPair());
+		});
+
+		if (it == markets.end()) {
+			markets.push_back(std::move(market));
+		} else {
+			*it = std::move(market);
+		}
+	}
+
+	if (delta.userFeeTiers) {
+		userFeeTiers = std::move(delta.userFeeTiers);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Market.h"
+#include "WalletManager.h"
+
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// What changed since the snapshot before it (a full one, or another delta), so checkpoints only
+// write the markets and addresses which were touched rather than everything. Deltas form a chain
+// through their sequences: a delta can only be applied to, or merged into, the snapshot whose
+// sequence is its baseSequence. See TradingEngine::TakeDelta() and SnapshotCompactor.h.
+struct SnapshotDelta {
+	uint64_t baseSequence = 0;
+	uint64_t sequence = 0;
+
+	// There's one for every wallet, even without any changes, so new wallets are created
+	std::vector<WalletDelta> wallets;
+
+	// Complete copies of the markets which changed, including new ones
+	std::vector<Market> markets;
+
+	// The whole table, only if any user's fee tier changed
+	std::optional<UserFeeTiers> userFeeTiers;
+
+	// Folds the delta which follows this one into it, only the latest of anything is kept
+	void Merge(SnapshotDelta&& delta);
+};
+
+namespace boost::serialization {
+
+template <class Archive>
+void serialize(Archive& ar, SnapshotDelta& snapshotDelta, const unsigned int version) {
+	ar& snapshotDelta.baseSequence;
+	ar& snapshotDelta.sequence;
+	ar& snapshotDelta.wallets;
+	ar& snapshotDelta.markets;
+
+	// The markets' archives don't have their fee schedules
+	if (version > 0) {
+		for (auto& market : snapshotDelta.markets) {
+			auto feeSchedule = market.GetFeeSchedule();
+			ar& feeSchedule;
+			if constexpr (Archive::is_loading::value) {
+				market.SetFeeSchedule(feeSchedule);
+			}
+		}
+
+		auto hasUserFeeTiers = snapshotDelta.userFeeTiers.has_value();
+		ar& hasUserFeeTiers;
+		if (hasUserFeeTiers) {
+			if constexpr (Archive::is_loading::value) {
+				snapshotDelta.userFeeTiers.emplace();
+			}
+			ar& snapshotDelta.userFeeTiers.value();
+		}
+	}
+}
+}
+
+BOOST_CLASS_VERSION(SnapshotDelta, 1)
@@ -0,0 +1,369 @@
+#include "SocketGateway.h"
+
+#include "Error.h"
+#include "MessageCodec.h"
+#include "PlatformSpecific/timestamp.h"
+#include "TradingEngine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+namespace {
+constexpr size_t maxNumEvents = 64;
+constexpr size_t readSize = 64 * 1024; // Room made in a connection's input before each read
+constexpr uint64_t listenUserData = 0; // Connections are their id + 1
+}
+
+SocketGateway::SocketGateway(TradingEngine& tradingEngine, const SocketGatewayConfig& config) :
+tradingEngine(tradingEngine),
+config(config) {
+	if (!eventPoll.IsAvailable()) {
+		throw Error(Error::Type::GatewayFailed, "epoll isn't available");
+	}
+
+	listenFd = ps::ListenUnixSocket(config.path, 128);
+	if (listenFd == -1) {
+		throw Error(Error::Type::GatewayFailed, "Could not listen on the socket");
+	}
+	if (!eventPoll.Add(listenFd, listenUserData, false)) {
+		ps::CloseSocket(listenFd);
+		ps::RemoveUnixSocket(config.path);
+		throw Error(Error::Type::GatewayFailed, "Could not poll the socket");
+	}
+	connections.reserve(config.maxNumConnections);
+}
+
+SocketGateway::~SocketGateway() {
+	for (size_t connectionId = 0; connectionId < connections.size(); ++connectionId) {
+		if (connections[connectionId]) {
+			Close(connectionId);
+		}
+	}
+	ps::CloseSocket(listenFd);
+	ps::RemoveUnixSocket(config.path);
+}
+
+size_t SocketGateway::Poll(std::chrono::milliseconds timeout) {
+	ps::EventPoll::Event events[maxNumEvents];
+	auto numEvents = eventPoll.Wait(events, maxNumEvents, timeout);
+	if (numEvents == 0) {
+		return 0;
+	}
+
+	auto start = ps::ReadTimestamp();
+	++stats.numWakeups;
+	readyConnections.clear();
+	for (size_t i = 0; i < numEvents; ++i) {
+		if (events[i].userData == listenUserData) {
+			Accept();
+			continue;
+		}
+
+		auto connectionId = events[i].userData - 1;
+		if (events[i].readable) {
+			Read(connectionId, events[i].closed);
+			readyConnections.push_back(connectionId);
+		} else if (events[i].writable && !connections[connectionId]->pendingOutput.empty()) {
+			// Room for what didn't fit before
+			Write(connectionId);
+			auto& connection = *connections[connectionId];
+			if (connection.closing || connection.peerClosed) {
+				Close(connectionId);
+			}
+		}
+	}
+
+	// One batch for everything which arrived together, whichever connection it came on
+	for (auto connectionId : readyConnections) {
+		Parse(connectionId);
+	}
+	auto numRequests = requests.size();
+	if (numRequests > 0) {
+		ProcessBatch();
+	}
+
+	for (auto connectionId : readyConnections) {
+		auto& connection = *connections[connectionId];
+		if (!connection.pieces.empty() && !connection.closing && !connection.peerClosed) {
+			Write(connectionId);
+		}
+
+		// Keep the start of a frame which hasn't all arrived yet
+		std::memmove(connection.input.data(), connection.input.data() + connection.inputParsed, connection.inputSize - connection.inputParsed);
+		connection.inputSize -= connection.inputParsed;
+		connection.inputParsed = 0;
+
+		if (connection.closing || connection.peerClosed) {
+			Close(connectionId);
+		}
+	}
+
+	if (numRequests > 0) {
+		stats.batchLatency.Record(ps::ReadTimestamp() - start);
+	}
+	return numRequests;
+}
+
+void SocketGateway::Run(const std::atomic<bool>& stop) {
+	while (!stop.load(std::memory_order_relaxed)) {
+		Poll(std::chrono::milliseconds(100));
+	}
+}
+
+size_t SocketGateway::GetNumConnections() const {
+	return numConnections;
+}
+
+const SocketGatewayStats& SocketGateway::GetStats() const {
+	return stats;
+}
+
+void SocketGateway::Accept() {
+	// Edge-triggered, so everything waiting is accepted now
+	int fd;
+	while ((fd = ps::AcceptUnixSocket(listenFd)) != -1) {
+		if (numConnections == config.maxNumConnections) {
+			ps::CloseSocket(fd);
+			continue;
+		}
+
+		auto slot = std::find(connections.begin(), connections.end(), nullptr);
+		auto connectionId = static_cast<size_t>(slot - connections.begin());
+		if (slot == connections.end()) {
+			connections.emplace_back();
+		}
+
+		// Anything which arrived before it was added still wakes the next Poll()
+		if (!eventPoll.Add(fd, connectionId + 1, true)) {
+			ps::CloseSocket(fd);
+			continue;
+		}
+		connections[connectionId] = std::make_unique<Connection>();
+		connections[connectionId]->fd = fd;
+		++numConnections;
+	}
+}
+
+void SocketGateway::Read(size_t connectionId, bool closed) {
+	auto& connection = *connections[connectionId];
+	while (true) {
+		if (connection.input.size() - connection.inputSize < readSize) {
+			connection.input.resize(std::max(connection.input.size() * 2, connection.inputSize + readSize));
+		}
+
+		auto space = connection.input.size() - connection.inputSize;
+		auto numRead = ps::ReadSocket(connection.fd, connection.input.data() + connection.inputSize, space);
+		if (numRead == ps::socketWouldBlock) {
+			return;
+		} else if (numRead == 0) {
+			connection.peerClosed = true;
+			return;
+		}
+
+		// A stream socket only reads short once it has been drained, which saves the read which
+		// would find nothing. Unless it has closed, as there won't be another event for that.
+		connection.inputSize += static_cast<size_t>(numRead);
+		if (static_cast<size_t>(numRead) < space && !closed) {
+			return;
+		}
+	}
+}
+
+void SocketGateway::Parse(size_t connectionId) {
+	auto& connection = *connections[connectionId];
+	auto offset = connection.inputParsed;
+	GatewayFrameHeader header;
+	while (connection.inputSize - offset >= sizeof(header)) {
+		std::memcpy(&header, connection.input.data() + offset, sizeof(header));
+		if (header.size > config.maxFrameSize) {
+			connection.closing = true;
+			++stats.numDisconnects;
+			return;
+		}
+		if (connection.inputSize - offset - sizeof(header) < header.size) {
+			break;
+		}
+
+		requests.push_back({ connectionId, offset + sizeof(header), header.size });
+		offset += sizeof(header) + header.size;
+	}
+	connection.inputParsed = offset;
+}
+
+void SocketGateway::ProcessBatch() {
+	++stats.numBatches;
+	stats.numRequests += requests.size();
+	stats.maxBatchSize = std::max<uint64_t>(stats.maxBatchSize, requests.size());
+
+	output.clear();
+	headers.clear();
+	encoded.clear();
+	Message message;
+	for (const auto& request : requests) {
+		auto& connection = *connections[request.connectionId];
+		if (connection.closing) {
+			continue;
+		}
+		if (!DecodeRaw(std::string_view(connection.input.data() + request.offset, request.size), &message)) {
+			connection.closing = true;
+			++stats.numDisconnects;
+			continue;
+		}
+
+		// The output is only referred to until it's written, as the vector can still grow
+		auto begin = output.size();
+		tradingEngine.Process(message, &output);
+		auto end = output.size();
+		if (connection.peerClosed) {
+			continue;
+		}
+
+		if (begin == end) {
+			connection.pieces.push_back({ static_cast<uint32_t>(headers.size()), -1, 0 });
+			headers.push_back({ 0, gatewayEndOfResponse });
+			continue;
+		}
+		for (auto i = begin; i < end; ++i) {
+			auto size = GetRawSize(output[i]);
+			connection.pieces.push_back({ static_cast<uint32_t>(headers.size()), static_cast<int64_t>(i), 0 });
+			headers.push_back({ static_cast<uint32_t>(size), (i + 1 == end) ? gatewayEndOfResponse : 0 });
+
+			// The attachment only lives until the next request, so those are encoded now
+			if (size != sizeof(Message)) {
+				connection.pieces.back().outputIndex = -1;
+				connection.pieces.back().encodedOffset = encoded.size();
+				encoded.resize(encoded.size() + size);
+				EncodeRaw(output[i], &encoded[encoded.size() - size]);
+			}
+		}
+	}
+	requests.clear();
+}
+
+void SocketGateway::Write(size_t connectionId) {
+	auto& connection = *connections[connectionId];
+	slices.clear();
+	if (!connection.pendingOutput.empty()) {
+		slices.push_back({ connection.pendingOutput.data(), connection.pendingOutput.size() });
+	}
+	for (const auto& piece : connection.pieces) {
+		const auto& header = headers[piece.header];
+		slices.push_back({ &header, sizeof(header) });
+		if (piece.outputIndex >= 0) {
+			slices.push_back({ &output[piece.outputIndex], sizeof(Message) });
+		} else if (header.size > 0) {
+			slices.push_back({ encoded.data() + piece.encodedOffset, header.size });
+		}
+	}
+	connection.pieces.clear();
+
+	size_t first = 0;
+	while (first < slices.size()) {
+		auto numWritten = ps::WriteSocket(connection.fd, &slices[first], slices.size() - first);
+		++stats.numWrites;
+		if (numWritten == ps::socketWouldBlock) {
+			break;
+		} else if (numWritten == 0) {
+			connection.peerClosed = true;
+			connection.pendingOutput.clear();
+			return;
+		}
+
+		for (; first < slices.size() && static_cast<size_t>(numWritten) >= slices[first].size; ++first) {
+			numWritten -= slices[first].size;
+		}
+		if (first < slices.size()) {
+			slices[first].data = static_cast<const char*>(slices[first].data) + numWritten;
+			slices[first].size -= numWritten;
+		}
+	}
+
+	// Copied, as the output is reused by the next batch. Written on the next writable event.
+	std::string remainder;
+	for (auto i = first; i < slices.size(); ++i) {
+		remainder.append(static_cast<const char*>(slices[i].data), slices[i].size);
+	}
+	connection.pendingOutput.swap(remainder);
+	if (connection.pendingOutput.size() > config.maxPendingOutput) {
+		connection.closing = true;
+		++stats.numDisconnects;
+	}
+}
+
+void SocketGateway::Close(size_t connectionId) {
+	auto fd = connections[connectionId]->fd;
+	eventPoll.Remove(fd);
+	ps::CloseSocket(fd);
+	connections[connectionId].reset();
+	--numConnections;
+}
+
+SocketGatewayClient::SocketGatewayClient(const std::string& path) :
+fd(ps::ConnectUnixSocket(path)) {
+	if (fd == -1) {
+		throw Error(Error::Type::GatewayFailed, "Could not connect to the gateway");
+	}
+}
+
+SocketGatewayClient::~SocketGatewayClient() {
+	ps::CloseSocket(fd);
+}
+
+void SocketGatewayClient::Send(const Message& message) {
+	GatewayFrameHeader header{ static_cast<uint32_t>(GetRawSize(message)), 0 };
+	buffer.resize(sizeof(header) + header.size);
+	std::memcpy(&buffer[0], &header, sizeof(header));
+	EncodeRaw(message, &buffer[sizeof(header)]);
+	SendRaw(buffer.data(), buffer.size());
+}
+
+void SocketGatewayClient::SendRaw(const void* data, size_t size) {
+	ps::IoSlice slice{ data, size };
+	while (slice.size > 0) {
+		auto numWritten = ps::WriteSocket(fd, &slice, 1);
+		if (numWritten <= 0) {
+			throw Error(Error::Type::GatewayFailed, "The gateway closed the connection");
+		}
+		slice.data = static_cast<const char*>(slice.data) + numWritten;
+		slice.size -= static_cast<size_t>(numWritten);
+	}
+}
+
+bool SocketGatewayClient::Receive(std::vector<Message>* responses, std::chrono::milliseconds timeout) {
+	responses->clear();
+	if (!ps::WaitReadable(fd, timeout)) {
+		return false;
+	}
+
+	GatewayFrameHeader header;
+	do {
+		ReadExactly(&header, sizeof(header));
+		buffer.resize(header.size);
+		ReadExactly(&buffer[0], header.size);
+		if (header.size > 0) {
+			responses->emplace_back();
+			if (!DecodeRaw(buffer, &responses->back())) {
+				throw Error(Error::Type::GatewayFailed, "Not a message from the gateway");
+			}
+		}
+	} while ((header.flags & gatewayEndOfResponse) == 0);
+	return true;
+}
+
+bool SocketGatewayClient::Call(const Message& message, std::vector<Message>* responses, std::chrono::milliseconds timeout) {
+	Send(message);
+	return Receive(responses, timeout);
+}
+
+void SocketGatewayClient::ReadExactly(void* data, size_t size) {
+	auto out = static_cast<char*>(data);
+	while (size > 0) {
+		auto numRead = ps::ReadSocket(fd, out, size);
+		if (numRead <= 0) {
+			throw Error(Error::Type::GatewayFailed, "The gateway closed the connection");
+		}
+		out += numRead;
+		size -= static_cast<size_t>(numRead);
+	}
+}
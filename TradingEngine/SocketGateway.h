@@ -0,0 +1,149 @@
+#pragma once
+
+#include "LatencyHistogram.h"
+#include "Message.h"
+#include "PlatformSpecific/unix_socket.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class TradingEngine;
+
+// The protocol over the socket is frames of a header and then size bytes of one message in the
+// raw format (see MessageCodec.h), with its attachment. Each request gets the frames of its
+// output messages back in order, the last one flagged gatewayEndOfResponse. A request without
+// any output gets one empty frame with the flag.
+struct GatewayFrameHeader {
+	uint32_t size;
+	uint32_t flags;
+};
+
+constexpr uint32_t gatewayEndOfResponse = 1;
+
+struct SocketGatewayConfig {
+	std::string path; // Of the Unix domain socket, replacing a socket left there
+	size_t maxNumConnections = 64;
+	size_t maxFrameSize = 64 * 1024; // A client sending a bigger one is disconnected
+	size_t maxPendingOutput = 4 * 1024 * 1024; // Response bytes the socket hasn't taken before the client is disconnected
+};
+
+struct SocketGatewayStats {
+	uint64_t numWakeups = 0;
+	uint64_t numBatches = 0; // Wakeups with requests in
+	uint64_t numRequests = 0;
+	uint64_t maxBatchSize = 0;
+	uint64_t numWrites = 0;
+	uint64_t numDisconnects = 0; // By the gateway, for breaking the protocol or not reading
+
+	// Timestamp ticks (see ps::ReadTimestamp()) from the wakeup until every response to the batch is
+	// written
+	LatencyHistogram batchLatency;
+};
+
+// A reference gateway for clients which can't use IpcTransport.h. It waits on every connection
+// with one edge-triggered epoll and, for each wakeup, reads everything each ready connection
+// has, processes all the complete requests with the engine as one batch and writes each
+// connection's responses with one writev(), gathered straight from the engine's output. Only one
+// thread uses it, only supported on Linux.
+class SocketGateway {
+public:
+	// Listens on config.path. Throws Error::Type::GatewayFailed if it can't.
+	SocketGateway(TradingEngine& tradingEngine, const SocketGatewayConfig& config);
+	~SocketGateway(); // Closes every connection and removes the path
+
+	SocketGateway(const SocketGateway&) = delete;
+	SocketGateway& operator=(const SocketGateway&) = delete;
+
+	// Handles one wakeup, waiting up to timeout for it. Returns the number of requests processed.
+	size_t Poll(std::chrono::milliseconds timeout);
+
+	// Polls until stop is set
+	void Run(const std::atomic<bool>& stop);
+
+	size_t GetNumConnections() const;
+	const SocketGatewayStats& GetStats() const;
+
+private:
+	struct Piece {
+		uint32_t header; // Index into headers
+		int64_t outputIndex; // The message in output, or -1 when it is in encoded (or there's none)
+		size_t encodedOffset;
+	};
+
+	struct Connection {
+		int fd = -1;
+		std::vector<char> input;
+		size_t inputSize = 0; // What has been read into input
+		size_t inputParsed = 0; // Of which was complete frames, for this batch
+		std::string pendingOutput; // What the socket didn't take last time
+		std::vector<Piece> pieces; // Of this batch's responses
+		bool closing = false; // Once the batch is done
+		bool peerClosed = false;
+	};
+
+	struct Request {
+		size_t connectionId;
+		size_t offset; // Of the payload in the connection's input
+		size_t size;
+	};
+
+	TradingEngine& tradingEngine;
+	SocketGatewayConfig config;
+	SocketGatewayStats stats;
+	ps::EventPoll eventPoll;
+	int listenFd = -1;
+	std::vector<std::unique_ptr<Connection>> connections; // Free slots are nullptr
+	size_t numConnections = 0;
+
+	// Reused for every batch
+	std::vector<size_t> readyConnections;
+	std::vector<Request> requests;
+	std::vector<Message> output;
+	std::vector<GatewayFrameHeader> headers;
+	std::string encoded; // Output messages with attachments, in the raw format
+	std::vector<ps::IoSlice> slices;
+
+	void Accept();
+	void Read(size_t connectionId, bool closed);
+	void Parse(size_t connectionId);
+	void ProcessBatch();
+	void Write(size_t connectionId);
+	void Close(size_t connectionId);
+};
+
+// A blocking client of a SocketGateway, for tools and tests
+class SocketGatewayClient {
+public:
+	// Throws Error::Type::GatewayFailed if nothing is listening at path
+	explicit SocketGatewayClient(const std::string& path);
+	~SocketGatewayClient();
+
+	SocketGatewayClient(const SocketGatewayClient&) = delete;
+	SocketGatewayClient& operator=(const SocketGatewayClient&) = delete;
+
+	// Throws Error::Type::GatewayFailed if the gateway has closed the connection
+	void Send(const Message& message);
+
+	// Sends the frame as it is, for testing what the gateway makes of it
+	void SendRaw(const void* data, size_t size);
+
+	// The response to the oldest request not yet received, in place of what was in responses.
+	// The attachment of the last one is in Message::cancelOrders/massQuote. Returns false if
+	// nothing arrived within the timeout. Throws Error::Type::GatewayFailed if the gateway has
+	// closed the connection.
+	bool Receive(std::vector<Message>* responses, std::chrono::milliseconds timeout);
+
+	// Send() then Receive()
+	bool Call(const Message& message, std::vector<Message>* responses, std::chrono::milliseconds timeout);
+
+private:
+	int fd = -1;
+	std::string buffer;
+
+	void ReadExactly(void* data, size_t size);
+};
@@ -3,7 +3,9 @@
 #include "Address.h"
 #include "CoinPair.h"
 #include "Error.h"
+#include "EventRing.h"
 #include "FatalError.h"
+#include "LatencyStats.h"
 #include "Fee.h"
 #include "Listener/Listener.h"
 #include "Listener/ListenerOrder.h"
@@ -12,30 +14,124 @@
 #include "MessageType.h"
 #include "Orders/OrderAction.h"
 #include "Orders/OrderType.h"
+#include "Orders/orders.h"
+#include "PlatformSpecific/crc32c.h"
 #include "market_helper.h"
 
 #include <algorithm>
+#include <initializer_list>
 #include <iostream>
 #include <iterator>
 #include <memory>
 #include <sstream>
+#include <type_traits>
+#include <vector>
+
+namespace {
+uint32_t HashValues(std::initializer_list<int64_t> values, uint32_t crc) {
+	return ps::Crc32c(values.begin(), values.size() * sizeof(int64_t), crc);
+}
+
+// The maps are sorted and each level is in time order, so they're the same on every engine
+template <class OrderMap>
+uint32_t HashOrders(const OrderMap& orderMap, uint32_t crc) {
+	crc = HashValues({ static_cast<int64_t>(orderMap.size()) }, crc);
+	for (const auto& [price, orders] : orderMap) {
+		crc = HashValues({ price, static_cast<int64_t>(orders.size()) }, crc);
+		for (const auto& order : orders) {
+			crc = HashValues({ order.GetId(), order.GetUserId(), order.GetAmount(), order.GetFilled() }, crc);
+			if constexpr (std::is_same_v<std::decay_t<decltype(order)>, StopLimitOrder>) {
+				crc = HashValues({ order.GetActualPrice() }, crc);
+			}
+		}
+	}
+	return crc;
+}
+
+uint32_t HashPriceOrderIds(const std::vector<PriceOrderId>& priceOrderIds, uint32_t crc) {
+	crc = HashValues({ static_cast<int64_t>(priceOrderIds.size()) }, crc);
+	for (const auto& priceOrderId : priceOrderIds) {
+		crc = HashValues({ priceOrderId.price, priceOrderId.orderId }, crc);
+	}
+	return crc;
+}
+
+uint32_t HashFeeSchedule(const FeeSchedule& feeSchedule, uint32_t crc) {
+	for (const auto& tier : feeSchedule.GetTiers()) {
+		crc = HashValues({ tier.maker.GetDivisor(), tier.taker.GetDivisor() }, crc);
+	}
+	return crc;
+}
+}
+
+uint32_t TradingEngine::HashMarket(const Market& market) {
+	const auto& config = market.GetConfig();
+	auto crc = HashValues({ market.GetCoinPair().GetCoinId(), market.GetCoinPair().GetBaseId(),
+	market.GetCurrentOrderId(), market.GetCurrentTradeId(), config.feeDivision, config.maxNumLimitOpenOrders,
+	config.maxNumStopLimitOpenOrders }, 0);
+	crc = HashOrders(market.GetBuyLimitOrderMap(), crc);
+	crc = HashOrders(market.GetSellLimitOrderMap(), crc);
+	crc = HashOrders(market.GetBuyStopLimitOrderMap(), crc);
+	crc = HashOrders(market.GetSellStopLimitOrderMap(), crc);
+	crc = HashValues({ market.GetReservations().buy, market.GetReservations().sell }, crc);
+	crc = HashFeeSchedule(market.GetFeeSchedule(), crc);
+
+	// In user id order rather than however they are in the map
+	const auto& userOrderMap = market.GetUserOrderMap();
+	std::vector<int32_t> userIds;
+	userIds.reserve(userOrderMap.size());
+	for (const auto& userOrders : userOrderMap) {
+		userIds.push_back(userOrders.first);
+	}
+	std::sort(userIds.begin(), userIds.end());
+	for (auto userId : userIds) {
+		const auto& userOrders = userOrderMap.at(userId);
+		crc = HashValues({ userId }, crc);
+		crc = HashPriceOrderIds(userOrders.buyLimitPrices, crc);
+		crc = HashPriceOrderIds(userOrders.sellLimitPrices, crc);
+		crc = HashPriceOrderIds(userOrders.buyStopLimitPrices, crc);
+		crc = HashPriceOrderIds(userOrders.sellStopLimitPrices, crc);
+	}
+	return crc;
+}
 
 // Process a message and return a vector of output messages
 std::vector<Message> TradingEngine::Process(const Message& message) {
+	// Declared first so the returned messages are included
+	ALLOCATION_COUNTER(&allocationStats, message.messageType);
 	std::vector<Message> messages;
+	ProcessMessage(message, &messages);
+	return messages;
+}
 
+void TradingEngine::Process(const Message& message, std::vector<Message>* messages) {
+	ALLOCATION_COUNTER(&allocationStats, message.messageType);
+	ProcessMessage(message, messages);
+}
+
+size_t TradingEngine::Process(const Message& message, EventRing* ring) {
+	ALLOCATION_COUNTER(&allocationStats, message.messageType);
+	output.clear();
+	ProcessMessage(message, &output);
+	ring->Publish(output.data(), output.size());
+	return output.size();
+}
+
+// Appends the output messages
+void TradingEngine::ProcessMessage(const Message& message, std::vector<Message>* messages) {
+	auto numMessages = messages->size();
 	try {
 		switch (message.messageType) {
 			case MessageType::MarketOrder:
-				messages = ProcessOrder<MarketOrder>(message);
+				ProcessOrder<MarketOrder>(message, messages);
 				break;
 
 			case MessageType::LimitOrder:
-				messages = ProcessOrder<LimitOrder>(message);
+				ProcessOrder<LimitOrder>(message, messages);
 				break;
 
 			case MessageType::StopLimitOrder:
-				messages = ProcessOrder<StopLimitOrder>(message);
+				ProcessOrder<StopLimitOrder>(message, messages);
 				break;
 
 			case MessageType::CancelOrder:
@@ -46,8 +142,24 @@ std::vector<Message> TradingEngine::Process(const Message& message) {
 				}
 
 				if (message.fullUpdate) {
-					messages.push_back(message);
+					messages->push_back(message);
+				}
+				break;
+			case MessageType::AmendOrder:
+				if (static_cast<OrderType>(message.orderType) != OrderType::Limit) {
+					throw Error(Error::Type::InvalidAmend, "Only limit orders can be amended");
+				}
+
+				if (message.fullUpdate) {
+					messages->push_back(message);
 				}
+				AmendOrder(message, messages);
+				break;
+			case MessageType::MassQuote:
+				if (message.fullUpdate) {
+					messages->push_back(message);
+				}
+				ReplaceQuotes(message, messages);
 				break;
 			case MessageType::CancelAllOrders: {
 				auto allCancelledOrders = marketManager.CancelAll(message.userId, walletManager);
@@ -65,25 +177,25 @@ std::vector<Message> TradingEngine::Process(const Message& message) {
 				}
 
 				if (message.fullUpdate) {
-					messages.push_back(message);
+					messages->push_back(message);
 				}
 				break;
 			}
 			case MessageType::Deposit:
 				walletManager.GetWallet(message.coinId)->Deposit(message.userId, message.amount);
 				if (message.fullUpdate) {
-					messages.push_back(message);
+					messages->push_back(message);
 				}
 				break;
 			case MessageType::Withdraw:
 				walletManager.GetWallet(message.coinId)->Withdraw(message.userId, message.amount);
 				if (message.fullUpdate) {
-					messages.push_back(message);
+					messages->push_back(message);
 				}
 				break;
 			case MessageType::NewCoin:
 				walletManager.AddWallet({ message.coinId });
-				messages.push_back(message);
+				messages->push_back(message);
 				break;
 			case MessageType::NewMarket: {
 				CoinPair coinPair = { message.coinId, message.baseId };
@@ -93,7 +205,7 @@ std::vector<Message> TradingEngine::Process(const Message& message) {
 
 				Market market{ std::make_unique<Listener>(), coinPair, marketConfig };
 				marketManager.AddMarket(std::move(market));
-				messages.push_back(message);
+				messages->push_back(message);
 				break;
 			}
 
@@ -120,7 +232,7 @@ std::vector<Message> TradingEngine::Process(const Message& message) {
 				Message outputMessage;
 				auto address = walletManager.GetWallet(message.coinId)->GetAddress(message.userId);
 				outputMessage.amount = address->GetTotalBalance();
-				messages.push_back(outputMessage);
+				messages->push_back(outputMessage);
 				break;
 			}
 			case MessageType::GetAvailable: {
@@ -129,20 +241,20 @@ std::vector<Message> TradingEngine::Process(const Message& message) {
 				auto total = address->GetTotalBalance();
 				auto inOrder = address->GetInOrder();
 				outputMessage.amount = total - inOrder;
-				messages.push_back(outputMessage);
+				messages->push_back(outputMessage);
 				break;
 			}
 			case MessageType::GetInOrder: {
 				Message outputMessage;
 				auto address = walletManager.GetWallet(message.coinId)->GetAddress(message.userId);
 				outputMessage.amount = address->GetInOrder();
-				messages.push_back(outputMessage);
+				messages->push_back(outputMessage);
 				break;
 			}
 			case MessageType::GetTotal: {
 				Message outputMessage;
 				outputMessage.amount = walletManager.GetWallet(message.coinId)->GetTotal();
-				messages.push_back(outputMessage);
+				messages->push_back(outputMessage);
 				break;
 			}
 			case MessageType::ClearOpenOrders: {
@@ -185,13 +297,11 @@ std::vector<Message> TradingEngine::Process(const Message& message) {
 		}
 		// We do not handle FatalErrors here
 	} catch (const Error& error) { // These are expected errors
-		messages.clear(); // Should be empty already, but make sure..
+		messages->resize(numMessages); // Should be nothing to remove already, but make sure..
 		Message errorMessage = message;
 		errorMessage.errorCode = static_cast<int>(error.GetType());
-		messages.push_back(errorMessage);
+		messages->push_back(errorMessage);
 	}
-
-	return messages;
 }
 
 MarketWallets TradingEngine::GetMarketWallets(const Message& message) {
@@ -201,9 +311,7 @@ MarketWallets TradingEngine::GetMarketWallets(const Message& message) {
 }
 
 template <typename T>
-std::vector<Message> TradingEngine::ProcessOrder(const Message& message) {
-	std::vector<Message> messages;
-
+void TradingEngine::ProcessOrder(const Message& message, std::vector<Message>* messages) {
 	auto market = marketManager.GetMarket({ message.coinId, message.baseId });
 	auto marketWallets = GetMarketWallets(message);
 	auto order = CreateOrder<T>(message);
@@ -214,7 +322,18 @@ std::vector<Message> TradingEngine::ProcessOrder(const Message& message) {
 		market->NewProcess<OrderAction::Sell>(order, &marketWallets);
 	}
 
-	auto& listener = market->GetListener();
+	// Market orders never rest on the book
+	if constexpr (!IsMarketOrder_v<T>) {
+		marketManager.AddUserMarket(message.userId, market->GetCoinPair());
+	}
+
+	// Covers converting the listener operations to output messages
+	LATENCY_TIMER(market->GetLatencyStats(), GetOrderType<T>(), LatencyStage::Translate);
+	TranslateOperations(*market, messages);
+}
+
+void TradingEngine::TranslateOperations(const Market& market, std::vector<Message>* messages) {
+	auto& listener = market.GetListener();
 
 	const auto& operations = listener.GetOperations();
 	for (auto& operation : operations) {
@@ -231,11 +350,13 @@ std::vector<Message> TradingEngine::ProcessOrder(const Message& message) {
 				outputMessage.amount = operation.listenerOrder.amount;
 				outputMessage.price = operation.listenerOrder.price;
 				outputMessage.tradeId = operation.listenerOrder.tradeId;
+				outputMessage.buyFee = operation.listenerOrder.fees.buyFee;
+				outputMessage.sellFee = operation.listenerOrder.fees.sellFee;
 				break;
 			case Operation::Type::NewOpenOrder:
 				outputMessage.messageType = MessageType::NewOpenOrder;
-				outputMessage.coinId = market->GetCoinPair().GetCoinId();
-				outputMessage.baseId = market->GetCoinPair().GetBaseId();
+				outputMessage.coinId = market.GetCoinPair().GetCoinId();
+				outputMessage.baseId = market.GetCoinPair().GetBaseId();
 				outputMessage.userId = operation.listenerOrder.userId;
 				outputMessage.isBuy = (operation.action == OrderAction::Buy);
 				outputMessage.orderType = static_cast<int>(operation.listenerOrder.orderType);
@@ -246,8 +367,8 @@ std::vector<Message> TradingEngine::ProcessOrder(const Message& message) {
 				break;
 			case Operation::Type::NewFilledOrder:
 				outputMessage.messageType = MessageType::NewFilledOrder;
-				outputMessage.coinId = market->GetCoinPair().GetCoinId();
-				outputMessage.baseId = market->GetCoinPair().GetBaseId();
+				outputMessage.coinId = market.GetCoinPair().GetCoinId();
+				outputMessage.baseId = market.GetCoinPair().GetBaseId();
 				outputMessage.userId = operation.listenerOrder.userId;
 				outputMessage.isBuy = (operation.action == OrderAction::Buy);
 				outputMessage.orderType = static_cast<int>(operation.listenerOrder.orderType);
@@ -268,11 +389,10 @@ std::vector<Message> TradingEngine::ProcessOrder(const Message& message) {
 				throw Error(Error::Type::InvalidListenerOperation, "This operation is not supported");
 		}
 
-		messages.push_back(std::move(outputMessage));
+		messages->push_back(std::move(outputMessage));
 	}
 
 	listener.ClearOperations();
-	return messages;
 }
 
 template <typename Order>
@@ -293,6 +413,76 @@ void TradingEngine::CancelOrder(const Message& message) {
 	}
 }
 
+void TradingEngine::AmendOrder(const Message& message, std::vector<Message>* messages) {
+	auto market = marketManager.GetMarket({ message.coinId, message.baseId });
+	auto marketWallets = GetMarketWallets(message);
+
+	if (message.isBuy) {
+		market->AmendOrder<OrderAction::Buy>(message.orderId, message.price, message.newPrice,
+		message.amount, &marketWallets);
+	} else {
+		market->AmendOrder<OrderAction::Sell>(message.orderId, message.price, message.newPrice,
+		message.amount, &marketWallets);
+	}
+
+	// Moving it can trade
+	TranslateOperations(*market, messages);
+}
+
+// The ladder comes from Message::massQuote and the replaced orders go out in Message::cancelOrders
+void TradingEngine::ReplaceQuotes(const Message& message, std::vector<Message>* messages) {
+	auto market = marketManager.GetMarket({ message.coinId, message.baseId });
+	auto marketWallets = GetMarketWallets(message);
+
+	auto replacedIds = market->ReplaceQuotes(message.userId, Message::massQuote, &marketWallets);
+	marketManager.AddUserMarket(message.userId, market->GetCoinPair());
+
+	// Same format as CancelAllOrders
+	std::ostringstream ss;
+	for (auto id : replacedIds) {
+		ss << message.coinId << "_" << message.baseId << "_" << id << " ";
+	}
+
+	Message::cancelOrders = ss.str();
+	if (!Message::cancelOrders.empty()) {
+		Message::cancelOrders.erase(Message::cancelOrders.end() - 1); // Remove last space from string.
+	}
+
+	// A NewOpenOrder for each quote
+	TranslateOperations(*market, messages);
+}
+
+SnapshotDelta TradingEngine::TakeDelta() {
+	SnapshotDelta delta;
+	delta.baseSequence = deltaSequence;
+	delta.sequence = ++deltaSequence;
+	delta.wallets = walletManager.TakeModifiedAddresses();
+	delta.markets = marketManager.TakeModifiedMarkets();
+	delta.userFeeTiers = marketManager.TakeModifiedUserFeeTiers();
+	return delta;
+}
+
+void TradingEngine::ApplyDelta(const SnapshotDelta& delta) {
+	if (delta.baseSequence != deltaSequence) {
+		throw Error(Error::Type::SnapshotFailed, "The delta doesn't follow on from this snapshot");
+	}
+
+	walletManager.ApplyDelta(delta.wallets);
+	for (const auto& market : delta.markets) {
+		marketManager.SetMarket(Market(market));
+	}
+	if (delta.userFeeTiers) {
+		marketManager.SetUserFeeTiers(*delta.userFeeTiers);
+	}
+
+	deltaSequence = delta.sequence;
+}
+
+void TradingEngine::ClearModified() {
+	walletManager.ClearModified();
+	marketManager.ClearModified();
+}
+
 bool TradingEngine::operator==(const TradingEngine& TradingEngine) const {
 	return marketManager == TradingEngine.marketManager
 	&& walletManager == TradingEngine.walletManager;
@@ -313,3 +503,50 @@ template <>
 OrderContainer<MarketOrder> TradingEngine::CreateOrder(const Message& message) {
 	return OrderContainer<MarketOrder>({ message.userId, message.amount }, 0);
 }
+
+const AllocationStats& TradingEngine::GetAllocationStats() const {
+	return allocationStats;
+}
+
+void TradingEngine::ResetAllocationStats() {
+	allocationStats.Reset();
+}
+
+void TradingEngine::DumpLatencyStats(std::ostream& os) const {
+	marketManager.DumpLatencyStats(os);
+}
+
+uint32_t TradingEngine::GetStateHash() const {
+	// In coin pair order, the base coins are in an unordered map. The markets still pending from a
+	// lazy load haven't changed since their snapshot, so they have the hash it was saved with.
+	auto marketHashes = marketManager.GetPendingStateHashes();
+	for (const auto& baseMarkets : marketManager.GetMarkets()) {
+		for (const auto& market : baseMarkets.second) {
+			marketHashes.emplace_back(market.GetCoinPair(), HashMarket(market));
+		}
+	}
+	std::sort(marketHashes.begin(), marketHashes.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.first < rhs.first;
+	});
+
+	uint32_t crc = 0;
+	for (const auto& [coinPair, marketHash] : marketHashes) {
+		crc = HashValues({ coinPair.GetCoinId(), coinPair.GetBaseId(), marketHash }, crc);
+	}
+
+	// The wallets are sorted by coin id, and their addresses by user id
+	for (const auto& wallet : walletManager.GetWallets()) {
+		crc = HashValues({ wallet.GetCoinId(), static_cast<int64_t>(wallet.GetAddresses().size()) }, crc);
+		for (const auto& address : wallet.GetAddresses()) {
+			crc = HashValues({ address.GetUserId(), address.GetTotalBalance(), address.GetInOrder() }, crc);
+		}
+	}
+
+	const auto& userTiers = marketManager.GetUserFeeTiers().GetUserTiers();
+	crc = HashValues({ static_cast<int64_t>(userTiers.size()) }, crc);
+	return ps::Crc32c(userTiers.data(), userTiers.size(), crc);
+}
+
+bool TradingEngine::InOrderMatchesReservations() const {
+	return marketManager.InOrderMatchesReservations(walletManager);
+}
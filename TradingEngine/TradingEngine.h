@@ -1,15 +1,26 @@
 #pragma once
 
+#include "AllocationStats.h"
+#include "CoinPair.h"
 #include "MarketManager.h"
 #include "Message.h"
 #include "Orders/MarketOrder.h"
 #include "Orders/OrderContainer.h"
 #include "Orders/StopLimitOrder.h"
+#include "SnapshotDelta.h"
 #include "WalletManager.h"
 #include "serializer_defines.h"
 
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
 #include <vector>
 
+class EventRing;
 struct MarketWallets;
 
 SERIALIZE_HEADER(TradingEngine)
@@ -20,37 +31,143 @@ public:
 
 	TradingEngine() = default; // For serializing
 	std::vector<Message> Process(const Message& message);
+
+	// As above, appending the output messages to messages, which can be reused so nothing is
+	// allocated once the engine has warmed up
+	void Process(const Message& message, std::vector<Message>* messages);
+
+	// As above, except the output messages are published to the ring rather than returned, which
+	// doesn't allocate once the engine has warmed up. Returns how many were published.
+	size_t Process(const Message& message, EventRing* ring);
 	bool operator==(const TradingEngine& tradingEngine) const;
 
+	// A CRC32C of the order books, the users' orders, reservations, order/trade ids, config and
+	// fees of every market, the balances in every wallet and the users' fee tiers. It's the same
+	// for engines which started from the same state and processed the same input, however their
+	// markets and users were hashed into their maps (or loaded). Markets still pending from a lazy
+	// load aren't hydrated, their section has the hash they were saved with. Goes through every
+	// order, so only take it every so often.
+	uint32_t GetStateHash() const;
+
+	// Solvency check, see MarketManager::InOrderMatchesReservations
+	bool InOrderMatchesReservations() const;
+
+	// Per market stage timings, empty unless built with TRADING_ENGINE_LATENCY_STATS
+	void DumpLatencyStats(std::ostream& os) const;
+
+	// Allocations per input message type, empty unless built with TRADING_ENGINE_ALLOCATION_STATS
+	const AllocationStats& GetAllocationStats() const;
+	void ResetAllocationStats();
+
+	// The markets and addresses changed since the last delta (or ClearModified()), which follows
+	// on from it. Copying them is proportional to what changed rather than to the whole state.
+	SnapshotDelta TakeDelta();
+
+	// Throws Error::Type::SnapshotFailed if the delta doesn't follow on from this snapshot
+	void ApplyDelta(const SnapshotDelta& delta);
+
+	// Call once a full snapshot has been written (or loaded), so the next delta chains onto it
+	void ClearModified();
+
+	// A full snapshot with each wallet and market in its own section, encoded/decoded on numThreads
+	// threads (0 is one per core). Only load into an empty engine. Saving hydrates any markets
+	// still pending first. Defined in SectionedSnapshot.h.
+	template <class OArchive>
+	void SaveSections(const std::string& path, unsigned numThreads = 0);
+
+	template <class IArchive>
+	void LoadSections(const std::string& path, unsigned numThreads = 0);
+
+	// As LoadSections(), except the markets are only registered and their books are decoded on
+	// first use or by a warm-up thread, which goes through warmUpOrder (e.g the busiest markets)
+	// before the rest. Processing can start as soon as the wallets are loaded.
+	template <class IArchive>
+	void LoadSectionsLazily(const std::string& path, const std::vector<CoinPair>& warmUpOrder, unsigned numThreads = 0);
+
 	// Just for tests...
 	MarketManager& GetMarketManager() { return marketManager; }
 	WalletManager& GetWalletManager() { return walletManager; }
+	const WalletManager& GetWalletManager() const { return walletManager; }
 
 private:
 	MarketManager marketManager;
 	WalletManager walletManager;
+	AllocationStats allocationStats;
+
+	// Of the last delta taken or applied, full snapshots keep it so deltas can chain onto them
+	uint64_t deltaSequence = 0;
+
+	// Reused for the output of Process(message, ring)
+	std::vector<Message> output;
 
 	template <class T>
 	OrderContainer<T> CreateOrder(const Message& message);
 
 	MarketWallets GetMarketWallets(const Message& message);
 
+	void ProcessMessage(const Message& message, std::vector<Message>* messages);
+
 	template <typename T>
-	std::vector<Message> ProcessOrder(const Message& message);
+	void ProcessOrder(const Message& message, std::vector<Message>* messages);
 
 	template <typename Order>
 	void CancelOrder(const Message& message);
+
+	void AmendOrder(const Message& message, std::vector<Message>* messages);
+
+	void ReplaceQuotes(const Message& message, std::vector<Message>* messages);
+
+	// Converts the operations the market's listener has recorded to output messages
+	void TranslateOperations(const Market& market, std::vector<Message>* messages);
+
+	// Its part of GetStateHash(), which SaveSections() keeps in its section
+	static uint32_t HashMarket(const Market& market);
 };
 
 namespace boost::serialization {
 
 template <class Archive>
 void serialize(Archive& ar, TradingEngine& tradingEngine, const unsigned int version) {
+	// Markets still pending from a lazy load are only in the manager once they're hydrated
+	if constexpr (Archive::is_saving::value) {
+		tradingEngine.marketManager.HydrateAll();
+	}
 	ar& tradingEngine.marketManager;
+	if constexpr (Archive::is_loading::value) {
+		tradingEngine.marketManager.RebuildIndexes();
+	}
 	ar& tradingEngine.walletManager;
+	if constexpr (Archive::is_loading::value) {
+		tradingEngine.walletManager.BindWallets();
+	}
+	if (version > 0) {
+		ar& tradingEngine.deltaSequence;
+	}
+
+	// Not in the markets' archives, so after them
+	if (version > 1) {
+		MarketFeeSchedules feeSchedules;
+		if constexpr (Archive::is_saving::value) {
+			feeSchedules = tradingEngine.marketManager.GetFeeSchedules();
+		}
+		ar& feeSchedules;
+
+		UserFeeTiers userFeeTiers;
+		if constexpr (Archive::is_saving::value) {
+			userFeeTiers = tradingEngine.marketManager.GetUserFeeTiers();
+		}
+		ar& userFeeTiers;
+
+		if constexpr (Archive::is_loading::value) {
+			tradingEngine.marketManager.SetFeeSchedules(feeSchedules);
+			tradingEngine.marketManager.SetUserFeeTiers(userFeeTiers);
+		}
+	}
 }
 }
 
+BOOST_CLASS_VERSION(TradingEngine, 2)
+
 template <>
 OrderContainer<LimitOrder> TradingEngine::CreateOrder(const Message& message);
 
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "FixedPoint.h"
+
 #include <cstdint>
+#include <type_traits>
 
 // Convert without loss of precision from a double to a 64-bit integer.
 // Taken from https://en.bitcoin.it/wiki/Proper_Money_Handling_(JSON-RPC) for bitcoin
@@ -9,21 +12,18 @@
 // implicit primitive conversions in tests accidentally
 class Units {
 public:
+	// All amounts and prices in the engine use this
+	using Fixed = FixedPoint<100000000>;
+
 	// Only used with tests
 	template <class T>
 	static int64_t ExToIn(T value) {
 		static_assert(std::is_same_v<double, T>);
-		return static_cast<int64_t>(value * scale + 0.5);
+		return static_cast<int64_t>(value * Fixed::scale + 0.5);
 	}
 
-	// This takes the result of a multiplication between 2 scales integers,
-	// and reduces them by the desired scale
-	template <class T>
-	static int64_t ScaleDown(T doubleScaledInt) {
-		static_assert(std::is_same_v<T, int64_t>);
-		return doubleScaledInt / scale;
+	// Notional value of an amount at a price, exact and without overflowing in between
+	constexpr static int64_t Multiply(int64_t amount, int64_t price) {
+		return Fixed::Multiply(amount, price);
 	}
-
-private:
-	constexpr static double scale = 1e8;
 };
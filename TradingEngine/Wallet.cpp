@@ -5,7 +5,7 @@
 #include <algorithm>
 #include <boost/serialization/singleton.hpp>
 #include <iterator>
-#include <numeric>
+#include <utility>
 
 BOOST_CLASS_EXPORT_IMPLEMENT(Wallet)
 
@@ -16,6 +16,18 @@ coinId(coinId) {
 	}
 }
 
+Wallet::Wallet(const Wallet& wallet) :
+coinId(wallet.coinId),
+addresses(wallet.addresses) {
+	BindAddresses();
+}
+
+Wallet& Wallet::operator=(const Wallet& other) {
+	Wallet wallet(other); // Reuse copy constructor
+	*this = std::move(wallet); // Reuse move constructor
+	return *this;
+}
+
 std::vector<Address>::iterator Wallet::AddAddress(const Address& address) {
 	auto lb = findLbAddressFromUserId(address.GetUserId());
 	if (lb != addresses.end() && lb->GetUserId() == address.GetUserId()) {
@@ -23,9 +35,26 @@ std::vector<Address>::iterator Wallet::AddAddress(const Address& address) {
 	}
 
 	lb = addresses.insert(lb, address);
+	lb->SetTotals(totals.get());
+	lb->MarkModified();
+	totals->totalBalance += lb->GetTotalBalance();
+	totals->inOrder += lb->GetInOrder();
+	if (totals->allInOrder) {
+		*totals->allInOrder += lb->GetInOrder();
+	}
 	return lb;
 }
 
+void Wallet::SetAddress(const Address& address) {
+	auto lb = findLbAddressFromUserId(address.GetUserId());
+	if (lb == addresses.end() || lb->GetUserId() != address.GetUserId()) {
+		AddAddress(address);
+	} else {
+		lb->SetTotalBalance(address.GetTotalBalance());
+		lb->SetInOrder(address.GetInOrder());
+	}
+}
+
 std::vector<Address>::iterator Wallet::GetAddress(int32_t userId) {
 	auto lb = findLbAddressFromUserId(userId);
 	if (lb == addresses.end() || lb->GetUserId() != userId) {
@@ -54,13 +83,60 @@ void Wallet::Withdraw(int32_t userId, int64_t amount) {
 }
 
 int64_t Wallet::GetTotal() const {
-	// Loop over all addresses
-	int64_t total = std::accumulate(addresses.cbegin(), addresses.cend(), (int64_t)0,
-	[](int64_t amount, const Address& address) {
-		return address.GetTotalBalance() + amount;
-	});
+	return totals->totalBalance;
+}
+
+int64_t Wallet::GetTotalInOrder() const {
+	return totals->inOrder;
+}
+
+void Wallet::SetInOrderTotal(int64_t* allInOrder) {
+	if (totals->allInOrder) {
+		*totals->allInOrder -= totals->inOrder;
+	}
+
+	totals->allInOrder = allInOrder;
+	if (allInOrder) {
+		*allInOrder += totals->inOrder;
+	}
+}
+
+std::vector<Address> Wallet::TakeModifiedAddresses() {
+	auto& userIds = totals->modifiedUserIds;
+	std::sort(userIds.begin(), userIds.end());
+
+	std::vector<Address> modifiedAddresses;
+	modifiedAddresses.reserve(userIds.size());
+	for (auto userId : userIds) {
+		auto address = findLbAddressFromUserId(userId);
+		address->ClearModified();
+		modifiedAddresses.push_back(*address);
+	}
+
+	userIds.clear();
+	return modifiedAddresses;
+}
+
+void Wallet::ClearModified() {
+	for (auto userId : totals->modifiedUserIds) {
+		findLbAddressFromUserId(userId)->ClearModified();
+	}
+	totals->modifiedUserIds.clear();
+}
+
+// Attaches every address to the totals and recalculates them from scratch
+void Wallet::BindAddresses() {
+	auto allInOrder = totals->allInOrder;
+	SetInOrderTotal(nullptr);
+
+	*totals = AddressTotals();
+	for (auto& address : addresses) {
+		address.SetTotals(totals.get());
+		totals->totalBalance += address.GetTotalBalance();
+		totals->inOrder += address.GetInOrder();
+	}
 
-	return total;
+	SetInOrderTotal(allInOrder);
 }
 
 bool Wallet::Equals(const IWallet& inWallet) const {
@@ -11,6 +11,7 @@
 #include "serializer_defines.h"
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 SERIALIZE_HEADER(Wallet)
@@ -24,6 +25,11 @@ public:
 
 	Wallet() = default; // For serializing
 	Wallet(int32_t coinId);
+	Wallet(const Wallet& wallet);
+	Wallet& operator=(const Wallet& wallet);
+	Wallet(Wallet&& wallet) noexcept = default;
+	Wallet& operator=(Wallet&& wallet) noexcept = default;
+
 	std::vector<Address>::iterator AddAddress(const Address& address) override;
 	std::vector<Address>::iterator GetAddress(int32_t userId) override;
 	int32_t GetCoinId() const override;
@@ -33,6 +39,18 @@ public:
 
 	bool operator==(const Wallet& wallet) const;
 	int64_t GetTotal() const;
+	int64_t GetTotalInOrder() const;
+
+	// Keeps the total up to date with this wallet's in order, starting by adding what it has now.
+	// nullptr detaches it, taking it back out of the previous total.
+	void SetInOrderTotal(int64_t* allInOrder);
+
+	// Copies of the addresses changed (or added) since the last call, sorted by user id
+	std::vector<Address> TakeModifiedAddresses();
+	void ClearModified();
+
+	// Adds the address, or overwrites the balances of the one with the same user id
+	void SetAddress(const Address& address);
 
 	// Just for testing
 	const std::vector<Address>& GetAddresses() const;
@@ -43,7 +61,13 @@ private:
 	// This contains all the addresses for users, sorted by user id.
 	// Not everyone will have one until there has been a buy/sell requiring them to.
 	std::vector<Address> addresses;
+
+	// Kept up to date by the addresses themselves, so totals don't need to loop over every user.
+	// On the heap so that the addresses can point to it while the wallet moves around.
+	std::unique_ptr<AddressTotals> totals = std::make_unique<AddressTotals>();
+
 	std::vector<Address>::iterator findLbAddressFromUserId(int32_t userId);
+	void BindAddresses();
 };
 
 namespace boost::serialization {
@@ -54,6 +78,9 @@ void serialize(Archive& ar, Wallet& wallet, const unsigned int version) {
 
 	ar& wallet.addresses;
 	ar& wallet.coinId;
+
+	// Loaded addresses are copies, so they need attaching to the totals
+	wallet.BindAddresses();
 }
 }
 
@@ -4,15 +4,17 @@
 
 #include <algorithm>
 #include <iterator>
+#include <utility>
 
-void WalletManager::AddWallet(const Wallet& wallet) {
+void WalletManager::AddWallet(Wallet wallet) {
 	auto lb = findLbWalletFromCoinId(wallet.GetCoinId());
 	if (lb != wallets.end() && lb->GetCoinId() == wallet.GetCoinId()) {
 		throw Error(Error::Type::WalletAlreadyExists);
 	}
 
 	// Insert into sorted order
-	lb = wallets.insert(lb, wallet);
+	lb = wallets.insert(lb, std::move(wallet));
+	lb->SetInOrderTotal(totalInOrder.get());
 }
 
 std::vector<Wallet>::iterator WalletManager::GetWallet(int32_t coinId) {
@@ -27,6 +29,45 @@ bool WalletManager::AllWalletsEmpty() const {
 	return areEmpty;
 }
 
+int64_t WalletManager::GetTotalInOrder() const {
+	return *totalInOrder;
+}
+
+void WalletManager::BindWallets() {
+	for (auto& wallet : wallets) {
+		wallet.SetInOrderTotal(totalInOrder.get());
+	}
+}
+
+std::vector<WalletDelta> WalletManager::TakeModifiedAddresses() {
+	std::vector<WalletDelta> walletDeltas;
+	walletDeltas.reserve(wallets.size());
+	for (auto& wallet : wallets) {
+		walletDeltas.push_back({ wallet.GetCoinId(), wallet.TakeModifiedAddresses() });
+	}
+	return walletDeltas;
+}
+
+void WalletManager::ClearModified() {
+	for (auto& wallet : wallets) {
+		wallet.ClearModified();
+	}
+}
+
+void WalletManager::ApplyDelta(const std::vector<WalletDelta>& walletDeltas) {
+	for (const auto& walletDelta : walletDeltas) {
+		auto wallet = findLbWalletFromCoinId(walletDelta.coinId);
+		if (wallet == wallets.end() || wallet->GetCoinId() != walletDelta.coinId) {
+			wallet = wallets.insert(wallet, Wallet(walletDelta.coinId));
+			wallet->SetInOrderTotal(totalInOrder.get());
+		}
+
+		for (const auto& address : walletDelta.addresses) {
+			wallet->SetAddress(address);
+		}
+	}
+}
+
 std::vector<Wallet>::iterator WalletManager::findLbWalletFromCoinId(int32_t coinId) {
 	auto lb = std::lower_bound(wallets.begin(), wallets.end(), coinId,
 	[](const auto& wallet, int32_t coinId) {
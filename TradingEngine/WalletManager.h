@@ -4,26 +4,60 @@
 #include "serializer_defines.h"
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 SERIALIZE_HEADER(WalletManager)
 
+// The addresses of a wallet which changed, for delta snapshots (see SnapshotDelta.h)
+struct WalletDelta {
+	int32_t coinId = -1;
+	std::vector<Address> addresses; // Sorted by user id
+};
+
 class WalletManager {
 public:
 	SERIALIZE_FRIEND(WalletManager)
 
 	WalletManager() = default; // For serializing
-	void AddWallet(const Wallet& wallet);
+	void AddWallet(Wallet wallet);
 	std::vector<Wallet>::iterator GetWallet(int32_t coinId);
 	bool operator==(const WalletManager& walletManager) const;
 	int64_t GetTotal() const;
 	bool AllWalletsEmpty() const;
 
+	// In order summed over every wallet, kept up to date by the wallets
+	int64_t GetTotalInOrder() const;
+
+	// The total above isn't serialized, so the wallets are attached to it again once they have been
+	// deserialized (see serialize(TradingEngine))
+	void BindWallets();
+
+	// One for each wallet, with the addresses changed since the last call
+	std::vector<WalletDelta> TakeModifiedAddresses();
+	void ClearModified();
+
+	// Creates any wallets which don't exist yet
+	void ApplyDelta(const std::vector<WalletDelta>& walletDeltas);
+
 	// Just for testing
 	const std::vector<Wallet>& GetWallets() const;
 
 private:
 	// This contains a sorted collection of the wallets, by wallet id.
 	std::vector<Wallet> wallets;
+
+	// On the heap so that the wallets can point to it while the manager moves around
+	std::unique_ptr<int64_t> totalInOrder = std::make_unique<int64_t>(0);
+
 	std::vector<Wallet>::iterator findLbWalletFromCoinId(int32_t coinId);
 };
+
+namespace boost::serialization {
+
+template <class Archive>
+void serialize(Archive& ar, WalletDelta& walletDelta, const unsigned int version) {
+	ar& walletDelta.coinId;
+	ar& walletDelta.addresses;
+}
+}
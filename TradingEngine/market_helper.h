@@ -1,14 +1,15 @@
 #pragma once
 
 #include "Orders/StopLimitOrder.h"
-#include "PlatformSpecific/allocator_constants.h"
-#include "PoolAlloc.h"
-#include "SharedPoolAllocator.h"
+#include "Orders/orders.h"
+#include "PriceLevelQueue.h"
+#include "ShardAllocator.h"
 
 #include <cstdint>
 #include <deque>
 #include <functional>
 #include <map>
+#include <scoped_allocator>
 #include <unordered_map>
 #include <vector>
 
@@ -26,18 +27,28 @@ struct MarketConfig {
 	}
 };
 
+// What all the open orders on each side of the book hold, this is what the in order amounts of the
+// wallets should add up to.
+struct BookReservations {
+	int64_t buy = 0; // Held in the base wallet, the notional of what's left at each order's limit price
+	int64_t sell = 0; // Held in the coin wallet, the amount left to sell
+
+	bool operator==(const BookReservations& reservations) const {
+		return (buy == reservations.buy && sell == reservations.sell);
+	}
+};
+
 struct MarketWallets {
 	IWallet* coinWallet;
 	IWallet* baseWallet;
 };
 
-template <class Order, class Alloc>
-using BaseOrders = std::deque<Order, Alloc>;
-
 template <class Order>
-using Orders = BaseOrders<Order, SharedPoolAllocator<Order, ps::GetOrderDequeSize<Order>(), 64>>;
+using Orders = PriceLevelQueue<Order>;
 
-template <class Order, class Sort, class Alloc = PoolAlloc<std::pair<const int64_t, Orders<Order>>, 1024>>
+// The map hands its shard down to the queues it constructs, so a market's orders are in its shard too
+template <class Order, class Sort,
+class Alloc = std::scoped_allocator_adaptor<ShardAllocator<std::pair<const int64_t, Orders<Order>>>>>
 using OrderMap = std::map<int64_t, Orders<Order>, Sort, Alloc>;
 
 template <class Sort>
@@ -54,6 +65,10 @@ struct PriceOrderId {
 	int64_t price;
 	int64_t orderId;
 
+	// Where the order is in its price level (see PriceLevelQueue::GetHandle), nullHandle if it's
+	// not known yet (see Market::LinkUserOrders). Not part of its value.
+	NodePool::Handle handle = NodePool::nullHandle;
+
 	bool operator==(const PriceOrderId& priceOrderId) const {
 		return (price == priceOrderId.price && orderId == priceOrderId.orderId);
 	}
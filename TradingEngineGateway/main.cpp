@@ -0,0 +1,64 @@
+#include <TradingEngine/Error.h>
+#include <TradingEngine/SocketGateway.h>
+#include <TradingEngine/TradingEngine.h>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+
+// A reference gateway: a TradingEngine taking requests from local clients over a Unix domain
+// socket (see SocketGateway.h), until it is interrupted. Then it prints how it batched them and
+// the turnaround of each batch.
+
+namespace {
+std::atomic<bool> stop{ false };
+
+void Stop(int) {
+	stop = true;
+}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " <socket path> [max connections]\n";
+		return 1;
+	}
+
+	SocketGatewayConfig config;
+	config.path = argv[1];
+	if (argc > 2) {
+		config.maxNumConnections = std::strtoul(argv[2], nullptr, 10);
+	}
+
+	std::signal(SIGINT, Stop);
+	std::signal(SIGTERM, Stop);
+
+	TradingEngine tradingEngine;
+	try {
+		SocketGateway gateway(tradingEngine, config);
+		std::cout << "Listening on " << config.path << std::endl;
+		gateway.Run(stop);
+
+		const auto& stats = gateway.GetStats();
+		const auto& latency = stats.batchLatency;
+		std::cout << "wakeups=" << stats.numWakeups
+				  << " batches=" << stats.numBatches
+				  << " requests=" << stats.numRequests
+				  << " maxBatch=" << stats.maxBatchSize
+				  << " writes=" << stats.numWrites
+				  << " disconnects=" << stats.numDisconnects << "\n";
+		if (latency.GetCount() > 0) {
+			std::cout << "batch latency (ticks)"
+					  << " min=" << latency.GetMin()
+					  << " p50=" << latency.ValueAtPercentile(50.0)
+					  << " p99=" << latency.ValueAtPercentile(99.0)
+					  << " p99.9=" << latency.ValueAtPercentile(99.9)
+					  << " max=" << latency.GetMax() << "\n";
+		}
+		tradingEngine.DumpLatencyStats(std::cout);
+	} catch (const Error& error) {
+		std::cerr << error.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
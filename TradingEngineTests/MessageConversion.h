@@ -4,6 +4,7 @@
 #include <TradingEngine/CoinPair.h>
 #include <TradingEngine/Fee.h>
 #include <TradingEngine/MarketManager.h>
+#include <TradingEngine/Message.h>
 #include <TradingEngine/MessageType.h>
 #include <TradingEngine/Wallet.h>
 #include <TradingEngine/WalletManager.h>
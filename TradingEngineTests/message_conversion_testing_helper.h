@@ -44,12 +44,18 @@ inline int64_t GetOrderAmount() {
 	return Units::ExToIn(200.0);
 }
 
-inline int64_t GetInOrder() {
+// What the orders of CreateMarket hold in order. The sells hold their coins, the buys the notional at
+// their (actual) limit price: 200 * (0.5 + 0.4 + 0.6 + 0.8).
+inline int64_t GetSellInOrder() {
 	return (4 * GetOrderAmount());
 }
 
+inline int64_t GetBuyInOrder() {
+	return Units::ExToIn(460.0);
+}
+
 inline int64_t GetAvailable() {
-	return GetTotalBalance() - GetInOrder();
+	return GetTotalBalance() - GetBuyInOrder();
 }
 
 static CoinPair GetCoinPair(int index) {
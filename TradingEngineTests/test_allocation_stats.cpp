@@ -0,0 +1,76 @@
+#include "message_conversion_testing_helper.h"
+
+#include <TradingEngine/AllocationStats.h>
+#include <TradingEngine/Message.h>
+#include <TradingEngine/MessageType.h>
+#include <TradingEngine/TradingEngine.h>
+#include <TradingEngine/Units.h>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <sstream>
+
+TEST(TestAllocationStats, attributesToMessageType) {
+	AllocationStats allocationStats;
+	{
+		ScopedAllocationCounter allocationCounter{ &allocationStats, MessageType::Deposit };
+		CountAllocation(AllocationSource::NodePool, 16);
+	}
+
+	const auto& depositStats = *allocationStats.Get(MessageType::Deposit);
+	ASSERT_EQ(depositStats.numMessages, 1u);
+	auto expected = allocationStatsEnabled ? 1u : 0u;
+	ASSERT_EQ(depositStats.counts[static_cast<int>(AllocationSource::NodePool)].allocations, expected);
+	ASSERT_EQ(depositStats.counts[static_cast<int>(AllocationSource::NodePool)].bytes, expected * 16);
+	ASSERT_EQ(allocationStats.Get(MessageType::Withdraw)->numMessages, 0u);
+
+	// Output only or unknown message types are not tracked
+	allocationStats.Add(static_cast<MessageType>(10000), allocationCounts);
+	ASSERT_EQ(allocationStats.Get(MessageType::Last), nullptr);
+
+	std::ostringstream ss;
+	allocationStats.Dump(ss);
+	ASSERT_NE(ss.str().find("Deposit messages=1"), std::string::npos);
+
+	allocationStats.Reset();
+	ASSERT_EQ(allocationStats.Get(MessageType::Deposit)->numMessages, 0u);
+}
+
+TEST(TestAllocationStats, overAligned) {
+	if constexpr (!allocationStatsEnabled) {
+		return;
+	}
+
+	struct alignas(64) CacheLine {
+		char bytes[64];
+	};
+
+	auto before = allocationCounts[static_cast<int>(AllocationSource::Heap)];
+	auto cacheLine = std::make_unique<CacheLine>();
+	ASSERT_EQ(reinterpret_cast<uintptr_t>(cacheLine.get()) % 64, 0u);
+
+	const auto& heap = allocationCounts[static_cast<int>(AllocationSource::Heap)];
+	ASSERT_EQ(heap.allocations - before.allocations, 1u);
+	ASSERT_EQ(heap.bytes - before.bytes, sizeof(CacheLine));
+}
+
+TEST(TestAllocationStats, tradingEngine) {
+	TradingEngine tradingEngine;
+	for (auto& message : CreateSimpleMessages()) {
+		(void)tradingEngine.Process(message);
+	}
+
+	const auto& limitOrderStats = *tradingEngine.GetAllocationStats().Get(MessageType::LimitOrder);
+	if constexpr (!allocationStatsEnabled) {
+		ASSERT_EQ(limitOrderStats.numMessages, 0u);
+		return;
+	}
+
+	ASSERT_GT(limitOrderStats.numMessages, 0u);
+
+	// At least the returned messages are allocated
+	ASSERT_GT(limitOrderStats.counts[static_cast<int>(AllocationSource::Heap)].allocations, 0u);
+
+	tradingEngine.ResetAllocationStats();
+	ASSERT_EQ(tradingEngine.GetAllocationStats().Get(MessageType::LimitOrder)->numMessages, 0u);
+}
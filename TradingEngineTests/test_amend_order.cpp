@@ -0,0 +1,113 @@
+#include "message_conversion_testing_helper.h"
+
+#include <TradingEngine/Error.h>
+#include <TradingEngine/Listener/NullListener.h>
+#include <TradingEngine/Market.h>
+#include <TradingEngine/Orders/OrderAction.h>
+#include <TradingEngine/Orders/OrderContainer.h>
+#include <TradingEngine/Units.h>
+#include <TradingEngine/Wallet.h>
+#include <TradingEngine/market_helper.h>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+class AmendOrder : public ::testing::Test {
+protected:
+	Wallet coinWallet = CreateWallet(0);
+	Wallet baseWallet = CreateBaseWallet(0);
+	MarketWallets marketWallets{ &coinWallet, &baseWallet };
+	Market market{ std::make_unique<NullListener>(), CreateCoinPair(), CreateMarketConfig() };
+
+	// Buys at 0.5 (ids 1 and 2) and a sell at 0.7 (id 3)
+	void SetUp() override {
+		for (int i = 0; i < 2; ++i) {
+			market.NewProcess<OrderAction::Buy>(OrderContainer<LimitOrder>{ CreateLimitOrder(BuyUserId()), Units::ExToIn(0.5) }, &marketWallets);
+		}
+		market.NewProcess<OrderAction::Sell>(OrderContainer<LimitOrder>{ CreateLimitOrder(SellUserId()), Units::ExToIn(0.7) }, &marketWallets);
+	}
+
+	std::vector<int64_t> GetBuyIds(int64_t price) {
+		std::vector<int64_t> ids;
+		for (const auto& limitOrder : market.GetBuyLimitOrderMap().at(price)) {
+			ids.push_back(limitOrder.GetId());
+		}
+		return ids;
+	}
+
+	int64_t GetBuyInOrder() {
+		return baseWallet.GetAddress(BuyUserId())->GetInOrder();
+	}
+};
+
+TEST_F(AmendOrder, reduceKeepsPriority) {
+	auto inOrder = GetBuyInOrder();
+	market.AmendOrder<OrderAction::Buy>(1, Units::ExToIn(0.5), Units::ExToIn(0.5), Units::ExToIn(150.0), &marketWallets);
+
+	ASSERT_EQ(GetBuyIds(Units::ExToIn(0.5)), (std::vector<int64_t>{ 1, 2 }));
+	ASSERT_EQ(market.GetBuyLimitOrderMap().begin()->second.front().GetAmount(), Units::ExToIn(150.0));
+	// Buys hold the notional, 50 at 0.5
+	ASSERT_EQ(GetBuyInOrder(), inOrder - Units::ExToIn(25.0));
+	ASSERT_EQ(market.GetReservations().buy, Units::ExToIn(175.0));
+}
+
+TEST_F(AmendOrder, increaseLosesPriority) {
+	market.AmendOrder<OrderAction::Buy>(1, Units::ExToIn(0.5), Units::ExToIn(0.5), Units::ExToIn(250.0), &marketWallets);
+
+	ASSERT_EQ(GetBuyIds(Units::ExToIn(0.5)), (std::vector<int64_t>{ 2, 1 }));
+	ASSERT_EQ(GetBuyInOrder(), Units::ExToIn(225.0));
+}
+
+TEST_F(AmendOrder, movePrice) {
+	market.AmendOrder<OrderAction::Buy>(2, Units::ExToIn(0.5), Units::ExToIn(0.6), GetOrderAmount(), &marketWallets);
+
+	ASSERT_EQ(GetBuyIds(Units::ExToIn(0.5)), (std::vector<int64_t>{ 1 }));
+	ASSERT_EQ(GetBuyIds(Units::ExToIn(0.6)), (std::vector<int64_t>{ 2 }));
+	ASSERT_EQ(GetBuyInOrder(), Units::ExToIn(220.0));
+
+	const auto& priceOrderIds = market.GetUserOrderCache<OrderAction::Buy, LimitOrder>(BuyUserId());
+	ASSERT_EQ(priceOrderIds.size(), 2u);
+	ASSERT_EQ(priceOrderIds[0].price, Units::ExToIn(0.6));
+	ASSERT_EQ(priceOrderIds[0].orderId, 2);
+
+	// The only order at the price, so the level goes
+	market.AmendOrder<OrderAction::Buy>(2, Units::ExToIn(0.6), Units::ExToIn(0.4), GetOrderAmount(), &marketWallets);
+	ASSERT_EQ(market.GetBuyLimitOrderMap().count(Units::ExToIn(0.6)), 0u);
+	ASSERT_EQ(GetBuyIds(Units::ExToIn(0.4)), (std::vector<int64_t>{ 2 }));
+}
+
+TEST_F(AmendOrder, moveAcrossTheSpreadTrades) {
+	auto coinTotal = coinWallet.GetAddress(BuyUserId())->GetTotalBalance();
+	market.AmendOrder<OrderAction::Buy>(1, Units::ExToIn(0.5), Units::ExToIn(0.7), Units::ExToIn(50.0), &marketWallets);
+
+	// Filled straight away, so it doesn't rest anywhere
+	ASSERT_EQ(GetBuyIds(Units::ExToIn(0.5)), (std::vector<int64_t>{ 2 }));
+	ASSERT_EQ(market.GetBuyLimitOrderMap().count(Units::ExToIn(0.7)), 0u);
+	ASSERT_EQ(market.GetSellLimitOrderMap().begin()->second.front().GetRemaining(), GetOrderAmount() - Units::ExToIn(50.0));
+	ASSERT_GT(coinWallet.GetAddress(BuyUserId())->GetTotalBalance(), coinTotal);
+	ASSERT_EQ(GetBuyInOrder(), Units::ExToIn(100.0));
+	ASSERT_EQ(market.GetReservations().buy, Units::ExToIn(100.0));
+}
+
+TEST_F(AmendOrder, failureLeavesOrder) {
+	auto inOrder = GetBuyInOrder();
+	auto reservations = market.GetReservations();
+
+	ASSERT_THROW(market.AmendOrder<OrderAction::Buy>(4, Units::ExToIn(0.5), Units::ExToIn(0.5), Units::ExToIn(1.0), &marketWallets), Error);
+	ASSERT_THROW(market.AmendOrder<OrderAction::Buy>(1, Units::ExToIn(0.5), Units::ExToIn(0.5), 0, &marketWallets), Error);
+
+	// Not enough funds for the bigger order, it has to be put back where it was
+	ASSERT_THROW(market.AmendOrder<OrderAction::Buy>(1, Units::ExToIn(0.5), Units::ExToIn(0.5), Units::ExToIn(10000.0), &marketWallets), Error);
+	ASSERT_EQ(GetBuyIds(Units::ExToIn(0.5)), (std::vector<int64_t>{ 1, 2 }));
+
+	// Would trade with their own order after moving
+	market.NewProcess<OrderAction::Sell>(OrderContainer<LimitOrder>{ CreateLimitOrder(BuyUserId()), Units::ExToIn(0.8) }, &marketWallets);
+	ASSERT_THROW(market.AmendOrder<OrderAction::Buy>(2, Units::ExToIn(0.5), Units::ExToIn(0.9), Units::ExToIn(300.0), &marketWallets), Error);
+	ASSERT_EQ(GetBuyIds(Units::ExToIn(0.5)), (std::vector<int64_t>{ 1, 2 }));
+	ASSERT_EQ(market.GetBuyLimitOrderMap().size(), 1u);
+
+	ASSERT_EQ(GetBuyInOrder(), inOrder);
+	ASSERT_EQ(market.GetReservations().buy, reservations.buy);
+	ASSERT_EQ((market.GetUserOrderCache<OrderAction::Buy, LimitOrder>(BuyUserId()).size()), 2u);
+}
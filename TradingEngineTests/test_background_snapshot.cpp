@@ -0,0 +1,114 @@
+#include <TradingEngine/BackgroundSnapshot.h>
+#include <TradingEngine/Error.h>
+#include <TradingEngine/PlatformSpecific/fork_process.h>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/vector.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+std::string GetSnapshotPath() {
+	return testing::TempDir() + "background_snapshot_test";
+}
+
+std::vector<int64_t> Load(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	boost::archive::binary_iarchive archive(file);
+	std::vector<int64_t> values;
+	archive >> values;
+	return values;
+}
+}
+
+TEST(BackgroundSnapshot, pointInTime) {
+	std::vector<int64_t> values(100000, 1);
+	auto path = GetSnapshotPath();
+	std::remove(path.c_str());
+
+	BackgroundSnapshot snapshot;
+	snapshot.Start<boost::archive::binary_oarchive>(path, values);
+
+	// Carries on changing while it's written, the snapshot has them as they were
+	std::fill(values.begin(), values.end(), 2);
+	values.push_back(3);
+
+	const auto& stats = snapshot.Wait();
+	ASSERT_TRUE(stats.succeeded);
+	ASSERT_FALSE(snapshot.IsInProgress());
+	ASSERT_LE(stats.stall, stats.duration);
+
+	auto loaded = Load(path);
+	ASSERT_EQ(loaded, std::vector<int64_t>(100000, 1));
+	std::remove(path.c_str());
+}
+
+TEST(BackgroundSnapshot, oneAtATime) {
+	auto path = GetSnapshotPath();
+	std::vector<int64_t> values{ 1, 2, 3 };
+
+	BackgroundSnapshot snapshot;
+	snapshot.Start(path, [&values](std::ostream& os) {
+		// Keep it running long enough to try starting another
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		boost::archive::binary_oarchive archive(os);
+		archive << values;
+	});
+
+	if (snapshot.IsInProgress()) {
+		try {
+			snapshot.Start<boost::archive::binary_oarchive>(path, values);
+			FAIL() << "Expected an error";
+		} catch (const Error& error) {
+			ASSERT_EQ(error.GetType(), Error::Type::SnapshotInProgress);
+		}
+	}
+
+	while (snapshot.Poll()) {
+	}
+
+	ASSERT_TRUE(snapshot.GetLastStats().succeeded);
+	ASSERT_EQ(Load(path), values);
+	std::remove(path.c_str());
+}
+
+TEST(BackgroundSnapshot, notWhileThreadsShareState) {
+	auto path = GetSnapshotPath();
+	std::vector<int64_t> values{ 1, 2, 3 };
+
+	BackgroundSnapshot snapshot;
+	{
+		// i.e the market warm-up is running
+		ps::ForkGuard forkGuard;
+		try {
+			snapshot.Start<boost::archive::binary_oarchive>(path, values);
+			FAIL() << "Expected an error";
+		} catch (const Error& error) {
+			ASSERT_EQ(error.GetType(), Error::Type::SnapshotFailed);
+		}
+		ASSERT_FALSE(snapshot.IsInProgress());
+	}
+
+	snapshot.Start<boost::archive::binary_oarchive>(path, values);
+	ASSERT_TRUE(snapshot.Wait().succeeded);
+	ASSERT_EQ(Load(path), values);
+	std::remove(path.c_str());
+}
+
+TEST(BackgroundSnapshot, failed) {
+	BackgroundSnapshot snapshot;
+	try {
+		snapshot.Start(GetSnapshotPath() + "/missing/directory", [](std::ostream& os) {});
+	} catch (const Error& error) {
+		// Not in the background, so it's thrown instead
+		ASSERT_EQ(error.GetType(), Error::Type::SnapshotFailed);
+	}
+
+	ASSERT_FALSE(snapshot.Wait().succeeded);
+}
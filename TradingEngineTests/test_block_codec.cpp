@@ -0,0 +1,74 @@
+#include <TradingEngine/BlockCodec.h>
+#include <TradingEngine/PlatformSpecific/crc32c.h>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+namespace {
+void RoundTrip(const std::string& data) {
+	std::string compressed;
+	CompressBlock(data, &compressed);
+
+	std::string decompressed = "prefix";
+	ASSERT_TRUE(DecompressBlock(compressed, data.size(), &decompressed));
+	ASSERT_EQ(decompressed, "prefix" + data);
+}
+}
+
+TEST(Crc32c, checkValue) {
+	ASSERT_EQ(ps::Crc32c("123456789", 9), 0xE3069283);
+	ASSERT_EQ(ps::Crc32c("", 0), 0);
+
+	// Carrying on over more data is the same as doing it all at once
+	std::string data(1000, 'x');
+	data[500] = 'y';
+	ASSERT_EQ(ps::Crc32c(data.data() + 123, data.size() - 123, ps::Crc32c(data.data(), 123)), ps::Crc32c(data.data(), data.size()));
+}
+
+TEST(BlockCodec, roundTrip) {
+	RoundTrip("");
+	RoundTrip("a");
+	RoundTrip("abcdefghijkl");
+	RoundTrip(std::string(100000, 'z'));
+
+	std::mt19937 random(42);
+	std::string noise(50000, '\0');
+	for (auto& c : noise) {
+		c = static_cast<char>(random());
+	}
+	RoundTrip(noise);
+
+	std::string text;
+	for (auto i = 0; i < 5000; ++i) {
+		text += "order " + std::to_string(i % 97) + " price " + std::to_string(1000 + i % 13) + "\n";
+	}
+	RoundTrip(text);
+}
+
+TEST(BlockCodec, compresses) {
+	std::string data;
+	for (auto i = 0; i < 10000; ++i) {
+		data += "repeated ";
+	}
+
+	std::string compressed;
+	CompressBlock(data, &compressed);
+	ASSERT_LT(compressed.size(), data.size() / 50);
+}
+
+TEST(BlockCodec, malformed) {
+	std::string data(1000, 'q');
+	std::string compressed;
+	CompressBlock(data, &compressed);
+
+	std::string out = "unchanged";
+	ASSERT_FALSE(DecompressBlock(compressed, data.size() - 1, &out));
+	ASSERT_FALSE(DecompressBlock(compressed, data.size() + 1, &out));
+	ASSERT_FALSE(DecompressBlock(compressed.substr(0, compressed.size() - 3), data.size(), &out));
+
+	// An offset back before the start
+	std::string badOffset = { static_cast<char>(0x10), 'a', static_cast<char>(0xFF), static_cast<char>(0x00) };
+	ASSERT_FALSE(DecompressBlock(badOffset, 20, &out));
+	ASSERT_EQ(out, "unchanged");
+}
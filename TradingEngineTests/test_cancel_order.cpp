@@ -6,8 +6,11 @@
 #include <TradingEngine/Orders/StopLimitOrder.h>
 #include <TradingEngine/Units.h>
 #include <TradingEngine/market_helper.h>
+#include <algorithm>
+#include <cstdint>
 #include <deque>
 #include <gtest/gtest.h>
+#include <vector>
 
 class CancelOrder : public SampleECSTest {
 protected:
@@ -60,8 +63,9 @@ TEST_F(CancelOrder, sell) {
 	market->GetBuyStopLimitOrderMap());
 
 	// Check wallets
+	// The buys hold the notional at 0.3
 	ASSERT_EQ(coinWallet.GetAddress(6)->GetInOrder(), Units::ExToIn(220.0));
-	ASSERT_EQ(baseWallet.GetAddress(8)->GetInOrder(), Units::ExToIn(220.0));
+	ASSERT_EQ(baseWallet.GetAddress(8)->GetInOrder(), Units::ExToIn(66.0));
 
 	CheckUserOrderCache<OrderAction::Sell, OrderAction::Buy>(market.get());
 }
@@ -76,12 +80,26 @@ TEST_F(CancelOrder, buy) {
 	market->GetSellStopLimitOrderMap());
 
 	// Check wallets
+	// The buys hold the notional at 0.3
 	ASSERT_EQ(coinWallet.GetAddress(8)->GetInOrder(), Units::ExToIn(220.0));
-	ASSERT_EQ(baseWallet.GetAddress(6)->GetInOrder(), Units::ExToIn(220.0));
+	ASSERT_EQ(baseWallet.GetAddress(6)->GetInOrder(), Units::ExToIn(66.0));
 
 	CheckUserOrderCache<OrderAction::Buy, OrderAction::Sell>(market.get());
 }
 
+TEST_F(CancelOrder, copiedMarket) {
+	SetUp<OrderAction::Buy, OrderAction::Sell>();
+
+	// The copy's orders are in their own nodes, which it finds from their handles
+	Market copy(*market);
+	market.reset();
+	auto ids = copy.CancelAll(6);
+	std::sort(ids.begin(), ids.end());
+	ASSERT_EQ(ids, (std::vector<int64_t>{ 1, 2, 3, 4 }));
+	ASSERT_EQ(copy.GetBuyLimitOrderMap().size(), 0u);
+	ASSERT_EQ(Flatten(copy.GetSellStopLimitOrderMap()).size(), 4u);
+}
+
 TEST_F(CancelOrder, AllOrders) {
 	SetUp<OrderAction::Buy, OrderAction::Sell>();
 	market->CancelAll();
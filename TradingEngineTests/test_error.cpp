@@ -26,6 +26,18 @@ TEST(TestError, orderUnmodified) {
 	ASSERT_EQ(static_cast<int>(Error::Type::Timeout), 20);
 	ASSERT_EQ(static_cast<int>(Error::Type::RPCNotEnoughArguments), 21);
 	ASSERT_EQ(static_cast<int>(Error::Type::InvalidMessageType), 22);
+	ASSERT_EQ(static_cast<int>(Error::Type::InvalidFee), 23);
+	ASSERT_EQ(static_cast<int>(Error::Type::InvalidAmend), 24);
+	ASSERT_EQ(static_cast<int>(Error::Type::InvalidQuote), 25);
+	ASSERT_EQ(static_cast<int>(Error::Type::SnapshotInProgress), 26);
+	ASSERT_EQ(static_cast<int>(Error::Type::SnapshotFailed), 27);
+	ASSERT_EQ(static_cast<int>(Error::Type::JournalFailed), 28);
+	ASSERT_EQ(static_cast<int>(Error::Type::ArchiveFailed), 29);
+	ASSERT_EQ(static_cast<int>(Error::Type::IpcFailed), 30);
+	ASSERT_EQ(static_cast<int>(Error::Type::GatewayFailed), 31);
+	ASSERT_EQ(static_cast<int>(Error::Type::ReplicationFailed), 32);
+	ASSERT_EQ(static_cast<int>(Error::Type::ReplicaDiverged), 33);
+	ASSERT_EQ(static_cast<int>(Error::Type::Overflow), 34);
 
 	ASSERT_EQ(static_cast<int>(Error::Type::FatalErrorUnknown), 10000);
 	ASSERT_EQ(static_cast<int>(Error::Type::QueueDoesntExist), 10001);
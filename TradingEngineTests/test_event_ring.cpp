@@ -0,0 +1,189 @@
+#include "message_conversion_testing_helper.h"
+
+#include <TradingEngine/Error.h>
+#include <TradingEngine/EventRing.h>
+#include <TradingEngine/Message.h>
+#include <TradingEngine/MessageType.h>
+#include <TradingEngine/TradingEngine.h>
+#include <TradingEngine/Units.h>
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+namespace {
+Message MakeMessage(int32_t id) {
+	Message message;
+	message.messageType = MessageType::NewTrade;
+	message.id = id;
+	message.amount = id * 10;
+	return message;
+}
+}
+
+TEST(EventRing, poll) {
+	EventRing ring(5);
+	ASSERT_EQ(ring.GetSize(), 8u);
+
+	auto first = ring.AddConsumer(WaitStrategy::Yield);
+	std::vector<Message> messages{ MakeMessage(1), MakeMessage(2), MakeMessage(3) };
+	ring.Publish(messages.data(), messages.size());
+	ASSERT_EQ(ring.GetPublishedSequence(), 3u);
+
+	// Only sees what comes after it was added
+	auto second = ring.AddConsumer(WaitStrategy::BusySpin);
+	ring.Publish(messages.data(), 1);
+
+	std::vector<uint64_t> sequences;
+	ASSERT_EQ(first->Poll([&](uint64_t sequence, const RingEvent& event) {
+		sequences.push_back(sequence);
+		ASSERT_EQ(event.message.id, messages[(sequence - 1) % 3].id);
+	}),
+	4u);
+	ASSERT_EQ(sequences, (std::vector<uint64_t>{ 1, 2, 3, 4 }));
+	ASSERT_EQ(first->GetSequence(), 4u);
+	ASSERT_EQ(first->Poll([](uint64_t, const RingEvent&) {}), 0u);
+
+	ASSERT_EQ(second->Poll([](uint64_t sequence, const RingEvent& event) {
+		ASSERT_EQ(sequence, 4u);
+		ASSERT_EQ(event.message.id, 1);
+	}),
+	1u);
+}
+
+TEST(EventRing, attachments) {
+	EventRing ring(4);
+	auto consumer = ring.AddConsumer(WaitStrategy::Yield);
+
+	Message cancelAll;
+	cancelAll.messageType = MessageType::CancelAllOrders;
+	Message::cancelOrders = "3_1_5";
+	ring.Publish(&cancelAll, 1);
+	Message::cancelOrders.clear();
+
+	consumer->Poll([](uint64_t, const RingEvent& event) {
+		ASSERT_EQ(event.message.messageType, MessageType::CancelAllOrders);
+		ASSERT_EQ(event.cancelOrders, "3_1_5");
+	});
+}
+
+// Every consumer sees every event in order, however far behind it is, with the producer waiting
+// for the slowest rather than overwriting anything
+TEST(EventRing, consumersOnThreads) {
+	for (auto producerWaitStrategy : { WaitStrategy::BusySpin, WaitStrategy::Yield, WaitStrategy::Block }) {
+		constexpr int32_t numEvents = 5000;
+		EventRing ring(256, producerWaitStrategy);
+
+		std::vector<std::thread> threads;
+		std::vector<int64_t> sums(3, 0);
+		auto strategies = { WaitStrategy::BusySpin, WaitStrategy::Yield, WaitStrategy::Block };
+		size_t index = 0;
+		for (auto waitStrategy : strategies) {
+			auto consumer = ring.AddConsumer(waitStrategy);
+			auto sum = &sums[index++];
+			threads.emplace_back([consumer, sum]() {
+				int32_t expectedId = 1;
+				while (consumer->Consume([&](uint64_t sequence, const RingEvent& event) {
+					EXPECT_EQ(event.message.id, expectedId);
+					EXPECT_EQ(sequence, static_cast<uint64_t>(expectedId));
+					++expectedId;
+					*sum += event.message.amount;
+				})
+				> 0) {
+				}
+			});
+		}
+
+		std::vector<Message> batch;
+		for (int32_t id = 1; id <= numEvents;) {
+			batch.clear();
+			for (auto i = 0; i < 1 + id % 100 && id <= numEvents; ++i) {
+				batch.push_back(MakeMessage(id++));
+			}
+			ring.Publish(batch.data(), batch.size());
+		}
+		ring.Close();
+
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		int64_t expectedSum = int64_t(numEvents) * (numEvents + 1) / 2 * 10;
+		for (auto sum : sums) {
+			ASSERT_EQ(sum, expectedSum);
+		}
+	}
+}
+
+TEST(EventRing, detach) {
+	EventRing ring(4);
+	auto consumer = ring.AddConsumer(WaitStrategy::Yield);
+	consumer->Detach();
+
+	// Nothing holds the producer back
+	std::vector<Message> messages(100, MakeMessage(1));
+	ring.Publish(messages.data(), messages.size());
+	ASSERT_EQ(ring.GetPublishedSequence(), 100u);
+	ASSERT_EQ(ring.GetNumProducerWaits(), 0u);
+}
+
+TEST(EventRing, tooManyConsumers) {
+	EventRing ring(4);
+	for (size_t i = 0; i < EventRing::maxNumConsumers; ++i) {
+		ASSERT_NE(ring.AddConsumer(WaitStrategy::Yield), nullptr);
+	}
+	ASSERT_EQ(ring.AddConsumer(WaitStrategy::Yield), nullptr);
+}
+
+TEST(EventRing, tradingEngine) {
+	TradingEngine tradingEngine;
+	EventRing ring(16);
+	auto consumer = ring.AddConsumer(WaitStrategy::Yield);
+	for (const auto& message : ToMessages(CreateWalletManager())) {
+		tradingEngine.Process(message, &ring);
+		consumer->Poll([](uint64_t, const RingEvent&) {});
+	}
+
+	Message newMarket;
+	newMarket.messageType = MessageType::NewMarket;
+	newMarket.coinId = CreateCoinPair().GetCoinId();
+	newMarket.baseId = CreateCoinPair().GetBaseId();
+	newMarket.feePercentage = 0.1;
+	newMarket.maxNumLimitOpenOrders = 10;
+	newMarket.maxNumStopLimitOpenOrders = 10;
+	ASSERT_EQ(tradingEngine.Process(newMarket, &ring), 1u);
+	consumer->Poll([](uint64_t, const RingEvent&) {});
+
+	Message sell;
+	sell.messageType = MessageType::LimitOrder;
+	sell.coinId = CreateCoinPair().GetCoinId();
+	sell.baseId = CreateCoinPair().GetBaseId();
+	sell.userId = SellUserId();
+	sell.isBuy = false;
+	sell.price = Units::ExToIn(0.5);
+	sell.amount = Units::ExToIn(10.0);
+	ASSERT_EQ(tradingEngine.Process(sell, &ring), 1u);
+
+	auto buy = sell;
+	buy.userId = BuyUserId();
+	buy.isBuy = true;
+	auto published = tradingEngine.Process(buy, &ring);
+	ASSERT_GT(published, 1u);
+
+	std::vector<MessageType> types;
+	consumer->Poll([&](uint64_t, const RingEvent& event) {
+		types.push_back(event.message.messageType);
+	});
+	ASSERT_EQ(types.size(), 1 + published);
+	ASSERT_EQ(types[0], MessageType::NewOpenOrder);
+	ASSERT_NE(std::find(types.begin(), types.end(), MessageType::NewTrade), types.end());
+
+	// Errors are published too
+	Message invalid;
+	invalid.messageType = MessageType::Last;
+	ASSERT_EQ(tradingEngine.Process(invalid, &ring), 1u);
+	consumer->Poll([](uint64_t, const RingEvent& event) {
+		ASSERT_EQ(event.message.errorCode, static_cast<int>(Error::Type::InvalidMessageType));
+	});
+}
@@ -1,5 +1,17 @@
+#include "message_conversion_testing_helper.h"
+
+#include <TradingEngine/Error.h>
 #include <TradingEngine/Fee.h>
+#include <TradingEngine/FeeSchedule.h>
+#include <TradingEngine/Market.h>
+#include <TradingEngine/Orders/OrderAction.h>
+#include <TradingEngine/Orders/OrderContainer.h>
+#include <TradingEngine/Units.h>
+#include <TradingEngine/Wallet.h>
+#include <TradingEngine/market_helper.h>
+#include <cstdint>
 #include <gtest/gtest.h>
+#include <random>
 
 TEST(TestFees, ConvertToDivisible) {
 	ASSERT_EQ(Fee::ConvertToDivisibleFee(0.1), 1000);
@@ -8,3 +20,72 @@ TEST(TestFees, ConvertToDivisible) {
 TEST(TestFees, ConvertToFeePercent) {
 	ASSERT_EQ(Fee::ConvertToFeePercent(1000), 0.1);
 }
+
+TEST(TestFees, ConvertZeroToNoFee) {
+	ASSERT_EQ(Fee::ConvertToDivisibleFee(0.0), 0);
+}
+
+TEST(TestFees, dividerMatchesDivision) {
+	std::mt19937_64 rng(1234);
+	for (int32_t divisor : { 1, 2, 3, 7, 10, 400, 1000, 1023, 1024, 1025, 99999, INT32_MAX }) {
+		FeeDivider feeDivider(divisor);
+		for (int64_t value : { int64_t(0), int64_t(1), int64_t(divisor - 1), int64_t(divisor),
+		     INT64_MAX - 1, INT64_MAX }) {
+			ASSERT_EQ(feeDivider.Divide(value), value / divisor) << value << " / " << divisor;
+		}
+
+		for (int i = 0; i < 1000; ++i) {
+			auto value = static_cast<int64_t>(rng() >> 1);
+			ASSERT_EQ(feeDivider.Divide(value), value / divisor) << value << " / " << divisor;
+		}
+	}
+
+	// No fee
+	ASSERT_EQ(FeeDivider(0).Divide(INT64_MAX), 0);
+	ASSERT_THROW(FeeDivider(-1), Error);
+}
+
+TEST(TestFees, tiers) {
+	FeeSchedule feeSchedule;
+	feeSchedule.SetStandardFee(1000);
+	feeSchedule.SetTier(1, 0, 500);
+	UserFeeTiers userFeeTiers;
+	userFeeTiers.SetUserTier(6, 1);
+	ASSERT_EQ(feeSchedule.GetTier(6).taker.GetDivisor(), 1000);
+	feeSchedule.SetUserTiers(&userFeeTiers);
+
+	ASSERT_EQ(feeSchedule.GetTier(6).maker.GetDivisor(), 0);
+	ASSERT_EQ(feeSchedule.GetTier(6).taker.GetDivisor(), 500);
+
+	// Everyone else including users beyond the table is on the standard tier
+	ASSERT_EQ(feeSchedule.GetTier(5).taker.GetDivisor(), 1000);
+	ASSERT_EQ(feeSchedule.GetTier(100000).maker.GetDivisor(), 1000);
+
+	ASSERT_THROW(feeSchedule.SetTier(FeeSchedule::numTiers, 1, 1), Error);
+	ASSERT_THROW(userFeeTiers.SetUserTier(7, FeeSchedule::numTiers), Error);
+}
+
+TEST(TestFees, makerTakerInMarket) {
+	auto coinWallet = CreateWallet(0);
+	auto baseWallet = CreateBaseWallet(0);
+	MarketWallets marketWallets{ &coinWallet, &baseWallet };
+	auto market = CreateMarket(&marketWallets, 0);
+
+	// Buyer takes 100 at 0.6 from the resting sell order
+	OrderContainer<LimitOrder> orderContainer{ { BuyUserId(), Units::ExToIn(100.0), 0 },
+		Units::ExToIn(0.6) };
+	auto standard = market.Quote<OrderAction::Buy>(orderContainer);
+	auto feeDivision = market.GetConfig().feeDivision;
+	ASSERT_EQ(standard.fees.buyFee, Units::ExToIn(100.0) / feeDivision);
+	ASSERT_EQ(standard.fees.sellFee, Units::ExToIn(60.0) / feeDivision);
+
+	// Free for makers, 0.2% for takers
+	market.SetFeeTier(1, 0.0, 0.2);
+	UserFeeTiers userFeeTiers;
+	userFeeTiers.SetUserTier(BuyUserId(), 1);
+	userFeeTiers.SetUserTier(SellUserId(), 1);
+	market.SetUserFeeTiers(&userFeeTiers);
+	auto tiered = market.Quote<OrderAction::Buy>(orderContainer);
+	ASSERT_EQ(tiered.fees.buyFee, Units::ExToIn(100.0) / 500);
+	ASSERT_EQ(tiered.fees.sellFee, 0);
+}
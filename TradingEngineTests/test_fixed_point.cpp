@@ -0,0 +1,44 @@
+#include <TradingEngine/Error.h>
+#include <TradingEngine/FixedPoint.h>
+#include <TradingEngine/Units.h>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <limits>
+
+using Fixed = FixedPoint<100000000>;
+
+static_assert(Fixed::Multiply(200000000, 50000000) == 100000000); // 2 * 0.5
+static_assert(Units::Multiply(1, 1) == 0); // Truncated
+
+TEST(TestFixedPoint, multiply) {
+	ASSERT_EQ(Units::Multiply(Units::ExToIn(100.0), Units::ExToIn(0.1)), Units::ExToIn(10.0));
+	ASSERT_EQ(Units::Multiply(Units::ExToIn(3.0), Units::ExToIn(0.33333333)), 99999999);
+	ASSERT_EQ(Units::Multiply(-Units::ExToIn(2.0), Units::ExToIn(1.5)), -Units::ExToIn(3.0));
+}
+
+TEST(TestFixedPoint, noIntermediateOverflow) {
+	// 1 billion coins at a price of 50, amount * price alone is well past int64
+	auto amount = Units::ExToIn(1000000000.0);
+	auto price = Units::ExToIn(50.0);
+	ASSERT_GT(static_cast<double>(amount) * price, static_cast<double>(std::numeric_limits<int64_t>::max()));
+	ASSERT_EQ(Units::Multiply(amount, price), Units::ExToIn(50000000000.0));
+}
+
+TEST(TestFixedPoint, resultOverflow) {
+	// The product is scaled back down and still doesn't fit
+	auto max = std::numeric_limits<int64_t>::max();
+	ASSERT_THROW(Units::Multiply(max, Units::ExToIn(2.0)), Error);
+	ASSERT_THROW(Units::Multiply(max, -Units::ExToIn(2.0)), Error);
+	ASSERT_EQ(Units::Multiply(max, Units::ExToIn(1.0)), max);
+	ASSERT_EQ(Units::Multiply(std::numeric_limits<int64_t>::min(), Units::ExToIn(1.0)),
+	std::numeric_limits<int64_t>::min());
+}
+
+TEST(TestFixedPoint, otherScales) {
+	using Cents = FixedPoint<100>;
+	ASSERT_EQ(Cents::FromDouble(12.34), 1234);
+	ASSERT_EQ(Cents::FromDouble(-0.015), -2);
+	ASSERT_EQ(Cents::Multiply(Cents::FromDouble(2.5), Cents::FromDouble(4.0)), 1000);
+	ASSERT_EQ(Cents::ScaleDown(static_cast<__int128>(1234) * 100), 1234);
+	ASSERT_DOUBLE_EQ(Cents::ToDouble(1234), 12.34);
+}
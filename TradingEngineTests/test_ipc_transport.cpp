@@ -0,0 +1,280 @@
+#include "message_conversion_testing_helper.h"
+
+#include <TradingEngine/Error.h>
+#include <TradingEngine/IpcTransport.h>
+#include <TradingEngine/Message.h>
+#include <TradingEngine/MessageType.h>
+#include <TradingEngine/PlatformSpecific/fork_process.h>
+#include <TradingEngine/PlatformSpecific/shared_memory.h>
+#include <TradingEngine/TradingEngine.h>
+#include <TradingEngine/Units.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+IpcConfig MakeConfig(const std::string& name) {
+	IpcConfig config;
+	config.name = name;
+	config.maxNumClients = 4;
+	config.ringSize = 64 * 1024;
+	config.numSpins = 100;
+	return config;
+}
+
+// Echoes each request back with the attachment
+void Echo(IpcServer& server) {
+	server.Poll([&server](size_t clientId, const Message& message) {
+		server.Respond(clientId, &message, 1);
+	},
+	1s);
+}
+
+template <class Function>
+void ExpectIpcFailed(Function&& function) {
+	try {
+		function();
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::IpcFailed);
+	}
+}
+}
+
+TEST(IpcTransport, tradingEngine) {
+	IpcServer server(MakeConfig("/wte_test_ipc"));
+	TradingEngine tradingEngine;
+	std::atomic<bool> stop{ false };
+	std::thread serverThread([&]() {
+		while (!stop) {
+			server.Serve(tradingEngine, 10ms);
+		}
+	});
+
+	{
+		IpcClient client("/wte_test_ipc");
+		ASSERT_EQ(server.GetNumClients(), 1u);
+
+		std::vector<Message> responses;
+		for (const auto& message : ToMessages(CreateWalletManager())) {
+			ASSERT_TRUE(client.Call(message, &responses, 5s));
+		}
+
+		Message newMarket;
+		newMarket.messageType = MessageType::NewMarket;
+		newMarket.coinId = CreateCoinPair().GetCoinId();
+		newMarket.baseId = CreateCoinPair().GetBaseId();
+		newMarket.feePercentage = 0.1;
+		newMarket.maxNumLimitOpenOrders = 10;
+		newMarket.maxNumStopLimitOpenOrders = 10;
+		ASSERT_TRUE(client.Call(newMarket, &responses, 5s));
+		ASSERT_EQ(responses.size(), 1u);
+
+		Message sell;
+		sell.messageType = MessageType::LimitOrder;
+		sell.coinId = CreateCoinPair().GetCoinId();
+		sell.baseId = CreateCoinPair().GetBaseId();
+		sell.userId = SellUserId();
+		sell.isBuy = false;
+		sell.price = Units::ExToIn(0.5);
+		sell.amount = Units::ExToIn(10.0);
+		ASSERT_TRUE(client.Call(sell, &responses, 5s));
+		ASSERT_EQ(responses.size(), 1u);
+		ASSERT_EQ(responses[0].messageType, MessageType::NewOpenOrder);
+
+		// Pipelined, the responses come back in order
+		auto buy = sell;
+		buy.userId = BuyUserId();
+		buy.isBuy = true;
+		Message invalid;
+		invalid.messageType = MessageType::Last;
+		client.Send(buy);
+		client.Send(invalid);
+
+		ASSERT_TRUE(client.Receive(&responses, 5s));
+		ASSERT_GT(responses.size(), 1u);
+		ASSERT_NE(std::find_if(responses.begin(), responses.end(), [](const Message& message) { return message.messageType == MessageType::NewTrade; }), responses.end());
+
+		ASSERT_TRUE(client.Receive(&responses, 5s));
+		ASSERT_EQ(responses.size(), 1u);
+		ASSERT_EQ(responses[0].errorCode, static_cast<int>(Error::Type::InvalidMessageType));
+	}
+
+	stop = true;
+	serverThread.join();
+	ASSERT_EQ(server.GetNumClients(), 0u);
+}
+
+TEST(IpcTransport, attachments) {
+	IpcServer server(MakeConfig(""));
+	IpcClient client(server.GetFd());
+
+	Message massQuote;
+	massQuote.messageType = MessageType::MassQuote;
+	massQuote.userId = 7;
+	Message::massQuote.bids = { { 99, 10 }, { 98, 20 } };
+	Message::massQuote.asks = { { 101, 30 } };
+	client.Send(massQuote);
+	Message::massQuote = MassQuote();
+
+	Echo(server);
+	std::vector<Message> responses;
+	ASSERT_TRUE(client.Receive(&responses, 1s));
+	ASSERT_EQ(responses.size(), 1u);
+	ASSERT_EQ(responses[0].messageType, MessageType::MassQuote);
+	ASSERT_EQ(responses[0].userId, 7);
+	ASSERT_EQ(Message::massQuote.bids.size(), 2u);
+	ASSERT_EQ(Message::massQuote.bids[1].price, 98);
+	ASSERT_EQ(Message::massQuote.asks[0].amount, 30);
+	Message::massQuote = MassQuote();
+
+	// An empty response still completes the request
+	Message cancelAll;
+	cancelAll.messageType = MessageType::CancelAllOrders;
+	client.Send(cancelAll);
+	server.Poll([&server](size_t clientId, const Message&) {
+		server.Respond(clientId, nullptr, 0);
+	},
+	1s);
+	ASSERT_TRUE(client.Receive(&responses, 1s));
+	ASSERT_TRUE(responses.empty());
+
+	// Nothing more
+	ASSERT_FALSE(client.Receive(&responses, 1ms));
+}
+
+// A ring much smaller than what goes through it, so records wrap around many times
+TEST(IpcTransport, wrapAround) {
+	auto config = MakeConfig("");
+	config.ringSize = 4096;
+	IpcServer server(config);
+	IpcClient client(server.GetFd());
+
+	std::vector<Message> responses;
+	for (int32_t id = 1; id <= 500; ++id) {
+		Message message;
+		message.messageType = MessageType::CancelAllOrders;
+		message.id = id;
+		Message::cancelOrders = std::string(id % 200, 'x');
+		client.Send(message);
+		Echo(server);
+		ASSERT_TRUE(client.Receive(&responses, 1s));
+		ASSERT_EQ(responses.size(), 1u);
+		ASSERT_EQ(responses[0].id, id);
+		ASSERT_EQ(Message::cancelOrders, std::string(id % 200, 'x'));
+	}
+	Message::cancelOrders.clear();
+}
+
+// A client which doesn't read its responses is disconnected rather than holding up the server
+TEST(IpcTransport, slowClient) {
+	auto config = MakeConfig("");
+	config.ringSize = 4096;
+	IpcServer server(config);
+	IpcClient client(server.GetFd());
+
+	Message message;
+	message.messageType = MessageType::NewTrade;
+	std::vector<Message> response(20, message);
+	auto numResponded = 0;
+	for (auto i = 0; i < 10 && server.GetNumClients() > 0; ++i) {
+		client.Send(message);
+		server.Poll([&](size_t clientId, const Message&) {
+			numResponded += server.Respond(clientId, response.data(), response.size());
+		},
+		1s);
+	}
+	ASSERT_GT(numResponded, 0);
+	ASSERT_LT(numResponded, 10);
+	ASSERT_EQ(server.GetNumClients(), 0u);
+
+	// What was sent before is still there
+	std::vector<Message> responses;
+	for (auto i = 0; i < numResponded; ++i) {
+		ASSERT_TRUE(client.Receive(&responses, 1s));
+		ASSERT_EQ(responses.size(), response.size());
+	}
+	ExpectIpcFailed([&]() { client.Receive(&responses, 1s); });
+	ExpectIpcFailed([&]() { client.Send(message); });
+}
+
+// The server keeps to its own ring sizes whatever a client writes over the segment header
+TEST(IpcTransport, overwrittenHeader) {
+	IpcServer server(MakeConfig(""));
+	IpcClient client(server.GetFd());
+
+	// ringSize and slotSize, after the magic, format version, spins and number of clients
+	auto memory = ps::OpenSharedMemory(server.GetFd());
+	ASSERT_NE(memory.address, nullptr);
+	uint64_t sizes[2] = { uint64_t(1) << 40, uint64_t(1) << 40 };
+	std::memcpy(static_cast<char*>(memory.address) + 24, sizes, sizeof(sizes));
+	ps::CloseSharedMemory(memory);
+
+	Message message;
+	message.messageType = MessageType::NewTrade;
+	message.id = 7;
+	client.Send(message);
+	Echo(server);
+	std::vector<Message> responses;
+	ASSERT_TRUE(client.Receive(&responses, 1s));
+	ASSERT_EQ(responses.size(), 1u);
+	ASSERT_EQ(responses[0].id, 7);
+	ASSERT_EQ(server.GetNumClients(), 1u);
+}
+
+TEST(IpcTransport, clientSlots) {
+	IpcServer server(MakeConfig(""));
+	{
+		std::vector<std::unique_ptr<IpcClient>> clients;
+		for (size_t i = 0; i < 4; ++i) {
+			clients.push_back(std::make_unique<IpcClient>(server.GetFd()));
+			ASSERT_EQ(clients.back()->GetClientId(), i);
+		}
+		ExpectIpcFailed([&]() { IpcClient client(server.GetFd()); });
+
+		// Freed once the server sees it has gone
+		clients[1].reset();
+		server.Poll([](size_t, const Message&) {}, 1ms);
+		ASSERT_EQ(server.GetNumClients(), 3u);
+		ASSERT_EQ(IpcClient(server.GetFd()).GetClientId(), 1u);
+	}
+
+	ExpectIpcFailed([]() { IpcClient client("/wte_test_ipc_missing"); });
+}
+
+TEST(IpcTransport, forkedClient) {
+	IpcServer server(MakeConfig(""));
+
+	// Exits without disconnecting, as if it crashed
+	auto pid = ps::ForkProcess([&server]() {
+		auto client = new IpcClient(server.GetFd());
+		Message message;
+		message.messageType = MessageType::NewTrade;
+		message.id = 42;
+		std::vector<Message> responses;
+		if (!client->Call(message, &responses, 5s) || responses.size() != 1 || responses[0].id != 42) {
+			return 1;
+		}
+		return 0;
+	});
+	if (pid == -1) {
+		GTEST_SKIP();
+	}
+
+	while (server.Poll([&server](size_t clientId, const Message& message) { server.Respond(clientId, &message, 1); }, 10ms) == 0) {
+	}
+
+	int exitCode;
+	ASSERT_TRUE(ps::ReapProcess(pid, true, &exitCode));
+	ASSERT_EQ(exitCode, 0);
+	ASSERT_EQ(server.GetNumClients(), 1u);
+	server.ReclaimDeadClients();
+	ASSERT_EQ(server.GetNumClients(), 0u);
+}
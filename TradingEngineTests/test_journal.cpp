@@ -0,0 +1,217 @@
+#include <TradingEngine/Error.h>
+#include <TradingEngine/Journal.h>
+#include <TradingEngine/Message.h>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+class JournalTest : public ::testing::TestWithParam<bool> {
+protected:
+	JournalConfig config;
+
+	void SetUp() override {
+		config.directory = "test_journal";
+		config.segmentSize = 16 * 1024;
+		config.bufferSize = 8 * 1024;
+		config.numBuffers = 2;
+		config.ioUring = GetParam();
+		config.writerIdleSleep = std::chrono::microseconds(1);
+		std::filesystem::remove_all(config.directory);
+		std::filesystem::create_directory(config.directory);
+	}
+
+	void TearDown() override {
+		std::filesystem::remove_all(config.directory);
+	}
+
+	// Deterministic contents so they can be checked on the way back
+	static std::string MakeRecord(uint64_t sequence) {
+		return std::string(1 + (sequence * 37) % 3000, static_cast<char>('a' + sequence % 26));
+	}
+
+	std::vector<std::string> ReadAll(uint64_t* lastSequence = nullptr) {
+		std::vector<std::string> records;
+		auto last = Journal::Read(config.directory, [&records](uint64_t sequence, std::string_view record) {
+			EXPECT_EQ(sequence, records.size() + 1);
+			records.emplace_back(record);
+		});
+		if (lastSequence) {
+			*lastSequence = last;
+		}
+		return records;
+	}
+};
+}
+
+TEST_P(JournalTest, roundTrip) {
+	{
+		Journal journal(config);
+		for (uint64_t sequence = 1; sequence <= 500; ++sequence) {
+			auto record = MakeRecord(sequence);
+			ASSERT_EQ(journal.Append(record.data(), record.size()), sequence);
+			if (sequence % 7 == 0) {
+				journal.Flush();
+			}
+		}
+		journal.Sync();
+		ASSERT_EQ(journal.GetDurableSequence(), 500);
+
+		auto stats = journal.GetStats();
+		ASSERT_GT(stats.numBatches, 0);
+		ASSERT_EQ(stats.numBytesWritten % 4096, 0);
+	}
+
+	uint64_t lastSequence;
+	auto records = ReadAll(&lastSequence);
+	ASSERT_EQ(lastSequence, 500);
+	ASSERT_EQ(records.size(), 500);
+	for (uint64_t sequence = 1; sequence <= 500; ++sequence) {
+		ASSERT_EQ(records[sequence - 1], MakeRecord(sequence));
+	}
+
+	// Spread over many segments, each allocated up front
+	auto numSegments = 0;
+	for (const auto& entry : std::filesystem::directory_iterator(config.directory)) {
+		ASSERT_EQ(entry.file_size(), config.segmentSize);
+		++numSegments;
+	}
+	ASSERT_GT(numSegments, 10);
+}
+
+TEST_P(JournalTest, messages) {
+	Message limitOrder;
+	limitOrder.messageType = MessageType::LimitOrder;
+	limitOrder.coinId = 3;
+	limitOrder.baseId = 2;
+	limitOrder.userId = 7;
+	limitOrder.price = 1000;
+	limitOrder.amount = 50;
+	limitOrder.isBuy = true;
+
+	Message cancelAll;
+	cancelAll.messageType = MessageType::CancelAllOrders;
+	cancelAll.userId = 7;
+
+	Message massQuote;
+	massQuote.messageType = MessageType::MassQuote;
+	massQuote.coinId = 3;
+	massQuote.baseId = 2;
+	massQuote.userId = 7;
+
+	{
+		Journal journal(config);
+		journal.Append(limitOrder);
+		Message::cancelOrders = "1 2 3";
+		journal.Append(cancelAll);
+		Message::massQuote.bids = { { 99, 10 }, { 98, 20 } };
+		Message::massQuote.asks = { { 101, 30 } };
+		journal.Append(massQuote);
+		journal.Sync();
+	}
+
+	Message::cancelOrders.clear();
+	Message::massQuote = MassQuote();
+
+	auto records = ReadAll();
+	ASSERT_EQ(records.size(), 3);
+
+	Message message;
+	Journal::DecodeMessage(records[0], &message);
+	ASSERT_EQ(message.messageType, MessageType::LimitOrder);
+	ASSERT_EQ(std::memcmp(&message, &limitOrder, sizeof(Message)), 0);
+
+	Journal::DecodeMessage(records[1], &message);
+	ASSERT_EQ(message.messageType, MessageType::CancelAllOrders);
+	ASSERT_EQ(message.userId, 7);
+	ASSERT_EQ(Message::cancelOrders, "1 2 3");
+
+	Journal::DecodeMessage(records[2], &message);
+	ASSERT_EQ(message.messageType, MessageType::MassQuote);
+	ASSERT_EQ(message.userId, 7);
+	ASSERT_EQ(Message::massQuote.bids.size(), 2);
+	ASSERT_EQ(Message::massQuote.bids[1].price, 98);
+	ASSERT_EQ(Message::massQuote.asks.size(), 1);
+	ASSERT_EQ(Message::massQuote.asks[0].amount, 30);
+	Message::massQuote = MassQuote();
+}
+
+TEST_P(JournalTest, reopen) {
+	{
+		Journal journal(config);
+		for (uint64_t sequence = 1; sequence <= 10; ++sequence) {
+			auto record = MakeRecord(sequence);
+			journal.Append(record.data(), record.size());
+		}
+	}
+
+	{
+		Journal journal(config);
+		ASSERT_EQ(journal.GetLastSequence(), 10);
+		ASSERT_EQ(journal.GetDurableSequence(), 10);
+		for (uint64_t sequence = 11; sequence <= 15; ++sequence) {
+			auto record = MakeRecord(sequence);
+			ASSERT_EQ(journal.Append(record.data(), record.size()), sequence);
+		}
+	}
+
+	uint64_t lastSequence;
+	auto records = ReadAll(&lastSequence);
+	ASSERT_EQ(lastSequence, 15);
+	ASSERT_EQ(records.size(), 15);
+	ASSERT_EQ(records[14], MakeRecord(15));
+}
+
+TEST_P(JournalTest, tornRecord) {
+	{
+		Journal journal(config);
+		for (uint64_t sequence = 1; sequence <= 3; ++sequence) {
+			auto record = MakeRecord(sequence);
+			journal.Append(record.data(), record.size());
+		}
+	}
+
+	// Break the last record's sequence, as if it was only partly written
+	auto path = std::filesystem::directory_iterator(config.directory)->path();
+	auto offset = 2 * 12 + MakeRecord(1).size() + MakeRecord(2).size() + 4;
+	{
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(offset);
+		uint64_t sequence = 99;
+		file.write(reinterpret_cast<const char*>(&sequence), sizeof(sequence));
+	}
+
+	uint64_t lastSequence;
+	auto records = ReadAll(&lastSequence);
+	ASSERT_EQ(lastSequence, 2);
+	ASSERT_EQ(records.size(), 2);
+}
+
+TEST_P(JournalTest, tooBig) {
+	Journal journal(config);
+	std::string record(config.bufferSize, 'x');
+	try {
+		journal.Append(record.data(), record.size());
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::JournalFailed);
+	}
+	ASSERT_EQ(journal.GetLastSequence(), 0);
+}
+
+TEST_P(JournalTest, invalidConfig) {
+	config.bufferSize = 1000;
+	try {
+		Journal journal(config);
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::JournalFailed);
+	}
+}
+
+INSTANTIATE_TEST_SUITE_P(Journal, JournalTest, ::testing::Values(false, true));
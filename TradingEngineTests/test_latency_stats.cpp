@@ -0,0 +1,89 @@
+#include "message_conversion_testing_helper.h"
+
+#include <TradingEngine/LatencyHistogram.h>
+#include <TradingEngine/LatencyStats.h>
+#include <TradingEngine/Market.h>
+#include <TradingEngine/Orders/OrderAction.h>
+#include <TradingEngine/Orders/OrderContainer.h>
+#include <TradingEngine/Orders/OrderType.h>
+#include <TradingEngine/Units.h>
+#include <TradingEngine/Wallet.h>
+#include <TradingEngine/market_helper.h>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <sstream>
+
+TEST(TestLatencyHistogram, empty) {
+	LatencyHistogram histogram;
+	ASSERT_EQ(histogram.GetCount(), 0u);
+	ASSERT_EQ(histogram.GetMin(), 0u);
+	ASSERT_EQ(histogram.GetMax(), 0u);
+	ASSERT_EQ(histogram.ValueAtPercentile(99.0), 0u);
+}
+
+TEST(TestLatencyHistogram, smallValuesAreExact) {
+	LatencyHistogram histogram;
+	for (uint64_t i = 1; i <= 100; ++i) {
+		histogram.Record(i);
+	}
+
+	ASSERT_EQ(histogram.GetCount(), 100u);
+	ASSERT_EQ(histogram.GetMin(), 1u);
+	ASSERT_EQ(histogram.GetMax(), 100u);
+	ASSERT_EQ(histogram.ValueAtPercentile(50.0), 50u);
+	ASSERT_EQ(histogram.ValueAtPercentile(99.0), 99u);
+	ASSERT_EQ(histogram.ValueAtPercentile(100.0), 100u);
+}
+
+TEST(TestLatencyHistogram, largeValuesWithinPrecision) {
+	LatencyHistogram histogram;
+	const uint64_t value = 1234567;
+	histogram.Record(value);
+	histogram.Record(10 * value);
+
+	auto p50 = histogram.ValueAtPercentile(50.0);
+	ASSERT_GE(p50, value);
+	ASSERT_LE(p50, value + value / 50);
+	ASSERT_EQ(histogram.ValueAtPercentile(100.0), 10 * value);
+
+	// Huge values are clamped rather than overflowing the buckets
+	histogram.Record(UINT64_MAX);
+	ASSERT_EQ(histogram.GetCount(), 3u);
+
+	histogram.Reset();
+	ASSERT_EQ(histogram.GetCount(), 0u);
+	ASSERT_EQ(histogram.GetMax(), 0u);
+}
+
+TEST(TestLatencyStats, recordsStages) {
+	auto coinWallet = CreateWallet(0);
+	auto baseWallet = CreateBaseWallet(0);
+	MarketWallets marketWallets{ &coinWallet, &baseWallet };
+	auto market = CreateMarket(&marketWallets, 0);
+
+	if constexpr (!latencyStatsEnabled) {
+		ASSERT_EQ(market.GetLatencyStats(), nullptr);
+		return;
+	}
+
+	// Creating the market placed orders as well
+	auto& latencyStats = *market.GetLatencyStats();
+	latencyStats.Reset();
+
+	OrderContainer<LimitOrder> orderContainer{ { BuyUserId(), Units::ExToIn(1.0), 0 },
+		Units::ExToIn(0.6) };
+	market.NewProcess<OrderAction::Buy>(orderContainer, &marketWallets);
+
+	for (auto stage : { LatencyStage::ValidateFunds, LatencyStage::ValidateSameUserOrder,
+	     LatencyStage::Process, LatencyStage::CommitChanges }) {
+		ASSERT_EQ(latencyStats.Get(OrderType::Limit, stage).GetCount(), 1u);
+	}
+
+	// Translation is only done by the trading engine
+	ASSERT_EQ(latencyStats.Get(OrderType::Limit, LatencyStage::Translate).GetCount(), 0u);
+	ASSERT_EQ(latencyStats.Get(OrderType::Market, LatencyStage::Process).GetCount(), 0u);
+
+	std::ostringstream ss;
+	latencyStats.Dump(ss, market.GetCoinPair());
+	ASSERT_NE(ss.str().find("LimitOrder CommitChanges count=1"), std::string::npos);
+}
@@ -2,6 +2,12 @@
 
 #include <TradingEngine/CoinPair.h>
 #include <TradingEngine/Market.h>
+#include <TradingEngine/Orders/MarketOrder.h>
+#include <TradingEngine/Orders/OrderAction.h>
+#include <TradingEngine/Orders/OrderContainer.h>
+#include <TradingEngine/Orders/StopLimitOrder.h>
+#include <TradingEngine/Units.h>
+#include <TradingEngine/Wallet.h>
 #include <TradingEngine/market_helper.h>
 #include <gtest/gtest.h>
 #include <memory>
@@ -18,3 +24,51 @@ TEST(TestMarket, defaults) {
 	ASSERT_EQ(market.GetSellStopLimitOrderMap().size(), 0u);
 	ASSERT_EQ(market.GetCoinPair(), coinPair);
 }
+
+TEST(TestMarket, marketBuyAcrossPricesUsesScaledFunds) {
+	Wallet coinWallet{ 4 };
+	Wallet baseWallet{ 2 };
+	coinWallet.Deposit(7, Units::ExToIn(20.0));
+	baseWallet.Deposit(6, Units::ExToIn(11.0));
+	MarketWallets marketWallets{ &coinWallet, &baseWallet };
+
+	Market market(std::make_unique<StubListener>(), { 4, 2 }, createStubMarketConfig());
+	market.NewProcess<OrderAction::Sell>(OrderContainer<LimitOrder>{ { 7, Units::ExToIn(10.0), 0 }, Units::ExToIn(0.5) },
+	&marketWallets);
+	market.NewProcess<OrderAction::Sell>(OrderContainer<LimitOrder>{ { 7, Units::ExToIn(10.0), 0 }, Units::ExToIn(0.6) },
+	&marketWallets);
+
+	// Costs exactly 5 + 6
+	OrderContainer<MarketOrder> marketOrder{ { 6, Units::ExToIn(20.0) }, 0 };
+	ASSERT_NO_THROW(market.NewProcess<OrderAction::Buy>(marketOrder, &marketWallets));
+	ASSERT_EQ(market.GetSellLimitOrderMap().size(), 0u);
+	ASSERT_EQ(baseWallet.GetAddress(6)->GetTotalBalance(), 0);
+}
+
+TEST(TestMarket, triggeredStopCarriesOnPartWayThroughLevel) {
+	Wallet coinWallet{ 4 };
+	Wallet baseWallet{ 2 };
+	coinWallet.Deposit(7, Units::ExToIn(3.0));
+	baseWallet.Deposit(6, Units::ExToIn(10.0));
+	baseWallet.Deposit(8, Units::ExToIn(10.0));
+	MarketWallets marketWallets{ &coinWallet, &baseWallet };
+
+	Market market(std::make_unique<StubListener>(), { 4, 2 }, createStubMarketConfig());
+	for (int i = 0; i < 3; ++i) {
+		market.NewProcess<OrderAction::Sell>(OrderContainer<LimitOrder>{ { 7, Units::ExToIn(1.0), 0 }, Units::ExToIn(0.5) },
+		&marketWallets);
+	}
+	market.NewProcess<OrderAction::Buy>(OrderContainer<StopLimitOrder>{ { 8, Units::ExToIn(1.5), 0, Units::ExToIn(0.5) }, Units::ExToIn(0.5) },
+	&marketWallets);
+
+	// Fills the first order exactly, the stop order it triggers takes the rest from the second one on
+	market.NewProcess<OrderAction::Buy>(OrderContainer<LimitOrder>{ { 6, Units::ExToIn(1.0), 0 }, Units::ExToIn(0.5) },
+	&marketWallets);
+	ASSERT_EQ(market.GetBuyStopLimitOrderMap().size(), 0u);
+	ASSERT_EQ(market.GetBuyLimitOrderMap().size(), 0u);
+	const auto& sellOrders = market.GetSellLimitOrderMap().at(Units::ExToIn(0.5));
+	ASSERT_EQ(sellOrders.size(), 1u);
+	ASSERT_EQ(sellOrders.front().GetId(), 3);
+	ASSERT_EQ(sellOrders.front().GetRemaining(), Units::ExToIn(0.5));
+	ASSERT_EQ(coinWallet.GetAddress(8)->GetTotalBalance(), Units::ExToIn(1.5) - Units::ExToIn(1.5) / createStubMarketConfig().feeDivision);
+}
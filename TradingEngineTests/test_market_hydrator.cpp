@@ -0,0 +1,177 @@
+#include "StubListener.h"
+
+#include <TradingEngine/CoinPair.h>
+#include <TradingEngine/Error.h>
+#include <TradingEngine/Market.h>
+#include <TradingEngine/MarketHydrator.h>
+#include <TradingEngine/MarketManager.h>
+#include <TradingEngine/NodePool.h>
+#include <TradingEngine/Orders/LimitOrder.h>
+#include <TradingEngine/Orders/OrderAction.h>
+#include <TradingEngine/Orders/OrderContainer.h>
+#include <TradingEngine/PlatformSpecific/fork_process.h>
+#include <TradingEngine/Units.h>
+#include <TradingEngine/WalletManager.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+MarketConfig createStubMarketConfig();
+
+namespace {
+const int32_t userId = 6;
+
+// Stands in for decoding the market from a snapshot, counting how often it's done
+MarketLoader CreateLoader(const CoinPair& coinPair, std::atomic<int>* numLoads, int32_t orderUserId = userId) {
+	return [coinPair, numLoads, orderUserId](Market* market) {
+		++*numLoads;
+		*market = Market{ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() };
+		for (int64_t i = 1; i <= 10; ++i) {
+			market->ForceAddOrder<OrderAction::Buy>(OrderContainer<LimitOrder>{ { orderUserId, Units::ExToIn(1.0), i }, Units::ExToIn(0.1) * i });
+		}
+	};
+}
+
+bool WaitForWarmUp(const MarketManager& marketManager) {
+	for (int i = 0; i < 1000 && !marketManager.IsWarmedUp(); ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	return marketManager.IsWarmedUp();
+}
+}
+
+class MarketHydration : public ::testing::Test {
+protected:
+	MarketManager marketManager;
+	std::vector<CoinPair> coinPairs{ { 1, 2 }, { 3, 2 }, { 1, 4 } };
+	std::map<CoinPair, std::atomic<int>> numLoads;
+
+	void SetUp() override {
+		for (const auto& coinPair : coinPairs) {
+			marketManager.RegisterMarket(coinPair, CreateLoader(coinPair, &numLoads[coinPair]), { userId });
+		}
+	}
+};
+
+TEST_F(MarketHydration, onFirstUse) {
+	ASSERT_EQ(marketManager.GetNumPendingMarkets(), 3u);
+	ASSERT_TRUE(marketManager.GetMarkets().empty() || marketManager.GetMarkets().begin()->second.empty());
+
+	auto market = marketManager.GetMarket({ 3, 2 });
+	ASSERT_EQ(market->GetCoinPair(), CoinPair(3, 2));
+	ASSERT_EQ(market->GetMemoryUsage().numOrders, 10u);
+	ASSERT_EQ(numLoads[CoinPair(3, 2)], 1);
+	ASSERT_EQ(numLoads[CoinPair(1, 2)], 0);
+	ASSERT_EQ(marketManager.GetNumPendingMarkets(), 2u);
+
+	// Only once
+	ASSERT_EQ(&*marketManager.GetMarket({ 3, 2 }), &*market);
+	ASSERT_EQ(numLoads[CoinPair(3, 2)], 1);
+
+	// Sorted in with the others
+	marketManager.GetMarket({ 1, 2 });
+	ASSERT_EQ(marketManager.GetMarkets().at(2).front().GetCoinPair(), CoinPair(1, 2));
+	ASSERT_EQ(marketManager.GetMarkets().at(2).back().GetCoinPair(), CoinPair(3, 2));
+
+	// It's in its base coin's shard
+	auto reserved = marketManager.GetPoolShard(2).GetReservedBytes();
+	ASSERT_GE(reserved, NodePool::slabSize);
+	market = marketManager.GetMarket({ 3, 2 });
+	market->CancelAll();
+	marketManager.GetMarket({ 1, 2 })->CancelAll();
+	ASSERT_EQ(marketManager.GetPoolShard(2).Trim(), reserved);
+}
+
+TEST_F(MarketHydration, alreadyExists) {
+	ASSERT_THROW(marketManager.RegisterMarket({ 1, 2 }, CreateLoader({ 1, 2 }, &numLoads[CoinPair(1, 2)])), Error);
+	ASSERT_THROW(marketManager.AddMarket({ std::make_unique<StubListener>(), { 1, 4 }, createStubMarketConfig() }), Error);
+
+	marketManager.AddMarket({ std::make_unique<StubListener>(), { 5, 4 }, createStubMarketConfig() });
+	ASSERT_THROW(marketManager.RegisterMarket({ 5, 4 }, CreateLoader({ 5, 4 }, &numLoads[CoinPair(5, 4)])), Error);
+}
+
+TEST_F(MarketHydration, warmUp) {
+	marketManager.StartWarmUp({ { 1, 4 } });
+	ASSERT_EQ(ps::ForkGuard::GetNumHeld(), 1u); // No snapshots are forked while it runs
+	ASSERT_TRUE(WaitForWarmUp(marketManager));
+	marketManager.StopWarmUp();
+	ASSERT_EQ(ps::ForkGuard::GetNumHeld(), 0u);
+	ASSERT_EQ(marketManager.GetNumPendingMarkets(), 3u);
+
+	// Picked up from the warm-up without being decoded again
+	for (const auto& coinPair : coinPairs) {
+		auto market = marketManager.GetMarket(coinPair);
+		ASSERT_EQ(market->GetMemoryUsage().numOrders, 10u);
+		ASSERT_EQ(numLoads[coinPair], 1);
+	}
+
+	// Decoded a base coin at a time, the markets of each share a shard which is counted and
+	// trimmed as well
+	PoolShard marketPoolShard;
+	{
+		std::atomic<int> numMarketLoads{ 0 };
+		ScopedPoolShard scopedPoolShard(marketPoolShard);
+		Market market;
+		CreateLoader({ 1, 2 }, &numMarketLoads)(&market);
+	}
+	auto marketBytes = marketPoolShard.GetReservedBytes();
+	ASSERT_EQ(marketManager.GetPoolShard(2).GetReservedBytes(), 0u);
+	marketManager.TrimPools();
+	ASSERT_EQ(marketManager.GetReservedPoolBytes() - PoolShard::GetDefault().GetReservedBytes(), 2 * marketBytes);
+	for (const auto& coinPair : coinPairs) {
+		marketManager.GetMarket(coinPair)->CancelAll();
+	}
+	ASSERT_EQ(marketManager.TrimPools(), 2 * marketBytes);
+}
+
+TEST_F(MarketHydration, cancelAllHydratesUsersMarkets) {
+	// Another user's market, which is left pending
+	const int32_t otherUserId = 7;
+	marketManager.RegisterMarket({ 5, 4 }, CreateLoader({ 5, 4 }, &numLoads[CoinPair(5, 4)], otherUserId), { otherUserId });
+	ASSERT_EQ(marketManager.GetUserMarkets().at(userId).size(), 3u);
+
+	WalletManager walletManager;
+	for (int32_t coinId = 1; coinId <= 5; ++coinId) {
+		walletManager.AddWallet({ coinId });
+		walletManager.GetWallet(coinId)->AddAddress({ userId });
+	}
+
+	auto cancelledOrderMap = marketManager.CancelAll(userId, walletManager);
+	ASSERT_EQ(marketManager.GetNumPendingMarkets(), 1u);
+	ASSERT_EQ(numLoads[CoinPair(5, 4)], 0);
+	ASSERT_EQ(cancelledOrderMap.size(), 3u);
+	for (const auto& coinPair : coinPairs) {
+		ASSERT_EQ(cancelledOrderMap.at(coinPair).size(), 10u);
+	}
+	ASSERT_EQ(marketManager.GetUserMarkets().count(userId), 0u);
+	ASSERT_EQ(marketManager.GetUserMarkets().at(otherUserId).size(), 1u);
+}
+
+TEST_F(MarketHydration, loaderFails) {
+	std::atomic<int> numAttempts{ 0 };
+	marketManager.RegisterMarket({ 5, 4 }, [&numAttempts](Market* market) {
+		if (++numAttempts == 1) {
+			throw std::runtime_error("corrupt");
+		}
+		*market = Market{ std::make_unique<StubListener>(), { 5, 4 }, createStubMarketConfig() };
+	});
+
+	// Still pending, so it can be tried again
+	ASSERT_THROW(marketManager.GetMarket({ 5, 4 }), std::runtime_error);
+	ASSERT_EQ(marketManager.GetNumPendingMarkets(), 4u);
+	ASSERT_EQ(marketManager.GetMarket({ 5, 4 })->GetCoinPair(), CoinPair(5, 4));
+	ASSERT_EQ(numAttempts, 2);
+}
+
+TEST_F(MarketHydration, replacedBeforeHydrating) {
+	marketManager.SetMarket({ std::make_unique<StubListener>(), { 3, 2 }, createStubMarketConfig() });
+	ASSERT_EQ(marketManager.GetNumPendingMarkets(), 2u);
+	ASSERT_EQ(marketManager.GetMarket({ 3, 2 })->GetMemoryUsage().numOrders, 0u);
+	ASSERT_EQ(numLoads[CoinPair(3, 2)], 0);
+}
@@ -67,7 +67,7 @@ TEST(TestMarketListener, mockListener) {
 		expectedBuyLimitOrder.AddToFill(Units::ExToIn(100.0));
 
 		auto buyFee = Units::ExToIn(100.0) / fee;
-		auto sellFee = Units::ScaleDown(Units::ExToIn(100.0) * Units::ExToIn(0.1)) / fee;
+		auto sellFee = Units::Multiply(Units::ExToIn(100.0), Units::ExToIn(0.1)) / fee;
 		Fee fees{ buyFee, sellFee };
 		auto price = Units::ExToIn(0.2);
 
@@ -90,7 +90,7 @@ TEST(TestMarketListener, mockListener) {
 		expectedMarketSellOrder.AddToFill(Units::ExToIn(25.0));
 
 		auto buyFee = Units::ExToIn(25.0) / fee;
-		auto sellFee = Units::ScaleDown(Units::ExToIn(25.0) * Units::ExToIn(0.2)) / fee;
+		auto sellFee = Units::Multiply(Units::ExToIn(25.0), Units::ExToIn(0.2)) / fee;
 		Fee fees{ buyFee, sellFee };
 
 		OrderContainer expectedOrderContainer{ expectedMarketSellOrder, 0 };
@@ -129,14 +129,14 @@ TEST(TestMarketListener, mockListener) {
 	expectedMarketSellOrder.AddToFill(Units::ExToIn(55.0));
 
 	auto buyFees = Units::ExToIn(25.0) / fee;
-	auto sellFees = Units::ScaleDown(Units::ExToIn(25.0) * Units::ExToIn(0.2)) / fee;
+	auto sellFees = Units::Multiply(Units::ExToIn(25.0), Units::ExToIn(0.2)) / fee;
 	Fee fees{ buyFees, sellFees };
 
 	EXPECT_CALL(mockListener, NewTrade(3, 2, 7, Units::ExToIn(25.0), Units::ExToIn(0.2), fees)).Times(1);
 	EXPECT_CALL(mockListener, OrderFilled(2)).Times(1);
 
 	buyFees = Units::ExToIn(30.0) / fee;
-	sellFees = Units::ScaleDown(Units::ExToIn(30.0) * Units::ExToIn(0.2)) / fee;
+	sellFees = Units::Multiply(Units::ExToIn(30.0), Units::ExToIn(0.2)) / fee;
 	fees = { buyFees, sellFees };
 
 	EXPECT_CALL(mockListener, NewTrade(4, 4, 7, Units::ExToIn(30.0), Units::ExToIn(0.2), fees)).Times(1);
@@ -150,7 +150,7 @@ TEST(TestMarketListener, mockListener) {
 	EXPECT_CALL(mockListener, StopLimitTriggered(5, 4)).Times(1);
 
 	buyFees = Units::ExToIn(50.0) / fee;
-	sellFees = Units::ScaleDown(Units::ExToIn(50.0) * Units::ExToIn(0.2)) / fee;
+	sellFees = Units::Multiply(Units::ExToIn(50.0), Units::ExToIn(0.2)) / fee;
 	fees = { buyFees, sellFees };
 	LimitOrder expectedLimitSellOrder{ 6, Units::ExToIn(50.0), Units::ExToIn(50.0) }; // Id 5
 	expectedLimitSellOrder.SetId(5);
@@ -163,7 +163,7 @@ TEST(TestMarketListener, mockListener) {
 
 	// Second stop order
 	buyFees = Units::ExToIn(20.0) / fee;
-	sellFees = Units::ScaleDown(Units::ExToIn(20.0) * Units::ExToIn(0.2)) / fee;
+	sellFees = Units::Multiply(Units::ExToIn(20.0), Units::ExToIn(0.2)) / fee;
 	fees = { buyFees, sellFees };
 	EXPECT_CALL(mockListener, StopLimitTriggered(6, 4)).Times(1);
 	EXPECT_CALL(mockListener, NewTrade(6, 4, 6, Units::ExToIn(20.0), Units::ExToIn(0.2), fees)).Times(1);
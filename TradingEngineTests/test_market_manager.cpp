@@ -4,8 +4,14 @@
 #include <TradingEngine/Error.h>
 #include <TradingEngine/Market.h>
 #include <TradingEngine/MarketManager.h>
+#include <TradingEngine/Orders/OrderAction.h>
+#include <TradingEngine/Orders/OrderContainer.h>
+#include <TradingEngine/Units.h>
+#include <TradingEngine/Wallet.h>
+#include <TradingEngine/WalletManager.h>
 #include <TradingEngine/market_helper.h>
 #include <algorithm>
+#include <cstdint>
 #include <gtest/gtest.h>
 #include <memory>
 
@@ -47,3 +53,168 @@ TEST(TestMarketManager, getMarket) {
 	// Recheck first market
 	ASSERT_EQ(market.GetCoinPair(), marketManager.GetMarket(coinPair)->GetCoinPair());
 }
+
+TEST(TestMarketManager, cancelAllOnlyVisitsUsersMarkets) {
+	WalletManager walletManager;
+	walletManager.AddWallet({ 1 });
+	walletManager.AddWallet({ 2 });
+	walletManager.AddWallet({ 3 });
+	walletManager.GetWallet(2)->Deposit(6, Units::ExToIn(100.0));
+
+	MarketManager marketManager;
+	CoinPair coinPair{ 1, 2 };
+	CoinPair anotherCoinPair{ 3, 2 };
+	marketManager.AddMarket({ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() });
+	marketManager.AddMarket({ std::make_unique<StubListener>(), anotherCoinPair,
+	createStubMarketConfig() });
+
+	MarketWallets marketWallets{ &*walletManager.GetWallet(1), &*walletManager.GetWallet(2) };
+	OrderContainer<LimitOrder> orderContainer{ { 6, Units::ExToIn(10.0), 0 }, Units::ExToIn(0.5) };
+	marketManager.GetMarket(coinPair)->NewProcess<OrderAction::Buy>(orderContainer, &marketWallets);
+	marketManager.AddUserMarket(6, coinPair);
+	marketManager.AddUserMarket(6, coinPair); // Duplicates are ignored
+	ASSERT_EQ(marketManager.GetUserMarkets().at(6).size(), 1u);
+
+	auto cancelledOrderMap = marketManager.CancelAll(6, walletManager);
+	ASSERT_EQ(cancelledOrderMap.size(), 1u);
+	ASSERT_EQ(cancelledOrderMap.at(coinPair).size(), 1u);
+	ASSERT_EQ(walletManager.GetWallet(2)->GetAddress(6)->GetInOrder(), 0);
+	ASSERT_EQ(marketManager.GetMarket(coinPair)->GetBuyLimitOrderMap().size(), 0u);
+	ASSERT_EQ(marketManager.GetUserMarkets().count(6), 0u);
+
+	// A user with no orders anywhere
+	ASSERT_EQ(marketManager.CancelAll(7, walletManager).size(), 0u);
+}
+
+TEST(TestMarketManager, addMarketIndexesExistingOrders) {
+	CoinPair coinPair{ 1, 2 };
+	Market market{ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() };
+	market.ForceAddOrder<OrderAction::Sell>(OrderContainer<LimitOrder>{ { 8, 100, 0 }, 50 });
+
+	MarketManager marketManager;
+	marketManager.AddMarket(std::move(market));
+	ASSERT_EQ(marketManager.GetUserMarkets().at(8).front(), coinPair);
+}
+
+TEST(TestMarketManager, inOrderMatchesReservations) {
+	WalletManager walletManager;
+	walletManager.AddWallet({ 1 });
+	walletManager.AddWallet({ 2 });
+	walletManager.GetWallet(2)->Deposit(6, Units::ExToIn(100.0));
+	walletManager.GetWallet(1)->Deposit(7, Units::ExToIn(100.0));
+
+	MarketManager marketManager;
+	CoinPair coinPair{ 1, 2 };
+	marketManager.AddMarket({ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() });
+	auto market = marketManager.GetMarket(coinPair);
+	MarketWallets marketWallets{ &*walletManager.GetWallet(1), &*walletManager.GetWallet(2) };
+	ASSERT_TRUE(marketManager.InOrderMatchesReservations(walletManager));
+
+	OrderContainer<LimitOrder> buyOrder{ { 6, Units::ExToIn(10.0), 0 }, Units::ExToIn(0.5) };
+	market->NewProcess<OrderAction::Buy>(buyOrder, &marketWallets);
+	// Buys hold the notional in the base wallet
+	ASSERT_EQ(market->GetReservations().buy, Units::ExToIn(5.0));
+	ASSERT_EQ(walletManager.GetWallet(2)->GetTotalInOrder(), Units::ExToIn(5.0));
+	ASSERT_TRUE(marketManager.InOrderMatchesReservations(walletManager));
+
+	// Partially fill the buy and leave some of the sell on the book
+	OrderContainer<LimitOrder> sellOrder{ { 7, Units::ExToIn(4.0), 0 }, Units::ExToIn(0.5) };
+	market->NewProcess<OrderAction::Sell>(sellOrder, &marketWallets);
+	ASSERT_EQ(market->GetReservations().buy, Units::ExToIn(3.0));
+	ASSERT_TRUE(marketManager.InOrderMatchesReservations(walletManager));
+	OrderContainer<LimitOrder> anotherSellOrder{ { 7, Units::ExToIn(8.0), 0 }, Units::ExToIn(0.5) };
+	market->NewProcess<OrderAction::Sell>(anotherSellOrder, &marketWallets);
+	ASSERT_EQ(market->GetReservations().buy, 0);
+	ASSERT_EQ(market->GetReservations().sell, Units::ExToIn(2.0));
+	ASSERT_TRUE(marketManager.InOrderMatchesReservations(walletManager));
+
+	// Wallet totals are kept up to date along with the addresses
+	ASSERT_EQ(walletManager.GetWallet(1)->GetTotalInOrder(), Units::ExToIn(2.0));
+	ASSERT_EQ(walletManager.GetWallet(2)->GetTotalInOrder(), 0);
+
+	marketManager.AddUserMarket(7, coinPair);
+	marketManager.CancelAll(7, walletManager);
+	ASSERT_EQ(market->GetReservations(), BookReservations());
+	ASSERT_TRUE(marketManager.InOrderMatchesReservations(walletManager));
+
+	// An admin override of an in order amount is detected
+	walletManager.GetWallet(2)->GetAddress(6)->SetInOrder(1);
+	ASSERT_FALSE(marketManager.InOrderMatchesReservations(walletManager));
+}
+
+TEST(TestMarketManager, buysReleaseWhatTheyReserved) {
+	WalletManager walletManager;
+	walletManager.AddWallet({ 1 });
+	walletManager.AddWallet({ 2 });
+	walletManager.GetWallet(2)->Deposit(6, Units::ExToIn(100.0));
+	walletManager.GetWallet(1)->Deposit(7, Units::ExToIn(100.0));
+
+	MarketManager marketManager;
+	CoinPair coinPair{ 1, 2 };
+	marketManager.AddMarket({ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() });
+	auto market = marketManager.GetMarket(coinPair);
+	MarketWallets marketWallets{ &*walletManager.GetWallet(1), &*walletManager.GetWallet(2) };
+	auto buyersBase = [&walletManager]() { return walletManager.GetWallet(2)->GetAddress(6); };
+
+	// Buys 4 at the better price of 0.4, the rest holds its notional at 0.5
+	OrderContainer<LimitOrder> sellOrder{ { 7, Units::ExToIn(4.0), 0 }, Units::ExToIn(0.4) };
+	market->NewProcess<OrderAction::Sell>(sellOrder, &marketWallets);
+	OrderContainer<LimitOrder> buyOrder{ { 6, Units::ExToIn(10.0), 0 }, Units::ExToIn(0.5) };
+	market->NewProcess<OrderAction::Buy>(buyOrder, &marketWallets);
+	ASSERT_EQ(buyersBase()->GetTotalBalance(), Units::ExToIn(98.4));
+	ASSERT_EQ(buyersBase()->GetInOrder(), Units::ExToIn(3.0));
+	ASSERT_TRUE(marketManager.InOrderMatchesReservations(walletManager));
+
+	// Fills too small for the notional to divide evenly
+	for (int i = 0; i < 3; ++i) {
+		OrderContainer<LimitOrder> tinySellOrder{ { 7, 1, 0 }, Units::ExToIn(0.5) };
+		market->NewProcess<OrderAction::Sell>(tinySellOrder, &marketWallets);
+		auto remaining = market->GetBuyLimitOrderMap().begin()->second.front().GetRemaining();
+		ASSERT_EQ(buyersBase()->GetInOrder(), Units::Multiply(remaining, Units::ExToIn(0.5)));
+		ASSERT_TRUE(marketManager.InOrderMatchesReservations(walletManager));
+	}
+
+	OrderContainer<LimitOrder> restSellOrder{ { 7, Units::ExToIn(6.0) - 3, 0 }, Units::ExToIn(0.5) };
+	market->NewProcess<OrderAction::Sell>(restSellOrder, &marketWallets);
+	ASSERT_EQ(buyersBase()->GetInOrder(), 0);
+	ASSERT_EQ(market->GetReservations(), BookReservations());
+	ASSERT_TRUE(marketManager.InOrderMatchesReservations(walletManager));
+}
+
+TEST(TestMarketManager, userFeeTiersAreShared) {
+	MarketManager marketManager;
+	marketManager.SetFeeTier(1, 0.0, 0.2);
+	marketManager.SetUserFeeTier(6, 1);
+
+	// Markets added afterwards (i.e hydrated) pick the tiers up too
+	CoinPair coinPair{ 1, 2 };
+	Market market{ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() };
+	market.SetFeeTier(1, 0.0, 0.2);
+	market.ForceAddOrder<OrderAction::Sell>(OrderContainer<LimitOrder>{ { 8, Units::ExToIn(100.0), 0 }, Units::ExToIn(0.5) });
+	marketManager.AddMarket(std::move(market));
+
+	OrderContainer<LimitOrder> buyOrder{ { 6, Units::ExToIn(10.0), 0 }, Units::ExToIn(0.5) };
+	auto quote = marketManager.GetMarket(coinPair)->Quote<OrderAction::Buy>(buyOrder);
+	ASSERT_EQ(quote.fees.buyFee, Units::ExToIn(10.0) / 500);
+
+	// Copies refer to the same table rather than having their own
+	auto copy = *marketManager.GetMarket(coinPair);
+	marketManager.SetUserFeeTier(6, 0);
+	ASSERT_EQ(copy.Quote<OrderAction::Buy>(buyOrder).fees.buyFee,
+	Units::ExToIn(10.0) / createStubMarketConfig().feeDivision);
+}
+
+TEST(TestMarketManager, orderBooksDontMove) {
+	MarketManager marketManager;
+	CoinPair coinPair{ 5, 9 };
+	marketManager.AddMarket({ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() });
+	const auto* buyLimitOrderMap = &marketManager.GetMarket(coinPair)->GetBuyLimitOrderMap();
+	ASSERT_EQ(reinterpret_cast<uintptr_t>(buyLimitOrderMap) % 64, 0u);
+
+	// These go before it in the same vector, so the market itself is moved
+	for (int32_t coinId = 1; coinId < 5; ++coinId) {
+		marketManager.AddMarket({ std::make_unique<StubListener>(), { coinId, 9 }, createStubMarketConfig() });
+	}
+
+	ASSERT_EQ(&marketManager.GetMarket(coinPair)->GetBuyLimitOrderMap(), buyLimitOrderMap);
+}
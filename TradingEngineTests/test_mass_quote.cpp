@@ -0,0 +1,179 @@
+#include "message_conversion_testing_helper.h"
+
+#include <TradingEngine/Error.h>
+#include <TradingEngine/Listener/NullListener.h>
+#include <TradingEngine/Market.h>
+#include <TradingEngine/MassQuote.h>
+#include <TradingEngine/Message.h>
+#include <TradingEngine/MessageType.h>
+#include <TradingEngine/Orders/OrderAction.h>
+#include <TradingEngine/Orders/OrderContainer.h>
+#include <TradingEngine/TradingEngine.h>
+#include <TradingEngine/Units.h>
+#include <TradingEngine/Wallet.h>
+#include <TradingEngine/market_helper.h>
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+class MassQuoting : public ::testing::Test {
+protected:
+	Wallet coinWallet = CreateWallet(0);
+	Wallet baseWallet = CreateBaseWallet(0);
+	MarketWallets marketWallets{ &coinWallet, &baseWallet };
+	Market market{ std::make_unique<NullListener>(), CreateCoinPair(), CreateMarketConfig() };
+
+	// The market maker (BuyUserId) has a bid at 0.5 (id 1) and someone else an ask at 0.7 (id 2)
+	void SetUp() override {
+		market.NewProcess<OrderAction::Buy>(OrderContainer<LimitOrder>{ CreateLimitOrder(BuyUserId()), Units::ExToIn(0.5) }, &marketWallets);
+		market.NewProcess<OrderAction::Sell>(OrderContainer<LimitOrder>{ CreateLimitOrder(SellUserId()), Units::ExToIn(0.7) }, &marketWallets);
+	}
+
+	static QuoteLevel Level(double price, double amount) {
+		return { Units::ExToIn(price), Units::ExToIn(amount) };
+	}
+
+	template <class OrderMap>
+	static std::vector<int64_t> GetIds(const OrderMap& orderMap, double price) {
+		std::vector<int64_t> ids;
+		for (const auto& limitOrder : orderMap.at(Units::ExToIn(price))) {
+			ids.push_back(limitOrder.GetId());
+		}
+		return ids;
+	}
+
+	void ExpectUnchanged() {
+		ASSERT_EQ(market.GetBuyLimitOrderMap().size(), 1u);
+		ASSERT_EQ(GetIds(market.GetBuyLimitOrderMap(), 0.5), (std::vector<int64_t>{ 1 }));
+		ASSERT_EQ(market.GetSellLimitOrderMap().size(), 1u);
+		ASSERT_EQ(baseWallet.GetAddress(BuyUserId())->GetInOrder(), Units::ExToIn(100.0));
+		ASSERT_EQ(coinWallet.GetAddress(BuyUserId())->GetInOrder(), 0);
+		ASSERT_EQ(market.GetReservations(), (BookReservations{ Units::ExToIn(100.0), GetOrderAmount() }));
+	}
+};
+
+TEST_F(MassQuoting, replaces) {
+	MassQuote massQuote{ { Level(0.55, 100), Level(0.5, 100) }, { Level(0.65, 50) } };
+	auto replacedIds = market.ReplaceQuotes(BuyUserId(), massQuote, &marketWallets);
+	ASSERT_EQ(replacedIds, (std::vector<int64_t>{ 1 }));
+
+	// New ids, and the quotes go behind anything already at the price
+	ASSERT_EQ(GetIds(market.GetBuyLimitOrderMap(), 0.55), (std::vector<int64_t>{ 3 }));
+	ASSERT_EQ(GetIds(market.GetBuyLimitOrderMap(), 0.5), (std::vector<int64_t>{ 4 }));
+	ASSERT_EQ(GetIds(market.GetSellLimitOrderMap(), 0.65), (std::vector<int64_t>{ 5 }));
+	ASSERT_EQ(GetIds(market.GetSellLimitOrderMap(), 0.7), (std::vector<int64_t>{ 2 }));
+
+	// The bids hold their notional, 100 at 0.55 and 100 at 0.5
+	ASSERT_EQ(baseWallet.GetAddress(BuyUserId())->GetInOrder(), Units::ExToIn(105.0));
+	ASSERT_EQ(coinWallet.GetAddress(BuyUserId())->GetInOrder(), Units::ExToIn(50.0));
+	ASSERT_EQ(market.GetReservations(), (BookReservations{ Units::ExToIn(105.0), GetOrderAmount() + Units::ExToIn(50.0) }));
+
+	const auto& buyPriceOrderIds = market.GetUserOrderCache<OrderAction::Buy, LimitOrder>(BuyUserId());
+	ASSERT_EQ(buyPriceOrderIds, (std::vector<PriceOrderId>{ { Units::ExToIn(0.55), 3 }, { Units::ExToIn(0.5), 4 } }));
+	ASSERT_EQ((market.GetUserOrderCache<OrderAction::Sell, LimitOrder>(BuyUserId()).size()), 1u);
+
+	// An empty quote pulls everything
+	replacedIds = market.ReplaceQuotes(BuyUserId(), {}, &marketWallets);
+	std::sort(replacedIds.begin(), replacedIds.end());
+	ASSERT_EQ(replacedIds, (std::vector<int64_t>{ 3, 4, 5 }));
+	ASSERT_TRUE(market.GetBuyLimitOrderMap().empty());
+	ASSERT_EQ(market.GetSellLimitOrderMap().size(), 1u);
+	ASSERT_EQ(baseWallet.GetAddress(BuyUserId())->GetInOrder(), 0);
+	ASSERT_EQ(coinWallet.GetAddress(BuyUserId())->GetInOrder(), 0);
+	ASSERT_EQ(market.GetReservations(), (BookReservations{ 0, GetOrderAmount() }));
+}
+
+TEST_F(MassQuoting, ownOrdersDontCross) {
+	// Below their own bid at 0.5, which is being replaced
+	market.ReplaceQuotes(BuyUserId(), { {}, { Level(0.45, 10) } }, &marketWallets);
+	ASSERT_TRUE(market.GetBuyLimitOrderMap().empty());
+	ASSERT_EQ(market.GetSellLimitOrderMap().begin()->first, Units::ExToIn(0.45));
+}
+
+TEST_F(MassQuoting, othersBehindOwnOrdersCross) {
+	// Someone else joins the bid at 0.5, behind the market maker's own
+	market.NewProcess<OrderAction::Buy>(OrderContainer<LimitOrder>{ CreateLimitOrder(SellUserId()), Units::ExToIn(0.5) }, &marketWallets);
+	ASSERT_THROW(market.ReplaceQuotes(BuyUserId(), { {}, { Level(0.5, 10) } }, &marketWallets), Error);
+
+	market.ReplaceQuotes(BuyUserId(), { {}, { Level(0.55, 10) } }, &marketWallets);
+	ASSERT_EQ(market.GetSellLimitOrderMap().begin()->first, Units::ExToIn(0.55));
+}
+
+TEST_F(MassQuoting, rejected) {
+	auto expectError = [this](const MassQuote& massQuote, Error::Type type) {
+		try {
+			market.ReplaceQuotes(BuyUserId(), massQuote, &marketWallets);
+			FAIL() << "Expected an error";
+		} catch (const Error& error) {
+			ASSERT_EQ(error.GetType(), type);
+		}
+		ExpectUnchanged();
+	};
+
+	// Crosses someone else's ask, or itself
+	expectError({ { Level(0.7, 10) }, {} }, Error::Type::InvalidQuote);
+	expectError({ { Level(0.6, 10) }, { Level(0.6, 10) } }, Error::Type::InvalidQuote);
+
+	expectError({ { Level(0.5, 0) }, {} }, Error::Type::InvalidQuote);
+	expectError({ { Level(0, 10) }, {} }, Error::Type::InvalidQuote);
+
+	// The bid being replaced frees up its funds, but not enough
+	expectError({ { Level(0.5, 2000), Level(0.4, 1500) }, {} }, Error::Type::InsufficientFunds);
+	expectError({ {}, { Level(0.8, 1000), Level(0.9, 501) } }, Error::Type::InsufficientFunds);
+
+	market.SetMaxNumLimitOpenOrders(2);
+	expectError({ { Level(0.5, 10), Level(0.4, 10) }, { Level(0.8, 10) } }, Error::Type::ReachedNumOpenOrders);
+
+	// Just enough
+	market.SetMaxNumLimitOpenOrders(3);
+	market.ReplaceQuotes(BuyUserId(), { { Level(0.5, 2000), Level(0.4, 1250) }, { Level(0.8, 1500) } }, &marketWallets);
+	ASSERT_EQ(market.GetBuyLimitOrderMap().size(), 2u);
+}
+
+TEST(MassQuoteMessage, process) {
+	TradingEngine tradingEngine;
+	for (const auto& message : ToMessages(CreateWalletManager())) {
+		(void)tradingEngine.Process(message);
+	}
+
+	Message newMarket;
+	newMarket.messageType = MessageType::NewMarket;
+	newMarket.coinId = CreateCoinPair().GetCoinId();
+	newMarket.baseId = CreateCoinPair().GetBaseId();
+	newMarket.feePercentage = 0.1;
+	newMarket.maxNumLimitOpenOrders = 10;
+	newMarket.maxNumStopLimitOpenOrders = 10;
+	(void)tradingEngine.Process(newMarket);
+
+	Message message;
+	message.messageType = MessageType::MassQuote;
+	message.coinId = CreateCoinPair().GetCoinId();
+	message.baseId = CreateCoinPair().GetBaseId();
+	message.userId = BuyUserId();
+	Message::massQuote = { { { Units::ExToIn(0.5), Units::ExToIn(10.0) } }, { { Units::ExToIn(0.6), Units::ExToIn(10.0) } } };
+
+	auto outputMessages = tradingEngine.Process(message);
+	ASSERT_EQ(outputMessages.size(), 3u);
+	ASSERT_EQ(outputMessages[0], message);
+	ASSERT_EQ(outputMessages[1].messageType, MessageType::NewOpenOrder);
+	ASSERT_TRUE(outputMessages[1].isBuy);
+	ASSERT_EQ(outputMessages[2].messageType, MessageType::NewOpenOrder);
+	ASSERT_FALSE(outputMessages[2].isBuy);
+	ASSERT_TRUE(Message::cancelOrders.empty());
+
+	// Requoting cancels both
+	outputMessages = tradingEngine.Process(message);
+	ASSERT_EQ(outputMessages.size(), 3u);
+	ASSERT_EQ(Message::cancelOrders, "3_1_1 3_1_2");
+	ASSERT_TRUE(tradingEngine.InOrderMatchesReservations());
+
+	// Which is all or nothing
+	Message::massQuote.asks.push_back({ Units::ExToIn(0.5), Units::ExToIn(10.0) });
+	outputMessages = tradingEngine.Process(message);
+	ASSERT_EQ(outputMessages.size(), 1u);
+	ASSERT_EQ(outputMessages.front().errorCode, static_cast<int>(Error::Type::InvalidQuote));
+	ASSERT_EQ(tradingEngine.GetMarketManager().GetMarket(CreateCoinPair())->GetBuyLimitOrderMap().size(), 1u);
+	Message::massQuote = {};
+}
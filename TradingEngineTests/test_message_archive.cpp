@@ -0,0 +1,268 @@
+#include <TradingEngine/Error.h>
+#include <TradingEngine/Journal.h>
+#include <TradingEngine/Message.h>
+#include <TradingEngine/MessageArchive.h>
+#include <TradingEngine/MessageCodec.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+// Interleaved orders in a handful of markets, as the engine sees them
+std::vector<Message> MakeMessages(size_t numMessages) {
+	std::mt19937 random(7);
+	std::vector<Message> messages;
+	for (size_t i = 0; i < numMessages; ++i) {
+		Message message;
+		message.id = static_cast<int32_t>(i + 1);
+		message.baseId = 1 + static_cast<int32_t>(random() % 2);
+		message.coinId = 10 + static_cast<int32_t>(random() % 4);
+		switch (random() % 4) {
+			case 0:
+				message.messageType = MessageType::CancelOrder;
+				message.orderId = static_cast<int64_t>(random() % (i + 1));
+				break;
+			default:
+				message.messageType = MessageType::LimitOrder;
+				message.userId = static_cast<int32_t>(random() % 100);
+				message.price = 100000 + message.coinId * 1000 + static_cast<int64_t>(random() % 20);
+				message.amount = 1 + static_cast<int64_t>(random() % 1000);
+				message.isBuy = (random() % 2) == 0;
+				break;
+		}
+		messages.push_back(message);
+	}
+	return messages;
+}
+
+void ExpectSame(const Message& message, const Message& expected) {
+	ASSERT_EQ(message.messageType, expected.messageType);
+	ASSERT_EQ(message.id, expected.id);
+	ASSERT_EQ(message.coinId, expected.coinId);
+	ASSERT_EQ(message.baseId, expected.baseId);
+	ASSERT_EQ(message.orderId, expected.orderId);
+	ASSERT_EQ(message.price, expected.price);
+	ASSERT_EQ(message.amount, expected.amount);
+	ASSERT_EQ(message.stopPrice, expected.stopPrice);
+	ASSERT_EQ(message.isBuy, expected.isBuy);
+}
+}
+
+TEST(MessageCodec, roundTrip) {
+	auto messages = MakeMessages(1000);
+	MessageEncoder encoder;
+	std::string encoded;
+	for (const auto& message : messages) {
+		encoder.Encode(message, &encoded);
+	}
+	ASSERT_LT(encoded.size(), messages.size() * sizeof(Message) / 5);
+
+	MessageDecoder decoder;
+	std::string_view data(encoded);
+	Message message;
+	for (const auto& expected : messages) {
+		ASSERT_TRUE(decoder.Decode(&data, &message));
+		ExpectSame(message, expected);
+	}
+	ASSERT_TRUE(data.empty());
+	ASSERT_FALSE(decoder.Decode(&data, &message));
+}
+
+TEST(MessageCodec, attachments) {
+	Message cancelAll;
+	cancelAll.messageType = MessageType::CancelAllOrders;
+	cancelAll.userId = 3;
+	Message massQuote;
+	massQuote.messageType = MessageType::MassQuote;
+	massQuote.userId = 3;
+
+	MessageEncoder encoder;
+	std::string encoded;
+	Message::cancelOrders = "4 5 6";
+	encoder.Encode(cancelAll, &encoded);
+	Message::massQuote.bids = { { 100, 5 }, { 99, 6 } };
+	Message::massQuote.asks = { { 101, 7 } };
+	encoder.Encode(massQuote, &encoded);
+	auto expectedQuote = Message::massQuote;
+
+	Message::cancelOrders.clear();
+	Message::massQuote = MassQuote();
+
+	MessageDecoder decoder;
+	std::string_view data(encoded);
+	Message message;
+	ASSERT_TRUE(decoder.Decode(&data, &message));
+	ASSERT_EQ(message.messageType, MessageType::CancelAllOrders);
+	ASSERT_EQ(Message::cancelOrders, "4 5 6");
+	ASSERT_TRUE(decoder.Decode(&data, &message));
+	ASSERT_EQ(message.messageType, MessageType::MassQuote);
+	ASSERT_EQ(message.userId, 3);
+	ASSERT_EQ(Message::massQuote, expectedQuote);
+
+	Message::cancelOrders.clear();
+	Message::massQuote = MassQuote();
+
+	// Cut short in the attachment
+	std::string_view truncated(encoded.data(), 4);
+	decoder.Reset();
+	ASSERT_FALSE(decoder.Decode(&truncated, &message));
+}
+
+// The raw format comes from other processes (see IpcTransport.h), so it's checked before use
+TEST(MessageCodec, rawFromElsewhere) {
+	Message order;
+	order.messageType = MessageType::LimitOrder;
+	order.userId = 3;
+	order.price = 100;
+	order.amount = 5;
+	order.isBuy = true;
+	std::string raw(GetRawSize(order), '\0');
+	EncodeRaw(order, raw.data());
+
+	Message message;
+	ASSERT_TRUE(DecodeRaw(raw, &message));
+	ExpectSame(message, order);
+
+	// Any other byte in a bool is read as true
+	raw[offsetof(Message, isBuy)] = 2;
+	raw[offsetof(Message, fullUpdate)] = static_cast<char>(0xFF);
+	ASSERT_TRUE(DecodeRaw(raw, &message));
+	unsigned char isBuy, fullUpdate;
+	std::memcpy(&isBuy, &message.isBuy, 1);
+	std::memcpy(&fullUpdate, &message.fullUpdate, 1);
+	ASSERT_EQ(isBuy, 1u);
+	ASSERT_EQ(fullUpdate, 1u);
+
+	// Not one of the message types
+	for (auto messageType : { -1, static_cast<int>(MessageType::MassQuote) + 1, static_cast<int>(MessageType::Last) + 1 }) {
+		std::memcpy(raw.data() + offsetof(Message, messageType), &messageType, sizeof(messageType));
+		ASSERT_FALSE(DecodeRaw(raw, &message));
+	}
+
+	// Likewise for the compact encoding
+	Message unknown;
+	unknown.messageType = static_cast<MessageType>(static_cast<int>(MessageType::MassQuote) + 1);
+	MessageEncoder encoder;
+	std::string encoded;
+	encoder.Encode(unknown, &encoded);
+	MessageDecoder decoder;
+	std::string_view data(encoded);
+	ASSERT_FALSE(decoder.Decode(&data, &message));
+}
+
+TEST(MessageArchive, roundTrip) {
+	auto messages = MakeMessages(20000);
+	for (auto codec : { ArchiveCodec::None, ArchiveCodec::Lz }) {
+		MessageArchiveConfig config;
+		config.blockSize = 16 * 1024;
+		config.codec = codec;
+
+		std::stringstream stream;
+		MessageArchiveStats stats;
+		{
+			MessageArchiveWriter writer(stream, config, 5);
+			for (size_t i = 0; i < messages.size(); ++i) {
+				ASSERT_EQ(writer.Append(messages[i]), i + 5);
+			}
+			writer.Flush();
+			stats = writer.GetStats();
+		}
+		ASSERT_EQ(stats.numMessages, messages.size());
+		ASSERT_GT(stats.numBlocks, 1);
+		ASSERT_EQ(stats.numStoredBytes, stream.str().size());
+		ASSERT_LT(stats.numStoredBytes, stats.numRawBytes / 4);
+
+		size_t numRead = 0;
+		auto lastSequence = ReadMessageArchive(stream, [&](uint64_t sequence, const Message& message) {
+			ASSERT_EQ(sequence, numRead + 5);
+			ExpectSame(message, messages[numRead]);
+			++numRead;
+		});
+		ASSERT_EQ(numRead, messages.size());
+		ASSERT_EQ(lastSequence, messages.size() + 4);
+	}
+}
+
+TEST(MessageArchive, fromSequence) {
+	auto messages = MakeMessages(5000);
+	MessageArchiveConfig config;
+	config.blockSize = 4096;
+	std::stringstream stream;
+	{
+		MessageArchiveWriter writer(stream, config);
+		for (const auto& message : messages) {
+			writer.Append(message);
+		}
+	}
+
+	uint64_t firstSequence = 0;
+	size_t numRead = 0;
+	auto lastSequence = ReadMessageArchive(stream, [&](uint64_t sequence, const Message& message) {
+		if (numRead++ == 0) {
+			firstSequence = sequence;
+		}
+		ExpectSame(message, messages[sequence - 1]);
+	}, 4000);
+	ASSERT_EQ(firstSequence, 4000);
+	ASSERT_EQ(numRead, 1001);
+	ASSERT_EQ(lastSequence, 5000);
+}
+
+TEST(MessageArchive, corrupt) {
+	auto messages = MakeMessages(100);
+	std::stringstream stream;
+	{
+		MessageArchiveWriter writer(stream, MessageArchiveConfig());
+		for (const auto& message : messages) {
+			writer.Append(message);
+		}
+	}
+
+	auto contents = stream.str();
+	contents[contents.size() - 10] ^= 1;
+	std::stringstream corrupt(contents);
+	try {
+		ReadMessageArchive(corrupt, [](uint64_t, const Message&) {});
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::ArchiveFailed);
+	}
+
+	std::stringstream notArchive("definitely not an archive");
+	ASSERT_THROW(ReadMessageArchive(notArchive, [](uint64_t, const Message&) {}), Error);
+}
+
+TEST(MessageArchive, archiveJournal) {
+	JournalConfig journalConfig;
+	journalConfig.directory = "test_message_archive_journal";
+	journalConfig.segmentSize = 64 * 1024;
+	journalConfig.bufferSize = 16 * 1024;
+	std::filesystem::remove_all(journalConfig.directory);
+	std::filesystem::create_directory(journalConfig.directory);
+
+	auto messages = MakeMessages(2000);
+	{
+		Journal journal(journalConfig);
+		for (const auto& message : messages) {
+			journal.Append(message);
+		}
+	}
+
+	std::stringstream stream;
+	ASSERT_EQ(ArchiveJournal(journalConfig.directory, stream, MessageArchiveConfig()), messages.size());
+	std::filesystem::remove_all(journalConfig.directory);
+
+	size_t numRead = 0;
+	ReadMessageArchive(stream, [&](uint64_t sequence, const Message& message) {
+		ASSERT_EQ(sequence, numRead + 1);
+		ExpectSame(message, messages[numRead++]);
+	});
+	ASSERT_EQ(numRead, messages.size());
+}
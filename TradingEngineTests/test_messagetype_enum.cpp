@@ -29,5 +29,7 @@ TEST(TestError, messageTypeOrdering) {
 	ASSERT_EQ(static_cast<int>(MessageType::PartialFill), 24);
 	ASSERT_EQ(static_cast<int>(MessageType::StopLimitTriggered), 25);
 	ASSERT_EQ(static_cast<int>(MessageType::Quit), 26);
+	ASSERT_EQ(static_cast<int>(MessageType::AmendOrder), 27);
+	ASSERT_EQ(static_cast<int>(MessageType::MassQuote), 28);
 	ASSERT_EQ(static_cast<int>(MessageType::Last), 999999);
 }
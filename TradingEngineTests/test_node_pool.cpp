@@ -0,0 +1,193 @@
+#include "StubListener.h"
+
+#include <TradingEngine/CoinPair.h>
+#include <TradingEngine/Market.h>
+#include <TradingEngine/MarketManager.h>
+#include <TradingEngine/NodePool.h>
+#include <TradingEngine/Orders/LimitOrder.h>
+#include <TradingEngine/Orders/OrderAction.h>
+#include <TradingEngine/Orders/OrderContainer.h>
+#include <TradingEngine/ShardAllocator.h>
+#include <TradingEngine/Units.h>
+#include <TradingEngine/market_helper.h>
+#include <cstdint>
+#include <functional>
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+MarketConfig createStubMarketConfig();
+
+TEST(TestNodePool, lazy) {
+	NodePool pool(48, 8);
+	ASSERT_EQ(pool.GetReservedBytes(), 0u);
+
+	auto node = pool.Allocate();
+	ASSERT_EQ(pool.GetReservedBytes(), NodePool::slabSize);
+	ASSERT_EQ(pool.GetNumNodesInUse(), 1u);
+
+	// The freed node is handed out again
+	NodePool::Deallocate(node);
+	ASSERT_EQ(pool.GetNumNodesInUse(), 0u);
+	ASSERT_EQ(pool.Allocate(), node);
+	NodePool::Deallocate(node);
+}
+
+TEST(TestNodePool, trim) {
+	NodePool pool(64, 16);
+	std::vector<void*> nodes;
+	for (size_t i = 0; i < NodePool::slabSize / 64 * 3; ++i) {
+		auto node = pool.Allocate();
+		ASSERT_EQ(reinterpret_cast<uintptr_t>(node) % 16, 0u);
+		nodes.push_back(node);
+	}
+
+	auto reserved = pool.GetReservedBytes();
+	ASSERT_GE(reserved, 3 * NodePool::slabSize);
+
+	// Nothing is free yet
+	ASSERT_EQ(pool.Trim(), 0u);
+
+	// Keep the first node so its slab stays
+	for (size_t i = 1; i < nodes.size(); ++i) {
+		NodePool::Deallocate(nodes[i]);
+	}
+
+	ASSERT_EQ(pool.Trim(), reserved - NodePool::slabSize);
+	ASSERT_EQ(pool.GetReservedBytes(), NodePool::slabSize);
+
+	// Slabs are requested again after being trimmed
+	auto node = pool.Allocate();
+	ASSERT_EQ(pool.GetNumNodesInUse(), 2u);
+	NodePool::Deallocate(node);
+	NodePool::Deallocate(nodes.front());
+	ASSERT_EQ(pool.Trim(), NodePool::slabSize);
+	ASSERT_EQ(pool.GetReservedBytes(), 0u);
+}
+
+TEST(TestNodePool, handles) {
+	NodePool pool(40, 8);
+	std::vector<void*> nodes;
+	for (size_t i = 0; i < NodePool::slabSize / 40 * 3; ++i) {
+		nodes.push_back(pool.Allocate());
+	}
+
+	for (auto node : nodes) {
+		ASSERT_EQ(pool.FromHandle(NodePool::ToHandle(node)), node);
+	}
+
+	// The first slab's index is given to the next slab after it's trimmed
+	auto handle = NodePool::ToHandle(nodes.back());
+	for (size_t i = 0; i < NodePool::slabSize / 40 - 1; ++i) {
+		NodePool::Deallocate(nodes[i]);
+	}
+	ASSERT_EQ(pool.Trim(), NodePool::slabSize);
+
+	auto node = pool.Allocate();
+	ASSERT_EQ(pool.FromHandle(NodePool::ToHandle(node)), node);
+	ASSERT_EQ(pool.FromHandle(handle), nodes.back());
+}
+
+TEST(TestShardAllocator, sharesPools) {
+	PoolShard shard;
+	PoolUsage usage;
+	using Map = std::map<int64_t, int64_t, std::less<int64_t>, ShardAllocator<std::pair<const int64_t, int64_t>>>;
+
+	{
+		Map map1{ Map::allocator_type(shard, &usage) };
+		Map map2{ Map::allocator_type(shard) };
+		map1.emplace(1, 1);
+		map2.emplace(2, 2);
+
+		// Both maps have the same node size so use the same slab
+		ASSERT_EQ(shard.GetReservedBytes(), NodePool::slabSize);
+		ASSERT_EQ(usage.numNodes, 1u);
+
+		// Copies are not counted in the original's usage
+		auto map3 = map1;
+		ASSERT_EQ(usage.numNodes, 1u);
+		ASSERT_EQ(map3.size(), 1u);
+	}
+
+	ASSERT_EQ(usage.numNodes, 0u);
+	ASSERT_EQ(usage.bytes, 0u);
+	ASSERT_EQ(shard.Trim(), NodePool::slabSize);
+}
+
+TEST(TestMarketManager, memoryUsage) {
+	MarketManager marketManager;
+	CoinPair coinPair{ 1, 2 };
+	marketManager.AddMarket({ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() });
+	marketManager.AddMarket({ std::make_unique<StubListener>(), { 3, 2 }, createStubMarketConfig() });
+
+	// Nothing is allocated for the markets until they have orders
+	auto market = marketManager.GetMarket(coinPair);
+	auto memoryUsage = market->GetMemoryUsage();
+	ASSERT_EQ(memoryUsage.numPriceLevels, 0u);
+	ASSERT_EQ(memoryUsage.priceLevelBytes, 0u);
+	ASSERT_EQ(memoryUsage.numOrders, 0u);
+
+	for (int64_t i = 1; i <= 3; ++i) {
+		market->ForceAddOrder<OrderAction::Buy>(OrderContainer<LimitOrder>{ { 1, Units::ExToIn(1.0), i }, Units::ExToIn(0.1) * i });
+	}
+	market->ForceAddOrder<OrderAction::Buy>(OrderContainer<LimitOrder>{ { 1, Units::ExToIn(1.0), 4 }, Units::ExToIn(0.1) });
+
+	memoryUsage = market->GetMemoryUsage();
+	ASSERT_EQ(memoryUsage.numPriceLevels, 3u);
+	ASSERT_GT(memoryUsage.priceLevelBytes, 3 * sizeof(BuyLimitOrderMap::value_type));
+	ASSERT_EQ(memoryUsage.numOrders, 4u);
+	ASSERT_EQ(memoryUsage.orderBytes, 4 * Orders<LimitOrder>::nodeSize);
+	ASSERT_EQ(marketManager.GetMarket({ 3, 2 })->GetMemoryUsage().numPriceLevels, 0u);
+
+	// The slab is kept while the orders are there (other tests may have left empty ones around)
+	marketManager.TrimPools();
+	auto reserved = marketManager.GetReservedPoolBytes();
+	ASSERT_GE(reserved, NodePool::slabSize);
+	ASSERT_EQ(marketManager.TrimPools(), 0u);
+
+	market->CancelAll();
+	ASSERT_EQ(market->GetMemoryUsage().numPriceLevels, 0u);
+	ASSERT_EQ(market->GetMemoryUsage().priceLevelBytes, 0u);
+	ASSERT_GE(marketManager.TrimPools(), NodePool::slabSize);
+	ASSERT_LT(marketManager.GetReservedPoolBytes(), reserved);
+}
+
+TEST(TestScopedPoolShard, buildMarketsOnThreads) {
+	MarketManager marketManager;
+	std::vector<Market> markets(2);
+	std::vector<std::thread> threads;
+	for (int32_t baseId = 2; baseId <= 3; ++baseId) {
+		auto& poolShard = marketManager.GetPoolShard(baseId);
+		auto& market = markets[baseId - 2];
+		threads.emplace_back([&poolShard, &market, baseId]() {
+			ScopedPoolShard scopedPoolShard(poolShard);
+			ASSERT_EQ(&PoolShard::GetDefault(), &poolShard);
+
+			market = Market{ std::make_unique<StubListener>(), { 1, baseId }, createStubMarketConfig() };
+			for (int64_t i = 1; i <= 100; ++i) {
+				market.ForceAddOrder<OrderAction::Buy>(OrderContainer<LimitOrder>{ { 1, Units::ExToIn(1.0), i }, Units::ExToIn(0.1) * (i % 10 + 1) });
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	// Nothing is scoped on this thread
+	ASSERT_EQ(ScopedPoolShard::Get(), nullptr);
+
+	// Both the price levels and the orders are in the shard already, so nothing is copied
+	auto reserved = marketManager.GetPoolShard(2).GetReservedBytes();
+	ASSERT_GE(reserved, 2 * NodePool::slabSize);
+	marketManager.AddMarket(std::move(markets[0]));
+	marketManager.AddMarket(std::move(markets[1]));
+	ASSERT_EQ(marketManager.GetPoolShard(2).GetReservedBytes(), reserved);
+
+	auto market = marketManager.GetMarket({ 1, 2 });
+	ASSERT_EQ(market->GetMemoryUsage().numPriceLevels, 10u);
+	ASSERT_EQ(market->GetMemoryUsage().numOrders, 100u);
+	market->CancelAll();
+	ASSERT_EQ(marketManager.GetPoolShard(2).Trim(), reserved);
+}
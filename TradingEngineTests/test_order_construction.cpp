@@ -1,3 +1,5 @@
+#include <TradingEngine/Fee.h>
+#include <TradingEngine/Listener/Operation.h>
 #include <TradingEngine/Orders/MarketOrder.h>
 #include <TradingEngine/Orders/StopLimitOrder.h>
 #include <TradingEngine/Units.h>
@@ -9,3 +11,10 @@ TEST(TestOrder, construction) {
 	ASSERT_NO_THROW(MarketOrder(1, Units::ExToIn(100.0)));
 	ASSERT_NO_THROW(StopLimitOrder(1, Units::ExToIn(100.0), 0, Units::ExToIn(0.5)));
 }
+
+TEST(TestOrder, tradeOperation) {
+	// The sell order id shares its bytes with the (32 bit) user id
+	int64_t sellOrderId = (int64_t(1) << 40) + 3;
+	Operation operation(Operation::Type::NewTrade, 1, 2, sellOrderId, 10, 20, Fee());
+	ASSERT_EQ(operation.listenerOrder.sellOrderId, sellOrderId);
+}
@@ -0,0 +1,109 @@
+#include <TradingEngine/NodePool.h>
+#include <TradingEngine/PlatformSpecific/page_memory.h>
+#include <TradingEngine/PoolMemory.h>
+#include <cstddef>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <vector>
+
+TEST(TestPageMemory, mapPages) {
+	auto mapping = ps::MapPages(10000, true, false);
+	ASSERT_NE(mapping.address, nullptr);
+	ASSERT_GE(mapping.size, 10000u);
+	ASSERT_EQ(reinterpret_cast<uintptr_t>(mapping.address) % ps::smallPageSize, 0u);
+	ASSERT_EQ(mapping.size % (mapping.hugePages ? ps::hugePageSize : ps::smallPageSize), 0u);
+
+	auto bytes = static_cast<const char*>(mapping.address);
+	for (size_t i = 0; i < mapping.size; i += 1000) {
+		ASSERT_EQ(bytes[i], 0);
+	}
+	ps::UnmapPages(mapping);
+}
+
+TEST(TestPageArena, capacity) {
+	PoolMemoryConfig config;
+	config.capacity = 64 * 1024;
+	config.hugePages = false;
+	config.growthSize = 64 * 1024;
+	size_t grownBy = 0;
+	config.onGrowth = [&grownBy](size_t size) { grownBy += size; };
+
+	PageArena pageArena(config);
+	ASSERT_EQ(pageArena.GetStats().mappedBytes, config.capacity);
+
+	// The capacity is used without growing
+	void* blocks[4];
+	for (auto& block : blocks) {
+		block = pageArena.Allocate(16384, 4096);
+		ASSERT_EQ(reinterpret_cast<uintptr_t>(block) % 4096, 0u);
+		ASSERT_TRUE(pageArena.Owns(block));
+	}
+	ASSERT_EQ(pageArena.GetStats().numGrowths, 0u);
+	ASSERT_EQ(grownBy, 0u);
+
+	// Freed blocks are reused
+	pageArena.Deallocate(blocks[1], 16384);
+	ASSERT_EQ(pageArena.Allocate(16384, 4096), blocks[1]);
+
+	// Then it has to grow
+	auto block = pageArena.Allocate(16384, 16384);
+	ASSERT_EQ(reinterpret_cast<uintptr_t>(block) % 16384, 0u);
+	ASSERT_TRUE(pageArena.Owns(block));
+	ASSERT_EQ(pageArena.GetStats().numGrowths, 1u);
+	ASSERT_GT(grownBy, 0u);
+	ASSERT_EQ(pageArena.GetStats().usedBytes, 5 * 16384u);
+
+	int onStack;
+	ASSERT_FALSE(pageArena.Owns(&onStack));
+}
+
+TEST(TestPageArena, manyMappingsAndSizes) {
+	PoolMemoryConfig config;
+	config.hugePages = false;
+	config.growthSize = ps::smallPageSize;
+	PageArena pageArena(config);
+
+	// Most blocks need a new mapping, which aren't necessarily in address order
+	std::vector<void*> blocks;
+	for (size_t i = 0; i < 16; ++i) {
+		blocks.push_back(pageArena.Allocate(ps::smallPageSize * (1 + i % 3), 64));
+	}
+	auto numMappings = pageArena.GetMappings().size();
+	ASSERT_GT(numMappings, 8u);
+	for (auto block : blocks) {
+		ASSERT_TRUE(pageArena.Owns(block));
+		ASSERT_TRUE(pageArena.Owns(static_cast<char*>(block) + ps::smallPageSize - 1));
+	}
+
+	// Each size is reused from its own free list
+	for (size_t i = 0; i < 3; ++i) {
+		pageArena.Deallocate(blocks[2 - i], ps::smallPageSize * (1 + (2 - i) % 3));
+	}
+	for (size_t i = 0; i < 3; ++i) {
+		ASSERT_EQ(pageArena.Allocate(ps::smallPageSize * (1 + i), 64), blocks[i]);
+	}
+	ASSERT_EQ(pageArena.GetMappings().size(), numMappings);
+}
+
+TEST(TestPageArena, poolsUseIt) {
+	PoolMemoryConfig config;
+	config.capacity = 1024 * 1024;
+	ConfigurePoolMemory(config);
+	auto stats = GetPoolMemoryStats();
+	ASSERT_NE(stats, nullptr);
+	ASSERT_GE(stats->mappedBytes, config.capacity);
+
+	auto usedBefore = stats->usedBytes;
+	{
+		NodePool pool(32, 8);
+		auto node = pool.Allocate();
+		ASSERT_EQ(stats->usedBytes, usedBefore + NodePool::slabSize);
+		NodePool::Deallocate(node);
+
+		// The trimmed slab goes back to the arena and is handed out again
+		ASSERT_EQ(pool.Trim(), NodePool::slabSize);
+		pool.Allocate();
+		ASSERT_EQ(stats->usedBytes, usedBefore + NodePool::slabSize);
+	}
+	ASSERT_EQ(stats->numGrowths, 0u);
+}
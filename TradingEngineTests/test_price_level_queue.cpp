@@ -0,0 +1,128 @@
+#include <TradingEngine/Orders/LimitOrder.h>
+#include <TradingEngine/PriceLevelQueue.h>
+#include <TradingEngine/ShardAllocator.h>
+#include <TradingEngine/market_helper.h>
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace {
+PriceLevelQueue<LimitOrder> MakeQueue(int64_t numOrders) {
+	PriceLevelQueue<LimitOrder> queue;
+	for (int64_t i = 0; i < numOrders; ++i) {
+		auto& order = queue.emplace_back(static_cast<int32_t>(i), 100 + i, 0);
+		order.SetId(i + 1);
+	}
+	return queue;
+}
+
+std::vector<int64_t> GetIds(const PriceLevelQueue<LimitOrder>& queue) {
+	std::vector<int64_t> ids;
+	std::transform(queue.begin(), queue.end(), std::back_inserter(ids), [](const auto& order) { return order.GetId(); });
+	return ids;
+}
+}
+
+TEST(TestPriceLevelQueue, nodeSize) {
+	// Just the two links on top of the order
+	ASSERT_EQ(PriceLevelQueue<LimitOrder>::nodeSize, sizeof(LimitOrder) + 8);
+}
+
+TEST(TestPriceLevelQueue, fifo) {
+	auto queue = MakeQueue(3);
+	ASSERT_EQ(queue.size(), 3u);
+	ASSERT_EQ(queue.front().GetId(), 1);
+	ASSERT_EQ(queue.back().GetId(), 3);
+
+	queue.pop_front();
+	ASSERT_EQ(GetIds(queue), (std::vector<int64_t>{ 2, 3 }));
+
+	queue.front().AddToFill(10);
+	ASSERT_EQ(queue.front().GetFilled(), 10);
+
+	queue.pop_front();
+	queue.pop_front();
+	ASSERT_TRUE(queue.empty());
+	ASSERT_EQ(queue.begin(), queue.end());
+}
+
+TEST(TestPriceLevelQueue, eraseByHandle) {
+	auto queue = MakeQueue(5);
+
+	// Iterators are stable while other orders come and go
+	auto handle = std::next(queue.begin(), 2);
+	queue.pop_front();
+	queue.emplace_back(9, 1, 0).SetId(6);
+	ASSERT_EQ(handle->GetId(), 3);
+
+	auto next = queue.erase(handle);
+	ASSERT_EQ(next->GetId(), 4);
+	ASSERT_EQ(GetIds(queue), (std::vector<int64_t>{ 2, 4, 5, 6 }));
+
+	// Both ends
+	queue.erase(std::prev(queue.end()));
+	queue.erase(queue.begin());
+	ASSERT_EQ(GetIds(queue), (std::vector<int64_t>{ 4, 5 }));
+
+	queue.erase(queue.begin(), queue.end());
+	ASSERT_TRUE(queue.empty());
+}
+
+TEST(TestPriceLevelQueue, copyAndMove) {
+	auto queue = MakeQueue(4);
+	auto copy = queue;
+	ASSERT_EQ(copy, queue);
+
+	copy.pop_front();
+	ASSERT_NE(copy, queue);
+	ASSERT_EQ(queue.size(), 4u);
+
+	auto moved = std::move(queue);
+	ASSERT_EQ(GetIds(moved), (std::vector<int64_t>{ 1, 2, 3, 4 }));
+	ASSERT_TRUE(queue.empty());
+
+	// The moved to queue carries on from the moved nodes
+	moved.emplace_back(1, 1, 0).SetId(5);
+	moved.pop_front();
+	ASSERT_EQ(GetIds(moved), (std::vector<int64_t>{ 2, 3, 4, 5 }));
+
+	copy = moved;
+	ASSERT_EQ(copy, moved);
+	copy = PriceLevelQueue<LimitOrder>();
+	ASSERT_TRUE(copy.empty());
+}
+
+TEST(TestPriceLevelQueue, reusesNodes) {
+	PoolShard shard;
+	std::vector<PriceLevelQueue<LimitOrder>> queues;
+	for (int i = 0; i < 10; ++i) {
+		auto& queue = queues.emplace_back(ShardAllocator<LimitOrder>(shard));
+		for (int j = 0; j < 200; ++j) {
+			queue.emplace_back(1, 10, 100);
+		}
+	}
+
+	// All empty once they are cleared, so everything can be given back
+	queues.clear();
+	ASSERT_GT(shard.Trim(), 0u);
+}
+
+TEST(TestPriceLevelQueue, takesNodesFromTheMapsShard) {
+	PoolShard shard;
+	auto& nodePool = shard.GetPool(PriceLevelQueue<LimitOrder>::nodeSize, alignof(LimitOrder));
+	{
+		SellLimitOrderMap orderMap{ SellLimitOrderMap::allocator_type(ShardAllocator<char>(shard)) };
+		orderMap[100].emplace_back(1, 10, 100);
+
+		// Moved in from another shard, so it's copied
+		orderMap.emplace(101, MakeQueue(2));
+		ASSERT_EQ(nodePool.GetNumNodesInUse(), 3u);
+
+		auto copy = orderMap;
+		ASSERT_EQ(nodePool.GetNumNodesInUse(), 6u);
+	}
+	ASSERT_EQ(nodePool.GetNumNodesInUse(), 0u);
+}
@@ -0,0 +1,100 @@
+#include "message_conversion_testing_helper.h"
+
+#include <TradingEngine/Error.h>
+#include <TradingEngine/Market.h>
+#include <TradingEngine/Orders/MarketOrder.h>
+#include <TradingEngine/Orders/OrderAction.h>
+#include <TradingEngine/Orders/OrderContainer.h>
+#include <TradingEngine/OrderQuote.h>
+#include <TradingEngine/Units.h>
+#include <TradingEngine/Wallet.h>
+#include <TradingEngine/market_helper.h>
+#include <gtest/gtest.h>
+
+class TestQuote : public ::testing::Test {
+protected:
+	Wallet coinWallet = CreateWallet(0);
+	Wallet baseWallet = CreateBaseWallet(0);
+	MarketWallets marketWallets{ &coinWallet, &baseWallet };
+	Market market = CreateMarket(&marketWallets, 0);
+};
+
+TEST_F(TestQuote, limitBuyWalksTheBook) {
+	auto original = market;
+
+	// Takes all of 3|7|0.6|200 and half of 4|7|0.7|200
+	OrderContainer<LimitOrder> orderContainer{ { BuyUserId(), Units::ExToIn(300.0), 0 },
+		Units::ExToIn(0.7) };
+	auto quote = market.Quote<OrderAction::Buy>(orderContainer);
+
+	ASSERT_EQ(quote.fills.size(), 2u);
+	ASSERT_EQ(quote.fills[0].amount, Units::ExToIn(200.0));
+	ASSERT_EQ(quote.fills[0].price, Units::ExToIn(0.6));
+	ASSERT_EQ(quote.fills[1].amount, Units::ExToIn(100.0));
+	ASSERT_EQ(quote.fills[1].price, Units::ExToIn(0.7));
+	ASSERT_EQ(quote.filled, Units::ExToIn(300.0));
+	ASSERT_EQ(quote.remaining, 0);
+	ASSERT_EQ(quote.averagePrice, (Units::ExToIn(0.6) * 2 + Units::ExToIn(0.7)) / 3);
+
+	auto feeDivision = market.GetConfig().feeDivision;
+	ASSERT_EQ(quote.fees.buyFee,
+	Units::ExToIn(200.0) / feeDivision + Units::ExToIn(100.0) / feeDivision);
+	ASSERT_EQ(quote.fees.sellFee,
+	Units::Multiply(Units::ExToIn(200.0), Units::ExToIn(0.6)) / feeDivision
+	+ Units::Multiply(Units::ExToIn(100.0), Units::ExToIn(0.7)) / feeDivision);
+
+	// Nothing has changed, including the order/trade ids and what the listener saw
+	ASSERT_EQ(market, original);
+	ASSERT_TRUE(market.GetListener().GetOperations().empty());
+}
+
+TEST_F(TestQuote, limitSellStopsAtPrice) {
+	OrderContainer<LimitOrder> orderContainer{ { SellUserId(), Units::ExToIn(500.0), 0 },
+		Units::ExToIn(0.45) };
+	auto quote = market.Quote<OrderAction::Sell>(orderContainer);
+
+	ASSERT_EQ(quote.fills.size(), 1u);
+	ASSERT_EQ(quote.filled, Units::ExToIn(200.0));
+	ASSERT_EQ(quote.remaining, Units::ExToIn(300.0));
+	ASSERT_EQ(quote.averagePrice, Units::ExToIn(0.5));
+}
+
+TEST_F(TestQuote, marketOrderReportsUnfilled) {
+	auto control = market;
+	Wallet controlCoinWallet = coinWallet;
+	Wallet controlBaseWallet = baseWallet;
+	MarketWallets controlMarketWallets{ &controlCoinWallet, &controlBaseWallet };
+
+	OrderContainer<MarketOrder> orderContainer{ { BuyUserId(), Units::ExToIn(1000.0) }, 0 };
+	auto quote = market.Quote<OrderAction::Buy>(orderContainer);
+	ASSERT_EQ(quote.filled, Units::ExToIn(400.0));
+	ASSERT_EQ(quote.remaining, Units::ExToIn(600.0));
+
+	// The quote shouldn't affect the order being placed afterwards
+	OrderContainer<MarketOrder> smallOrder{ { BuyUserId(), Units::ExToIn(10.0) }, 0 };
+	market.NewProcess<OrderAction::Buy>(smallOrder, &marketWallets);
+	control.NewProcess<OrderAction::Buy>(smallOrder, &controlMarketWallets);
+
+	// Operations have uninitialised fields (i.e action for trades), so aren't comparable
+	market.GetListener().ClearOperations();
+	control.GetListener().ClearOperations();
+	ASSERT_EQ(market, control);
+	ASSERT_EQ(coinWallet, controlCoinWallet);
+	ASSERT_EQ(baseWallet, controlBaseWallet);
+}
+
+TEST_F(TestQuote, emptyBook) {
+	OrderContainer<LimitOrder> orderContainer{ { SellUserId(), Units::ExToIn(1.0), 0 },
+		Units::ExToIn(0.9) };
+	auto quote = market.Quote<OrderAction::Sell>(orderContainer);
+	ASSERT_TRUE(quote.fills.empty());
+	ASSERT_EQ(quote.averagePrice, -1);
+	ASSERT_EQ(quote.remaining, Units::ExToIn(1.0));
+}
+
+TEST_F(TestQuote, sameUser) {
+	OrderContainer<LimitOrder> orderContainer{ { SellUserId(), Units::ExToIn(1.0), 0 },
+		Units::ExToIn(0.6) };
+	ASSERT_THROW(market.Quote<OrderAction::Buy>(orderContainer), Error);
+	ASSERT_TRUE(market.GetListener().GetOperations().empty());
+}
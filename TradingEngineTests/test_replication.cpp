@@ -0,0 +1,381 @@
+#include "message_conversion_testing_helper.h"
+
+#include <TradingEngine/CoinPair.h>
+#include <TradingEngine/Error.h>
+#include <TradingEngine/Listener/Listener.h>
+#include <TradingEngine/Message.h>
+#include <TradingEngine/MessageType.h>
+#include <TradingEngine/Orders/LimitOrder.h>
+#include <TradingEngine/Orders/OrderAction.h>
+#include <TradingEngine/Orders/OrderContainer.h>
+#include <TradingEngine/PlatformSpecific/fork_process.h>
+#include <TradingEngine/PlatformSpecific/unix_socket.h>
+#include <TradingEngine/Replication.h>
+#include <TradingEngine/TradingEngine.h>
+#include <TradingEngine/Units.h>
+#include <algorithm>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+ReplicationConfig MakeConfig(uint64_t checkpointInterval) {
+	ReplicationConfig config;
+	config.stateHash = &TradingEngine::GetStateHash;
+	config.checkpointInterval = checkpointInterval;
+	return config;
+}
+
+class ReplicationTest : public ::testing::Test {
+protected:
+	int primaryFd = -1;
+	int replicaFd = -1;
+	TradingEngine primary;
+	TradingEngine standby;
+	std::vector<Message> output;
+
+	void SetUp() override {
+		ASSERT_TRUE(ps::CreateSocketPair(&primaryFd, &replicaFd));
+	}
+
+	void TearDown() override {
+		ps::CloseSocket(primaryFd);
+		ps::CloseSocket(replicaFd);
+	}
+
+	static std::vector<Message> MakeInput() {
+		auto messages = ToMessages(CreateWalletManager());
+
+		Message newMarket;
+		newMarket.messageType = MessageType::NewMarket;
+		newMarket.coinId = CreateCoinPair().GetCoinId();
+		newMarket.baseId = CreateCoinPair().GetBaseId();
+		newMarket.feePercentage = 0.1;
+		newMarket.maxNumLimitOpenOrders = 100;
+		newMarket.maxNumStopLimitOpenOrders = 100;
+		messages.push_back(newMarket);
+
+		// Resting orders on both sides, some of which cross
+		for (auto i = 0; i < 40; ++i) {
+			Message order;
+			order.messageType = MessageType::LimitOrder;
+			order.coinId = CreateCoinPair().GetCoinId();
+			order.baseId = CreateCoinPair().GetBaseId();
+			order.isBuy = (i % 2 == 0);
+			order.userId = order.isBuy ? BuyUserId() : SellUserId();
+			order.price = Units::ExToIn(order.isBuy ? 0.4 + 0.01 * (i % 13) : 0.5 - 0.01 * (i % 11));
+			order.amount = Units::ExToIn(1.0 + i % 3);
+			messages.push_back(order);
+		}
+
+		Message cancelAll;
+		cancelAll.messageType = MessageType::CancelAllOrders;
+		cancelAll.userId = SellUserId();
+		messages.push_back(cancelAll);
+		return messages;
+	}
+
+	// Sends the input to the replica a batch at a time, waiting for it to catch up each time
+	void Replicate(ReplicationSender& sender, Replica& replica, const std::vector<Message>& messages) {
+		for (size_t i = 0; i < messages.size(); ++i) {
+			sender.Process(primary, messages[i], &output);
+			if (i % 5 == 4 || i + 1 == messages.size()) {
+				sender.Flush();
+				while (replica.GetSequence() < sender.GetSequence()) {
+					replica.Poll(1s);
+				}
+			}
+		}
+	}
+};
+}
+
+TEST_F(ReplicationTest, followsPrimary) {
+	auto config = MakeConfig(7);
+	ReplicationSender sender(primaryFd, config);
+	Replica replica(standby, replicaFd, config);
+
+	auto messages = MakeInput();
+	Replicate(sender, replica, messages);
+	ASSERT_EQ(replica.GetSequence(), messages.size());
+	ASSERT_EQ(replica.GetNumCheckpoints(), messages.size() / 7);
+	ASSERT_TRUE(standby == primary);
+	ASSERT_EQ(standby.GetStateHash(), primary.GetStateHash());
+	ASSERT_FALSE(replica.IsPrimaryGone());
+
+	// Nothing more
+	ASSERT_EQ(replica.Poll(1ms), 0u);
+}
+
+TEST_F(ReplicationTest, failover) {
+	auto config = MakeConfig(0);
+	ReplicationSender sender(primaryFd, config);
+	Replica replica(standby, replicaFd, config);
+
+	auto messages = MakeInput();
+	Replicate(sender, replica, messages);
+
+	// Whatever was sent before the primary went is applied
+	Message deposit;
+	deposit.messageType = MessageType::Deposit;
+	deposit.coinId = CreateCoinPair().GetCoinId();
+	deposit.userId = BuyUserId();
+	deposit.amount = Units::ExToIn(5.0);
+	sender.Process(primary, deposit, &output);
+	sender.Flush();
+	sender.Wait();
+	ps::CloseSocket(primaryFd);
+	primaryFd = -1;
+
+	while (!replica.IsPrimaryGone()) {
+		replica.Poll(1s);
+	}
+	ASSERT_EQ(replica.GetSequence(), messages.size() + 1);
+	ASSERT_TRUE(standby == primary);
+
+	// The standby carries on where the primary left off, with the same ids
+	Message order;
+	order.messageType = MessageType::LimitOrder;
+	order.coinId = CreateCoinPair().GetCoinId();
+	order.baseId = CreateCoinPair().GetBaseId();
+	order.userId = SellUserId();
+	order.isBuy = false;
+	order.price = Units::ExToIn(0.9);
+	order.amount = Units::ExToIn(1.0);
+	auto primaryOutput = primary.Process(order);
+	auto standbyOutput = standby.Process(order);
+	ASSERT_EQ(standbyOutput.size(), primaryOutput.size());
+	ASSERT_EQ(standbyOutput.at(0).orderId, primaryOutput.at(0).orderId);
+}
+
+TEST_F(ReplicationTest, divergedState) {
+	auto config = MakeConfig(1);
+	ReplicationSender sender(primaryFd, config);
+	Replica replica(standby, replicaFd, config);
+
+	// Something only the standby has, which doesn't change the output of what follows
+	standby.Process(ToMessages(CreateWalletManager()).front());
+
+	sender.Process(primary, MakeInput().back(), &output);
+	sender.Flush();
+	try {
+		replica.Poll(1s);
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::ReplicaDiverged);
+	}
+}
+
+TEST_F(ReplicationTest, divergedOutput) {
+	auto config = MakeConfig(0);
+	ReplicationSender sender(primaryFd, config);
+	Replica replica(standby, replicaFd, config);
+
+	auto messages = MakeInput();
+	auto order = std::find_if(messages.begin(), messages.end(), [](const Message& message) { return message.messageType == MessageType::LimitOrder; });
+	Replicate(sender, replica, std::vector<Message>(messages.begin(), order));
+
+	// Only the standby has an order to cancel
+	auto sell = *(order + 1);
+	ASSERT_FALSE(sell.isBuy);
+	standby.Process(sell);
+	auto cancelAll = messages.back();
+	cancelAll.fullUpdate = true;
+	sender.Process(primary, cancelAll, &output);
+	sender.Flush();
+	try {
+		replica.Poll(1s);
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::ReplicaDiverged);
+	}
+	ASSERT_EQ(replica.GetSequence(), sender.GetSequence());
+}
+
+// The same order types, but the trade is at another price
+TEST_F(ReplicationTest, divergedPrice) {
+	auto config = MakeConfig(0);
+	ReplicationSender sender(primaryFd, config);
+	Replica replica(standby, replicaFd, config);
+
+	auto messages = MakeInput();
+	auto order = std::find_if(messages.begin(), messages.end(), [](const Message& message) { return message.messageType == MessageType::LimitOrder; });
+	Replicate(sender, replica, std::vector<Message>(messages.begin(), order));
+
+	auto sell = *(order + 1);
+	primary.Process(sell);
+	sell.price -= Units::ExToIn(0.01);
+	standby.Process(sell);
+
+	auto buy = *order;
+	buy.price = Units::ExToIn(0.6);
+	sender.Process(primary, buy, &output);
+	sender.Flush();
+	try {
+		replica.Poll(1s);
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::ReplicaDiverged);
+	}
+}
+
+// The same trade, but the standby charges another fee for it
+TEST_F(ReplicationTest, divergedFees) {
+	auto config = MakeConfig(0);
+	ReplicationSender sender(primaryFd, config);
+	Replica replica(standby, replicaFd, config);
+
+	auto messages = MakeInput();
+	auto order = std::find_if(messages.begin(), messages.end(), [](const Message& message) { return message.messageType == MessageType::LimitOrder; });
+	Replicate(sender, replica, std::vector<Message>(messages.begin(), order));
+
+	auto sell = *(order + 1);
+	primary.Process(sell);
+	standby.Process(sell);
+	standby.GetMarketManager().GetMarket(CreateCoinPair())->SetFeePercentage(0.2);
+
+	auto buy = *order;
+	buy.price = Units::ExToIn(0.6);
+	sender.Process(primary, buy, &output);
+	sender.Flush();
+	try {
+		replica.Poll(1s);
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::ReplicaDiverged);
+	}
+}
+
+// The engine carries on while the replica is behind, rather than waiting for it to read
+TEST_F(ReplicationTest, replicaBehind) {
+	auto config = MakeConfig(100);
+	ReplicationSender sender(primaryFd, config);
+	Replica replica(standby, replicaFd, config);
+
+	// Far more than the socket holds
+	auto messages = MakeInput();
+	Message deposit;
+	deposit.messageType = MessageType::Deposit;
+	deposit.coinId = CreateCoinPair().GetCoinId();
+	deposit.userId = BuyUserId();
+	deposit.amount = 1;
+	messages.insert(messages.end(), 20000, deposit);
+	for (const auto& message : messages) {
+		sender.Process(primary, message, &output);
+		sender.Flush();
+	}
+
+	while (replica.GetSequence() < sender.GetSequence()) {
+		replica.Poll(1s);
+	}
+	sender.Wait();
+	ASSERT_EQ(replica.GetNumCheckpoints(), messages.size() / 100);
+	ASSERT_EQ(standby.GetStateHash(), primary.GetStateHash());
+}
+
+TEST_F(ReplicationTest, replicaGone) {
+	ReplicationSender sender(primaryFd, MakeConfig(0));
+	ps::CloseSocket(replicaFd);
+	replicaFd = -1;
+
+	sender.Process(primary, MakeInput().front(), &output);
+	sender.Flush();
+	ASSERT_THROW(sender.Wait(), Error);
+	ASSERT_THROW(sender.Flush(), Error);
+}
+
+// However the markets and users ended up in their maps
+TEST(StateHash, canonical) {
+	std::vector<CoinPair> coinPairs{ { 1, 2 }, { 3, 2 }, { 1, 5 }, { 2, 7 }, { 4, 9 } };
+	auto addMarkets = [](TradingEngine& tradingEngine, const std::vector<CoinPair>& coinPairs, int64_t price) {
+		auto& marketManager = tradingEngine.GetMarketManager();
+		for (const auto& coinPair : coinPairs) {
+			marketManager.AddMarket({ std::make_unique<Listener>(), coinPair, CreateMarketConfig() });
+			marketManager.GetMarket(coinPair)->ForceAddOrder<OrderAction::Sell>(OrderContainer<LimitOrder>{ { 8, 100, 0 }, price });
+		}
+	};
+
+	TradingEngine tradingEngine;
+	addMarkets(tradingEngine, coinPairs, 50);
+	TradingEngine reversed;
+	addMarkets(reversed, { coinPairs.rbegin(), coinPairs.rend() }, 50);
+	ASSERT_TRUE(tradingEngine == reversed);
+	ASSERT_EQ(tradingEngine.GetStateHash(), reversed.GetStateHash());
+
+	TradingEngine otherPrice;
+	addMarkets(otherPrice, coinPairs, 51);
+	ASSERT_NE(tradingEngine.GetStateHash(), otherPrice.GetStateHash());
+}
+
+// What the next order and trade will get and the market's config are part of the state too
+TEST(StateHash, idsAndConfig) {
+	auto addMarket = [](TradingEngine& tradingEngine) {
+		tradingEngine.GetMarketManager().AddMarket({ std::make_unique<Listener>(), CreateCoinPair(), CreateMarketConfig() });
+		return tradingEngine.GetMarketManager().GetMarket(CreateCoinPair());
+	};
+
+	TradingEngine tradingEngine;
+	addMarket(tradingEngine);
+	TradingEngine otherOrderId;
+	addMarket(otherOrderId)->SetMaxOrderId(40);
+	TradingEngine otherTradeId;
+	addMarket(otherTradeId)->SetMaxTradeId(40);
+	TradingEngine otherConfig;
+	addMarket(otherConfig)->SetMaxNumLimitOpenOrders(7);
+
+	auto stateHash = tradingEngine.GetStateHash();
+	for (auto other : { &otherOrderId, &otherTradeId, &otherConfig }) {
+		ASSERT_NE(other->GetStateHash(), stateHash);
+	}
+}
+
+TEST_F(ReplicationTest, missingInput) {
+	auto config = MakeConfig(0);
+	ReplicationSender sender(primaryFd, config, 5);
+	Replica replica(standby, replicaFd, config, 3);
+
+	sender.Process(primary, MakeInput().back(), &output);
+	sender.Flush();
+	try {
+		replica.Poll(1s);
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::ReplicaDiverged);
+	}
+}
+
+// The standby in its own process, as it would be run
+TEST_F(ReplicationTest, forkedReplica) {
+	auto messages = MakeInput();
+	auto config = MakeConfig(10);
+	auto pid = ps::ForkProcess([&]() {
+		ps::CloseSocket(primaryFd);
+		TradingEngine engine;
+		Replica replica(engine, replicaFd, config);
+		while (!replica.IsPrimaryGone()) {
+			replica.Poll(1s);
+		}
+
+		// Passes back the state hash, as far as an exit code can
+		return static_cast<int>(engine.GetStateHash() & 0x7f);
+	});
+	if (pid == -1) {
+		GTEST_SKIP();
+	}
+
+	ReplicationSender sender(primaryFd, config);
+	for (const auto& message : messages) {
+		sender.Process(primary, message, &output);
+	}
+	sender.Flush();
+	sender.Wait();
+	ps::CloseSocket(primaryFd);
+	primaryFd = -1;
+
+	int exitCode;
+	ASSERT_TRUE(ps::ReapProcess(pid, true, &exitCode));
+	ASSERT_EQ(exitCode, static_cast<int>(primary.GetStateHash() & 0x7f));
+}
@@ -0,0 +1,396 @@
+#include "StubListener.h"
+
+#include <TradingEngine/Address.h>
+#include <TradingEngine/CoinPair.h>
+#include <TradingEngine/Error.h>
+#include <TradingEngine/Market.h>
+#include <TradingEngine/MarketManager.h>
+#include <TradingEngine/Orders/LimitOrder.h>
+#include <TradingEngine/Orders/OrderAction.h>
+#include <TradingEngine/Orders/OrderContainer.h>
+#include <TradingEngine/SectionedSnapshot.h>
+#include <TradingEngine/TradingEngine.h>
+#include <TradingEngine/Units.h>
+#include <TradingEngine/Wallet.h>
+#include <TradingEngine/WalletManager.h>
+#include <atomic>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/serialization/unordered_map.hpp>
+#include <boost/serialization/vector.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The real ones live with the rest of the serializer, these are just enough to check where the
+// wallets and markets end up, and who has orders in them
+namespace boost::serialization {
+
+template <class Archive>
+void serialize(Archive& ar, PriceOrderId& priceOrderId, const unsigned int version) {
+	ar& priceOrderId.price;
+	ar& priceOrderId.orderId;
+}
+
+template <class Archive>
+void serialize(Archive& ar, UserOrders& userOrders, const unsigned int version) {
+	ar& userOrders.buyLimitPrices;
+	ar& userOrders.sellLimitPrices;
+	ar& userOrders.buyStopLimitPrices;
+	ar& userOrders.sellStopLimitPrices;
+}
+
+template <class Archive>
+void serialize(Archive& ar, Address& address, const unsigned int version) {
+	ar& address.userId;
+	ar& address.totalBalance;
+	ar& address.numInOrder;
+}
+
+template <class Archive>
+void serialize(Archive& ar, CoinPair& coinPair, const unsigned int version) {
+	ar& coinPair.coinId;
+	ar& coinPair.baseId;
+}
+
+template <class Archive>
+void serialize(Archive& ar, Market& market, const unsigned int version) {
+	ar& market.coinPair;
+	ar& market.book->userOrderMap;
+	ar& market.book->currentOrderId;
+	ar& market.book->currentTradeId;
+	ar& market.config.feeDivision;
+	ar& market.config.maxNumLimitOpenOrders;
+	ar& market.config.maxNumStopLimitOpenOrders;
+}
+
+template <class Archive>
+void serialize(Archive& ar, MarketManager& marketManager, const unsigned int version) {
+	ar& marketManager.marketsMap;
+}
+
+template <class Archive>
+void serialize(Archive& ar, WalletManager& walletManager, const unsigned int version) {
+	ar& walletManager.wallets;
+}
+}
+
+MarketConfig createStubMarketConfig();
+
+namespace {
+const std::string snapshotPath = "test_sectioned_snapshot.bin";
+}
+
+TEST(SectionedSnapshot, roundTrip) {
+	std::string walletData = "wallet";
+	std::string marketData(100000, 'm');
+	std::vector<SnapshotSection> sections{
+		{ SnapshotSection::Type::Wallet, 1, 0, 0, walletData },
+		{ SnapshotSection::Type::Market, 1, 2, 0xdeadbeef, marketData, { 4, 9 } },
+		{ SnapshotSection::Type::Market, 3, 2, 5, {} }
+	};
+	WriteSectionedSnapshot(snapshotPath, 7, sections);
+
+	SectionedSnapshot snapshot;
+	ReadSectionedSnapshot(snapshotPath, &snapshot);
+	ASSERT_EQ(snapshot.deltaSequence, 7u);
+	ASSERT_EQ(snapshot.sections.size(), 3u);
+	for (size_t i = 0; i < sections.size(); ++i) {
+		ASSERT_EQ(snapshot.sections[i].type, sections[i].type);
+		ASSERT_EQ(snapshot.sections[i].coinId, sections[i].coinId);
+		ASSERT_EQ(snapshot.sections[i].baseId, sections[i].baseId);
+		ASSERT_EQ(snapshot.sections[i].stateHash, sections[i].stateHash);
+		ASSERT_EQ(snapshot.sections[i].data, sections[i].data);
+		ASSERT_EQ(snapshot.sections[i].userIds, sections[i].userIds);
+	}
+
+	std::remove(snapshotPath.c_str());
+}
+
+TEST(SectionedSnapshot, malformed) {
+	SectionedSnapshot snapshot;
+	ASSERT_THROW(ReadSectionedSnapshot("no_such_snapshot.bin", &snapshot), Error);
+
+	{
+		std::ofstream file(snapshotPath, std::ios::binary | std::ios::trunc);
+		file << "not a snapshot at all, but long enough for a header";
+	}
+	ASSERT_THROW(ReadSectionedSnapshot(snapshotPath, &snapshot), Error);
+
+	// Cut off part way through the data
+	std::string data(1000, 'x');
+	WriteSectionedSnapshot(snapshotPath, 0, { { SnapshotSection::Type::Wallet, 1, 0, 0, data } });
+	std::string contents;
+	{
+		std::ifstream file(snapshotPath, std::ios::binary);
+		contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	{
+		std::ofstream file(snapshotPath, std::ios::binary | std::ios::trunc);
+		file.write(contents.data(), contents.size() - 1);
+	}
+
+	try {
+		ReadSectionedSnapshot(snapshotPath, &snapshot);
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::SnapshotFailed);
+	}
+
+	std::remove(snapshotPath.c_str());
+}
+
+TEST(SectionedSnapshot, runInParallel) {
+	std::vector<std::atomic<int>> numRuns(100);
+	RunInParallel(numRuns.size(), 4, [&numRuns](size_t i) { ++numRuns[i]; });
+	for (const auto& runs : numRuns) {
+		ASSERT_EQ(runs, 1);
+	}
+
+	// Nothing to do
+	RunInParallel(0, 0, [](size_t) { FAIL(); });
+
+	// The other tasks still finish before it is rethrown
+	std::atomic<int> numFinished{ 0 };
+	ASSERT_THROW(RunInParallel(10, 3, [&numFinished](size_t i) {
+		if (i == 5) {
+			throw std::runtime_error("failed");
+		}
+		++numFinished;
+	}),
+	std::runtime_error);
+	ASSERT_EQ(numFinished, 9);
+}
+
+TEST(SectionedSnapshot, saveAndLoad) {
+	TradingEngine tradingEngine;
+	auto& walletManager = tradingEngine.GetWalletManager();
+	for (int32_t coinId = 1; coinId <= 8; ++coinId) {
+		walletManager.AddWallet({ coinId });
+		for (int32_t userId = 1; userId <= 50; ++userId) {
+			walletManager.GetWallet(coinId)->Deposit(userId, Units::ExToIn(1.0) * coinId + userId);
+		}
+	}
+
+	auto& marketManager = tradingEngine.GetMarketManager();
+	std::vector<CoinPair> coinPairs{ { 1, 2 }, { 3, 2 }, { 4, 2 }, { 1, 5 } };
+	for (const auto& coinPair : coinPairs) {
+		marketManager.AddMarket({ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() });
+	}
+	tradingEngine.SaveSections<boost::archive::text_oarchive>(snapshotPath, 4);
+
+	SectionedSnapshot snapshot;
+	ReadSectionedSnapshot(snapshotPath, &snapshot);
+	ASSERT_EQ(snapshot.sections.size(), 13u);
+	ASSERT_EQ(snapshot.sections[7].type, SnapshotSection::Type::Wallet);
+	ASSERT_EQ(snapshot.sections[7].coinId, 8);
+	ASSERT_EQ(snapshot.sections[8].type, SnapshotSection::Type::Market);
+	ASSERT_EQ(snapshot.sections[12].type, SnapshotSection::Type::UserFeeTiers);
+
+	TradingEngine restored;
+	restored.LoadSections<boost::archive::text_iarchive>(snapshotPath, 4);
+	ASSERT_EQ(restored.GetWalletManager(), walletManager);
+	for (const auto& coinPair : coinPairs) {
+		ASSERT_EQ(restored.GetMarketManager().GetMarket(coinPair)->GetCoinPair(), coinPair);
+	}
+
+	// The totals are rebuilt for the restored addresses
+	auto wallet = restored.GetWalletManager().GetWallet(3);
+	auto total = walletManager.GetWallet(3)->GetTotal();
+	ASSERT_EQ(wallet->GetTotal(), total);
+	wallet->Deposit(1, 1);
+	ASSERT_EQ(wallet->GetTotal(), total + 1);
+
+	std::remove(snapshotPath.c_str());
+}
+
+TEST(SectionedSnapshot, loadLazily) {
+	TradingEngine tradingEngine;
+	tradingEngine.GetWalletManager().AddWallet({ 2 });
+	std::vector<CoinPair> coinPairs{ { 1, 2 }, { 3, 2 }, { 1, 5 } };
+	for (const auto& coinPair : coinPairs) {
+		tradingEngine.GetMarketManager().AddMarket({ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() });
+	}
+	tradingEngine.GetMarketManager().GetMarket({ 3, 2 })->ForceAddOrder<OrderAction::Sell>(OrderContainer<LimitOrder>{ { 8, 100, 0 }, 50 });
+	tradingEngine.SaveSections<boost::archive::text_oarchive>(snapshotPath);
+
+	TradingEngine restored;
+	restored.LoadSectionsLazily<boost::archive::text_iarchive>(snapshotPath, { { 1, 5 } }, 2);
+	ASSERT_EQ(restored.GetWalletManager(), tradingEngine.GetWalletManager());
+
+	// Known from the index, before the market is decoded
+	ASSERT_EQ(restored.GetMarketManager().GetUserMarkets().at(8), std::vector<CoinPair>{ CoinPair(3, 2) });
+
+	// The snapshot file isn't needed any more, the loaders keep what they decode from
+	std::remove(snapshotPath.c_str());
+	auto& marketManager = restored.GetMarketManager();
+	for (const auto& coinPair : coinPairs) {
+		ASSERT_EQ(marketManager.GetMarket(coinPair)->GetCoinPair(), coinPair);
+	}
+	ASSERT_EQ(marketManager.GetNumPendingMarkets(), 0u);
+}
+
+// Markets which are still pending are hydrated rather than left out
+TEST(SectionedSnapshot, saveBeforeWarmedUp) {
+	TradingEngine tradingEngine;
+	tradingEngine.GetWalletManager().AddWallet({ 2 });
+	std::vector<CoinPair> coinPairs{ { 1, 2 }, { 3, 2 }, { 1, 5 }, { 4, 5 } };
+	for (const auto& coinPair : coinPairs) {
+		tradingEngine.GetMarketManager().AddMarket({ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() });
+	}
+	tradingEngine.GetMarketManager().GetMarket({ 4, 5 })->ForceAddOrder<OrderAction::Sell>(OrderContainer<LimitOrder>{ { 8, 100, 0 }, 50 });
+	tradingEngine.SaveSections<boost::archive::text_oarchive>(snapshotPath);
+
+	// Saved again straight away, while the warm-up is still going (or yet to start)
+	TradingEngine lazy;
+	lazy.LoadSectionsLazily<boost::archive::text_iarchive>(snapshotPath, { { 1, 5 } });
+	std::stringstream stream;
+	{
+		boost::archive::text_oarchive archive(stream);
+		archive << lazy;
+	}
+	lazy.SaveSections<boost::archive::text_oarchive>(snapshotPath);
+	ASSERT_EQ(lazy.GetMarketManager().GetNumPendingMarkets(), 0u);
+
+	TradingEngine fromSections;
+	fromSections.LoadSections<boost::archive::text_iarchive>(snapshotPath);
+	std::remove(snapshotPath.c_str());
+
+	TradingEngine fromArchive;
+	{
+		boost::archive::text_iarchive archive(stream);
+		archive >> fromArchive;
+	}
+
+	for (auto restored : { &fromSections, &fromArchive }) {
+		auto& marketManager = restored->GetMarketManager();
+		ASSERT_EQ(marketManager.GetNumPendingMarkets(), 0u);
+		ASSERT_EQ(marketManager.GetMarkets().at(2).size(), 2u);
+		ASSERT_EQ(marketManager.GetMarkets().at(5).size(), 2u);
+		ASSERT_EQ(marketManager.GetUserMarkets().at(8), std::vector<CoinPair>{ CoinPair(4, 5) });
+	}
+}
+
+// The markets a lazy load hasn't hydrated yet are hashed from their sections, rather than hydrated
+TEST(SectionedSnapshot, stateHashOfPendingMarkets) {
+	TradingEngine tradingEngine;
+	tradingEngine.GetWalletManager().AddWallet({ 2 });
+	tradingEngine.GetWalletManager().GetWallet(2)->Deposit(8, 100);
+	for (const auto& coinPair : std::vector<CoinPair>{ { 1, 2 }, { 3, 2 }, { 1, 5 } }) {
+		tradingEngine.GetMarketManager().AddMarket({ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() });
+	}
+	tradingEngine.GetMarketManager().GetMarket({ 3, 2 })->SetMaxOrderId(40);
+	tradingEngine.GetMarketManager().GetMarket({ 1, 5 })->SetFeeTier(1, 0.05, 0.2);
+	tradingEngine.SaveSections<boost::archive::text_oarchive>(snapshotPath);
+
+	TradingEngine lazy;
+	lazy.LoadSectionsLazily<boost::archive::text_iarchive>(snapshotPath, {});
+	std::remove(snapshotPath.c_str());
+
+	ASSERT_EQ(lazy.GetStateHash(), tradingEngine.GetStateHash());
+	ASSERT_EQ(lazy.GetMarketManager().GetNumPendingMarkets(), 3u);
+
+	// The same once they are
+	lazy.GetMarketManager().HydrateAll();
+	ASSERT_EQ(lazy.GetStateHash(), tradingEngine.GetStateHash());
+}
+
+// The per user market index isn't serialized, it's rebuilt from the markets
+TEST(SectionedSnapshot, restoreIndexesUsers) {
+	TradingEngine tradingEngine;
+	tradingEngine.GetMarketManager().AddMarket({ std::make_unique<StubListener>(), { 1, 2 }, createStubMarketConfig() });
+	tradingEngine.GetMarketManager().GetMarket({ 1, 2 })->ForceAddOrder<OrderAction::Buy>(OrderContainer<LimitOrder>{ { 8, 100, 0 }, 50 });
+
+	std::stringstream stream;
+	{
+		boost::archive::text_oarchive archive(stream);
+		archive << tradingEngine;
+	}
+
+	TradingEngine restored;
+	{
+		boost::archive::text_iarchive archive(stream);
+		archive >> restored;
+	}
+	ASSERT_EQ(restored.GetMarketManager().GetUserMarkets().at(8), std::vector<CoinPair>{ CoinPair(1, 2) });
+}
+
+// Neither the markets' archives nor the manager's have the fees, every kind of snapshot carries them
+TEST(SectionedSnapshot, fees) {
+	TradingEngine tradingEngine;
+	TradingEngine base;
+	for (const auto& coinPair : std::vector<CoinPair>{ { 1, 2 }, { 3, 2 } }) {
+		tradingEngine.GetMarketManager().AddMarket({ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() });
+		base.GetMarketManager().AddMarket({ std::make_unique<StubListener>(), coinPair, createStubMarketConfig() });
+	}
+	tradingEngine.ClearModified();
+
+	auto& marketManager = tradingEngine.GetMarketManager();
+	marketManager.SetFeeTier(1, 0.05, 0.2);
+	marketManager.GetMarket({ 3, 2 })->SetFeeTier(2, 0.01, 0.02);
+	marketManager.SetUserFeeTier(8, 1);
+	marketManager.SetUserFeeTier(9, 2);
+	auto expectFees = [&tradingEngine](TradingEngine& restored) {
+		for (const auto& coinPair : std::vector<CoinPair>{ { 1, 2 }, { 3, 2 } }) {
+			ASSERT_EQ(restored.GetMarketManager().GetMarket(coinPair)->GetFeeSchedule(),
+			tradingEngine.GetMarketManager().GetMarket(coinPair)->GetFeeSchedule());
+		}
+		ASSERT_EQ(restored.GetMarketManager().GetUserFeeTiers(), tradingEngine.GetMarketManager().GetUserFeeTiers());
+		ASSERT_EQ(restored.GetStateHash(), tradingEngine.GetStateHash());
+	};
+
+	// The fees are part of the state
+	ASSERT_NE(base.GetStateHash(), tradingEngine.GetStateHash());
+
+	// The stub markets can't be copied once loaded (they have no listener), so the delta applied
+	// is the one taken and the loaded one is only compared with it
+	auto delta = tradingEngine.TakeDelta();
+	std::stringstream deltaStream;
+	{
+		boost::archive::text_oarchive archive(deltaStream);
+		archive << delta;
+	}
+	SnapshotDelta loadedDelta;
+	{
+		boost::archive::text_iarchive archive(deltaStream);
+		archive >> loadedDelta;
+	}
+	ASSERT_EQ(loadedDelta.markets.size(), 2u);
+	for (size_t i = 0; i < delta.markets.size(); ++i) {
+		ASSERT_EQ(loadedDelta.markets[i].GetFeeSchedule(), delta.markets[i].GetFeeSchedule());
+	}
+	ASSERT_EQ(loadedDelta.userFeeTiers, delta.userFeeTiers);
+
+	base.ApplyDelta(delta);
+	expectFees(base);
+	ASSERT_FALSE(tradingEngine.TakeDelta().userFeeTiers);
+
+	std::stringstream stream;
+	{
+		boost::archive::text_oarchive archive(stream);
+		archive << tradingEngine;
+	}
+	TradingEngine fromArchive;
+	{
+		boost::archive::text_iarchive archive(stream);
+		archive >> fromArchive;
+	}
+	expectFees(fromArchive);
+
+	tradingEngine.SaveSections<boost::archive::text_oarchive>(snapshotPath);
+	TradingEngine fromSections;
+	fromSections.LoadSections<boost::archive::text_iarchive>(snapshotPath);
+	expectFees(fromSections);
+
+	TradingEngine lazy;
+	lazy.LoadSectionsLazily<boost::archive::text_iarchive>(snapshotPath, {});
+	std::remove(snapshotPath.c_str());
+	expectFees(lazy);
+}
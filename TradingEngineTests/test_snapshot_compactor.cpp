@@ -0,0 +1,48 @@
+#include <TradingEngine/Error.h>
+#include <TradingEngine/SnapshotCompactor.h>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/serialization/vector.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace {
+std::string GetSnapshotPath() {
+	return testing::TempDir() + "snapshot_compactor_test";
+}
+}
+
+TEST(SnapshotCompactor, saveAndLoad) {
+	auto path = GetSnapshotPath();
+	std::vector<int64_t> values{ 1, 2, 3 };
+
+	// The text archive only finishes writing when it is destroyed
+	SaveSnapshot<boost::archive::text_oarchive>(path, values);
+	ASSERT_FALSE(std::ifstream(path + ".tmp").good());
+
+	std::vector<int64_t> loaded;
+	LoadSnapshot<boost::archive::text_iarchive>(path, &loaded);
+	ASSERT_EQ(loaded, values);
+	std::remove(path.c_str());
+}
+
+TEST(SnapshotCompactor, failed) {
+	std::vector<int64_t> values{ 1, 2, 3 };
+	try {
+		SaveSnapshot<boost::archive::text_oarchive>(GetSnapshotPath() + "/missing/directory", values);
+		FAIL() << "Expected an error";
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::SnapshotFailed);
+	}
+
+	try {
+		LoadSnapshot<boost::archive::text_iarchive>(GetSnapshotPath() + "/missing/directory", &values);
+		FAIL() << "Expected an error";
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::SnapshotFailed);
+	}
+}
@@ -0,0 +1,139 @@
+#include "message_conversion_testing_helper.h"
+
+#include <TradingEngine/Error.h>
+#include <TradingEngine/Message.h>
+#include <TradingEngine/MessageType.h>
+#include <TradingEngine/SnapshotDelta.h>
+#include <TradingEngine/TradingEngine.h>
+#include <TradingEngine/Units.h>
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <utility>
+#include <vector>
+
+namespace {
+void CreateEngine(TradingEngine* tradingEngine) {
+	for (const auto& message : CreateSimpleMessages()) {
+		(void)tradingEngine->Process(message);
+	}
+	tradingEngine->ClearModified();
+}
+
+Message CreateLimitOrderMessage(bool isBuy, int32_t userId, double price) {
+	Message message;
+	message.messageType = MessageType::LimitOrder;
+	message.isBuy = isBuy;
+	message.coinId = CreateCoinPair().GetCoinId();
+	message.baseId = CreateCoinPair().GetBaseId();
+	message.userId = userId;
+	message.amount = Units::ExToIn(100.0);
+	message.price = Units::ExToIn(price);
+	return message;
+}
+
+std::vector<int32_t> GetUserIds(const SnapshotDelta& delta, int32_t coinId) {
+	auto walletDelta = std::find_if(delta.wallets.begin(), delta.wallets.end(), [coinId](const auto& walletDelta) {
+		return (walletDelta.coinId == coinId);
+	});
+
+	std::vector<int32_t> userIds;
+	for (const auto& address : walletDelta->addresses) {
+		userIds.push_back(address.GetUserId());
+	}
+	return userIds;
+}
+}
+
+class SnapshotDeltas : public ::testing::Test {
+protected:
+	TradingEngine tradingEngine;
+
+	void SetUp() override {
+		CreateEngine(&tradingEngine);
+	}
+};
+
+TEST_F(SnapshotDeltas, onlyChanges) {
+	auto delta = tradingEngine.TakeDelta();
+	ASSERT_EQ(delta.baseSequence, 0u);
+	ASSERT_EQ(delta.sequence, 1u);
+	ASSERT_TRUE(delta.markets.empty());
+	ASSERT_EQ(delta.wallets.size(), 4u);
+	for (const auto& walletDelta : delta.wallets) {
+		ASSERT_TRUE(walletDelta.addresses.empty());
+	}
+
+	// Trades with the sell at 0.6, so both users change in both wallets of the market
+	(void)tradingEngine.Process(CreateLimitOrderMessage(true, BuyUserId(), 0.6));
+
+	delta = tradingEngine.TakeDelta();
+	ASSERT_EQ(delta.baseSequence, 1u);
+	ASSERT_EQ(delta.markets.size(), 1u);
+	ASSERT_EQ(delta.markets.front().GetCoinPair(), CreateCoinPair());
+	ASSERT_EQ(GetUserIds(delta, CreateCoinPair().GetBaseId()), (std::vector<int32_t>{ 6, 7 }));
+	ASSERT_EQ(GetUserIds(delta, CreateCoinPair().GetCoinId()), (std::vector<int32_t>{ 6, 7 }));
+	ASSERT_TRUE(GetUserIds(delta, CreateAnotherCoinPair().GetBaseId()).empty());
+
+	// A deposit only touches the one address
+	Message deposit;
+	deposit.messageType = MessageType::Deposit;
+	deposit.coinId = CreateCoinPair().GetCoinId();
+	deposit.userId = 8;
+	deposit.amount = Units::ExToIn(5.0);
+	(void)tradingEngine.Process(deposit);
+
+	delta = tradingEngine.TakeDelta();
+	ASSERT_TRUE(delta.markets.empty());
+	ASSERT_EQ(GetUserIds(delta, CreateCoinPair().GetCoinId()), (std::vector<int32_t>{ 8 }));
+	ASSERT_TRUE(GetUserIds(delta, CreateCoinPair().GetBaseId()).empty());
+}
+
+TEST_F(SnapshotDeltas, chain) {
+	TradingEngine restored;
+	CreateEngine(&restored);
+
+	(void)tradingEngine.Process(CreateLimitOrderMessage(true, BuyUserId(), 0.6));
+	(void)tradingEngine.Process(CreateLimitOrderMessage(false, SellUserId(), 0.55));
+	auto delta1 = tradingEngine.TakeDelta();
+
+	Message newCoin;
+	newCoin.messageType = MessageType::NewCoin;
+	newCoin.coinId = 5;
+	(void)tradingEngine.Process(newCoin);
+
+	Message deposit;
+	deposit.messageType = MessageType::Deposit;
+	deposit.coinId = 5;
+	deposit.userId = BuyUserId();
+	deposit.amount = Units::ExToIn(5.0);
+	(void)tradingEngine.Process(deposit);
+	(void)tradingEngine.Process(CreateLimitOrderMessage(true, BuyUserId(), 0.45));
+	auto delta2 = tradingEngine.TakeDelta();
+
+	// Has to follow on
+	ASSERT_THROW(restored.ApplyDelta(delta2), Error);
+
+	TradingEngine merged;
+	CreateEngine(&merged);
+
+	restored.ApplyDelta(delta1);
+	restored.ApplyDelta(delta2);
+	ASSERT_EQ(restored, tradingEngine);
+	ASSERT_TRUE(restored.InOrderMatchesReservations());
+
+	auto mergedDelta = delta1;
+	ASSERT_THROW(mergedDelta.Merge(SnapshotDelta(delta1)), Error);
+	mergedDelta.Merge(std::move(delta2));
+	ASSERT_EQ(mergedDelta.sequence, 2u);
+	ASSERT_EQ(mergedDelta.markets.size(), 1u);
+
+	merged.ApplyDelta(mergedDelta);
+	ASSERT_EQ(merged, tradingEngine);
+
+	// Later deltas carry on from either
+	(void)tradingEngine.Process(CreateLimitOrderMessage(false, SellUserId(), 0.65));
+	auto delta3 = tradingEngine.TakeDelta();
+	merged.ApplyDelta(delta3);
+	ASSERT_EQ(merged, tradingEngine);
+}
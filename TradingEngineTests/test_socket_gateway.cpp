@@ -0,0 +1,238 @@
+#include "message_conversion_testing_helper.h"
+
+#include <TradingEngine/Error.h>
+#include <TradingEngine/Message.h>
+#include <TradingEngine/MessageType.h>
+#include <TradingEngine/SocketGateway.h>
+#include <TradingEngine/TradingEngine.h>
+#include <TradingEngine/Units.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+const char* socketPath = "test_socket_gateway.sock";
+
+class SocketGatewayTest : public ::testing::Test {
+protected:
+	TradingEngine tradingEngine;
+	std::unique_ptr<SocketGateway> gateway;
+
+	void SetUp() override {
+		SocketGatewayConfig config;
+		config.path = socketPath;
+		config.maxFrameSize = 4096;
+		gateway = std::make_unique<SocketGateway>(tradingEngine, config);
+	}
+
+	// Polls until that many requests have been processed
+	void Process(size_t numRequests) {
+		for (size_t numProcessed = 0; numProcessed < numRequests;) {
+			numProcessed += gateway->Poll(1s);
+		}
+	}
+
+	std::vector<Message> Call(SocketGatewayClient& client, const Message& message) {
+		client.Send(message);
+		Process(1);
+		std::vector<Message> responses;
+		EXPECT_TRUE(client.Receive(&responses, 1s));
+		return responses;
+	}
+
+	Message MakeSell() {
+		Message sell;
+		sell.messageType = MessageType::LimitOrder;
+		sell.coinId = CreateCoinPair().GetCoinId();
+		sell.baseId = CreateCoinPair().GetBaseId();
+		sell.userId = SellUserId();
+		sell.isBuy = false;
+		sell.price = Units::ExToIn(0.5);
+		sell.amount = Units::ExToIn(10.0);
+		return sell;
+	}
+
+	void AddMarket(SocketGatewayClient& client) {
+		for (const auto& message : ToMessages(CreateWalletManager())) {
+			Call(client, message);
+		}
+
+		Message newMarket;
+		newMarket.messageType = MessageType::NewMarket;
+		newMarket.coinId = CreateCoinPair().GetCoinId();
+		newMarket.baseId = CreateCoinPair().GetBaseId();
+		newMarket.feePercentage = 0.1;
+		newMarket.maxNumLimitOpenOrders = 10;
+		newMarket.maxNumStopLimitOpenOrders = 10;
+		ASSERT_EQ(Call(client, newMarket).size(), 1u);
+	}
+};
+}
+
+TEST_F(SocketGatewayTest, tradingEngine) {
+	SocketGatewayClient client(socketPath);
+	AddMarket(client);
+
+	auto sell = MakeSell();
+	auto responses = Call(client, sell);
+	ASSERT_EQ(responses.size(), 1u);
+	ASSERT_EQ(responses[0].messageType, MessageType::NewOpenOrder);
+
+	auto buy = sell;
+	buy.userId = BuyUserId();
+	buy.isBuy = true;
+	responses = Call(client, buy);
+	ASSERT_GT(responses.size(), 1u);
+	ASSERT_NE(std::find_if(responses.begin(), responses.end(), [](const Message& message) { return message.messageType == MessageType::NewTrade; }), responses.end());
+
+	Message invalid;
+	invalid.messageType = MessageType::Last;
+	responses = Call(client, invalid);
+	ASSERT_EQ(responses.size(), 1u);
+	ASSERT_EQ(responses[0].errorCode, static_cast<int>(Error::Type::InvalidMessageType));
+	ASSERT_EQ(gateway->GetNumConnections(), 1u);
+}
+
+// Output with an attachment is encoded rather than gathered from the engine's output
+TEST_F(SocketGatewayTest, attachments) {
+	SocketGatewayClient client(socketPath);
+	AddMarket(client);
+	ASSERT_EQ(Call(client, MakeSell()).size(), 1u);
+
+	Message cancelAll;
+	cancelAll.messageType = MessageType::CancelAllOrders;
+	cancelAll.userId = SellUserId();
+	cancelAll.fullUpdate = true;
+	Message::cancelOrders.clear();
+	auto responses = Call(client, cancelAll);
+	ASSERT_EQ(responses.size(), 1u);
+	ASSERT_EQ(responses[0].messageType, MessageType::CancelAllOrders);
+	ASSERT_EQ(Message::cancelOrders, "3_1_1");
+	Message::cancelOrders.clear();
+
+	// Nothing to cancel and no full update, so an empty response
+	cancelAll.fullUpdate = false;
+	ASSERT_TRUE(Call(client, cancelAll).empty());
+}
+
+// Everything which arrives together, on any connection, is processed as one batch
+TEST_F(SocketGatewayTest, batching) {
+	SocketGatewayClient first(socketPath);
+	SocketGatewayClient second(socketPath);
+	ASSERT_EQ(gateway->Poll(1s), 0u);
+	ASSERT_EQ(gateway->GetNumConnections(), 2u);
+
+	Message invalid;
+	invalid.messageType = MessageType::Last;
+	for (int32_t id = 1; id <= 3; ++id) {
+		invalid.id = id;
+		first.Send(invalid);
+		invalid.id = -id;
+		second.Send(invalid);
+	}
+	ASSERT_EQ(gateway->Poll(1s), 6u);
+	ASSERT_EQ(gateway->GetStats().numBatches, 1u);
+	ASSERT_EQ(gateway->GetStats().maxBatchSize, 6u);
+	ASSERT_EQ(gateway->GetStats().batchLatency.GetCount(), 1u);
+
+	// One write each
+	ASSERT_EQ(gateway->GetStats().numWrites, 2u);
+
+	std::vector<Message> responses;
+	for (int32_t id = 1; id <= 3; ++id) {
+		ASSERT_TRUE(first.Receive(&responses, 1s));
+		ASSERT_EQ(responses.size(), 1u);
+		ASSERT_EQ(responses[0].id, id);
+		ASSERT_TRUE(second.Receive(&responses, 1s));
+		ASSERT_EQ(responses[0].id, -id);
+	}
+}
+
+TEST_F(SocketGatewayTest, partialFrame) {
+	SocketGatewayClient client(socketPath);
+	Message invalid;
+	invalid.messageType = MessageType::Last;
+	invalid.id = 5;
+	GatewayFrameHeader header{ sizeof(Message), 0 };
+	std::vector<char> frame(sizeof(header) + sizeof(Message));
+	std::memcpy(frame.data(), &header, sizeof(header));
+	std::memcpy(frame.data() + sizeof(header), &invalid, sizeof(invalid));
+
+	client.SendRaw(frame.data(), 20);
+	while (gateway->GetNumConnections() == 0) {
+		ASSERT_EQ(gateway->Poll(1s), 0u);
+	}
+	ASSERT_EQ(gateway->Poll(1s), 0u);
+
+	client.SendRaw(frame.data() + 20, frame.size() - 20);
+	ASSERT_EQ(gateway->Poll(1s), 1u);
+	std::vector<Message> responses;
+	ASSERT_TRUE(client.Receive(&responses, 1s));
+	ASSERT_EQ(responses.at(0).id, 5);
+}
+
+TEST_F(SocketGatewayTest, frameTooBig) {
+	SocketGatewayClient client(socketPath);
+	GatewayFrameHeader header{ 1 << 20, 0 };
+	client.SendRaw(&header, sizeof(header));
+	while (gateway->GetStats().numDisconnects == 0) {
+		gateway->Poll(1s);
+	}
+	ASSERT_EQ(gateway->GetNumConnections(), 0u);
+
+	std::vector<Message> responses;
+	try {
+		client.Receive(&responses, 1s);
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::GatewayFailed);
+	}
+}
+
+TEST_F(SocketGatewayTest, closedClient) {
+	{
+		SocketGatewayClient client(socketPath);
+		Message invalid;
+		invalid.messageType = MessageType::Last;
+		client.Send(invalid);
+	}
+
+	// Still processed, with nobody to tell
+	Process(1);
+	while (gateway->GetNumConnections() > 0) {
+		gateway->Poll(1s);
+	}
+	ASSERT_EQ(gateway->GetStats().numDisconnects, 0u);
+}
+
+TEST(SocketGateway, noGateway) {
+	try {
+		SocketGatewayClient client("test_socket_gateway_missing.sock");
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::GatewayFailed);
+	}
+}
+
+TEST(SocketGateway, keepsOtherFiles) {
+	const char* path = "test_socket_gateway_file.sock";
+	std::ofstream(path) << "not a socket";
+	TradingEngine tradingEngine;
+	SocketGatewayConfig config;
+	config.path = path;
+	try {
+		SocketGateway gateway(tradingEngine, config);
+		FAIL();
+	} catch (const Error& error) {
+		ASSERT_EQ(error.GetType(), Error::Type::GatewayFailed);
+	}
+	ASSERT_TRUE(std::ifstream(path).good());
+	std::remove(path);
+}
@@ -45,14 +45,14 @@ void CompareOtherMarket(MarketManager& marketManager, WalletManager& walletManag
 	ASSERT_EQ(market, *marketManager.GetMarket(coinPair));
 
 	// Confirm wallets are unchanged
-	auto CheckBalances = [&walletManager](const auto& coinId, int32_t id) {
+	auto CheckBalances = [&walletManager](const auto& coinId, int32_t id, int64_t inOrder) {
 		auto address = walletManager.GetWallet(coinId)->GetAddress(id);
-		ASSERT_EQ(address->GetInOrder(), GetInOrder());
+		ASSERT_EQ(address->GetInOrder(), inOrder);
 		ASSERT_EQ(address->GetTotalBalance(), GetTotalBalance());
 	};
 
-	CheckBalances(coinPair.GetBaseId(), 6);
-	CheckBalances(coinPair.GetCoinId(), 7);
+	CheckBalances(coinPair.GetBaseId(), 6, GetBuyInOrder());
+	CheckBalances(coinPair.GetCoinId(), 7, GetSellInOrder());
 }
 
 TEST_F(TradingEngineProcessing, Error) {
@@ -329,6 +329,70 @@ TEST_F(TradingEngineProcessing, CancelOrder) {
 	CompareOtherMarket(tradingEngine.GetMarketManager(), tradingEngine.GetWalletManager());
 }
 
+// A cancel only carries the order id, which shares its storage with the user id
+TEST_F(TradingEngineProcessing, CancelOrderOfAnotherId) {
+	Message message;
+	message.messageType = MessageType::LimitOrder;
+	message.isBuy = true;
+	message.coinId = 3;
+	message.baseId = 1;
+	message.userId = BuyUserId();
+	message.amount = Units::ExToIn(1.0);
+	message.price = Units::ExToIn(0.3);
+	ASSERT_EQ(tradingEngine.Process(message).front().errorCode, 0);
+
+	auto market = tradingEngine.GetMarketManager().GetMarket(CreateCoinPair());
+	auto orderId = market->GetBuyLimitOrderMap().at(message.price).front().GetId();
+	ASSERT_NE(orderId, BuyUserId());
+
+	message.messageType = MessageType::CancelOrder;
+	message.orderType = static_cast<int32_t>(OrderType::Limit);
+	message.orderId = orderId;
+	auto outputMessages = tradingEngine.Process(message);
+	ASSERT_EQ(outputMessages.size(), 1u);
+	ASSERT_EQ(outputMessages.front().errorCode, 0);
+	ASSERT_EQ(market->GetBuyLimitOrderMap().count(message.price), 0u);
+
+	auto& walletManager = tradingEngine.GetWalletManager();
+	ASSERT_EQ(walletManager.GetWallet(message.baseId)->GetAddress(BuyUserId())->GetInOrder(), GetBuyInOrder());
+	CompareOtherMarket(tradingEngine.GetMarketManager(), tradingEngine.GetWalletManager());
+}
+
+// Like cancelling, an amend only carries the order id
+TEST_F(TradingEngineProcessing, AmendOrderOfAnotherId) {
+	Message message;
+	message.messageType = MessageType::LimitOrder;
+	message.isBuy = true;
+	message.coinId = 3;
+	message.baseId = 1;
+	message.userId = BuyUserId();
+	message.amount = Units::ExToIn(2.0);
+	message.price = Units::ExToIn(0.3);
+	ASSERT_EQ(tradingEngine.Process(message).front().errorCode, 0);
+
+	auto market = tradingEngine.GetMarketManager().GetMarket(CreateCoinPair());
+	auto orderId = market->GetBuyLimitOrderMap().at(message.price).front().GetId();
+	ASSERT_NE(orderId, BuyUserId());
+
+	auto& walletManager = tradingEngine.GetWalletManager();
+	auto address = walletManager.GetWallet(message.baseId)->GetAddress(BuyUserId());
+	auto inOrder = address->GetInOrder();
+
+	message.messageType = MessageType::AmendOrder;
+	message.orderType = static_cast<int32_t>(OrderType::Limit);
+	message.orderId = orderId;
+	message.newPrice = message.price;
+	message.amount = Units::ExToIn(1.0);
+	auto outputMessages = tradingEngine.Process(message);
+	ASSERT_EQ(outputMessages.size(), 1u);
+	ASSERT_EQ(outputMessages.front().errorCode, 0);
+	ASSERT_EQ(market->GetBuyLimitOrderMap().at(message.price).front().GetAmount(), Units::ExToIn(1.0));
+
+	// Buys hold the notional, 1 at 0.3
+	ASSERT_EQ(address->GetInOrder(), inOrder - Units::ExToIn(0.3));
+	CompareOtherMarket(tradingEngine.GetMarketManager(), tradingEngine.GetWalletManager());
+}
+
 TEST_F(TradingEngineProcessing, CancelAllOrders) {
 	// Clear id 7, which just consists of sell orders..
 	Message message;
@@ -395,7 +459,7 @@ TEST_F(TradingEngineProcessing, ClearOpenOrders) {
 
 	// Should be untouched
 	ASSERT_EQ(walletManager.GetWallet(coinPair.GetBaseId())->GetAddress(6)->GetInOrder(),
-	Units::ExToIn(800.0));
+	GetBuyInOrder());
 	CompareOtherMarket(tradingEngine.GetMarketManager(), tradingEngine.GetWalletManager());
 }
 
@@ -565,7 +629,7 @@ TEST_F(TradingEngineProcessing, GetInOrder) {
 	auto outputMessages = tradingEngine.Process(message);
 	ASSERT_EQ(outputMessages.size(), 1u);
 	ASSERT_EQ(outputMessages.front().errorCode, 0);
-	ASSERT_EQ(outputMessages.front().amount, GetInOrder());
+	ASSERT_EQ(outputMessages.front().amount, GetBuyInOrder());
 }
 
 TEST_F(TradingEngineProcessing, GetTotal) {
@@ -3,6 +3,7 @@
 #include <TradingEngine/Wallet.h>
 #include <gtest/gtest.h>
 #include <iterator>
+#include <utility>
 
 TEST(TestWallet, invalidId) {
 	ASSERT_THROW(Wallet{ -1 }, Error);
@@ -47,3 +48,33 @@ TEST(TestWallet, getAddress) {
 	// Recheck that this works
 	ASSERT_EQ(address, *wallet.GetAddress(userId));
 }
+
+TEST(TestWallet, totals) {
+	Wallet wallet{ 5 };
+
+	Address address{ 500 };
+	address.SetTotalBalance(100);
+	address.SetInOrder(40);
+	wallet.AddAddress(address);
+	wallet.AddAddress(Address{ 1000 });
+	ASSERT_EQ(wallet.GetTotal(), 100);
+	ASSERT_EQ(wallet.GetTotalInOrder(), 40);
+
+	// Changes made through the wallet's addresses are reflected in the totals
+	wallet.GetAddress(1000)->AddToTotalBalance(25);
+	wallet.GetAddress(1000)->AddToInOrder(5);
+	wallet.GetAddress(500)->RemoveFromInOrder(40);
+	ASSERT_EQ(wallet.GetTotal(), 125);
+	ASSERT_EQ(wallet.GetTotalInOrder(), 5);
+
+	// Copies keep their own totals
+	auto copy = wallet;
+	copy.GetAddress(500)->RemoveFromTotalBalance(100);
+	ASSERT_EQ(copy.GetTotal(), 25);
+	ASSERT_EQ(wallet.GetTotal(), 125);
+
+	// Moving keeps the addresses bound
+	auto moved = std::move(wallet);
+	moved.GetAddress(500)->SetTotalBalance(0);
+	ASSERT_EQ(moved.GetTotal(), 25);
+}